@@ -0,0 +1,77 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Writes the assets for the FileEmbed benchmark: COUNT files named
+// assetN.bin of MEGABYTES each, filled by a generator seeded with N so that
+// embed_bench can check every byte without reading them back.
+
+#include "assets.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_WIN32)
+#include <direct.h>
+#define embedMakeDirectory(path) _mkdir(path)
+#else
+#include <sys/stat.h>
+#define embedMakeDirectory(path) mkdir(path, 0777)
+#endif
+
+int main(int argc, char **argv)
+{
+    if (argc != 4)
+    {
+        fprintf(stderr, "usage: embed_assets DIR COUNT MEGABYTES\n");
+        return 2;
+    }
+    const char *dir = argv[1];
+    int count = atoi(argv[2]);
+    size_t size = (size_t)atoi(argv[3]) << 20;
+
+    embedMakeDirectory(dir);
+    uint8_t *buffer = malloc(size);
+    if (!buffer)
+    {
+        return 1;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/asset%d.bin", dir, i);
+        FILE *file = fopen(path, "wb");
+        if (!file)
+        {
+            fprintf(stderr, "could not write %s\n", path);
+            free(buffer);
+            return 1;
+        }
+        embedAssetFill(buffer, size, i);
+        size_t written = fwrite(buffer, 1, size, file);
+        if (fclose(file) != 0 || written != size)
+        {
+            fprintf(stderr, "could not write %s\n", path);
+            free(buffer);
+            return 1;
+        }
+    }
+
+    free(buffer);
+    return 0;
+}
@@ -0,0 +1,35 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BIRCH_EMBED_ASSETS_H
+#define BIRCH_EMBED_ASSETS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The contents of asset index, shared by the generator and the checks
+static inline void embedAssetFill(uint8_t *buffer, size_t size, int index)
+{
+    uint32_t state = 2166136261u ^ (uint32_t)index;
+    for (size_t i = 0; i < size; i++)
+    {
+        state = state * 1664525u + 1013904223u;
+        buffer[i] = (uint8_t)(state >> 24);
+    }
+}
+
+#endif
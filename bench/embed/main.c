@@ -0,0 +1,87 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "assets.h"
+#include "file_embed.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Checks that every generated asset was embedded whole, aligned and findable
+// by name, and how long the lookups take
+int main(void)
+{
+    size_t size = (size_t)EMBED_BENCH_MEGABYTES << 20;
+    uint8_t *expected = malloc(size);
+    if (!expected)
+    {
+        return 1;
+    }
+
+    bool ok = file_embed_asset_count == EMBED_BENCH_FILES;
+    size_t total = 0;
+    for (int i = 0; i < EMBED_BENCH_FILES && ok; i++)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "asset%d.bin", i);
+        const file_embed_asset *asset = file_embed_find(name);
+        if (!asset || asset->size != size || (uintptr_t)asset->data % 16 ||
+            asset->data[size] != 0)
+        {
+            fprintf(stderr, "%s is missing or malformed\n", name);
+            ok = false;
+            break;
+        }
+        embedAssetFill(expected, size, i);
+        if (memcmp(asset->data, expected, size) != 0)
+        {
+            fprintf(stderr, "%s has the wrong contents\n", name);
+            ok = false;
+        }
+        total += asset->size;
+    }
+    free(expected);
+    if (!ok || file_embed_find("missing.bin"))
+    {
+        fprintf(stderr, "embedded assets do not match\n");
+        return 1;
+    }
+
+    int lookups = 1000000;
+    size_t found = 0;
+    clock_t start = clock();
+    for (int i = 0; i < lookups; i++)
+    {
+        found += file_embed_find(file_embed_assets[i % EMBED_BENCH_FILES].name)
+                     ->size;
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    printf(
+        "%d assets, %zu MB embedded and verified\n"
+        "lookup by name: %.1f ns (%zu)\n",
+        EMBED_BENCH_FILES,
+        total >> 20,
+        seconds * 1e9 / lookups,
+        found
+    );
+    return 0;
+}
@@ -0,0 +1,195 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+#include <birch/allocator.h>
+#include <birch/draw.h>
+#include <birch/headless.h>
+#include <birch/window.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_ALLOC_WARMUP 60
+#define BENCH_ALLOC_SAMPLES 64
+#define BENCH_ALLOC_SCRATCH 4096
+
+static const char *benchAllocNames[] = {"callbacks", "queue"};
+
+// Counts what birch asks of the heap independently of its own counters
+static atomic_size_t benchAllocCalls;
+static atomic_size_t benchAllocBytes;
+
+static void *benchAllocAllocate(void *user, size_t size)
+{
+    atomic_fetch_add_explicit(&benchAllocCalls, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&benchAllocBytes, size, memory_order_relaxed);
+    return malloc(size);
+}
+
+static void *benchAllocReallocate(void *user, void *pointer, size_t size)
+{
+    atomic_fetch_add_explicit(&benchAllocCalls, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&benchAllocBytes, size, memory_order_relaxed);
+    return realloc(pointer, size);
+}
+
+static void benchAllocFree(void *user, void *pointer)
+{
+    free(pointer);
+}
+
+static void benchAllocKey(int key)
+{
+}
+
+// A frame of the dashboard with a burst of input, an overlay recorded out
+// of layer order so the draw calls are sorted, and scratch memory taken
+// from the frame arena
+static bool benchAllocFrame(BirchWindow *window, bool queue, size_t frame)
+{
+    for (int i = 0; i < BENCH_ALLOC_SAMPLES; i++)
+    {
+        birchHeadlessInjectMouseMoved(window, frame % 1280, i);
+    }
+    birchHeadlessInjectKeyPressed(window, BIRCH_KEY_SPACE);
+    birchHeadlessInjectKeyReleased(window, BIRCH_KEY_SPACE);
+
+    benchSceneDraw(window, frame / 60.0f);
+    birchDrawSetLayer(window, 0);
+    birchDrawRect(window, 10, 10, 100, 40, (BirchColor){1, 1, 1, 0.5f});
+
+    unsigned char *scratch =
+        birchWindowFrameAllocate(window, BENCH_ALLOC_SCRATCH);
+    if (!scratch)
+    {
+        return false;
+    }
+    memset(scratch, (int)frame, BENCH_ALLOC_SCRATCH);
+
+    birchWindowUpdate(window);
+    if (queue)
+    {
+        BirchEvent events[256];
+        while (birchWindowPollEvents(window, events, 256))
+        {
+        }
+    }
+    return true;
+}
+
+// Steady state frames must not touch the heap at all
+bool benchAlloc(void)
+{
+    bool zero = true;
+
+    printf(
+        "%-10s %10s %10s %10s %10s %10s  %s\n",
+        "alloc",
+        "frames",
+        "allocs",
+        "bytes",
+        "arena",
+        "capacity",
+        "steady"
+    );
+    BirchAllocator allocator = {
+        .allocate = benchAllocAllocate,
+        .reallocate = benchAllocReallocate,
+        .free = benchAllocFree,
+    };
+    // Blocks allocated before are freed with free as well
+    if (!birchSetAllocator(&allocator))
+    {
+        return false;
+    }
+    for (int mode = 0; mode <= 1; mode++)
+    {
+        BirchWindow *window = birchWindowNew(1280, 720, "bench");
+        if (!window)
+        {
+            birchSetAllocator(NULL);
+            return false;
+        }
+        birchWindowSetKeyPressedCallback(window, benchAllocKey);
+        if (mode)
+        {
+            birchWindowSetEventMode(window, BIRCH_EVENT_MODE_QUEUE);
+        }
+
+        bool ok = true;
+        size_t frame = 0;
+        for (; frame < BENCH_ALLOC_WARMUP; frame++)
+        {
+            ok = ok && benchAllocFrame(window, mode, frame);
+        }
+
+        size_t calls = atomic_load(&benchAllocCalls);
+        size_t bytes = atomic_load(&benchAllocBytes);
+        size_t reported = 0;
+        size_t frames = 0;
+        size_t arena = 0;
+        double start = benchNow();
+        do
+        {
+            ok = ok && benchAllocFrame(window, mode, frame++);
+            BirchAllocationStats stats;
+            birchWindowGetAllocationStats(window, &stats);
+            reported += stats.frameAllocations;
+            arena = stats.arenaBytes;
+            frames++;
+        } while (benchNow() - start < benchSeconds);
+        calls = atomic_load(&benchAllocCalls) - calls;
+        bytes = atomic_load(&benchAllocBytes) - bytes;
+
+        BirchAllocationStats stats;
+        birchWindowGetAllocationStats(window, &stats);
+        birchWindowFree(window);
+
+        bool steady = ok && calls == 0 && reported == 0;
+        zero = zero && steady;
+        printf(
+            "%-10s %10zu %10.2f %10.0f %10zu %10zu  %s\n",
+            benchAllocNames[mode],
+            frames,
+            (double)calls / frames,
+            (double)bytes / frames,
+            arena,
+            stats.arenaCapacity,
+            steady ? "zero" : "ALLOCATES"
+        );
+        benchRecord(
+            "alloc",
+            (double)calls / frames,
+            "allocations/frame",
+            "%s",
+            benchAllocNames[mode]
+        );
+        benchRecord(
+            "alloc",
+            (double)arena,
+            "bytes",
+            "%s arena",
+            benchAllocNames[mode]
+        );
+    }
+    birchSetAllocator(NULL);
+    return zero;
+}
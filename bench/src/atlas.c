@@ -0,0 +1,366 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "atlas.h"
+#include "bench.h"
+#include <birch/image.h>
+#include <birch/window.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(BIRCH_BENCH_HEADLESS)
+#include <birch/headless.h>
+#endif
+
+#define BENCH_ATLAS_WIDTH 1280
+#define BENCH_ATLAS_HEIGHT 720
+#define BENCH_ATLAS_SPRITE_IMAGES 500
+#define BENCH_ATLAS_SPRITES 2000
+#define BENCH_ATLAS_CHURN_IMAGES 2000
+#define BENCH_ATLAS_CHURN_DRAWN 100
+
+typedef struct
+{
+    const char *name;
+    int minSize;
+    int maxSize;
+} BenchAtlasSizes;
+
+static const BenchAtlasSizes benchAtlasSizes[] = {
+    {"glyphs", 8, 32},
+    {"sprites", 8, 128},
+    {"icons", 64, 256},
+};
+
+static int benchAtlasSize(uint32_t *state, const BenchAtlasSizes *sizes)
+{
+    return sizes->minSize +
+           (int)(benchRandom(state) * (sizes->maxSize - sizes->minSize + 1));
+}
+
+// Fill one page with random rectangles until one does not fit
+static bool benchAtlasPacking(void)
+{
+    printf(
+        "%-12s %10s %10s %12s\n",
+        "packing",
+        "rects",
+        "occupancy",
+        "ns/rect"
+    );
+    for (size_t i = 0; i < sizeof(benchAtlasSizes) / sizeof(benchAtlasSizes[0]);
+         i++)
+    {
+        const BenchAtlasSizes *sizes = &benchAtlasSizes[i];
+        BirchSkyline skyline;
+        if (!birchSkylineInit(&skyline, BIRCH_ATLAS_SIZE, BIRCH_ATLAS_SIZE))
+        {
+            return false;
+        }
+
+        size_t packed = 0;
+        size_t area = 0;
+        size_t pages = 0;
+        size_t rects = 0;
+        double start = benchNow();
+        double elapsed;
+        do
+        {
+            uint32_t state = 0x2545f491;
+            birchSkylineReset(&skyline);
+            for (;;)
+            {
+                int width = benchAtlasSize(&state, sizes);
+                int height = benchAtlasSize(&state, sizes);
+                int x;
+                int y;
+                rects++;
+                if (!birchSkylinePack(&skyline, width, height, &x, &y))
+                {
+                    break;
+                }
+                if (pages == 0)
+                {
+                    packed++;
+                    area += (size_t)width * height;
+                }
+            }
+            pages++;
+            elapsed = benchNow() - start;
+        } while (elapsed < benchSeconds);
+        birchSkylineRelease(&skyline);
+
+        double occupancy =
+            (double)area / ((double)BIRCH_ATLAS_SIZE * BIRCH_ATLAS_SIZE);
+        printf(
+            "%-12s %10zu %9.1f%% %12.1f\n",
+            sizes->name,
+            packed,
+            occupancy * 100,
+            elapsed / rects * 1e9
+        );
+        benchRecord("atlas", occupancy * 100, "%", "%s occupancy", sizes->name);
+        benchRecord(
+            "atlas",
+            elapsed / rects * 1e9,
+            "ns",
+            "%s pack",
+            sizes->name
+        );
+    }
+    return true;
+}
+
+static uint8_t *benchAtlasPixels(int width, int height, uint32_t seed)
+{
+    uint8_t *pixels = malloc((size_t)width * height * 4);
+    if (!pixels)
+    {
+        return NULL;
+    }
+    for (size_t i = 0; i < (size_t)width * height; i++)
+    {
+        seed = seed * 1664525 + 1013904223;
+        pixels[i * 4 + 0] = seed >> 24;
+        pixels[i * 4 + 1] = seed >> 16;
+        pixels[i * 4 + 2] = seed >> 8;
+        pixels[i * 4 + 3] = 255;
+    }
+    return pixels;
+}
+
+// Replace the pixels of one image every frame, measured through to the end
+// of birchWindowUpdate so GPU backends include their texture upload
+static bool benchAtlasUpload(void)
+{
+    static const int sizes[] = {64, 256, 1024};
+
+    printf("%-12s %10s %10s %12s\n", "upload", "frames/s", "MB/s", "uploads");
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        BirchWindow *window =
+            birchWindowNew(BENCH_ATLAS_WIDTH, BENCH_ATLAS_HEIGHT, "bench");
+        uint8_t *pixels[2] = {
+            benchAtlasPixels(sizes[i], sizes[i], 1),
+            benchAtlasPixels(sizes[i], sizes[i], 2),
+        };
+        BirchImage *image =
+            window && pixels[0] && pixels[1]
+                ? birchImageNew(window, sizes[i], sizes[i], pixels[0])
+                : NULL;
+        if (!image)
+        {
+            free(pixels[0]);
+            free(pixels[1]);
+            birchWindowFree(window);
+            return false;
+        }
+
+        BirchColor white = {1, 1, 1, 1};
+        birchDrawImage(window, image, 0, 0, 256, 256, white);
+        birchWindowUpdate(window);
+
+        size_t frames = 0;
+        size_t uploads = 0;
+        size_t bytes = 0;
+        double start = benchNow();
+        double elapsed;
+        do
+        {
+            birchImageUpdate(image, pixels[frames & 1]);
+            birchDrawImage(window, image, 0, 0, 256, 256, white);
+            birchWindowUpdate(window);
+            frames++;
+
+            BirchAtlasStats stats;
+            birchWindowGetAtlasStats(window, &stats);
+            uploads += stats.uploads;
+            bytes += stats.uploadedBytes;
+            elapsed = benchNow() - start;
+        } while (elapsed < benchSeconds);
+
+        birchWindowFree(window);
+        free(pixels[0]);
+        free(pixels[1]);
+
+        double megabytes = bytes / elapsed / (1024.0 * 1024.0);
+        printf(
+            "%4dx%-7d %10.1f %10.1f %12.2f\n",
+            sizes[i],
+            sizes[i],
+            frames / elapsed,
+            megabytes,
+            (double)uploads / frames
+        );
+        benchRecord("atlas", megabytes, "MB/s", "upload %d", sizes[i]);
+    }
+    return true;
+}
+
+#if defined(BIRCH_BENCH_HEADLESS)
+// Draw `count` sprites of the images, `offset` selecting the first image
+static void benchAtlasDrawSprites(
+    BirchWindow *window,
+    BirchImage **images,
+    size_t imageCount,
+    size_t offset,
+    size_t count,
+    size_t frame
+)
+{
+    uint32_t state = 0x9e3779b9;
+    for (size_t i = 0; i < count; i++)
+    {
+        float x = benchRandom(&state) * (BENCH_ATLAS_WIDTH - 32);
+        float y = benchRandom(&state) * (BENCH_ATLAS_HEIGHT - 32);
+        float drift = (float)((frame + i) % 64);
+        birchDrawImage(
+            window,
+            images[(offset + i) % imageCount],
+            x + drift,
+            y,
+            32,
+            32,
+            (BirchColor){1, 1, 1, 1}
+        );
+    }
+}
+
+// Sprites from a set of images that fits the atlas, and a sliding window
+// over a set that does not, which keeps emptying pages. Sprites are skipped
+// when every page was drawn from too recently to be emptied.
+static bool benchAtlasSprites(void)
+{
+    printf(
+        "%-12s %10s %10s %8s %8s %8s %10s %8s\n",
+        "sprites",
+        "frames/s",
+        "ms/frame",
+        "draws",
+        "pages",
+        "misses",
+        "evictions",
+        "failed"
+    );
+    for (int churn = 0; churn <= 1; churn++)
+    {
+        size_t imageCount =
+            churn ? BENCH_ATLAS_CHURN_IMAGES : BENCH_ATLAS_SPRITE_IMAGES;
+        size_t drawn = churn ? BENCH_ATLAS_CHURN_DRAWN : BENCH_ATLAS_SPRITES;
+        const BenchAtlasSizes *sizes =
+            churn ? &benchAtlasSizes[2] : &benchAtlasSizes[1];
+
+        BirchWindow *window =
+            birchWindowNew(BENCH_ATLAS_WIDTH, BENCH_ATLAS_HEIGHT, "bench");
+        BirchImage **images = calloc(imageCount, sizeof(BirchImage *));
+        if (!window || !images)
+        {
+            birchWindowFree(window);
+            free(images);
+            return false;
+        }
+        uint32_t state = 0x2545f491;
+        for (size_t i = 0; i < imageCount; i++)
+        {
+            int width = benchAtlasSize(&state, sizes);
+            int height = benchAtlasSize(&state, sizes);
+            uint8_t *pixels = benchAtlasPixels(width, height, (uint32_t)i);
+            images[i] =
+                pixels ? birchImageNew(window, width, height, pixels) : NULL;
+            free(pixels);
+            if (!images[i])
+            {
+                birchWindowFree(window);
+                free(images);
+                return false;
+            }
+        }
+
+        size_t frames = 0;
+        size_t draws = 0;
+        double start = benchNow();
+        double elapsed;
+        do
+        {
+            size_t offset = churn ? frames * BENCH_ATLAS_CHURN_DRAWN / 4 : 0;
+            benchAtlasDrawSprites(
+                window,
+                images,
+                imageCount,
+                offset,
+                drawn,
+                frames
+            );
+            birchWindowUpdate(window);
+            frames++;
+
+            BirchDrawStats drawStats;
+            birchWindowGetDrawStats(window, &drawStats);
+            draws += drawStats.drawCalls;
+            elapsed = benchNow() - start;
+        } while (elapsed < benchSeconds);
+
+        BirchAtlasStats stats;
+        birchWindowGetAtlasStats(window, &stats);
+        birchWindowFree(window);
+        free(images);
+
+        const char *name = churn ? "churn" : "resident";
+        printf(
+            "%-12s %10.1f %10.3f %8.1f %8u %8.1f %10.2f %8.2f\n",
+            name,
+            frames / elapsed,
+            elapsed / frames * 1e3,
+            (double)draws / frames,
+            stats.pages,
+            (double)stats.misses / frames,
+            (double)stats.evictions / frames,
+            (double)stats.failures / frames
+        );
+        benchRecord("atlas", frames / elapsed, "frames/s", "%s", name);
+        benchRecord(
+            "atlas",
+            (double)draws / frames,
+            "draws",
+            "%s draw calls",
+            name
+        );
+        benchRecord(
+            "atlas",
+            (double)stats.evictions / frames,
+            "evictions",
+            "%s evictions",
+            name
+        );
+    }
+    return true;
+}
+#endif
+
+bool benchAtlas(void)
+{
+    bool ok = benchAtlasPacking();
+    printf("\n");
+    ok = benchAtlasUpload() && ok;
+#if defined(BIRCH_BENCH_HEADLESS)
+    printf("\n");
+    ok = benchAtlasSprites() && ok;
+#endif
+    return ok;
+}
@@ -0,0 +1,219 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+#include "initInternal.h"
+#include "raster.h"
+#include "thread.h"
+#include "threadPool.h"
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_MAX_RESULTS 512
+
+typedef struct
+{
+    const char *section;
+    char name[64];
+    double value;
+    const char *unit;
+} BenchResult;
+
+double benchSeconds = 0.5;
+double benchPackMegabytes = 2048;
+const char *benchFontPath = NULL;
+
+static BenchResult benchResults[BENCH_MAX_RESULTS];
+static size_t benchResultCount;
+
+double benchNow(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+double benchThreadCpu(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+float benchRandom(uint32_t *state)
+{
+    // xorshift32, the same sequence on every run
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return (*state >> 8) / (float)(1 << 24);
+}
+
+void benchTriangles(
+    Vertex *vertices,
+    size_t count,
+    float size,
+    int width,
+    int height
+)
+{
+    uint32_t state = 0x9e3779b9;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        float x = benchRandom(&state) * (width - size);
+        float y = benchRandom(&state) * (height - size);
+        bool flip = i & 1;
+        Vertex *v = vertices + i * 3;
+
+        v[0].position.x = x;
+        v[0].position.y = y;
+        v[1].position.x = flip ? x : x + size;
+        v[1].position.y = flip ? y + size : y;
+        v[2].position.x = flip ? x + size : x;
+        v[2].position.y = flip ? y : y + size;
+        for (int j = 0; j < 3; j++)
+        {
+            v[j].color.x = benchRandom(&state);
+            v[j].color.y = benchRandom(&state);
+            v[j].color.z = benchRandom(&state);
+            v[j].color.w = 1.0f;
+        }
+    }
+}
+
+uint64_t benchChecksum(const uint32_t *pixels, size_t count)
+{
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325;
+    for (size_t i = 0; i < count; i++)
+    {
+        hash = (hash ^ pixels[i]) * 0x100000001b3;
+    }
+    return hash;
+}
+
+void benchRecord(
+    const char *section,
+    double value,
+    const char *unit,
+    const char *name,
+    ...
+)
+{
+    if (benchResultCount == BENCH_MAX_RESULTS)
+    {
+        return;
+    }
+
+    BenchResult *result = &benchResults[benchResultCount++];
+    result->section = section;
+    result->value = value;
+    result->unit = unit;
+
+    va_list arguments;
+    va_start(arguments, name);
+    vsnprintf(result->name, sizeof(result->name), name, arguments);
+    va_end(arguments);
+}
+
+static void benchWriteString(FILE *file, const char *string)
+{
+    fputc('"', file);
+    for (; *string; string++)
+    {
+        unsigned char c = *string;
+        if (c == '"' || c == '\\')
+        {
+            fprintf(file, "\\%c", c);
+        }
+        else if (c < 0x20)
+        {
+            fprintf(file, "\\u%04x", c);
+        }
+        else
+        {
+            fputc(c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+static const char *benchCompiler(void)
+{
+#if defined(__clang__)
+    return "clang " __clang_version__;
+#elif defined(__GNUC__)
+    return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+    return "msvc";
+#else
+    return "unknown";
+#endif
+}
+
+bool benchWriteJson(const char *path, bool ok)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        return false;
+    }
+
+    fprintf(file, "{\n  \"benchmark\": \"birch_bench\",\n");
+    fprintf(file, "  \"version\": \"%s\",\n", BIRCH_BENCH_VERSION);
+    fprintf(file, "  \"compiler\": ");
+    benchWriteString(file, benchCompiler());
+    fprintf(file, ",\n  \"isa\": \"%s\",\n", birchRasterIsa());
+    fprintf(file, "  \"cpus\": %u,\n", birchCpuCount());
+    fprintf(
+        file,
+        "  \"threads\": %u,\n",
+        birchThreadPoolSize(birchGetThreadPool())
+    );
+    fprintf(file, "  \"seconds\": %g,\n", benchSeconds);
+    fprintf(file, "  \"ok\": %s,\n", ok ? "true" : "false");
+    fprintf(file, "  \"results\": [");
+    for (size_t i = 0; i < benchResultCount; i++)
+    {
+        const BenchResult *result = &benchResults[i];
+        fprintf(file, "%s\n    {\"section\": ", i ? "," : "");
+        benchWriteString(file, result->section);
+        fprintf(file, ", \"name\": ");
+        benchWriteString(file, result->name);
+        // JSON has no NaN or infinity
+        if (isfinite(result->value))
+        {
+            fprintf(file, ", \"value\": %.6g, \"unit\": ", result->value);
+        }
+        else
+        {
+            fprintf(file, ", \"value\": null, \"unit\": ");
+        }
+        benchWriteString(file, result->unit);
+        fputc('}', file);
+    }
+    fprintf(file, "\n  ]\n}\n");
+
+    bool written = !ferror(file);
+    return fclose(file) == 0 && written;
+}
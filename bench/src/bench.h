@@ -0,0 +1,114 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BIRCH_BENCH_H
+#define BIRCH_BENCH_H
+
+#include "shaderTypes.h"
+#include <birch/window.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Shared by the birch_bench sections. Every section prints a table for
+// people and records its numbers with benchRecord for the JSON report.
+// Inputs are generated from fixed seeds so runs are comparable.
+
+/// @brief Minimum time every timed loop runs for, in seconds
+extern double benchSeconds;
+
+/// @brief Size of the asset pack the pack section writes, in megabytes
+extern double benchPackMegabytes;
+
+/// @brief TrueType font the text section draws with, NULL to look for one
+/// in the usual system locations
+extern const char *benchFontPath;
+
+/// @brief Monotonic wall clock in seconds
+double benchNow(void);
+
+/// @brief CPU time used by the calling thread in seconds
+double benchThreadCpu(void);
+
+/// @brief Uniform float in [0, 1) from a xorshift32 state
+float benchRandom(uint32_t *state);
+
+/// @brief Fill `vertices` with `count` right triangles in random
+/// orientations with legs of `size` pixels, half of them wound each way
+void benchTriangles(
+    Vertex *vertices,
+    size_t count,
+    float size,
+    int width,
+    int height
+);
+
+/// @brief FNV-1a hash of a framebuffer
+uint64_t benchChecksum(const uint32_t *pixels, size_t count);
+
+/// @brief Add a result to the JSON report, `name` is formatted like printf
+void benchRecord(
+    const char *section,
+    double value,
+    const char *unit,
+    const char *name,
+    ...
+);
+
+/// @brief Write the recorded results and the build configuration as JSON
+bool benchWriteJson(const char *path, bool ok);
+
+bool benchWindow(void);
+bool benchSubmit(void);
+bool benchRaster(void);
+bool benchTiled(void);
+bool benchProfile(void);
+bool benchPack(void);
+bool benchAtlas(void);
+bool benchText(void);
+
+// Drive input through the birchHeadlessInject* functions
+#if defined(BIRCH_BENCH_HEADLESS)
+bool benchDispatch(void);
+bool benchScene(void);
+bool benchInput(void);
+bool benchPacing(void);
+bool benchDamage(void);
+bool benchAlloc(void);
+bool benchWindows(void);
+bool benchThreaded(void);
+bool benchReplay(void);
+bool benchCallbacks(void);
+bool benchResize(void);
+
+/// @brief Deliver `count` key presses and releases straight through the
+/// dispatcher the backends call, without the event pump. Returns seconds.
+double benchDispatchKeys(BirchWindow *window, size_t count);
+
+/// @brief Draw a 1280x720 dashboard with every element moving with `time`
+void benchSceneDraw(BirchWindow *window, float time);
+#endif
+
+#if defined(BIRCH_BENCH_XCB)
+bool benchPresent(void);
+#endif
+
+#if defined(BIRCH_BENCH_EGL)
+bool benchGlLoad(void);
+#endif
+
+#endif
@@ -0,0 +1,177 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+extern "C"
+{
+#include "bench.h"
+}
+#include <birch/window.hpp>
+#include <cstdio>
+#include <functional>
+
+#define BENCH_CALLBACKS_BATCH 4096
+
+namespace
+{
+    // What an application does with a key: a little state of its own
+    struct BenchGame
+    {
+        size_t events = 0;
+        int lastKey = 0;
+
+        void key(int key)
+        {
+            events++;
+            lastKey = key;
+        }
+    };
+
+    // Bare callbacks carry no context, C++ reaches its objects through
+    // globals
+    BenchGame *benchCallbacksGame;
+    std::function<void(int)> benchCallbacksFunction;
+
+    void benchCallbacksGlobal(int key)
+    {
+        benchCallbacksGame->key(key);
+    }
+
+    void benchCallbacksSingleton(int key)
+    {
+        benchCallbacksFunction(key);
+    }
+
+    void benchCallbacksUserData(void *userData, int key)
+    {
+        static_cast<BenchGame *>(userData)->key(key);
+    }
+
+    enum BenchCallbacksKind
+    {
+        BENCH_CALLBACKS_GLOBAL,
+        BENCH_CALLBACKS_SINGLETON,
+        BENCH_CALLBACKS_USER_DATA,
+        BENCH_CALLBACKS_MEMBER,
+        BENCH_CALLBACKS_LAMBDA,
+        BENCH_CALLBACKS_COUNT,
+    };
+
+    const char *benchCallbacksKinds[] = {
+        "global",
+        "std::function",
+        "user data",
+        "member",
+        "lambda",
+    };
+}
+
+// Cost per key event of the ways C++ code can receive it, delivered the way
+// the backends deliver events so the event pump does not drown out the
+// difference. The first two are what bare callbacks allow: an object found
+// through a global, or a std::function behind one. The others bind the
+// object to the window.
+bool benchCallbacks(void)
+{
+    std::printf("%-14s %12s %12s\n", "callbacks", "Mevents/s", "ns/event");
+    for (int kind = 0; kind < BENCH_CALLBACKS_COUNT; kind++)
+    {
+        birch::Window window(1, 1, "bench");
+        if (!window)
+        {
+            return false;
+        }
+
+        BenchGame game;
+        const auto lambda = [&game](int key)
+        {
+            game.key(key);
+        };
+        switch (kind)
+        {
+        case BENCH_CALLBACKS_GLOBAL:
+            benchCallbacksGame = &game;
+            birchWindowSetKeyPressedCallback(
+                window.get(),
+                benchCallbacksGlobal
+            );
+            birchWindowSetKeyReleasedCallback(
+                window.get(),
+                benchCallbacksGlobal
+            );
+            break;
+        case BENCH_CALLBACKS_SINGLETON:
+            benchCallbacksFunction = [&game](int key)
+            {
+                game.key(key);
+            };
+            birchWindowSetKeyPressedCallback(
+                window.get(),
+                benchCallbacksSingleton
+            );
+            birchWindowSetKeyReleasedCallback(
+                window.get(),
+                benchCallbacksSingleton
+            );
+            break;
+        case BENCH_CALLBACKS_USER_DATA:
+            birchWindowSetKeyPressedHandler(
+                window.get(),
+                benchCallbacksUserData,
+                &game
+            );
+            birchWindowSetKeyReleasedHandler(
+                window.get(),
+                benchCallbacksUserData,
+                &game
+            );
+            break;
+        case BENCH_CALLBACKS_MEMBER:
+            window.onKeyPressed<&BenchGame::key>(&game);
+            window.onKeyReleased<&BenchGame::key>(&game);
+            break;
+        default:
+            window.onKeyPressed(lambda);
+            window.onKeyReleased(lambda);
+            break;
+        }
+
+        double elapsed = 0;
+        do
+        {
+            elapsed += benchDispatchKeys(window.get(), BENCH_CALLBACKS_BATCH);
+        } while (elapsed < benchSeconds);
+        benchCallbacksFunction = nullptr;
+
+        double perSecond = game.events / elapsed;
+        std::printf(
+            "%-14s %12.2f %12.1f\n",
+            benchCallbacksKinds[kind],
+            perSecond / 1e6,
+            1e9 / perSecond
+        );
+        benchRecord(
+            "callbacks",
+            perSecond / 1e6,
+            "Mevents/s",
+            "%s",
+            benchCallbacksKinds[kind]
+        );
+    }
+    return true;
+}
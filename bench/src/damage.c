@@ -0,0 +1,169 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+#include <birch/draw.h>
+#include <birch/headless.h>
+#include <birch/window.h>
+#include <stdio.h>
+
+#define BENCH_DAMAGE_WIDTH 1280
+#define BENCH_DAMAGE_HEIGHT 720
+
+typedef enum
+{
+    BENCH_DAMAGE_STATIC,
+    BENCH_DAMAGE_INDICATOR,
+    BENCH_DAMAGE_ANIMATED,
+} BenchDamageCase;
+
+static const char *benchDamageNames[] = {"static", "indicator", "animated"};
+
+// The dashboard of the scene section, still, with a blinking indicator, or
+// with everything moving
+static void
+benchDamageDraw(BirchWindow *window, BenchDamageCase scene, size_t frame)
+{
+    if (scene == BENCH_DAMAGE_ANIMATED)
+    {
+        benchSceneDraw(window, frame / 60.0f);
+        return;
+    }
+
+    benchSceneDraw(window, 0);
+    if (scene == BENCH_DAMAGE_INDICATOR)
+    {
+        float shade = (frame % 30) / 30.0f;
+        birchDrawSetLayer(window, 3);
+        birchDrawRect(
+            window,
+            BENCH_DAMAGE_WIDTH - 50,
+            BENCH_DAMAGE_HEIGHT - 30,
+            40,
+            20,
+            (BirchColor){shade, 1, shade, 1}
+        );
+    }
+}
+
+static uint64_t benchDamageChecksum(BirchWindow *window)
+{
+    unsigned int width;
+    unsigned int height;
+    const uint8_t *pixels =
+        birchHeadlessGetFramebuffer(window, &width, &height, NULL);
+    return benchChecksum((const uint32_t *)pixels, (size_t)width * height);
+}
+
+// Only the tiles that changed are redrawn; check that the result still
+// matches drawing the last frame into a fresh window
+bool benchDamage(void)
+{
+    bool identical = true;
+
+    printf(
+        "%-10s %10s %10s %8s %8s  %s\n",
+        "damage",
+        "frames/s",
+        "ms/frame",
+        "rects",
+        "redrawn",
+        "matches"
+    );
+    for (int scene = 0; scene <= BENCH_DAMAGE_ANIMATED; scene++)
+    {
+        BirchWindow *window = birchWindowNew(
+            BENCH_DAMAGE_WIDTH,
+            BENCH_DAMAGE_HEIGHT,
+            "bench"
+        );
+        if (!window)
+        {
+            return false;
+        }
+
+        benchDamageDraw(window, scene, 0);
+        birchWindowUpdate(window);
+
+        size_t frames = 0;
+        size_t rects = 0;
+        double redrawn = 0;
+        double start = benchNow();
+        double elapsed;
+        do
+        {
+            frames++;
+            benchDamageDraw(window, scene, frames);
+            birchWindowUpdate(window);
+
+            BirchDamageStats stats;
+            birchWindowGetDamageStats(window, &stats);
+            rects += stats.rects;
+            redrawn += (double)stats.pixels / stats.totalPixels;
+            elapsed = benchNow() - start;
+        } while (elapsed < benchSeconds);
+        uint64_t checksum = benchDamageChecksum(window);
+        birchWindowFree(window);
+
+        BirchWindow *reference = birchWindowNew(
+            BENCH_DAMAGE_WIDTH,
+            BENCH_DAMAGE_HEIGHT,
+            "bench"
+        );
+        if (!reference)
+        {
+            return false;
+        }
+        benchDamageDraw(reference, scene, frames);
+        birchWindowUpdate(reference);
+        bool matches = benchDamageChecksum(reference) == checksum;
+        birchWindowFree(reference);
+        identical = identical && matches;
+
+        printf(
+            "%-10s %10.1f %10.3f %8.1f %7.1f%%  %s\n",
+            benchDamageNames[scene],
+            frames / elapsed,
+            elapsed / frames * 1e3,
+            (double)rects / frames,
+            redrawn / frames * 100,
+            matches ? "yes" : "no"
+        );
+        benchRecord(
+            "damage",
+            frames / elapsed,
+            "frames/s",
+            "%s",
+            benchDamageNames[scene]
+        );
+        benchRecord(
+            "damage",
+            redrawn / frames * 100,
+            "%",
+            "%s redrawn",
+            benchDamageNames[scene]
+        );
+    }
+
+    if (!identical)
+    {
+        fprintf(stderr, "partial redraws differ from full redraws\n");
+    }
+    return identical;
+}
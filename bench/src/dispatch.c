@@ -0,0 +1,194 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+#include "windowInternal.h"
+#include <birch/headless.h>
+#include <birch/window.h>
+#include <stdio.h>
+
+// Events injected per update. Large enough that the update's fixed cost
+// does not matter, small enough to stay in cache.
+#define BENCH_DISPATCH_BATCH 1024
+
+typedef enum
+{
+    BENCH_DISPATCH_KEY,
+    BENCH_DISPATCH_BUTTON,
+    BENCH_DISPATCH_MOTION,
+    BENCH_DISPATCH_COUNT,
+} BenchDispatchKind;
+
+static const char *benchDispatchKinds[] = {
+    "key",
+    "mouse button",
+    "mouse motion",
+};
+
+static size_t benchDispatchEvents;
+
+static void benchDispatchKey(int key)
+{
+    benchDispatchEvents++;
+}
+
+static void benchDispatchMouseMoved(int x, int y)
+{
+    benchDispatchEvents++;
+}
+
+static void benchDispatchInject(BirchWindow *window, BenchDispatchKind kind)
+{
+    for (int i = 0; i < BENCH_DISPATCH_BATCH; i += 2)
+    {
+        switch (kind)
+        {
+        case BENCH_DISPATCH_KEY:
+            birchHeadlessInjectKeyPressed(window, BIRCH_KEY_A);
+            birchHeadlessInjectKeyReleased(window, BIRCH_KEY_A);
+            break;
+        case BENCH_DISPATCH_BUTTON:
+            birchHeadlessInjectMouseButtonPressed(window, 0);
+            birchHeadlessInjectMouseButtonReleased(window, 0);
+            break;
+        default:
+            birchHeadlessInjectMouseMoved(window, (float)i, 1.0f);
+            birchHeadlessInjectMouseMoved(window, (float)i, 2.0f);
+            break;
+        }
+    }
+}
+
+double benchDispatchKeys(BirchWindow *window, size_t count)
+{
+    double start = benchNow();
+    for (size_t i = 0; i < count; i += 2)
+    {
+        birchWindowDispatchKeyPressed(window, BIRCH_KEY_A, 0);
+        birchWindowDispatchKeyReleased(window, BIRCH_KEY_A, 0);
+    }
+    return benchNow() - start;
+}
+
+// Polling every key the way game logic does each frame, instead of
+// mirroring the state from callbacks
+static bool benchDispatchKeyState(void)
+{
+    BirchWindow *window = birchWindowNew(1, 1, "bench");
+    if (!window)
+    {
+        return false;
+    }
+    for (int key = 0; key <= BIRCH_KEY_LAST; key += 3)
+    {
+        birchHeadlessInjectKeyPressed(window, key);
+    }
+    for (int button = 0; button < BIRCH_MOUSE_BUTTON_COUNT; button++)
+    {
+        birchHeadlessInjectMouseButtonPressed(window, button);
+    }
+    birchWindowUpdate(window);
+
+    // Up to the last button, past BIRCH_MOUSE_BUTTON_LAST
+    bool buttons = true;
+    for (int button = 0; button < BIRCH_MOUSE_BUTTON_COUNT; button++)
+    {
+        buttons = buttons && birchWindowIsMouseButtonDown(window, button) &&
+                  birchWindowWasMouseButtonPressed(window, button);
+    }
+
+    size_t queries = 0;
+    size_t held = 0;
+    double start = benchNow();
+    double elapsed;
+    do
+    {
+        for (int key = 0; key <= BIRCH_KEY_LAST; key++)
+        {
+            held += birchWindowIsKeyDown(window, key);
+            held += birchWindowWasKeyPressed(window, key);
+        }
+        queries += 2 * (BIRCH_KEY_LAST + 1);
+        elapsed = benchNow() - start;
+    } while (elapsed < benchSeconds);
+    birchWindowFree(window);
+
+    double perSecond = queries / elapsed;
+    printf(
+        "%-14s %12.2f %12.1f\n",
+        "key state",
+        perSecond / 1e6,
+        1e9 / perSecond
+    );
+    benchRecord("dispatch", perSecond / 1e6, "Mqueries/s", "key state");
+    return held > 0 && buttons;
+}
+
+// Callback delivery through birchWindowUpdate. Injection stands in for the
+// OS and is not timed. The window is a single pixel so rendering the empty
+// frame costs next to nothing.
+bool benchDispatch(void)
+{
+    printf(
+        "%-14s %12s %12s\n",
+        "dispatch",
+        "Mevents/s",
+        "ns/event"
+    );
+    for (int kind = 0; kind < BENCH_DISPATCH_COUNT; kind++)
+    {
+        BirchWindow *window = birchWindowNew(1, 1, "bench");
+        if (!window)
+        {
+            return false;
+        }
+        birchWindowSetKeyPressedCallback(window, benchDispatchKey);
+        birchWindowSetKeyReleasedCallback(window, benchDispatchKey);
+        birchWindowSetMouseButtonPressedCallback(window, benchDispatchKey);
+        birchWindowSetMouseButtonReleasedCallback(window, benchDispatchKey);
+        birchWindowSetMouseMovedCallback(window, benchDispatchMouseMoved);
+
+        benchDispatchEvents = 0;
+        double elapsed = 0;
+        do
+        {
+            benchDispatchInject(window, kind);
+            double start = benchNow();
+            birchWindowUpdate(window);
+            elapsed += benchNow() - start;
+        } while (elapsed < benchSeconds);
+        birchWindowFree(window);
+
+        double perSecond = benchDispatchEvents / elapsed;
+        printf(
+            "%-14s %12.2f %12.1f\n",
+            benchDispatchKinds[kind],
+            perSecond / 1e6,
+            1e9 / perSecond
+        );
+        benchRecord(
+            "dispatch",
+            perSecond / 1e6,
+            "Mevents/s",
+            "%s",
+            benchDispatchKinds[kind]
+        );
+    }
+    return benchDispatchKeyState();
+}
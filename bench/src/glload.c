@@ -0,0 +1,201 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+#include "glLoader.h"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <stdio.h>
+
+// OpenGL startup on Linux through EGL, with Mesa's software rasterizer when
+// there is no GPU. The win32 backend does the same work through WGL.
+
+static unsigned int benchGlLookups = 0;
+
+static GLADapiproc benchGlLookup(void *user, const char *name)
+{
+    benchGlLookups++;
+    return (GLADapiproc)eglGetProcAddress(name);
+}
+
+// What the win32 backend calls while creating a window and drawing its
+// first frame, minus the shaders, whose compile time would swamp the rest
+static void benchGlFirstCalls(void)
+{
+    GLint alignment;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    GLuint vao;
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glEnableVertexAttribArray(0);
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, 256, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(alignment), &alignment);
+    glViewport(0, 0, 64, 64);
+    glClearColor(0, 0, 0, 1);
+    glClear(GL_COLOR_BUFFER_BIT);
+    GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    glDeleteSync(fence);
+    glDeleteBuffers(1, &buffer);
+    glDeleteVertexArrays(1, &vao);
+}
+
+static bool benchGlContext(EGLDisplay *display, EGLContext *context)
+{
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+            "eglGetPlatformDisplayEXT"
+        );
+    *display = getPlatformDisplay
+                   ? getPlatformDisplay(
+                         EGL_PLATFORM_SURFACELESS_MESA,
+                         EGL_DEFAULT_DISPLAY,
+                         NULL
+                     )
+                   : eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (*display == EGL_NO_DISPLAY || !eglInitialize(*display, NULL, NULL))
+    {
+        return false;
+    }
+
+    // The context the win32 backend asks for
+    const EGLint attributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION,
+        3,
+        EGL_CONTEXT_MINOR_VERSION,
+        3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK,
+        EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE,
+    };
+    eglBindAPI(EGL_OPENGL_API);
+    *context = eglCreateContext(
+        *display,
+        EGL_NO_CONFIG_KHR,
+        EGL_NO_CONTEXT,
+        attributes
+    );
+    if (*context == EGL_NO_CONTEXT ||
+        !eglMakeCurrent(*display, EGL_NO_SURFACE, EGL_NO_SURFACE, *context))
+    {
+        eglTerminate(*display);
+        return false;
+    }
+    return true;
+}
+
+bool benchGlLoad(void)
+{
+    const char *modes[] = {"glad", "list", "lazy"};
+
+    EGLDisplay display;
+    EGLContext context;
+    if (!benchGlContext(&display, &context))
+    {
+        fprintf(stderr, "no EGL context with desktop GL 3.3\n");
+        return false;
+    }
+
+    printf(
+        "%-8s %10s %14s %10s %14s\n",
+        "glload",
+        "load us",
+        "first call us",
+        "lookups",
+        "first lookups"
+    );
+    bool ok = true;
+    for (int mode = 0; mode < 3; mode++)
+    {
+        size_t iterations = 0;
+        double loadTime = 0;
+        double callTime = 0;
+        unsigned int lookups = 0;
+        unsigned int callLookups = 0;
+        double start = benchNow();
+        do
+        {
+            benchGlLookups = 0;
+            double loadStart = benchNow();
+            int version =
+                mode == 0
+                    ? gladLoadGLUserPtr(benchGlLookup, NULL)
+                    : birchGlLoad(
+                          mode == 1 ? BIRCH_GL_LOAD_LIST : BIRCH_GL_LOAD_LAZY,
+                          benchGlLookup,
+                          NULL
+                      );
+            double callStart = benchNow();
+            if (!version)
+            {
+                ok = false;
+                break;
+            }
+            lookups = benchGlLookups;
+
+            benchGlFirstCalls();
+            callTime += benchNow() - callStart;
+            loadTime += callStart - loadStart;
+            callLookups = benchGlLookups - lookups;
+            iterations++;
+        } while (benchNow() - start < benchSeconds);
+        if (!iterations)
+        {
+            continue;
+        }
+
+        printf(
+            "%-8s %10.2f %14.2f %10u %14u\n",
+            modes[mode],
+            loadTime / iterations * 1e6,
+            callTime / iterations * 1e6,
+            lookups,
+            callLookups
+        );
+        benchRecord(
+            "glload",
+            loadTime / iterations * 1e6,
+            "us",
+            "%s load",
+            modes[mode]
+        );
+        benchRecord(
+            "glload",
+            (loadTime + callTime) / iterations * 1e6,
+            "us",
+            "%s load and first calls",
+            modes[mode]
+        );
+        benchRecord(
+            "glload",
+            lookups + callLookups,
+            "lookups",
+            "%s",
+            modes[mode]
+        );
+    }
+
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(display, context);
+    eglTerminate(display);
+    return ok;
+}
@@ -0,0 +1,125 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+#include <birch/headless.h>
+#include <birch/window.h>
+#include <stdio.h>
+
+// 8 kHz mouse motion at 60 frames per second
+#define BENCH_INPUT_FRAMES 2000
+#define BENCH_INPUT_SAMPLES (8000 / 60)
+
+typedef enum
+{
+    BENCH_INPUT_NONE,
+    BENCH_INPUT_CALLBACKS,
+    BENCH_INPUT_QUEUE,
+    BENCH_INPUT_COALESCED,
+} BenchInputMode;
+
+static const char *benchInputModes[] = {
+    "no input",
+    "callbacks",
+    "queue",
+    "coalesced",
+};
+
+static size_t benchInputEvents;
+
+static void benchInputMouseMoved(int x, int y)
+{
+    benchInputEvents++;
+}
+
+bool benchInput(void)
+{
+    BirchEvent events[256];
+
+    printf(
+        "%-10s %14s %14s %14s\n",
+        "input",
+        "ns/frame",
+        "events/frame",
+        "samples/frame"
+    );
+    for (int mode = BENCH_INPUT_NONE; mode <= BENCH_INPUT_COALESCED; mode++)
+    {
+        BirchWindow *window = birchWindowNew(64, 64, "bench");
+        if (!window)
+        {
+            return false;
+        }
+        birchWindowSetMouseMovedCallback(window, benchInputMouseMoved);
+        birchWindowSetEventMode(
+            window,
+            mode == BENCH_INPUT_QUEUE ? BIRCH_EVENT_MODE_QUEUE
+                                      : BIRCH_EVENT_MODE_CALLBACKS
+        );
+        birchWindowSetMouseCoalescing(window, mode == BENCH_INPUT_COALESCED);
+
+        benchInputEvents = 0;
+        size_t samples = 0;
+        double elapsed = 0;
+        for (int frame = 0; frame < BENCH_INPUT_FRAMES; frame++)
+        {
+            if (mode != BENCH_INPUT_NONE)
+            {
+                for (int i = 0; i < BENCH_INPUT_SAMPLES; i++)
+                {
+                    birchHeadlessInjectMouseMoved(
+                        window,
+                        frame + i / (float)BENCH_INPUT_SAMPLES,
+                        32.25f
+                    );
+                }
+            }
+
+            // Injecting stands in for the OS, only time birch's side
+            double start = benchNow();
+            birchWindowUpdate(window);
+            size_t polled;
+            while ((polled = birchWindowPollEvents(window, events, 256)))
+            {
+                benchInputEvents += polled;
+            }
+            size_t count;
+            birchWindowGetMouseHistory(window, &count);
+            samples += count;
+            elapsed += benchNow() - start;
+        }
+        birchWindowFree(window);
+
+        printf(
+            "%-10s %14.0f %14.1f %14.1f\n",
+            benchInputModes[mode],
+            elapsed / BENCH_INPUT_FRAMES * 1e9,
+            (double)benchInputEvents / BENCH_INPUT_FRAMES,
+            (double)samples / BENCH_INPUT_FRAMES
+        );
+        benchRecord(
+            "input",
+            elapsed / BENCH_INPUT_FRAMES * 1e9,
+            "ns/frame",
+            "%s",
+            benchInputModes[mode]
+        );
+    }
+    return true;
+}
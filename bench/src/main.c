@@ -0,0 +1,174 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+#include <birch/init.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+    const char *name;
+    bool (*run)(void);
+    const char *description;
+} BenchSection;
+
+static const BenchSection benchSections[] = {
+    {"window", benchWindow, "window creation and teardown"},
+#if defined(BIRCH_BENCH_HEADLESS)
+    {"dispatch", benchDispatch, "event dispatch through the callbacks"},
+#endif
+    {"submit", benchSubmit, "vertex submission through the draw API"},
+    {"raster", benchRaster, "rasterizer fill rate per instruction set"},
+    {"tiled", benchTiled, "tiled rasterizer scaling per thread count"},
+#if defined(BIRCH_BENCH_HEADLESS)
+    {"scene", benchScene, "end-to-end frames per second"},
+    {"input", benchInput, "8 kHz mouse motion per event mode"},
+    {"pacing", benchPacing, "frame limiter, vsync and waiting for events"},
+    {"damage", benchDamage, "redrawing only what changed"},
+    {"alloc", benchAlloc, "heap allocations of steady state frames"},
+    {"windows", benchWindows, "frame cost per window with many windows"},
+    {"threaded", benchThreaded, "frame pacing with a render thread"},
+    {"replay", benchReplay, "input recording and replay"},
+    {"callbacks", benchCallbacks, "C and C++ callback binding per event"},
+    {"resize", benchResize, "frames during a live window resize"},
+#endif
+#if defined(BIRCH_BENCH_XCB)
+    {"present", benchPresent, "MIT-SHM against xcb_put_image presentation"},
+#endif
+#if defined(BIRCH_BENCH_EGL)
+    {"glload", benchGlLoad, "OpenGL entry point loading per loader mode"},
+#endif
+    {"profile", benchProfile, "profiler zone cost and trace export"},
+    {"pack", benchPack, "cold start and memory of a memory mapped pack"},
+    {"atlas", benchAtlas, "atlas packing, texture uploads and sprites"},
+    {"text", benchText, "glyph distance fields and screens of text"},
+};
+
+#define BENCH_SECTION_COUNT (sizeof(benchSections) / sizeof(benchSections[0]))
+
+static void benchUsage(FILE *file)
+{
+    fprintf(
+        file,
+        "usage: birch_bench [--json PATH] [--seconds S] [--pack-size MB] "
+        "[--font PATH] [SECTION...]\n"
+        "\n"
+        "  --json PATH     also write the results as JSON to PATH\n"
+        "  --seconds S     minimum duration of every timed loop (default %g)\n"
+        "  --pack-size MB  size of the asset pack written to $TMPDIR "
+        "(default %g)\n"
+        "  --font PATH     TrueType font of the text section (default: the "
+        "first\n"
+        "                  of a few common system fonts)\n"
+        "\n"
+        "sections, all by default:\n",
+        benchSeconds,
+        benchPackMegabytes
+    );
+    for (size_t i = 0; i < BENCH_SECTION_COUNT; i++)
+    {
+        fprintf(
+            file,
+            "  %-12s  %s\n",
+            benchSections[i].name,
+            benchSections[i].description
+        );
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *json = NULL;
+    bool selected[BENCH_SECTION_COUNT] = {false};
+    bool any = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+        {
+            json = argv[++i];
+        }
+        else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+        {
+            benchSeconds = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--pack-size") == 0 && i + 1 < argc)
+        {
+            benchPackMegabytes = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--font") == 0 && i + 1 < argc)
+        {
+            benchFontPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--help") == 0)
+        {
+            benchUsage(stdout);
+            return 0;
+        }
+        else
+        {
+            size_t section = 0;
+            while (section < BENCH_SECTION_COUNT &&
+                   strcmp(argv[i], benchSections[section].name) != 0)
+            {
+                section++;
+            }
+            if (section == BENCH_SECTION_COUNT)
+            {
+                benchUsage(stderr);
+                return 2;
+            }
+            selected[section] = true;
+            any = true;
+        }
+    }
+
+    birchInit("birch_bench");
+
+    bool ok = true;
+    bool printed = false;
+    for (size_t i = 0; i < BENCH_SECTION_COUNT; i++)
+    {
+        if (any && !selected[i])
+        {
+            continue;
+        }
+        if (printed)
+        {
+            printf("\n");
+        }
+        printed = true;
+        if (!benchSections[i].run())
+        {
+            fprintf(stderr, "%s failed\n", benchSections[i].name);
+            ok = false;
+        }
+    }
+
+    if (json && !benchWriteJson(json, ok))
+    {
+        fprintf(stderr, "could not write %s\n", json);
+        ok = false;
+    }
+
+    birchTerminate();
+    return ok ? 0 : 1;
+}
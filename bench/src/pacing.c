@@ -0,0 +1,103 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+#include "clock.h"
+#include "thread.h"
+#include <birch/headless.h>
+#include <birch/window.h>
+#include <stdio.h>
+
+static void benchPacingWake(void *argument)
+{
+    birchClockSleepUntil(birchClockNow() + 200000000);
+    birchHeadlessInjectKeyPressed(argument, BIRCH_KEY_SPACE);
+}
+
+bool benchPacing(void)
+{
+    BirchWindow *window = birchWindowNew(64, 64, "bench");
+    if (!window)
+    {
+        return false;
+    }
+
+    printf(
+        "%-14s %10s %10s %10s %10s\n",
+        "pacing",
+        "mean ms",
+        "jitter ms",
+        "min ms",
+        "max ms"
+    );
+    const char *names[] = {"limit 120 Hz", "vsync 60 Hz"};
+    for (int i = 0; i < 2; i++)
+    {
+        birchWindowSetFrameRateLimit(window, i == 0 ? 120 : 0);
+        birchWindowSetVsync(window, i == 1);
+        // Warm up, then fill the 120 frame statistics window
+        for (int frame = 0; frame < 130; frame++)
+        {
+            birchWindowUpdate(window);
+        }
+
+        BirchFrameStats stats;
+        birchWindowGetFrameStats(window, &stats);
+        printf(
+            "%-14s %10.3f %10.3f %10.3f %10.3f\n",
+            names[i],
+            stats.frameTime * 1e3,
+            stats.jitter * 1e3,
+            stats.minFrameTime * 1e3,
+            stats.maxFrameTime * 1e3
+        );
+        benchRecord("pacing", stats.frameTime * 1e3, "ms", "%s", names[i]);
+        benchRecord(
+            "pacing",
+            stats.jitter * 1e3,
+            "ms",
+            "%s jitter",
+            names[i]
+        );
+    }
+
+    // An idle wait should cost the waiting thread no CPU and wake promptly
+    BirchThread waker;
+    uint64_t start = birchClockNow();
+    double cpuStart = benchThreadCpu();
+    if (!birchThreadStart(&waker, benchPacingWake, window))
+    {
+        birchWindowFree(window);
+        return false;
+    }
+    bool woken = birchWindowWaitEvents(window, -1.0);
+    double waited = (birchClockNow() - start) / 1e9;
+    double cpu = benchThreadCpu() - cpuStart;
+    birchThreadJoin(&waker);
+    printf(
+        "wait events    %s after %.1f ms, %.1f ms of CPU\n",
+        woken ? "woke" : "timed out",
+        waited * 1e3,
+        cpu * 1e3
+    );
+    benchRecord("pacing", cpu * 1e3, "ms", "wait events CPU");
+
+    birchWindowFree(window);
+    return woken;
+}
@@ -0,0 +1,387 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include "bench.h"
+#include <birch/pack.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Textures make up the size of the pack, next to compressible text assets
+// and many small files for the index
+#define BENCH_PACK_TEXTURE_SIZE (8 << 20)
+#define BENCH_PACK_TEXT_COUNT 64
+#define BENCH_PACK_TEXT_SIZE (256 << 10)
+#define BENCH_PACK_SMALL_COUNT 4096
+#define BENCH_PACK_SMALL_SIZE 1024
+
+// Noise, which does not compress, like most texture data
+static void benchPackTexture(uint8_t *data, size_t size, uint32_t seed)
+{
+    uint32_t state = seed * 2654435761u + 1;
+    for (size_t i = 0; i + 4 <= size; i += 4)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        memcpy(data + i, &state, 4);
+    }
+}
+
+// Source-like text, which compresses about 2-4x with LZ4
+static void benchPackText(char *data, size_t size, uint32_t seed)
+{
+    static const char *words[] = {
+        "float4 ", "return ", "vertex ", "color ", "position ", "uniform ",
+        "in.", "out.", "= ", "* ", "+ ", "; ", "\n    ", "(", ") ", "{ ",
+        "} ", "texture ", "sample ", "half3 ",
+    };
+    uint32_t state = seed * 2654435761u + 1;
+    size_t length = 0;
+    while (length + 1 < size)
+    {
+        const char *word = words[(uint32_t)(benchRandom(&state) * 20)];
+        while (*word && length + 1 < size)
+        {
+            data[length++] = *word++;
+        }
+    }
+    data[length] = '\0';
+}
+
+// Resident set size of the process in bytes, -1 where unknown
+static double benchPackResident(void)
+{
+#if defined(__linux__)
+    FILE *file = fopen("/proc/self/statm", "r");
+    long pages;
+    long resident;
+    bool read = file && fscanf(file, "%ld %ld", &pages, &resident) == 2;
+    if (file)
+    {
+        fclose(file);
+    }
+    return read ? (double)resident * sysconf(_SC_PAGESIZE) : -1;
+#else
+    return -1;
+#endif
+}
+
+// Drop the pack from the page cache, so the next access reads the disk as
+// after a reboot. Returns false where that is not possible.
+static bool benchPackEvict(const char *path)
+{
+#if defined(__linux__)
+    int file = open(path, O_RDONLY);
+    if (file < 0)
+    {
+        return false;
+    }
+    bool evicted = fdatasync(file) == 0 &&
+                   posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(file);
+    return evicted;
+#else
+    return false;
+#endif
+}
+
+static bool benchPackWrite(const char *path, size_t textures, double *seconds)
+{
+    uint8_t *texture = malloc(BENCH_PACK_TEXTURE_SIZE);
+    char *text = malloc(BENCH_PACK_TEXT_SIZE);
+    BirchPackWriter *writer = birchPackWriterNew(path);
+    bool ok = texture && text && writer;
+
+    double start = benchNow();
+    char name[64];
+    for (size_t i = 0; ok && i < textures; i++)
+    {
+        snprintf(name, sizeof(name), "textures/%zu.rgba", i);
+        benchPackTexture(texture, BENCH_PACK_TEXTURE_SIZE, (uint32_t)i);
+        ok = birchPackWriterAdd(
+            writer,
+            name,
+            texture,
+            BENCH_PACK_TEXTURE_SIZE,
+            false
+        );
+    }
+    for (size_t i = 0; ok && i < BENCH_PACK_TEXT_COUNT; i++)
+    {
+        snprintf(name, sizeof(name), "shaders/%zu.metal", i);
+        benchPackText(text, BENCH_PACK_TEXT_SIZE, (uint32_t)i);
+        ok = birchPackWriterAdd(
+            writer,
+            name,
+            text,
+            BENCH_PACK_TEXT_SIZE,
+            true
+        );
+    }
+    for (size_t i = 0; ok && i < BENCH_PACK_SMALL_COUNT; i++)
+    {
+        snprintf(name, sizeof(name), "ui/%zu.json", i);
+        benchPackText(text, BENCH_PACK_SMALL_SIZE, (uint32_t)i + 1000);
+        ok = birchPackWriterAdd(
+            writer,
+            name,
+            text,
+            BENCH_PACK_SMALL_SIZE,
+            i & 1
+        );
+    }
+    if (writer)
+    {
+        ok = birchPackWriterFinish(writer) && ok;
+    }
+    *seconds = benchNow() - start;
+
+    free(texture);
+    free(text);
+    return ok;
+}
+
+// Check a texture and a compressed asset against what was written
+static bool benchPackVerify(BirchPack *pack, size_t textures)
+{
+    uint8_t *expected = malloc(BENCH_PACK_TEXTURE_SIZE);
+    bool ok = expected != NULL;
+    size_t size;
+
+    const void *texture = birchPackGet(pack, "textures/0.rgba", &size);
+    if (ok)
+    {
+        benchPackTexture(expected, BENCH_PACK_TEXTURE_SIZE, 0);
+        ok = texture && size == BENCH_PACK_TEXTURE_SIZE &&
+             (uintptr_t)texture % BIRCH_PACK_ALIGNMENT == 0 &&
+             memcmp(texture, expected, size) == 0;
+    }
+
+    const char *text = birchPackGet(pack, "shaders/1.metal", &size);
+    if (ok)
+    {
+        benchPackText((char *)expected, BENCH_PACK_TEXT_SIZE, 1);
+        ok = text && size == BENCH_PACK_TEXT_SIZE &&
+             strcmp(text, (char *)expected) == 0;
+    }
+
+    free(expected);
+    size_t count = textures + BENCH_PACK_TEXT_COUNT + BENCH_PACK_SMALL_COUNT;
+    return ok && birchPackGetCount(pack) == count &&
+           !birchPackGet(pack, "textures/missing.rgba", NULL);
+}
+
+// Open a pack too large to read into memory, from a cold page cache, and
+// compare it with reading the whole file
+bool benchPack(void)
+{
+    const char *directory = getenv("TMPDIR");
+    char path[1024];
+    snprintf(
+        path,
+        sizeof(path),
+        "%s/birch_bench.pack",
+        directory ? directory : "/tmp"
+    );
+
+    size_t textures =
+        (size_t)(benchPackMegabytes * (1 << 20) / BENCH_PACK_TEXTURE_SIZE);
+    double writeSeconds;
+    if (!benchPackWrite(path, textures, &writeSeconds))
+    {
+        fprintf(stderr, "could not write %s\n", path);
+        return false;
+    }
+
+    BirchPackInfo info;
+    double textSize = 0;
+    double textStored = 0;
+    bool evicted = benchPackEvict(path);
+
+    double residentBefore = benchPackResident();
+    double start = benchNow();
+    BirchPack *pack = birchPackOpen(path);
+    double openSeconds = benchNow() - start;
+    if (!pack)
+    {
+        remove(path);
+        return false;
+    }
+    double residentOpen = benchPackResident();
+
+    // The first lookup faults in a page of the index and of the names
+    start = benchNow();
+    const uint8_t *texture = birchPackGet(pack, "textures/1.rgba", NULL);
+    double lookupSeconds = benchNow() - start;
+
+    // Then reading the texture faults in its pages
+    start = benchNow();
+    uint64_t sum = 0;
+    for (size_t i = 0; texture && i < BENCH_PACK_TEXTURE_SIZE; i += 4096)
+    {
+        sum += texture[i];
+    }
+    double touchSeconds = benchNow() - start;
+    double residentTouched = benchPackResident();
+
+    // Warm lookups of every small asset
+    size_t count = birchPackGetCount(pack);
+    char(*names)[16] = malloc(BENCH_PACK_SMALL_COUNT * sizeof(*names));
+    for (size_t i = 0; names && i < BENCH_PACK_SMALL_COUNT; i++)
+    {
+        snprintf(names[i], sizeof(names[i]), "ui/%zu.json", i);
+    }
+    size_t lookups = 0;
+    start = benchNow();
+    double elapsed;
+    do
+    {
+        for (size_t i = 0; names && i < BENCH_PACK_SMALL_COUNT; i++)
+        {
+            sum += birchPackGetInfo(pack, names[i], &info);
+        }
+        lookups += BENCH_PACK_SMALL_COUNT;
+        elapsed = benchNow() - start;
+    } while (names && elapsed < benchSeconds);
+    free(names);
+    double lookupNanoseconds = elapsed * 1e9 / lookups;
+
+    // Decompressing into memory of the caller
+    char *text = malloc(BENCH_PACK_TEXT_SIZE);
+    char name[64];
+    size_t decoded = 0;
+    start = benchNow();
+    do
+    {
+        for (size_t i = 0; text && i < BENCH_PACK_TEXT_COUNT; i++)
+        {
+            snprintf(name, sizeof(name), "shaders/%zu.metal", i);
+            birchPackGetInfo(pack, name, &info);
+            textSize += info.size;
+            textStored += info.storedSize;
+            decoded += birchPackRead(pack, name, text, BENCH_PACK_TEXT_SIZE)
+                           ? info.size
+                           : 0;
+        }
+        elapsed = benchNow() - start;
+    } while (text && elapsed < benchSeconds);
+    free(text);
+
+    bool ok = texture && benchPackVerify(pack, textures);
+    birchPackClose(pack);
+
+    // Reading the whole pack into the heap instead
+    benchPackEvict(path);
+    double residentRead = benchPackResident();
+    start = benchNow();
+    FILE *file = fopen(path, "rb");
+    size_t fileSize = 0;
+    uint8_t *contents = NULL;
+    if (file && fseeko(file, 0, SEEK_END) == 0)
+    {
+        fileSize = (size_t)ftello(file);
+        rewind(file);
+        contents = malloc(fileSize);
+    }
+    bool read = contents && fread(contents, 1, fileSize, file) == fileSize;
+    double readSeconds = benchNow() - start;
+    double residentLoaded = benchPackResident();
+    if (file)
+    {
+        fclose(file);
+    }
+    free(contents);
+    remove(path);
+
+    double megabytes = fileSize / 1048576.0;
+    printf(
+        "pack: %.0f MB, %zu assets, written at %.0f MB/s, %s page cache\n",
+        megabytes,
+        count,
+        megabytes / writeSeconds,
+        evicted ? "cold" : "warm"
+    );
+    printf("%-22s %12s %12s\n", "pack", "time", "resident");
+    printf(
+        "%-22s %10.3f ms %9.1f MB\n",
+        "open",
+        openSeconds * 1e3,
+        (residentOpen - residentBefore) / 1048576
+    );
+    printf("%-22s %10.3f ms\n", "first lookup", lookupSeconds * 1e3);
+    printf(
+        "%-22s %10.3f ms %9.1f MB\n",
+        "read one 8 MB texture",
+        touchSeconds * 1e3,
+        (residentTouched - residentBefore) / 1048576
+    );
+    printf("%-22s %10.1f ns\n", "warm lookup", lookupNanoseconds);
+    printf(
+        "%-22s %7.0f MB/s  %.2fx smaller\n",
+        "LZ4 decompression",
+        decoded / 1048576.0 / elapsed,
+        textStored ? textSize / textStored : 0
+    );
+    printf(
+        "%-22s %10.3f ms %9.1f MB\n",
+        "fread whole pack",
+        readSeconds * 1e3,
+        (residentLoaded - residentRead) / 1048576
+    );
+
+    benchRecord("pack", megabytes, "MB", "pack size");
+    benchRecord("pack", openSeconds * 1e3, "ms", "open");
+    benchRecord("pack", lookupSeconds * 1e3, "ms", "first lookup");
+    benchRecord("pack", touchSeconds * 1e3, "ms", "read one texture");
+    benchRecord("pack", lookupNanoseconds, "ns", "warm lookup");
+    benchRecord(
+        "pack",
+        decoded / 1048576.0 / elapsed,
+        "MB/s",
+        "LZ4 decompression"
+    );
+    benchRecord("pack", readSeconds * 1e3, "ms", "fread whole pack");
+    if (residentBefore >= 0)
+    {
+        benchRecord(
+            "pack",
+            (residentTouched - residentBefore) / 1048576,
+            "MB",
+            "resident after open and one texture"
+        );
+        benchRecord(
+            "pack",
+            (residentLoaded - residentRead) / 1048576,
+            "MB",
+            "resident after fread"
+        );
+    }
+
+    if (!ok || !read || !sum)
+    {
+        fprintf(stderr, "pack contents do not match\n");
+        return false;
+    }
+    return true;
+}
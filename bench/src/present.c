@@ -0,0 +1,104 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+#include <birch/draw.h>
+#include <birch/window.h>
+#include <birch/xcb.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_PRESENT_WIDTH 1280
+#define BENCH_PRESENT_HEIGHT 720
+
+// The same frames presented through MIT-SHM and through xcb_put_image. Run
+// under Xvfb for numbers that do not depend on a compositor.
+bool benchPresent(void)
+{
+    const char *modes[] = {"shm", "put image"};
+
+    printf(
+        "%-10s %10s %12s %14s\n",
+        "present",
+        "frames/s",
+        "latency ms",
+        "bytes/frame"
+    );
+    for (int mode = 0; mode < 2; mode++)
+    {
+        setenv("BIRCH_XCB_SHM", mode == 0 ? "1" : "0", 1);
+        BirchWindow *window = birchWindowNew(
+            BENCH_PRESENT_WIDTH,
+            BENCH_PRESENT_HEIGHT,
+            "bench"
+        );
+        unsetenv("BIRCH_XCB_SHM");
+        if (!window)
+        {
+            fprintf(stderr, "no X display, set DISPLAY or run under Xvfb\n");
+            return false;
+        }
+
+        size_t frames = 0;
+        double start = benchNow();
+        double elapsed;
+        do
+        {
+            float x = (float)(frames % BENCH_PRESENT_WIDTH);
+            birchDrawRect(window, x, 0, 64, 64, (BirchColor){1, 1, 1, 1});
+            birchWindowUpdate(window);
+            frames++;
+            elapsed = benchNow() - start;
+        } while (elapsed < benchSeconds);
+
+        BirchXcbPresentStats stats;
+        birchXcbGetPresentStats(window, &stats);
+        birchWindowFree(window);
+
+        const char *name = stats.sharedMemory ? modes[0] : modes[1];
+        if (mode == 0 && !stats.sharedMemory)
+        {
+            printf("%-10s %s\n", modes[0], "unavailable");
+            continue;
+        }
+        printf(
+            "%-10s %10.1f %12.3f %14zu\n",
+            name,
+            frames / elapsed,
+            stats.presentLatency * 1e3,
+            stats.bytesCopied
+        );
+        benchRecord("present", frames / elapsed, "frames/s", "%s", name);
+        benchRecord(
+            "present",
+            stats.presentLatency * 1e3,
+            "ms",
+            "%s latency",
+            name
+        );
+        benchRecord(
+            "present",
+            (double)stats.bytesCopied,
+            "bytes",
+            "%s copied per frame",
+            name
+        );
+    }
+    return true;
+}
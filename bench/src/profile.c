@@ -0,0 +1,98 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+#include "clock.h"
+#include <birch/draw.h>
+#include <birch/profile.h>
+#include <birch/window.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Cost of one begin/end pair, and a trace of a few real frames
+#define BENCH_PROFILE_ZONES 10000000
+#define BENCH_PROFILE_TRACE "birch_bench_trace.json"
+
+bool benchProfile(void)
+{
+#if defined(BIRCH_PROFILE) && BIRCH_PROFILE
+    uint64_t start = birchClockNow();
+    for (int i = 0; i < BENCH_PROFILE_ZONES; i++)
+    {
+        BIRCH_PROFILE_BEGIN(zone, "bench zone");
+        BIRCH_PROFILE_END(zone);
+    }
+    double elapsed = (birchClockNow() - start) / 1e9;
+    printf(
+        "profile zone   %.1f ns per begin/end\n",
+        elapsed / BENCH_PROFILE_ZONES * 1e9
+    );
+    benchRecord(
+        "profile",
+        elapsed / BENCH_PROFILE_ZONES * 1e9,
+        "ns",
+        "zone"
+    );
+
+    BirchWindow *window = birchWindowNew(1024, 768, "bench");
+    if (!window)
+    {
+        return false;
+    }
+    Vertex *vertices = malloc(10000 * 3 * sizeof(Vertex));
+    if (!vertices)
+    {
+        birchWindowFree(window);
+        return false;
+    }
+    benchTriangles(vertices, 10000, 64.0f, 1024, 768);
+    for (int frame = 0; frame < 10; frame++)
+    {
+        for (size_t i = 0; i < 10000 * 3; i += 3)
+        {
+            const Vertex *v = vertices + i;
+            birchDrawTriangle(
+                window,
+                v[0].position.x,
+                v[0].position.y,
+                v[1].position.x,
+                v[1].position.y,
+                v[2].position.x,
+                v[2].position.y,
+                (BirchColor){v->color.x, v->color.y, v->color.z, 1.0f}
+            );
+        }
+        birchWindowUpdate(window);
+    }
+    free(vertices);
+    birchWindowFree(window);
+
+    bool written = birchProfileWriteTrace(BENCH_PROFILE_TRACE);
+    printf(
+        "profile trace  %s\n",
+        written ? BENCH_PROFILE_TRACE : "could not be written"
+    );
+    return written;
+#else
+    printf(
+        "profile        compiled out, configure with -DBIRCH_PROFILE=ON\n"
+    );
+    return true;
+#endif
+}
@@ -0,0 +1,309 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+#include "raster.h"
+#include "threadPool.h"
+#include "tiler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Single-threaded rasterizer throughput per instruction set
+#define BENCH_RASTER_SIZE 1024
+#define BENCH_RASTER_TRIANGLES 4096
+
+// Tiled rendering of a dense 4K scene per thread count
+#define BENCH_TILED_WIDTH 3840
+#define BENCH_TILED_HEIGHT 2160
+#define BENCH_TILED_TRIANGLES 100000
+#define BENCH_TILED_SIZE 48.0f
+
+typedef struct
+{
+    const char *name;
+    // length of the legs in pixels
+    float size;
+} BenchShape;
+
+static const BenchShape benchShapes[] = {
+    {"small", 4.0f},
+    {"medium", 32.0f},
+    {"large", 512.0f},
+};
+
+static const char *benchIsas[] = {"scalar", "sse2", "avx2"};
+
+static const unsigned int benchThreadCounts[] = {1, 2, 4, 8, 16, 32};
+
+bool benchRaster(void)
+{
+    size_t pixelCount = (size_t)BENCH_RASTER_SIZE * BENCH_RASTER_SIZE;
+    uint32_t *pixels = malloc(pixelCount * 4);
+    Vertex *vertices = malloc(BENCH_RASTER_TRIANGLES * 3 * sizeof(Vertex));
+    if (!pixels || !vertices)
+    {
+        free(pixels);
+        free(vertices);
+        return false;
+    }
+
+    BirchRasterTarget target = {
+        pixels,
+        BENCH_RASTER_SIZE,
+        BENCH_RASTER_SIZE,
+        BENCH_RASTER_SIZE,
+        false,
+    };
+    VertexUniforms uniforms = {BENCH_RASTER_SIZE, BENCH_RASTER_SIZE};
+    bool identical = true;
+
+    printf(
+        "%-8s %-8s %12s %12s  %s\n",
+        "shape",
+        "isa",
+        "Mtris/s",
+        "Mpixels/s",
+        "checksum"
+    );
+    for (size_t s = 0; s < sizeof(benchShapes) / sizeof(benchShapes[0]); s++)
+    {
+        const BenchShape *shape = &benchShapes[s];
+        double pixelsPerTriangle = shape->size * shape->size / 2;
+        uint64_t expected = 0;
+        benchTriangles(
+            vertices,
+            BENCH_RASTER_TRIANGLES,
+            shape->size,
+            BENCH_RASTER_SIZE,
+            BENCH_RASTER_SIZE
+        );
+
+        for (size_t i = 0; i < sizeof(benchIsas) / sizeof(benchIsas[0]); i++)
+        {
+            setenv("BIRCH_RASTER_ISA", benchIsas[i], 1);
+            birchRasterInit();
+            if (strcmp(birchRasterIsa(), benchIsas[i]) != 0)
+            {
+                // Not supported by this CPU or build
+                continue;
+            }
+
+            memset(pixels, 0, pixelCount * 4);
+            birchRasterTriangles(
+                &target,
+                vertices,
+                BENCH_RASTER_TRIANGLES * 3,
+                &uniforms
+            );
+            uint64_t checksum = benchChecksum(pixels, pixelCount);
+            if (i == 0)
+            {
+                expected = checksum;
+            }
+            else if (checksum != expected)
+            {
+                identical = false;
+            }
+
+            size_t triangles = 0;
+            double start = benchNow();
+            double elapsed;
+            do
+            {
+                birchRasterTriangles(
+                    &target,
+                    vertices,
+                    BENCH_RASTER_TRIANGLES * 3,
+                    &uniforms
+                );
+                triangles += BENCH_RASTER_TRIANGLES;
+                elapsed = benchNow() - start;
+            } while (elapsed < benchSeconds);
+
+            printf(
+                "%-8s %-8s %12.3f %12.1f  %016llx\n",
+                shape->name,
+                benchIsas[i],
+                triangles / elapsed / 1e6,
+                triangles * pixelsPerTriangle / elapsed / 1e6,
+                (unsigned long long)checksum
+            );
+            benchRecord(
+                "raster",
+                triangles / elapsed / 1e6,
+                "Mtriangles/s",
+                "%s %s triangles",
+                shape->name,
+                benchIsas[i]
+            );
+            benchRecord(
+                "raster",
+                triangles * pixelsPerTriangle / elapsed / 1e6,
+                "Mpixels/s",
+                "%s %s fill",
+                shape->name,
+                benchIsas[i]
+            );
+        }
+    }
+
+    unsetenv("BIRCH_RASTER_ISA");
+    birchRasterInit();
+    free(vertices);
+    free(pixels);
+
+    if (!identical)
+    {
+        fprintf(stderr, "instruction sets disagree on the output\n");
+    }
+    return identical;
+}
+
+bool benchTiled(void)
+{
+    size_t pixelCount = (size_t)BENCH_TILED_WIDTH * BENCH_TILED_HEIGHT;
+    uint32_t *pixels = malloc(pixelCount * 4);
+    Vertex *vertices = malloc(BENCH_TILED_TRIANGLES * 3 * sizeof(Vertex));
+    if (!pixels || !vertices)
+    {
+        free(pixels);
+        free(vertices);
+        return false;
+    }
+
+    BirchRasterTarget target = {
+        pixels,
+        BENCH_TILED_WIDTH,
+        BENCH_TILED_HEIGHT,
+        BENCH_TILED_WIDTH,
+        false,
+    };
+    VertexUniforms uniforms = {BENCH_TILED_WIDTH, BENCH_TILED_HEIGHT};
+    BirchTiler tiler = {0};
+    bool identical = true;
+    uint64_t expected = 0;
+    double baseline = 0;
+
+    benchTriangles(
+        vertices,
+        BENCH_TILED_TRIANGLES,
+        BENCH_TILED_SIZE,
+        BENCH_TILED_WIDTH,
+        BENCH_TILED_HEIGHT
+    );
+
+    printf(
+        "%-8s %8s %12s %12s %8s  %s\n",
+        "threads",
+        "frames/s",
+        "Mtris/s",
+        "Mpixels/s",
+        "speedup",
+        "checksum"
+    );
+    for (size_t i = 0;
+         i < sizeof(benchThreadCounts) / sizeof(benchThreadCounts[0]);
+         i++)
+    {
+        BirchThreadPool *pool = birchThreadPoolNew(benchThreadCounts[i]);
+        if (benchThreadCounts[i] > 1 && !pool)
+        {
+            continue;
+        }
+
+        memset(pixels, 0, pixelCount * 4);
+        birchTilerRender(
+            &tiler,
+            pool,
+            &target,
+            NULL,
+            vertices,
+            BENCH_TILED_TRIANGLES * 3,
+            NULL,
+            0,
+            NULL,
+            &uniforms
+        );
+        uint64_t checksum = benchChecksum(pixels, pixelCount);
+        if (i == 0)
+        {
+            expected = checksum;
+        }
+        else if (checksum != expected)
+        {
+            identical = false;
+        }
+
+        size_t frames = 0;
+        double start = benchNow();
+        double elapsed;
+        do
+        {
+            birchTilerRender(
+                &tiler,
+                pool,
+                &target,
+                NULL,
+                vertices,
+                BENCH_TILED_TRIANGLES * 3,
+                NULL,
+                0,
+                NULL,
+                &uniforms
+            );
+            frames++;
+            elapsed = benchNow() - start;
+        } while (elapsed < benchSeconds);
+        birchThreadPoolFree(pool);
+
+        double framesPerSecond = frames / elapsed;
+        if (i == 0)
+        {
+            baseline = framesPerSecond;
+        }
+        printf(
+            "%-8u %8.2f %12.3f %12.1f %8.2f  %016llx\n",
+            benchThreadCounts[i],
+            framesPerSecond,
+            framesPerSecond * BENCH_TILED_TRIANGLES / 1e6,
+            framesPerSecond * BENCH_TILED_TRIANGLES * BENCH_TILED_SIZE *
+                BENCH_TILED_SIZE / 2 / 1e6,
+            framesPerSecond / baseline,
+            (unsigned long long)checksum
+        );
+        benchRecord(
+            "tiled",
+            framesPerSecond,
+            "frames/s",
+            "%u threads",
+            benchThreadCounts[i]
+        );
+    }
+
+    birchTilerRelease(&tiler);
+    free(vertices);
+    free(pixels);
+
+    if (!identical)
+    {
+        fprintf(stderr, "thread counts disagree on the output\n");
+    }
+    return identical;
+}
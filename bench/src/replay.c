@@ -0,0 +1,293 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "bench.h"
+#include <birch/headless.h>
+#include <birch/replay.h>
+#include <birch/window.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// A session of 8 kHz mouse motion with a key and a button clicked every
+// half second, drawn with the scene of the scene section
+#define BENCH_REPLAY_FRAMES 600
+#define BENCH_REPLAY_SAMPLES (8000 / 60)
+
+// FNV-1a over everything the callbacks see, to check a replay delivers the
+// recorded session
+static uint64_t benchReplayHash;
+static size_t benchReplayEvents;
+
+static void benchReplayAdd(int type, int a, int b)
+{
+    int values[3] = {type, a, b};
+    const unsigned char *bytes = (const unsigned char *)values;
+    for (size_t i = 0; i < sizeof(values); i++)
+    {
+        benchReplayHash = (benchReplayHash ^ bytes[i]) * 0x100000001b3;
+    }
+    benchReplayEvents++;
+}
+
+static void benchReplayMouseMoved(int x, int y)
+{
+    benchReplayAdd(0, x, y);
+}
+
+static void benchReplayKeyPressed(int key)
+{
+    benchReplayAdd(1, key, 0);
+}
+
+static void benchReplayKeyReleased(int key)
+{
+    benchReplayAdd(2, key, 0);
+}
+
+static void benchReplayButtonPressed(int button)
+{
+    benchReplayAdd(3, button, 0);
+}
+
+static void benchReplayButtonReleased(int button)
+{
+    benchReplayAdd(4, button, 0);
+}
+
+static BirchWindow *benchReplayWindow(void)
+{
+    BirchWindow *window = birchWindowNew(1280, 720, "bench");
+    if (window)
+    {
+        birchWindowSetMouseMovedCallback(window, benchReplayMouseMoved);
+        birchWindowSetKeyPressedCallback(window, benchReplayKeyPressed);
+        birchWindowSetKeyReleasedCallback(window, benchReplayKeyReleased);
+        birchWindowSetMouseButtonPressedCallback(
+            window,
+            benchReplayButtonPressed
+        );
+        birchWindowSetMouseButtonReleasedCallback(
+            window,
+            benchReplayButtonReleased
+        );
+    }
+    benchReplayHash = 0xcbf29ce484222325;
+    benchReplayEvents = 0;
+    return window;
+}
+
+static void benchReplayInject(BirchWindow *window, int frame)
+{
+    for (int i = 0; i < BENCH_REPLAY_SAMPLES; i++)
+    {
+        float t = frame + (float)i / BENCH_REPLAY_SAMPLES;
+        birchHeadlessInjectMouseMoved(window, t * 2.125f, 360 + i * 0.5f);
+    }
+    if (frame % 30 == 0)
+    {
+        birchHeadlessInjectKeyPressed(window, BIRCH_KEY_SPACE);
+        birchHeadlessInjectMouseButtonPressed(window, BIRCH_MOUSE_BUTTON_LEFT);
+    }
+    else if (frame % 30 == 1)
+    {
+        birchHeadlessInjectKeyReleased(window, BIRCH_KEY_SPACE);
+        birchHeadlessInjectMouseButtonReleased(
+            window,
+            BIRCH_MOUSE_BUTTON_LEFT
+        );
+    }
+}
+
+// Run the session live, optionally recording it
+static bool benchReplayLive(const char *path, double *seconds)
+{
+    BirchWindow *window = benchReplayWindow();
+    if (!window || (path && !birchWindowStartRecording(window, path)))
+    {
+        if (window)
+        {
+            birchWindowFree(window);
+        }
+        return false;
+    }
+
+    double start = benchNow();
+    for (int frame = 0; frame < BENCH_REPLAY_FRAMES; frame++)
+    {
+        benchReplayInject(window, frame);
+        benchSceneDraw(window, frame / 60.0f);
+        birchWindowUpdate(window);
+    }
+    *seconds = benchNow() - start;
+
+    bool ok = !path || birchWindowStopRecording(window);
+    birchWindowFree(window);
+    return ok;
+}
+
+// Replay the log until it runs out
+static bool benchReplayRun(
+    const char *path,
+    BirchReplayMode mode,
+    double *seconds,
+    int *frames
+)
+{
+    BirchWindow *window = benchReplayWindow();
+    if (!window || !birchWindowStartReplay(window, path, mode))
+    {
+        if (window)
+        {
+            birchWindowFree(window);
+        }
+        return false;
+    }
+
+    double start = benchNow();
+    *frames = 0;
+    while (birchWindowIsReplaying(window))
+    {
+        benchSceneDraw(window, *frames / 60.0f);
+        birchWindowUpdate(window);
+        ++*frames;
+    }
+    *seconds = benchNow() - start;
+    birchWindowFree(window);
+    return true;
+}
+
+// Recording should cost little next to a frame, and a replay should deliver
+// the session exactly, frame by frame when fast
+bool benchReplay(void)
+{
+    const char *directory = getenv("TMPDIR");
+    char path[1024];
+    snprintf(
+        path,
+        sizeof(path),
+        "%s/birch_bench.birchinput",
+        directory ? directory : "/tmp"
+    );
+
+    double liveSeconds;
+    double recordSeconds;
+    if (!benchReplayLive(NULL, &liveSeconds) ||
+        !benchReplayLive(path, &recordSeconds))
+    {
+        fprintf(stderr, "could not record %s\n", path);
+        remove(path);
+        return false;
+    }
+    uint64_t liveHash = benchReplayHash;
+    size_t events = benchReplayEvents;
+
+    FILE *file = fopen(path, "rb");
+    long size = -1;
+    if (file && fseek(file, 0, SEEK_END) == 0)
+    {
+        size = ftell(file);
+    }
+    if (file)
+    {
+        fclose(file);
+    }
+
+    printf(
+        "%-12s %10s %10s %12s %10s\n",
+        "replay",
+        "frames",
+        "ms/frame",
+        "events",
+        "matches"
+    );
+    printf(
+        "%-12s %10d %10.3f %12zu %10s\n",
+        "live",
+        BENCH_REPLAY_FRAMES,
+        liveSeconds * 1e3 / BENCH_REPLAY_FRAMES,
+        events,
+        "-"
+    );
+    printf(
+        "%-12s %10d %10.3f %12zu %10s\n",
+        "recording",
+        BENCH_REPLAY_FRAMES,
+        recordSeconds * 1e3 / BENCH_REPLAY_FRAMES,
+        events,
+        "-"
+    );
+    benchRecord(
+        "replay",
+        liveSeconds * 1e3 / BENCH_REPLAY_FRAMES,
+        "ms",
+        "live frame"
+    );
+    benchRecord(
+        "replay",
+        recordSeconds * 1e3 / BENCH_REPLAY_FRAMES,
+        "ms",
+        "recording frame"
+    );
+
+    bool ok = true;
+    const char *names[] = {"fast", "real time"};
+    BirchReplayMode modes[] = {BIRCH_REPLAY_FAST, BIRCH_REPLAY_REAL_TIME};
+    for (int i = 0; i < 2; i++)
+    {
+        double seconds;
+        int frames;
+        if (!benchReplayRun(path, modes[i], &seconds, &frames))
+        {
+            remove(path);
+            return false;
+        }
+        bool matches = benchReplayHash == liveHash &&
+                       benchReplayEvents == events;
+        // A fast replay also keeps the recorded frames; the last update
+        // only finds the log exhausted
+        if (modes[i] == BIRCH_REPLAY_FAST)
+        {
+            matches = matches && frames == BENCH_REPLAY_FRAMES + 1;
+        }
+        ok = ok && matches;
+        printf(
+            "%-12s %10d %10.3f %12zu %10s\n",
+            names[i],
+            frames,
+            seconds * 1e3 / frames,
+            benchReplayEvents,
+            matches ? "yes" : "no"
+        );
+        benchRecord(
+            "replay",
+            seconds * 1e3 / frames,
+            "ms",
+            "%s replay frame",
+            names[i]
+        );
+    }
+
+    printf(
+        "log          %.1f KiB, %.2f bytes per event\n",
+        size / 1024.0,
+        (double)size / events
+    );
+    benchRecord("replay", (double)size / events, "bytes", "per event");
+    remove(path);
+    return ok;
+}
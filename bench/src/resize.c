@@ -0,0 +1,116 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+#include "heap.h"
+#include <birch/headless.h>
+#include <birch/window.h>
+#include <stdio.h>
+
+#define BENCH_RESIZE_FRAMES 120
+// Sizes a live resize reports per frame, a few pixels apart
+#define BENCH_RESIZE_STEPS 8
+
+static const char *benchResizeModes[] = {"steady", "resizing"};
+
+static size_t benchResizeCallbacks;
+
+static void benchResizeCallback(int width, int height)
+{
+    benchResizeCallbacks++;
+}
+
+// The dashboard while the window is dragged from 1280x720 to about twice
+// that, against the same frames at a fixed size. Intermediate sizes are
+// dropped, and the framebuffer is only reallocated when it outgrows its
+// headroom.
+bool benchResize(void)
+{
+    printf(
+        "%-14s %10s %10s %10s %10s\n",
+        "resize",
+        "ms/frame",
+        "resizes",
+        "allocs",
+        "KiB"
+    );
+    for (int mode = 0; mode < 2; mode++)
+    {
+        BirchWindow *window = birchWindowNew(1280, 720, "bench");
+        if (!window)
+        {
+            return false;
+        }
+        birchWindowSetResizeCallback(window, benchResizeCallback);
+        benchResizeCallbacks = 0;
+
+        BirchHeapCounters before;
+        birchHeapGetCounters(&before);
+        double start = benchNow();
+        for (int frame = 0; frame < BENCH_RESIZE_FRAMES; frame++)
+        {
+            for (int step = 0; mode && step < BENCH_RESIZE_STEPS; step++)
+            {
+                int grown = frame * BENCH_RESIZE_STEPS + step + 1;
+                birchHeadlessInjectResize(
+                    window,
+                    1280 + grown,
+                    720 + grown * 9 / 16
+                );
+            }
+            benchSceneDraw(window, frame / 60.0f);
+            birchWindowUpdate(window);
+        }
+        double elapsed = benchNow() - start;
+        BirchHeapCounters after;
+        birchHeapGetCounters(&after);
+        size_t coalesced = birchWindowGetCoalescedResizes(window);
+        birchWindowFree(window);
+
+        double milliseconds = elapsed * 1e3 / BENCH_RESIZE_FRAMES;
+        double allocations =
+            (double)(after.allocations - before.allocations) /
+            BENCH_RESIZE_FRAMES;
+        double kibibytes = (double)(after.bytes - before.bytes) / 1024 /
+                           BENCH_RESIZE_FRAMES;
+        printf(
+            "%-14s %10.3f %10.2f %10.2f %10.1f\n",
+            benchResizeModes[mode],
+            milliseconds,
+            (double)benchResizeCallbacks / BENCH_RESIZE_FRAMES,
+            allocations,
+            kibibytes
+        );
+        benchRecord("resize", milliseconds, "ms", "%s", benchResizeModes[mode]);
+        benchRecord(
+            "resize",
+            kibibytes,
+            "KiB",
+            "%s allocated per frame",
+            benchResizeModes[mode]
+        );
+        if (mode && (benchResizeCallbacks > BENCH_RESIZE_FRAMES ||
+                     coalesced + benchResizeCallbacks !=
+                         BENCH_RESIZE_FRAMES * BENCH_RESIZE_STEPS))
+        {
+            return false;
+        }
+    }
+    return true;
+}
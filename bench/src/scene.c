@@ -0,0 +1,149 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+#include <birch/draw.h>
+#include <birch/headless.h>
+#include <birch/window.h>
+#include <math.h>
+#include <stdio.h>
+
+#define BENCH_SCENE_WIDTH 1280
+#define BENCH_SCENE_HEIGHT 720
+#define BENCH_SCENE_COLUMNS 40
+#define BENCH_SCENE_ROWS 20
+#define BENCH_SCENE_LINES 500
+#define BENCH_SCENE_TRIANGLES 1000
+
+// A dashboard-like frame: a background, a grid of tiles, a layer of lines
+// and a layer of gradient triangles, all moving with `time`
+void benchSceneDraw(BirchWindow *window, float time)
+{
+    const float width = BENCH_SCENE_WIDTH;
+    const float height = BENCH_SCENE_HEIGHT;
+    const float cellWidth = width / BENCH_SCENE_COLUMNS;
+    const float cellHeight = height / BENCH_SCENE_ROWS;
+    uint32_t state = 0x2545f491;
+
+    BirchColor background = {0.1f, 0.1f, 0.1f, 1};
+    birchDrawRect(window, 0, 0, width, height, background);
+    for (int row = 0; row < BENCH_SCENE_ROWS; row++)
+    {
+        for (int column = 0; column < BENCH_SCENE_COLUMNS; column++)
+        {
+            float shade = 0.5f + 0.5f * sinf(time + row * 0.3f + column * 0.2f);
+            birchDrawRect(
+                window,
+                column * cellWidth + 2,
+                row * cellHeight + 2,
+                cellWidth - 4,
+                cellHeight - 4,
+                (BirchColor){shade, 0.4f, 1 - shade, 1}
+            );
+        }
+    }
+
+    birchDrawSetLayer(window, 1);
+    for (int i = 0; i < BENCH_SCENE_LINES; i++)
+    {
+        float x = benchRandom(&state) * width;
+        float y = benchRandom(&state) * height;
+        float angle = time + i;
+        birchDrawLine(
+            window,
+            x,
+            y,
+            x + cosf(angle) * 60,
+            y + sinf(angle) * 60,
+            2,
+            (BirchColor){1, 1, 1, 1}
+        );
+    }
+
+    birchDrawSetLayer(window, 2);
+    for (int i = 0; i < BENCH_SCENE_TRIANGLES; i++)
+    {
+        float x = benchRandom(&state) * (width - 40) + 20 * sinf(time);
+        float y = benchRandom(&state) * (height - 40) + 20 * cosf(time);
+        birchDrawTriangleGradient(
+            window,
+            x,
+            y,
+            x + 40,
+            y,
+            x + 20,
+            y + 40,
+            (BirchColor){1, 0, 0, 1},
+            (BirchColor){0, 1, 0, 1},
+            (BirchColor){0, 0, 1, 1}
+        );
+    }
+}
+
+// End to end: record, submit, rasterize with birchInit's thread pool and
+// present, as fast as possible
+bool benchScene(void)
+{
+    BirchWindow *window =
+        birchWindowNew(BENCH_SCENE_WIDTH, BENCH_SCENE_HEIGHT, "bench");
+    if (!window)
+    {
+        return false;
+    }
+
+    // The first frame is the same on every run and every machine
+    benchSceneDraw(window, 0);
+    birchWindowUpdate(window);
+    unsigned int width;
+    unsigned int height;
+    const uint8_t *pixels =
+        birchHeadlessGetFramebuffer(window, &width, &height, NULL);
+    uint64_t checksum =
+        benchChecksum((const uint32_t *)pixels, (size_t)width * height);
+
+    size_t frames = 0;
+    double start = benchNow();
+    double elapsed;
+    do
+    {
+        benchSceneDraw(window, frames / 60.0f);
+        birchWindowUpdate(window);
+        frames++;
+        elapsed = benchNow() - start;
+    } while (elapsed < benchSeconds);
+    birchWindowFree(window);
+
+    printf(
+        "%-10s %10s %10s  %s\n",
+        "scene",
+        "frames/s",
+        "ms/frame",
+        "checksum"
+    );
+    printf(
+        "%-10s %10.1f %10.3f  %016llx\n",
+        "dashboard",
+        frames / elapsed,
+        elapsed / frames * 1e3,
+        (unsigned long long)checksum
+    );
+    benchRecord("scene", frames / elapsed, "frames/s", "dashboard");
+    benchRecord("scene", elapsed / frames * 1e3, "ms", "dashboard frame");
+    return true;
+}
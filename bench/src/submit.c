@@ -0,0 +1,128 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+#include <birch/draw.h>
+#include <birch/window.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_SUBMIT_TRIANGLES 100000
+
+// Record a frame of triangles. With `layers` every other triangle goes to
+// another layer, which defeats batching and makes the update sort.
+static void benchSubmitRecord(
+    BirchWindow *window,
+    const Vertex *vertices,
+    bool layers
+)
+{
+    for (size_t i = 0; i < BENCH_SUBMIT_TRIANGLES; i++)
+    {
+        const Vertex *v = vertices + i * 3;
+        if (layers)
+        {
+            birchDrawSetLayer(window, i & 1);
+        }
+        birchDrawTriangle(
+            window,
+            v[0].position.x,
+            v[0].position.y,
+            v[1].position.x,
+            v[1].position.y,
+            v[2].position.x,
+            v[2].position.y,
+            (BirchColor){v->color.x, v->color.y, v->color.z, 1.0f}
+        );
+    }
+}
+
+// Vertex throughput of the draw API alone, and through birchWindowUpdate,
+// which flattens the command list into the streaming vertex buffer. The
+// triangles lie outside the single pixel window so the CPU rasterizers
+// rejects them during setup.
+bool benchSubmit(void)
+{
+    Vertex *vertices = malloc(BENCH_SUBMIT_TRIANGLES * 3 * sizeof(Vertex));
+    BirchWindow *window = birchWindowNew(1, 1, "bench");
+    if (!vertices || !window)
+    {
+        free(vertices);
+        if (window)
+        {
+            birchWindowFree(window);
+        }
+        return false;
+    }
+    benchTriangles(vertices, BENCH_SUBMIT_TRIANGLES, 16.0f, 1280, 720);
+    for (size_t i = 0; i < BENCH_SUBMIT_TRIANGLES * 3; i++)
+    {
+        vertices[i].position.x += 2.0f;
+    }
+
+    printf(
+        "%-18s %14s %14s\n",
+        "submit",
+        "record Mv/s",
+        "update Mv/s"
+    );
+    const char *names[] = {"in order", "interleaved layers"};
+    for (int layers = 0; layers < 2; layers++)
+    {
+        size_t frames = 0;
+        double recording = 0;
+        double updating = 0;
+        do
+        {
+            double start = benchNow();
+            benchSubmitRecord(window, vertices, layers);
+            double recorded = benchNow();
+            birchWindowUpdate(window);
+            recording += recorded - start;
+            updating += benchNow() - recorded;
+            frames++;
+        } while (recording + updating < benchSeconds);
+
+        double submitted = (double)frames * BENCH_SUBMIT_TRIANGLES * 3;
+        printf(
+            "%-18s %14.1f %14.1f\n",
+            names[layers],
+            submitted / recording / 1e6,
+            submitted / updating / 1e6
+        );
+        benchRecord(
+            "submit",
+            submitted / recording / 1e6,
+            "Mvertices/s",
+            "%s record",
+            names[layers]
+        );
+        benchRecord(
+            "submit",
+            submitted / updating / 1e6,
+            "Mvertices/s",
+            "%s update",
+            names[layers]
+        );
+    }
+
+    birchWindowFree(window);
+    free(vertices);
+    return true;
+}
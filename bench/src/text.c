@@ -0,0 +1,321 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+#include <birch/draw.h>
+#include <birch/text.h>
+#include <birch/window.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_TEXT_WIDTH 1280
+#define BENCH_TEXT_HEIGHT 720
+#define BENCH_TEXT_GLYPHS 100000
+#define BENCH_TEXT_SIZE 8.0f
+
+// Tried in order when --font is not given
+static const char *benchTextFonts[] = {
+    "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf",
+    "/usr/share/fonts/TTF/DejaVuSans.ttf",
+    "/usr/share/fonts/dejavu/DejaVuSans.ttf",
+    "/usr/share/fonts/truetype/liberation/LiberationSans-Regular.ttf",
+    "/usr/share/fonts/liberation-sans/LiberationSans-Regular.ttf",
+    "/System/Library/Fonts/Supplemental/Arial.ttf",
+    "C:\\Windows\\Fonts\\arial.ttf",
+};
+
+static uint8_t *benchTextLoad(const char *path, size_t *size)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        return NULL;
+    }
+    uint8_t *data = NULL;
+    long length;
+    if (fseek(file, 0, SEEK_END) == 0 && (length = ftell(file)) > 0 &&
+        fseek(file, 0, SEEK_SET) == 0 && (data = malloc((size_t)length)))
+    {
+        *size = fread(data, 1, (size_t)length, file);
+        if (*size != (size_t)length)
+        {
+            free(data);
+            data = NULL;
+        }
+    }
+    fclose(file);
+    return data;
+}
+
+// Every printable character of Latin-1 and Latin Extended-A, as UTF-8
+static void benchTextCharset(char *text)
+{
+    for (unsigned int c = 0x20; c < 0x180; c++)
+    {
+        if (c >= 0x7f && c < 0xa0)
+        {
+            continue;
+        }
+        if (c < 0x80)
+        {
+            *text++ = (char)c;
+        }
+        else
+        {
+            *text++ = (char)(0xc0 | c >> 6);
+            *text++ = (char)(0x80 | (c & 0x3f));
+        }
+    }
+    *text = '\0';
+}
+
+// A fresh font per round, so every glyph has its distance field rendered
+static bool benchTextRasterize(const uint8_t *data, size_t size)
+{
+    char charset[1024];
+    benchTextCharset(charset);
+
+    printf(
+        "%-12s %10s %10s %10s %12s\n",
+        "rasterize",
+        "glyphs",
+        "glyphs/s",
+        "us/glyph",
+        "bytes/glyph"
+    );
+    BirchWindow *window =
+        birchWindowNew(BENCH_TEXT_WIDTH, BENCH_TEXT_HEIGHT, "bench");
+    if (!window)
+    {
+        return false;
+    }
+
+    size_t rounds = 0;
+    BirchTextStats stats;
+    size_t memory = 0;
+    double start = benchNow();
+    do
+    {
+        BirchFont *font = birchFontNew(window, data, size);
+        if (!font)
+        {
+            birchWindowFree(window);
+            return false;
+        }
+        birchTextMeasure(font, charset, 16);
+        birchWindowGetTextStats(window, &stats);
+        memory = stats.memory;
+        birchFontFree(font);
+        rounds++;
+    } while (benchNow() - start < benchSeconds);
+    birchWindowGetTextStats(window, &stats);
+    birchWindowFree(window);
+
+    size_t glyphs = stats.misses / rounds;
+    double perSecond = stats.misses / stats.rasterizeTime;
+    printf(
+        "%-12s %10zu %10.0f %10.1f %12.0f\n",
+        "latin",
+        glyphs,
+        perSecond,
+        1e6 / perSecond,
+        (double)memory / glyphs
+    );
+    benchRecord("text", perSecond, "glyphs/s", "rasterize");
+    return true;
+}
+
+#if defined(BIRCH_BENCH_HEADLESS)
+static const char benchTextSample[] =
+    "The quick brown fox jumps over the lazy dog. Sphinx of black quartz, "
+    "judge my vow! \xc3\x84rger \xc3\xbc"
+    "ber \xc3\x96l, \xc3\xa7"
+    "a co\xc3\xbbte 12,50 \xe2\x82\xac, na\xc3\xafve fa\xc3\xa7"
+    "ade. ";
+
+// Lines of the sample packed over the window, overlapping once it is full,
+// until BENCH_TEXT_GLYPHS glyphs are drawn; spaces draw nothing. `scroll`
+// moves everything so no two frames are the same.
+static void benchTextScreen(BirchWindow *window, BirchFont *font, float scroll)
+{
+    size_t characters = 0;
+    for (const char *c = benchTextSample; *c; c++)
+    {
+        characters += (*c & 0xc0) != 0x80 && *c != ' ';
+    }
+
+    BirchColor color = {0.1f, 0.1f, 0.2f, 1};
+    float lineHeight = birchFontGetLineHeight(font, BENCH_TEXT_SIZE);
+    float x = -scroll;
+    float y = BENCH_TEXT_HEIGHT - lineHeight;
+    for (size_t drawn = 0; drawn < BENCH_TEXT_GLYPHS; drawn += characters)
+    {
+        x += birchDrawText(
+            window,
+            font,
+            benchTextSample,
+            x,
+            y,
+            BENCH_TEXT_SIZE,
+            color
+        );
+        if (x > BENCH_TEXT_WIDTH)
+        {
+            x = -scroll;
+            y -= lineHeight;
+        }
+        if (y < 0)
+        {
+            y = BENCH_TEXT_HEIGHT - lineHeight;
+        }
+    }
+}
+
+// Recording the glyphs is what every backend pays for on the CPU; whole
+// frames add the software rasterizer
+static bool benchTextFrames(const uint8_t *data, size_t size)
+{
+    BirchWindow *window =
+        birchWindowNew(BENCH_TEXT_WIDTH, BENCH_TEXT_HEIGHT, "bench");
+    BirchFont *font = window ? birchFontNew(window, data, size) : NULL;
+    if (!font)
+    {
+        birchWindowFree(window);
+        return false;
+    }
+    birchDrawRect(
+        window,
+        0,
+        0,
+        BENCH_TEXT_WIDTH,
+        BENCH_TEXT_HEIGHT,
+        (BirchColor){1, 1, 1, 1}
+    );
+    benchTextScreen(window, font, 0);
+    birchWindowUpdate(window);
+
+    size_t frames = 0;
+    size_t glyphs = 0;
+    double recording = 0;
+    double start = benchNow();
+    double elapsed;
+    do
+    {
+        double recordStart = benchNow();
+        birchDrawRect(
+            window,
+            0,
+            0,
+            BENCH_TEXT_WIDTH,
+            BENCH_TEXT_HEIGHT,
+            (BirchColor){1, 1, 1, 1}
+        );
+        benchTextScreen(window, font, (float)(frames % 16));
+        recording += benchNow() - recordStart;
+        birchWindowUpdate(window);
+        frames++;
+
+        BirchTextStats stats;
+        birchWindowGetTextStats(window, &stats);
+        glyphs += stats.glyphs;
+        elapsed = benchNow() - start;
+    } while (elapsed < benchSeconds);
+
+    BirchTextStats stats;
+    birchWindowGetTextStats(window, &stats);
+    BirchDrawStats drawStats;
+    birchWindowGetDrawStats(window, &drawStats);
+    birchWindowFree(window);
+
+    printf(
+        "%-12s %10s %10s %10s %10s\n",
+        "draw",
+        "glyphs",
+        "frames/s",
+        "ms/frame",
+        "Mglyphs/s"
+    );
+    double perFrame = (double)glyphs / frames;
+    printf(
+        "%-12s %10.0f %10.1f %10.3f %10.2f\n",
+        "record",
+        perFrame,
+        frames / recording,
+        recording / frames * 1e3,
+        glyphs / recording / 1e6
+    );
+    printf(
+        "%-12s %10.0f %10.1f %10.3f %10.2f\n",
+        "frame",
+        perFrame,
+        frames / elapsed,
+        elapsed / frames * 1e3,
+        glyphs / elapsed / 1e6
+    );
+    printf(
+        "\ncache: %.4f%% hits, %zu glyphs, %.1f KB, %zu draw calls\n",
+        stats.hitRate * 100,
+        stats.cachedGlyphs,
+        stats.memory / 1024.0,
+        drawStats.drawCalls
+    );
+    benchRecord("text", glyphs / recording, "glyphs/s", "record");
+    benchRecord("text", frames / elapsed, "frames/s", "frame");
+    benchRecord("text", stats.hitRate, "ratio", "hit rate");
+    benchRecord("text", (double)stats.memory, "bytes", "memory");
+    return true;
+}
+#endif
+
+bool benchText(void)
+{
+    const char *path = benchFontPath;
+    for (size_t i = 0;
+         !path && i < sizeof(benchTextFonts) / sizeof(benchTextFonts[0]);
+         i++)
+    {
+        FILE *file = fopen(benchTextFonts[i], "rb");
+        if (file)
+        {
+            fclose(file);
+            path = benchTextFonts[i];
+        }
+    }
+    if (!path)
+    {
+        printf("text: no font found, pass --font PATH\n");
+        return true;
+    }
+
+    size_t size;
+    uint8_t *data = benchTextLoad(path, &size);
+    if (!data)
+    {
+        fprintf(stderr, "could not read %s\n", path);
+        return false;
+    }
+    printf("font %s\n\n", path);
+    bool ok = benchTextRasterize(data, size);
+#if defined(BIRCH_BENCH_HEADLESS)
+    printf("\n");
+    ok = benchTextFrames(data, size) && ok;
+#endif
+    free(data);
+    return ok;
+}
@@ -0,0 +1,125 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "bench.h"
+#include "clock.h"
+#include <birch/headless.h>
+#include <birch/window.h>
+#include <stdio.h>
+
+#define BENCH_THREADED_FRAMES 130
+
+// Application work per frame: a few milliseconds, and every eighth frame a
+// spike longer than the 60 Hz refresh period, on average well within it.
+// The thread sleeps through it, as when it waits for I/O or for workers on
+// other CPUs, so the numbers do not depend on a spare CPU for rendering.
+static void benchThreadedWork(uint32_t *seed, unsigned int frame)
+{
+    double milliseconds =
+        frame % 8 == 7 ? 22.0 : 2.0 + 4.0 * benchRandom(seed);
+    birchClockSleepUntil(birchClockNow() + (uint64_t)(milliseconds * 1e6));
+}
+
+// With vsync, a frame rendered inside birchWindowUpdate misses the refresh
+// whenever the application is slow. Frames queued for a render thread keep
+// the screen at the refresh rate through the spikes, at the price of input
+// waiting longer before it is seen: latency is measured from a mouse move
+// injected before the work of every frame to the present showing it.
+bool benchThreaded(void)
+{
+    printf(
+        "%-14s %10s %10s %10s %10s %10s %10s\n",
+        "threaded",
+        "present ms",
+        "jitter ms",
+        "max ms",
+        "update ms",
+        "input p50",
+        "input p99"
+    );
+    for (unsigned int ahead = 0; ahead <= BIRCH_MAX_FRAMES_AHEAD; ahead++)
+    {
+        BirchWindow *window = birchWindowNew(1280, 720, "bench");
+        if (!window)
+        {
+            return false;
+        }
+        birchWindowSetVsync(window, true);
+        if (!birchWindowSetRenderThread(window, ahead))
+        {
+            birchWindowFree(window);
+            return false;
+        }
+
+        uint32_t seed = 0x7f4a7c15;
+        for (unsigned int frame = 0; frame < BENCH_THREADED_FRAMES; frame++)
+        {
+            birchHeadlessInjectMouseMoved(window, frame % 640, 360);
+            benchThreadedWork(&seed, frame);
+            benchSceneDraw(window, frame / 60.0f);
+            birchWindowUpdate(window);
+        }
+        birchWindowFinishFrames(window);
+
+        BirchFrameStats present;
+        BirchFrameStats update;
+        birchWindowGetPresentStats(window, &present);
+        birchWindowGetFrameStats(window, &update);
+        BirchLatencyStats latency;
+        birchWindowGetLatencyStats(window, &latency);
+        birchWindowFree(window);
+
+        char name[32];
+        if (ahead)
+        {
+            snprintf(name, sizeof(name), "%u ahead", ahead);
+        }
+        else
+        {
+            snprintf(name, sizeof(name), "no thread");
+        }
+        printf(
+            "%-14s %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+            name,
+            present.frameTime * 1e3,
+            present.jitter * 1e3,
+            present.maxFrameTime * 1e3,
+            update.frameTime * 1e3,
+            latency.p50 * 1e3,
+            latency.p99 * 1e3
+        );
+        benchRecord("threaded", present.frameTime * 1e3, "ms", "%s", name);
+        benchRecord(
+            "threaded",
+            present.jitter * 1e3,
+            "ms",
+            "%s jitter",
+            name
+        );
+        benchRecord(
+            "threaded",
+            present.maxFrameTime * 1e3,
+            "ms",
+            "%s max",
+            name
+        );
+        benchRecord("threaded", latency.p50 * 1e3, "ms", "%s input p50", name);
+        benchRecord("threaded", latency.p99 * 1e3, "ms", "%s input p99", name);
+    }
+    return true;
+}
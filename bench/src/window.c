@@ -0,0 +1,72 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+#include <birch/window.h>
+#include <stdio.h>
+
+#define BENCH_WINDOW_WIDTH 1280
+#define BENCH_WINDOW_HEIGHT 720
+
+// Create and free windows back to back, optionally presenting one empty
+// frame in between, which is where the backend allocates its framebuffer
+// and streaming buffers
+static bool benchWindowCycle(bool present, double *perWindow)
+{
+    size_t windows = 0;
+    double start = benchNow();
+    double elapsed;
+    do
+    {
+        BirchWindow *window =
+            birchWindowNew(BENCH_WINDOW_WIDTH, BENCH_WINDOW_HEIGHT, "bench");
+        if (!window)
+        {
+            return false;
+        }
+        if (present)
+        {
+            birchWindowUpdate(window);
+        }
+        birchWindowFree(window);
+        windows++;
+        elapsed = benchNow() - start;
+    } while (elapsed < benchSeconds);
+
+    *perWindow = elapsed / windows;
+    return true;
+}
+
+bool benchWindow(void)
+{
+    const char *names[] = {"create, free", "create, frame, free"};
+
+    printf("%-22s %12s\n", "window", "us/window");
+    for (int i = 0; i < 2; i++)
+    {
+        double perWindow;
+        if (!benchWindowCycle(i == 1, &perWindow))
+        {
+            return false;
+        }
+        printf("%-22s %12.1f\n", names[i], perWindow * 1e6);
+        benchRecord("window", perWindow * 1e6, "us", "%s", names[i]);
+    }
+    return true;
+}
@@ -0,0 +1,166 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+#include <birch/draw.h>
+#include <birch/headless.h>
+#include <birch/window.h>
+#include <stdio.h>
+
+#define BENCH_WINDOWS_MAX 16
+#define BENCH_WINDOWS_WIDTH 320
+#define BENCH_WINDOWS_HEIGHT 180
+#define BENCH_WINDOWS_SAMPLES 8
+
+static const unsigned int benchWindowsCounts[] = {1, 2, 4, 8, 16};
+
+static const char *benchWindowsModes[] = {"update", "poll"};
+
+static void benchWindowsMoved(int x, int y)
+{
+}
+
+// One frame of every window: a little input each, one pump of all of them
+// with birchPollEvents or one per birchWindowUpdate, then a small redraw
+static void benchWindowsFrame(
+    BirchWindow **windows,
+    unsigned int count,
+    bool poll,
+    size_t frame,
+    double *pollSeconds
+)
+{
+    for (unsigned int i = 0; i < count; i++)
+    {
+        for (int j = 0; j < BENCH_WINDOWS_SAMPLES; j++)
+        {
+            birchHeadlessInjectMouseMoved(windows[i], frame % 320, j);
+        }
+    }
+
+    if (poll)
+    {
+        double start = benchNow();
+        birchPollEvents();
+        *pollSeconds += benchNow() - start;
+    }
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        float x = (float)((frame + i * 16) % 280);
+        birchDrawRect(windows[i], 0, 0, 320, 180, (BirchColor){0, 0, 0, 1});
+        birchDrawRect(windows[i], x, 60, 40, 40, (BirchColor){1, 0.5f, 0, 1});
+        birchWindowUpdate(windows[i]);
+    }
+}
+
+// Per window cost should stay flat as windows are added, with the OS events
+// of all of them pumped once per frame
+bool benchWindows(void)
+{
+    printf(
+        "%-10s %8s %10s %12s %12s %12s\n",
+        "windows",
+        "count",
+        "frames",
+        "us/frame",
+        "us/window",
+        "us/poll"
+    );
+
+    BirchWindow *windows[BENCH_WINDOWS_MAX];
+    for (int mode = 0; mode <= 1; mode++)
+    {
+        size_t countCount =
+            sizeof(benchWindowsCounts) / sizeof(benchWindowsCounts[0]);
+        for (size_t c = 0; c < countCount; c++)
+        {
+            unsigned int count = benchWindowsCounts[c];
+            for (unsigned int i = 0; i < count; i++)
+            {
+                windows[i] = birchWindowNew(
+                    BENCH_WINDOWS_WIDTH,
+                    BENCH_WINDOWS_HEIGHT,
+                    "bench"
+                );
+                if (!windows[i])
+                {
+                    while (i > 0)
+                    {
+                        birchWindowFree(windows[--i]);
+                    }
+                    return false;
+                }
+                birchWindowSetMouseMovedCallback(
+                    windows[i],
+                    benchWindowsMoved
+                );
+            }
+
+            double pollSeconds = 0;
+            size_t frame = 0;
+            for (; frame < 30; frame++)
+            {
+                benchWindowsFrame(windows, count, mode, frame, &pollSeconds);
+            }
+
+            pollSeconds = 0;
+            size_t frames = 0;
+            double start = benchNow();
+            double elapsed;
+            do
+            {
+                benchWindowsFrame(
+                    windows,
+                    count,
+                    mode,
+                    frame++,
+                    &pollSeconds
+                );
+                frames++;
+                elapsed = benchNow() - start;
+            } while (elapsed < benchSeconds);
+
+            for (unsigned int i = 0; i < count; i++)
+            {
+                birchWindowFree(windows[i]);
+            }
+
+            double perFrame = elapsed * 1e6 / frames;
+            printf(
+                "%-10s %8u %10zu %12.1f %12.1f %12.2f\n",
+                benchWindowsModes[mode],
+                count,
+                frames,
+                perFrame,
+                perFrame / count,
+                pollSeconds * 1e6 / frames
+            );
+            benchRecord(
+                "windows",
+                perFrame / count,
+                "us/window",
+                "%s %u windows",
+                benchWindowsModes[mode],
+                count
+            );
+        }
+    }
+    return true;
+}
@@ -0,0 +1,421 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Build-time generator behind FileEmbed.cmake. It never parses the assets:
+//
+//   FileEmbed incbin|array NAME FILE DIR
+//     writes DIR/NAME.h and DIR/NAME.c, defining NAME_data and NAME_size.
+//     incbin has the assembler include the file with .incbin, so the cost
+//     does not depend on the C compiler; array spells it out as a C array
+//     for compilers without GNU assembler syntax, e.g. MSVC.
+//   FileEmbed index DIR NAME FILE...
+//     writes DIR/file_embed.h and DIR/file_embed.c, a table of the assets
+//     sorted by name and file_embed_find to search it.
+//
+// The data is const, 16 byte aligned and followed by a NUL byte that is not
+// counted in the size, so text assets can be used as C strings.
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define FILE_EMBED_ALIGNMENT 16
+
+static bool fileEmbedSize(const char *path, unsigned long long *size)
+{
+#if defined(_WIN32)
+    struct _stat64 info;
+    int result = _stat64(path, &info);
+#else
+    struct stat info;
+    int result = stat(path, &info);
+#endif
+    if (result != 0)
+    {
+        fprintf(stderr, "FileEmbed: %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    *size = (unsigned long long)info.st_size;
+    return true;
+}
+
+static FILE *fileEmbedOpen(const char *dir, const char *name, const char *ext)
+{
+    size_t length = strlen(dir) + strlen(name) + strlen(ext) + 2;
+    char *path = malloc(length);
+    if (!path)
+    {
+        return NULL;
+    }
+    snprintf(path, length, "%s/%s%s", dir, name, ext);
+
+    FILE *file = fopen(path, "wb");
+    if (!file)
+    {
+        fprintf(stderr, "FileEmbed: %s: %s\n", path, strerror(errno));
+    }
+    free(path);
+    return file;
+}
+
+// Quote a path for an assembler or C string literal
+static void fileEmbedQuote(FILE *out, const char *string)
+{
+    fputc('"', out);
+    for (; *string; string++)
+    {
+        if (*string == '"' || *string == '\\')
+        {
+            fputc('\\', out);
+        }
+        fputc(*string, out);
+    }
+    fputc('"', out);
+}
+
+static bool fileEmbedHeader(const char *dir, const char *name)
+{
+    FILE *out = fileEmbedOpen(dir, name, ".h");
+    if (!out)
+    {
+        return false;
+    }
+
+    fprintf(
+        out,
+        "// Generated by FileEmbed, do not edit\n"
+        "#ifndef %s_H\n"
+        "#define %s_H\n"
+        "#include <stddef.h>\n"
+        "#include <stdint.h>\n"
+        "#ifdef __cplusplus\n"
+        "extern \"C\" {\n"
+        "#endif\n"
+        "extern const uint8_t %s_data[];\n"
+        "extern const size_t %s_size;\n"
+        "#ifdef __cplusplus\n"
+        "}\n"
+        "#endif\n"
+        "#endif\n",
+        name,
+        name,
+        name,
+        name
+    );
+    return fclose(out) == 0;
+}
+
+static bool fileEmbedIncbin(
+    const char *name,
+    const char *path,
+    const char *dir,
+    unsigned long long size
+)
+{
+    FILE *out = fileEmbedOpen(dir, name, ".c");
+    if (!out)
+    {
+        return false;
+    }
+
+    fprintf(
+        out,
+        "// Generated by FileEmbed, do not edit\n"
+        "#include \"%s.h\"\n"
+        "\n"
+        "#define FILE_EMBED_STRING(x) #x\n"
+        "#define FILE_EMBED_PREFIX(x) FILE_EMBED_STRING(x)\n"
+        "#define FILE_EMBED_SYMBOL FILE_EMBED_PREFIX(__USER_LABEL_PREFIX__) "
+        "\"%s_data\"\n"
+        "#if defined(__APPLE__)\n"
+        "#define FILE_EMBED_SECTION \".const_data\"\n"
+        "#elif defined(_WIN32)\n"
+        "#define FILE_EMBED_SECTION \".section .rdata,\\\"dr\\\"\"\n"
+        "#else\n"
+        "#define FILE_EMBED_SECTION \".section .rodata\"\n"
+        "#endif\n"
+        "\n"
+        "const size_t %s_size = %lluu;\n"
+        "\n"
+        "__asm__(\n"
+        "    FILE_EMBED_SECTION \"\\n\"\n"
+        "    \".globl \" FILE_EMBED_SYMBOL \"\\n\"\n"
+        "    \".balign %d\\n\"\n"
+        "    FILE_EMBED_SYMBOL \":\\n\"\n"
+        "    \".incbin \" ",
+        name,
+        name,
+        name,
+        size,
+        FILE_EMBED_ALIGNMENT
+    );
+    // The path is a C string holding an assembler string
+    fputs("\"\\\"", out);
+    for (const char *c = path; *c; c++)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            fputs("\\\\\\", out);
+        }
+        fputc(*c, out);
+    }
+    fputs(
+        "\\\"\\n\"\n"
+        "    \".byte 0\\n\"\n"
+        "    \".text\\n\"\n"
+        ");\n",
+        out
+    );
+    return fclose(out) == 0;
+}
+
+static bool fileEmbedArray(
+    const char *name,
+    const char *path,
+    const char *dir,
+    unsigned long long size
+)
+{
+    FILE *in = fopen(path, "rb");
+    if (!in)
+    {
+        fprintf(stderr, "FileEmbed: %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    FILE *out = fileEmbedOpen(dir, name, ".c");
+    if (!out)
+    {
+        fclose(in);
+        return false;
+    }
+
+    fprintf(
+        out,
+        "// Generated by FileEmbed, do not edit\n"
+        "#include \"%s.h\"\n"
+        "\n"
+        "const size_t %s_size = %lluu;\n"
+        "_Alignas(%d) const uint8_t %s_data[] = {\n",
+        name,
+        name,
+        size,
+        FILE_EMBED_ALIGNMENT,
+        name
+    );
+
+    unsigned char buffer[1 << 16];
+    size_t read;
+    size_t column = 0;
+    while ((read = fread(buffer, 1, sizeof(buffer), in)) > 0)
+    {
+        for (size_t i = 0; i < read; i++)
+        {
+            fprintf(out, "%u,", buffer[i]);
+            if (++column == 32)
+            {
+                fputc('\n', out);
+                column = 0;
+            }
+        }
+    }
+    fputs("0};\n", out);
+
+    bool ok = !ferror(in);
+    fclose(in);
+    return fclose(out) == 0 && ok;
+}
+
+typedef struct
+{
+    const char *name;
+    const char *path;
+} FileEmbedEntry;
+
+static int fileEmbedCompare(const void *a, const void *b)
+{
+    return strcmp(
+        ((const FileEmbedEntry *)a)->name,
+        ((const FileEmbedEntry *)b)->name
+    );
+}
+
+// Must match string(MAKE_C_IDENTIFIER) in FileEmbed.cmake
+static void fileEmbedIdentifier(FILE *out, const char *name)
+{
+    if (*name >= '0' && *name <= '9')
+    {
+        fputc('_', out);
+    }
+    for (; *name; name++)
+    {
+        char c = *name;
+        bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                     (c >= '0' && c <= '9') || c == '_';
+        fputc(valid ? c : '_', out);
+    }
+}
+
+static bool fileEmbedIndex(const char *dir, FileEmbedEntry *entries, int count)
+{
+    qsort(entries, count, sizeof(FileEmbedEntry), fileEmbedCompare);
+
+    FILE *header = fileEmbedOpen(dir, "file_embed", ".h");
+    if (!header)
+    {
+        return false;
+    }
+    fputs(
+        "// Generated by FileEmbed, do not edit\n"
+        "#ifndef file_embed_H\n"
+        "#define file_embed_H\n"
+        "#include <stddef.h>\n"
+        "#include <stdint.h>\n"
+        "#ifdef __cplusplus\n"
+        "extern \"C\" {\n"
+        "#endif\n"
+        "typedef struct\n"
+        "{\n"
+        "    const char *name;\n"
+        "    const uint8_t *data;\n"
+        "    size_t size;\n"
+        "} file_embed_asset;\n"
+        "// Every embedded asset, sorted by file name\n"
+        "extern const file_embed_asset file_embed_assets[];\n"
+        "extern const size_t file_embed_asset_count;\n"
+        "// Find an asset by file name, NULL if there is none\n"
+        "const file_embed_asset *file_embed_find(const char *name);\n"
+        "#ifdef __cplusplus\n"
+        "}\n"
+        "#endif\n"
+        "#endif\n",
+        header
+    );
+    if (fclose(header) != 0)
+    {
+        return false;
+    }
+
+    FILE *out = fileEmbedOpen(dir, "file_embed", ".c");
+    if (!out)
+    {
+        return false;
+    }
+    fputs(
+        "// Generated by FileEmbed, do not edit\n"
+        "#include \"file_embed.h\"\n"
+        "#include <stdlib.h>\n"
+        "#include <string.h>\n"
+        "\n",
+        out
+    );
+    for (int i = 0; i < count; i++)
+    {
+        fputs("#include \"", out);
+        fileEmbedIdentifier(out, entries[i].name);
+        fputs(".h\"\n", out);
+    }
+
+    fputs("\nconst file_embed_asset file_embed_assets[] = {\n", out);
+    for (int i = 0; i < count; i++)
+    {
+        unsigned long long size;
+        if (!fileEmbedSize(entries[i].path, &size))
+        {
+            fclose(out);
+            return false;
+        }
+        fputs("    {", out);
+        fileEmbedQuote(out, entries[i].name);
+        fputs(", ", out);
+        fileEmbedIdentifier(out, entries[i].name);
+        fprintf(out, "_data, %lluu},\n", size);
+    }
+    // An empty initializer list is not valid C
+    if (!count)
+    {
+        fputs("    {NULL, NULL, 0},\n", out);
+    }
+    fprintf(
+        out,
+        "};\n"
+        "const size_t file_embed_asset_count = %d;\n"
+        "\n"
+        "static int file_embed_compare(const void *name, const void *asset)\n"
+        "{\n"
+        "    return strcmp(name, ((const file_embed_asset *)asset)->name);\n"
+        "}\n"
+        "\n"
+        "const file_embed_asset *file_embed_find(const char *name)\n"
+        "{\n"
+        "    return bsearch(name, file_embed_assets, file_embed_asset_count,\n"
+        "                   sizeof(file_embed_asset), file_embed_compare);\n"
+        "}\n",
+        count
+    );
+    return fclose(out) == 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 5 &&
+        (strcmp(argv[1], "incbin") == 0 || strcmp(argv[1], "array") == 0))
+    {
+        const char *name = argv[2];
+        const char *path = argv[3];
+        const char *dir = argv[4];
+        unsigned long long size;
+        if (!fileEmbedSize(path, &size) || !fileEmbedHeader(dir, name))
+        {
+            return 1;
+        }
+        bool ok = strcmp(argv[1], "incbin") == 0
+                      ? fileEmbedIncbin(name, path, dir, size)
+                      : fileEmbedArray(name, path, dir, size);
+        return ok ? 0 : 1;
+    }
+
+    if (argc >= 3 && argc % 2 == 1 && strcmp(argv[1], "index") == 0)
+    {
+        int count = (argc - 3) / 2;
+        FileEmbedEntry *entries =
+            malloc((count ? count : 1) * sizeof(FileEmbedEntry));
+        if (!entries)
+        {
+            return 1;
+        }
+        for (int i = 0; i < count; i++)
+        {
+            entries[i].name = argv[3 + i * 2];
+            entries[i].path = argv[4 + i * 2];
+        }
+        bool ok = fileEmbedIndex(argv[2], entries, count);
+        free(entries);
+        return ok ? 0 : 1;
+    }
+
+    fprintf(
+        stderr,
+        "usage: FileEmbed incbin|array NAME FILE DIR\n"
+        "       FileEmbed index DIR [NAME FILE]...\n"
+    );
+    return 2;
+}
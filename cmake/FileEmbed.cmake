@@ -1,87 +1,77 @@
+# Embeds files into the file_embed library. Each file gets a header in the
+# file_embed include directory, named after the file as a C identifier
+# (shaders.metallib becomes shaders_metallib.h), declaring
+#
+#     extern const uint8_t shaders_metallib_data[];
+#     extern const size_t shaders_metallib_size;
+#
+# and file_embed.h indexes every embedded file by its file name through
+# file_embed_find. The data is written by a small C program rather than
+# CMake string operations, with .incbin where the compiler supports it, so
+# embedding costs about as much as copying the files.
+
+set(FILE_EMBED_SOURCE_DIR ${CMAKE_CURRENT_LIST_DIR})
+
 function(FileEmbedSetup)
 
-    if (NOT EXISTS ${CMAKE_BINARY_DIR}/file_embed)
-        file(MAKE_DIRECTORY ${CMAKE_BINARY_DIR}file_embed)
-    endif ()
+    set(dir ${CMAKE_BINARY_DIR}/file_embed)
+    file(MAKE_DIRECTORY ${dir})
 
-    if (NOT EXISTS ${CMAKE_BINARY_DIR}/file_embed/file_embed_empty.c)
-        file(WRITE ${CMAKE_BINARY_DIR}/file_embed/file_embed_empty.c "")
-    endif ()
+    add_executable(file_embed_generate ${FILE_EMBED_SOURCE_DIR}/FileEmbed.c)
 
-    add_library(file_embed ${CMAKE_BINARY_DIR}/file_embed/file_embed_empty.c)
-    target_include_directories(file_embed PUBLIC ${CMAKE_BINARY_DIR}/file_embed)
-
-endfunction()
-
-function(FileEmbedAdd file)
-    FileEmbedGenerate(${file} var)
-    target_sources(file_embed PUBLIC ${var})
+    add_library(file_embed ${dir}/file_embed.c)
+    target_include_directories(file_embed PUBLIC ${dir})
 
+    # The index is generated last, from the files all FileEmbedAdd calls
+    # recorded on the target
+    set(files $<TARGET_PROPERTY:file_embed,FILE_EMBED_FILES>)
+    set(arguments $<TARGET_PROPERTY:file_embed,FILE_EMBED_ARGUMENTS>)
     add_custom_command(
-            OUTPUT ${var}
-            COMMAND ${CMAKE_COMMAND}
-            -DRUN_FILE_EMBED_GENERATE=1
-            -DFILE_EMBED_GENERATE_PATH=${file}
-            -P ${CMAKE_SOURCE_DIR}/cmake/FileEmbed.cmake
-            MAIN_DEPENDENCY ${file}
+            OUTPUT ${dir}/file_embed.c ${dir}/file_embed.h
+            COMMAND file_embed_generate index ${dir} ${arguments}
+            DEPENDS file_embed_generate ${files}
+            COMMAND_EXPAND_LISTS
+            VERBATIM
     )
+
 endfunction()
 
-function(FileEmbedGenerate file generated_c)
+function(FileEmbedAdd)
 
-    get_filename_component(base_filename ${file} NAME)
-    set(output_filename "${base_filename}.c")
-    string(MAKE_C_IDENTIFIER ${base_filename} c_name)
-    file(READ ${file} content HEX)
+    set(dir ${CMAKE_BINARY_DIR}/file_embed)
 
-    # Separate into individual bytes.
-    string(REGEX MATCHALL "([A-Fa-f0-9][A-Fa-f0-9])" SEPARATED_HEX ${content})
+    # GNU assembler syntax is understood by GCC and Clang on every platform
+    if (CMAKE_C_COMPILER_ID MATCHES "GNU|Clang")
+        set(mode incbin)
+    else ()
+        set(mode array)
+    endif ()
 
-    set(output_c "")
+    get_target_property(names file_embed FILE_EMBED_NAMES)
+    if (NOT names)
+        set(names "")
+    endif ()
 
-    set(counter 0)
-    foreach (hex IN LISTS SEPARATED_HEX)
-        string(APPEND output_c "0x${hex},")
-        MATH(EXPR counter "${counter}+1")
-        if (counter GREATER 16)
-            string(APPEND output_c "\n    ")
-            set(counter 0)
+    foreach (file IN LISTS ARGN)
+        get_filename_component(file ${file} ABSOLUTE)
+        get_filename_component(name ${file} NAME)
+        string(MAKE_C_IDENTIFIER ${name} c_name)
+        if (c_name IN_LIST names)
+            message(FATAL_ERROR "FileEmbed: ${file} is embedded as ${c_name} twice")
         endif ()
+        list(APPEND names ${c_name})
+
+        add_custom_command(
+                OUTPUT ${dir}/${c_name}.c ${dir}/${c_name}.h
+                COMMAND file_embed_generate ${mode} ${c_name} ${file} ${dir}
+                DEPENDS file_embed_generate ${file}
+                VERBATIM
+        )
+        target_sources(file_embed PRIVATE ${dir}/${c_name}.c)
+        set_property(TARGET file_embed APPEND PROPERTY FILE_EMBED_FILES ${file})
+        set_property(TARGET file_embed APPEND PROPERTY FILE_EMBED_ARGUMENTS ${name} ${file})
     endforeach ()
 
-    set(output_c "
-#include \"${c_name}.h\"
-uint8_t ${c_name}_data[] = {
-    ${output_c}
-}\;
-unsigned ${c_name}_size = sizeof(${c_name}_data)\;
-")
-
-    set(output_h "
-#ifndef ${c_name}_H
-#define ${c_name}_H
-#include \"stdint.h\"
-extern uint8_t ${c_name}_data[]\;
-extern unsigned ${c_name}_size\;
-#endif // ${c_name}_H
-    ")
-
-
-    if (NOT EXISTS ${CMAKE_BINARY_DIR}/file_embed)
-        file(MAKE_DIRECTORY ${CMAKE_BINARY_DIR}/file_embed)
-    endif ()
-
-
-    file(WRITE ${CMAKE_BINARY_DIR}/file_embed/${c_name}.c
-            ${output_c})
-
-    file(WRITE ${CMAKE_BINARY_DIR}/file_embed/${c_name}.h
-            ${output_h})
-
-    set(${generated_c} ${CMAKE_BINARY_DIR}/file_embed/${c_name}.c PARENT_SCOPE)
+    set_property(TARGET file_embed PROPERTY FILE_EMBED_NAMES ${names})
 
 endfunction()
-
-if (RUN_FILE_EMBED_GENERATE)
-    FileEmbedGenerate(${FILE_EMBED_GENERATE_PATH} var)
-endif ()
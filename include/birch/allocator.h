@@ -0,0 +1,91 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef BIRCH_ALLOCATOR_H
+#define BIRCH_ALLOCATOR_H
+
+#include "window.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Every allocation birch makes goes through one allocator, malloc unless
+// birchSetAllocator replaces it. Memory returned by the OS libraries birch
+// calls (xcb replies, Objective-C objects) is not birch's and is not
+// counted.
+//
+// Transient data that lives for a single frame comes from a per-window
+// linear arena instead. The arena is reset at the end of every
+// birchWindowUpdate and keeps its memory, so once it has grown to the
+// largest frame, frames allocate nothing from the heap.
+
+typedef struct
+{
+    /// like malloc, realloc and free, with `user` passed back. All three
+    /// are required.
+    void *(*allocate)(void *user, size_t size);
+    void *(*reallocate)(void *user, void *pointer, size_t size);
+    void (*free)(void *user, void *pointer);
+    void *user;
+} BirchAllocator;
+
+typedef struct
+{
+    /// heap allocations and reallocations made during the window's last
+    /// frame, from any thread or window, and the bytes they asked for
+    size_t frameAllocations;
+    size_t frameBytes;
+    /// since the program started: heap allocations and reallocations, and
+    /// blocks still allocated
+    size_t totalAllocations;
+    size_t liveAllocations;
+    /// bytes taken from the window's frame arena by its last frame, and the
+    /// size of the arena
+    size_t arenaBytes;
+    size_t arenaCapacity;
+} BirchAllocationStats;
+
+/// @brief Route every allocation of birch through `allocator`
+/// @param allocator copied, NULL to go back to malloc. birch frees memory
+/// with the allocator current at the time, so set it before birchInit; it
+/// can only be replaced later by one that frees what the previous one
+/// allocated, like another wrapper around malloc.
+/// @return false, keeping the current allocator, if any of the three hooks
+/// is NULL
+bool birchSetAllocator(const BirchAllocator *allocator);
+
+/// @brief Allocate transient memory from the window's frame arena
+/// @return 16 byte aligned memory that stays valid until the end of the
+/// next birchWindowUpdate, NULL if out of memory. It is never freed
+/// individually. Only call it from the thread that updates the window.
+void *birchWindowFrameAllocate(BirchWindow *window, size_t size);
+
+/// @brief Get the allocation counters of the last frame of a window
+void birchWindowGetAllocationStats(
+    BirchWindow *window,
+    BirchAllocationStats *stats
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
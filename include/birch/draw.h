@@ -0,0 +1,139 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BIRCH_DRAW_H
+#define BIRCH_DRAW_H
+
+#include "window.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Immediate-mode 2D drawing. Coordinates are in points (1/72 in) with the
+// origin in the bottom left corner of the window, the same space as the
+// window's width and height. Primitives are recorded into the window's
+// command list and rendered by the next birchWindowUpdate, which also
+// starts a new, empty list.
+//
+// Consecutive primitives that share a pipeline and texture are merged into
+// one draw. Within a layer birch may reorder primitives to group them by
+// pipeline and texture, so use layers when overlapping primitives of
+// different kinds must be drawn in a specific order.
+
+typedef struct
+{
+    float r;
+    float g;
+    float b;
+    float a;
+} BirchColor;
+
+typedef struct
+{
+    /// primitives recorded
+    size_t primitives;
+    /// vertices submitted
+    size_t vertices;
+    /// runs of primitives with the same pipeline and texture, before sorting
+    size_t batches;
+    /// draws issued to the backend after sorting and merging
+    size_t drawCalls;
+} BirchDrawStats;
+
+/// highest layer, birchDrawSetLayer clamps larger layers to it
+#define BIRCH_MAX_LAYER 0xffffffu
+
+/// @brief Set the layer of the primitives drawn after this call. Layers are
+/// drawn in increasing order, the layer is reset to 0 every frame.
+/// @param layer the layer, at most BIRCH_MAX_LAYER
+void birchDrawSetLayer(BirchWindow *window, unsigned int layer);
+
+void birchDrawTriangle(
+    BirchWindow *window,
+    float x0,
+    float y0,
+    float x1,
+    float y1,
+    float x2,
+    float y2,
+    BirchColor color
+);
+
+/// @brief Draw a triangle with the colors interpolated between its vertices
+void birchDrawTriangleGradient(
+    BirchWindow *window,
+    float x0,
+    float y0,
+    float x1,
+    float y1,
+    float x2,
+    float y2,
+    BirchColor color0,
+    BirchColor color1,
+    BirchColor color2
+);
+
+/// @brief Draw a convex quad, the vertices in clockwise or counterclockwise
+/// order
+void birchDrawQuad(
+    BirchWindow *window,
+    float x0,
+    float y0,
+    float x1,
+    float y1,
+    float x2,
+    float y2,
+    float x3,
+    float y3,
+    BirchColor color
+);
+
+/// @brief Draw an axis-aligned rectangle
+/// @param x left edge
+/// @param y bottom edge
+void birchDrawRect(
+    BirchWindow *window,
+    float x,
+    float y,
+    float width,
+    float height,
+    BirchColor color
+);
+
+/// @brief Draw a line segment
+/// @param thickness width of the line in points
+void birchDrawLine(
+    BirchWindow *window,
+    float x0,
+    float y0,
+    float x1,
+    float y1,
+    float thickness,
+    BirchColor color
+);
+
+/// @brief Get the drawing counters of the last rendered frame
+void birchWindowGetDrawStats(BirchWindow *window, BirchDrawStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,69 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BIRCH_HEADLESS_H
+#define BIRCH_HEADLESS_H
+
+#include "window.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Only available when birch is built with the headless backend
+// (BIRCH_PLATFORM=headless). Headless windows have no display: they render
+// into an offscreen framebuffer with one pixel per point, and all of their
+// input comes from the birchHeadlessInject* functions below. Injected events
+// are queued and delivered to the window callbacks by the next
+// birchWindowUpdate, just like the events of a real OS message pump. They
+// can be injected from any thread, which also wakes birchWindowWaitEvents.
+
+/// @brief Get the offscreen framebuffer of a headless window
+/// @param window the window
+/// @param width receives the width of the framebuffer in pixels, may be NULL
+/// @param height receives the height of the framebuffer in pixels, may be NULL
+/// @param stride receives the distance between rows in bytes, may be NULL
+/// @return the RGBA8 pixels of the last presented frame, top row first. The
+/// pointer stays valid until the window is resized or freed. With a render
+/// thread, call birchWindowFinishFrames first.
+const uint8_t *birchHeadlessGetFramebuffer(
+    BirchWindow *window,
+    unsigned int *width,
+    unsigned int *height,
+    unsigned int *stride
+);
+
+/// @brief Queue mouse motion, timestamped now
+void birchHeadlessInjectMouseMoved(BirchWindow *window, float x, float y);
+/// @brief Queue a resize, negative sizes are taken as 0
+void birchHeadlessInjectResize(BirchWindow *window, int width, int height);
+void birchHeadlessInjectKeyPressed(BirchWindow *window, int key);
+void birchHeadlessInjectKeyReleased(BirchWindow *window, int key);
+void birchHeadlessInjectMouseButtonPressed(BirchWindow *window, int button);
+void birchHeadlessInjectMouseButtonReleased(BirchWindow *window, int button);
+
+/// @brief Ask a headless window to close, as if the user clicked its close
+/// button. birchWindowShouldClose returns true after the next update.
+void birchHeadlessInjectClose(BirchWindow *window);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
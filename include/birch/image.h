@@ -0,0 +1,105 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef BIRCH_IMAGE_H
+#define BIRCH_IMAGE_H
+
+#include "draw.h"
+#include "window.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Images are RGBA8 pictures drawn with birchDrawImage. birch keeps a copy of
+// their pixels and packs the images a window draws into a few 2048 x 2048
+// atlas pages, so sprites that share a page and layer are drawn together.
+// Images are uploaded when first drawn; birchImageUpdate uploads only the
+// image's own rectangle. When every page is full, the page least recently
+// drawn from is emptied and its images are packed again the next time they
+// are drawn, unless a frame still in flight may sample it.
+
+typedef struct BirchImage BirchImage;
+
+typedef struct
+{
+    /// images alive, and those currently packed into a page
+    size_t images;
+    size_t residentImages;
+    /// atlas pages allocated
+    unsigned int pages;
+    /// fraction of the pages' area covered by resident images, their
+    /// borders included
+    double occupancy;
+    /// rectangles uploaded by the last birchWindowUpdate, and their size
+    size_t uploads;
+    size_t uploadedBytes;
+    /// since the window was created: images packed because they were not
+    /// resident, pages emptied to make room, and draws skipped because no
+    /// page could be emptied
+    size_t misses;
+    size_t evictions;
+    size_t failures;
+} BirchAtlasStats;
+
+/// @brief Create an image that `window` can draw
+/// @param pixels width * height RGBA8 pixels, top row first, copied
+/// @return the image, or NULL if out of memory or if the image does not fit
+/// an atlas page
+BirchImage *birchImageNew(
+    BirchWindow *window,
+    int width,
+    int height,
+    const uint8_t *pixels
+);
+
+/// @brief Free an image. Images still alive are freed with their window.
+void birchImageFree(BirchImage *image);
+
+/// @brief Replace the pixels of an image, uploading them by the next
+/// birchWindowUpdate if the image is resident
+/// @param pixels width * height RGBA8 pixels, top row first, copied
+void birchImageUpdate(BirchImage *image, const uint8_t *pixels);
+
+/// @brief Draw an image stretched over an axis-aligned rectangle, its
+/// pixels multiplied with `tint` and alpha blended with what is below
+/// @param window the window the image was created with, any other draws
+/// nothing
+/// @param x left edge
+/// @param y bottom edge
+void birchDrawImage(
+    BirchWindow *window,
+    BirchImage *image,
+    float x,
+    float y,
+    float width,
+    float height,
+    BirchColor tint
+);
+
+/// @brief Get the atlas counters of a window
+void birchWindowGetAtlasStats(BirchWindow *window, BirchAtlasStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
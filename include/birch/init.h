@@ -18,7 +18,25 @@
 #ifndef BIRCH_H
 #define BIRCH_H
 
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct
+{
+    /// threads used for CPU rendering, including the thread calling
+    /// birchWindowUpdate. 0 uses one per CPU.
+    unsigned int threadCount;
+} BirchInitOptions;
+
 void birchInit(const char *name);
+/// @brief birchInit with options, NULL for the defaults
+void birchInitWithOptions(const char *name, const BirchInitOptions *options);
 void birchTerminate();
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -0,0 +1,127 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BIRCH_PACK_H
+#define BIRCH_PACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Asset packs bundle many files into one, for assets too large to embed.
+// A pack is memory mapped rather than read: opening one costs the same for
+// a few kilobytes or many gigabytes, and only the pages of the assets that
+// are used are ever loaded, by the OS, and can be dropped again under
+// memory pressure.
+//
+// Assets are found through an index sorted by the 64 bit hash of their
+// names, with a table of where every range of hashes starts, so a lookup
+// compares about one entry. Data is aligned to BIRCH_PACK_ALIGNMENT and
+// followed by a NUL byte that is not counted in its size. Uncompressed
+// assets are returned as pointers into the mapping and can be handed to
+// the GPU or parsers without copying; LZ4 compressed ones are decompressed
+// on first use.
+//
+//     BirchPack *pack = birchPackOpen("assets.pack");
+//     size_t size;
+//     const void *shader = birchPackGet(pack, "shaders.metallib", &size);
+//     // A no-op destructor stops dispatch from copying it for Metal
+//     dispatch_data_t data = dispatch_data_create(shader, size, NULL, ^{});
+//
+// Packs are written with birchPackWriterNew, birchPackWriterAdd and
+// birchPackWriterFinish. The format is little endian.
+
+#define BIRCH_PACK_ALIGNMENT 64
+
+typedef struct BirchPack BirchPack;
+typedef struct BirchPackWriter BirchPackWriter;
+
+typedef struct
+{
+    /// size of the asset
+    size_t size;
+    /// size of the asset in the pack
+    size_t storedSize;
+    /// whether the asset is LZ4 compressed in the pack
+    bool compressed;
+} BirchPackInfo;
+
+/// @brief Map a pack
+/// @return NULL if the file cannot be mapped or is not a pack
+BirchPack *birchPackOpen(const char *path);
+
+/// @brief Unmap a pack. Pointers returned by birchPackGet become invalid.
+void birchPackClose(BirchPack *pack);
+
+/// @brief Number of assets in a pack
+size_t birchPackGetCount(BirchPack *pack);
+
+/// @brief Look up an asset without loading it
+/// @return false if there is no asset with that name
+bool birchPackGetInfo(BirchPack *pack, const char *name, BirchPackInfo *info);
+
+/// @brief Get the data of an asset. Compressed assets are decompressed the
+/// first time and kept in memory until the pack is closed. Safe to call
+/// from multiple threads.
+/// @param size receives the size of the asset, may be NULL
+/// @return the data, valid until the pack is closed, or NULL if there is no
+/// asset with that name or it is corrupt
+const void *birchPackGet(BirchPack *pack, const char *name, size_t *size);
+
+/// @brief Copy or decompress an asset into memory of the caller, without
+/// keeping a decompressed copy
+/// @return false if there is no such asset, it is corrupt or larger than
+/// `capacity`
+bool birchPackRead(
+    BirchPack *pack,
+    const char *name,
+    void *buffer,
+    size_t capacity
+);
+
+/// @brief Start writing a pack to `path`
+/// @return NULL if the file cannot be created
+BirchPackWriter *birchPackWriterNew(const char *path);
+
+/// @brief Append an asset. Names must be unique within a pack.
+/// @param compress store it LZ4 compressed, unless that does not make it
+/// smaller
+/// @return false if writing failed; the pack is then discarded by
+/// birchPackWriterFinish
+bool birchPackWriterAdd(
+    BirchPackWriter *writer,
+    const char *name,
+    const void *data,
+    size_t size,
+    bool compress
+);
+
+/// @brief Write the index and close the pack, freeing the writer
+/// @return false if any write failed or names were repeated, in which case
+/// the file is deleted
+bool birchPackWriterFinish(BirchPackWriter *writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
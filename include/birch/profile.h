@@ -0,0 +1,101 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef BIRCH_PROFILE_H
+#define BIRCH_PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// CPU zone profiler. Configure birch with -DBIRCH_PROFILE=ON to enable it;
+// otherwise the zone macros expand to nothing and cost nothing.
+//
+// A zone records its name and start and end time into a ring buffer owned
+// by the calling thread, without locks, keeping the most recent 65536 zones
+// of every thread. birchProfileWriteTrace saves them in the Chrome trace
+// event format, which chrome://tracing and ui.perfetto.dev open.
+//
+//     BIRCH_PROFILE_BEGIN(physics, "physics");
+//     stepPhysics();
+//     BIRCH_PROFILE_END(physics);
+//
+//     BIRCH_PROFILE_SCOPE("render")
+//     {
+//         render(); // no return or break out of the block
+//     }
+//
+// Zone names must be string literals or otherwise outlive the profiler.
+
+typedef struct
+{
+    const char *name;
+    uint64_t start;
+} BirchProfileZone;
+
+/// @brief Current profiler timestamp, in unspecified ticks
+uint64_t birchProfileNow(void);
+
+/// @brief Record a finished zone for the calling thread
+void birchProfileRecord(const char *name, uint64_t start, uint64_t end);
+
+/// @brief Name the calling thread in traces
+void birchProfileSetThreadName(const char *name);
+
+/// @brief Write the recorded zones of all threads as Chrome trace JSON
+/// @return false if profiling is compiled out or the file cannot be written
+bool birchProfileWriteTrace(const char *path);
+
+#if defined(BIRCH_PROFILE) && BIRCH_PROFILE
+
+#define BIRCH_PROFILE_BEGIN(zone, name)                                        \
+    BirchProfileZone birchProfileZone_##zone = {(name), birchProfileNow()}
+#define BIRCH_PROFILE_END(zone)                                                \
+    birchProfileRecord(                                                        \
+        birchProfileZone_##zone.name,                                          \
+        birchProfileZone_##zone.start,                                         \
+        birchProfileNow()                                                      \
+    )
+// Loops once, recording the zone on the way out
+#define BIRCH_PROFILE_SCOPE(name)                                              \
+    for (BirchProfileZone birchProfileScope = {(name), birchProfileNow()};     \
+         birchProfileScope.name;                                               \
+         birchProfileRecord(                                                   \
+             birchProfileScope.name,                                           \
+             birchProfileScope.start,                                          \
+             birchProfileNow()                                                 \
+         ),                                                                    \
+         birchProfileScope.name = 0)
+
+#else
+
+#define BIRCH_PROFILE_BEGIN(zone, name) ((void)0)
+#define BIRCH_PROFILE_END(zone) ((void)0)
+#define BIRCH_PROFILE_SCOPE(name)
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,93 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BIRCH_REPLAY_H
+#define BIRCH_REPLAY_H
+
+#include "window.h"
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Input logs capture the events a window dispatches so a session can be
+// fed back into a window later, for repeatable measurements of input heavy
+// workloads on machines without a display or a user.
+//
+//     // On the desktop
+//     birchWindowStartRecording(window, "session.birchinput");
+//     ...
+//     birchWindowStopRecording(window);
+//
+//     // On the benchmark machine
+//     birchWindowStartReplay(window, "session.birchinput",
+//                            BIRCH_REPLAY_FAST);
+//     while (birchWindowIsReplaying(window))
+//     {
+//         draw(window);
+//         birchWindowUpdate(window);
+//     }
+//
+// Every key, mouse button, mouse motion and resize event is logged with
+// its monotonic timestamp, along with where each birchWindowUpdate ended.
+// Mouse positions are truncated to 1/64 of a point. Records are variable
+// length and store differences to the previous one, about 4 bytes per
+// event, so an hour of 1 kHz mouse motion takes around 15 megabytes.
+//
+// Replayed events reach the callbacks or the event queue like OS events,
+// which keep arriving. Replayed resize events do not resize the window.
+
+typedef enum
+{
+    /// events are delivered once as much time has passed since the replay
+    /// started as had passed since the recording started
+    BIRCH_REPLAY_REAL_TIME,
+    /// every birchWindowUpdate delivers the events of the next recorded
+    /// update, without waiting
+    BIRCH_REPLAY_FAST,
+} BirchReplayMode;
+
+/// @brief Log the events the window dispatches to `path`, replacing the
+/// file, until birchWindowStopRecording or the window is freed
+/// @return false if the file cannot be created
+bool birchWindowStartRecording(BirchWindow *window, const char *path);
+
+/// @brief Finish the log
+/// @return false if not all of it could be written
+bool birchWindowStopRecording(BirchWindow *window);
+
+/// @brief Feed the events of a log into the window, starting with the next
+/// birchWindowUpdate. Replaces a replay in progress.
+/// @return false if the file cannot be read or is not an input log
+bool birchWindowStartReplay(
+    BirchWindow *window,
+    const char *path,
+    BirchReplayMode mode
+);
+
+void birchWindowStopReplay(BirchWindow *window);
+
+/// @brief Whether a replay has events left to deliver
+bool birchWindowIsReplaying(BirchWindow *window);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
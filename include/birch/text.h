@@ -0,0 +1,104 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef BIRCH_TEXT_H
+#define BIRCH_TEXT_H
+
+#include "draw.h"
+#include "window.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Text in TrueType fonts. Every glyph a font draws is rendered once into a
+// signed distance field and kept in the window's image atlas, so text of
+// any size is drawn from the same cached glyphs, as textured quads batched
+// with the rest of the layer. Text is laid out with the font's advances and
+// pair kerning; there is no complex shaping (ligatures, marks or
+// right-to-left scripts).
+
+typedef struct BirchFont BirchFont;
+
+typedef struct
+{
+    /// glyphs drawn by the last frame
+    size_t glyphs;
+    /// glyph lookups since the window was created, those that found the
+    /// glyph cached, and those that had to render its distance field
+    size_t lookups;
+    size_t hits;
+    size_t misses;
+    /// hits / lookups, 0 before the first lookup
+    double hitRate;
+    /// glyphs cached by the window's fonts, and the bytes used by their
+    /// distance fields and the caches
+    size_t cachedGlyphs;
+    size_t memory;
+    /// time spent rendering distance fields, in seconds
+    double rasterizeTime;
+} BirchTextStats;
+
+/// @brief Load a TrueType font (.ttf, or the first font of a .ttc) that
+/// `window` can draw with
+/// @param data the font file. It is not copied and must stay alive and
+/// unchanged until the font is freed, like the data of a pack or of an
+/// embedded asset.
+/// @return the font, or NULL if out of memory or if the data is not a
+/// TrueType font with glyph outlines
+BirchFont *birchFontNew(BirchWindow *window, const uint8_t *data, size_t size);
+
+/// @brief Free a font and its glyphs. Fonts still alive are freed with
+/// their window.
+void birchFontFree(BirchFont *font);
+
+/// @brief Distance between the baselines of two lines of text
+float birchFontGetLineHeight(BirchFont *font, float size);
+
+/// @brief Width of the widest line of UTF-8 `text` at `size` points per em
+float birchTextMeasure(BirchFont *font, const char *text, float size);
+
+/// @brief Draw UTF-8 text, alpha blended with what is below. Lines are
+/// separated by '\n'; invalid UTF-8 is drawn as U+FFFD.
+/// @param window the window the font was loaded for, any other draws
+/// nothing
+/// @param x left edge of the text
+/// @param y baseline of the first line, later lines go down
+/// @param size points per em
+/// @return the width of the widest line, 0 if nothing was drawn
+float birchDrawText(
+    BirchWindow *window,
+    BirchFont *font,
+    const char *text,
+    float x,
+    float y,
+    float size,
+    BirchColor color
+);
+
+/// @brief Get the glyph cache counters of a window
+void birchWindowGetTextStats(BirchWindow *window, BirchTextStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
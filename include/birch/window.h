@@ -19,6 +19,13 @@
 #define BIRCH_WINDOW_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
 
 /* The unknown key */
 #define BIRCH_KEY_UNKNOWN -1
@@ -160,10 +167,72 @@
 #define BIRCH_MOUSE_BUTTON_9 8
 #define BIRCH_MOUSE_BUTTON_10 9
 #define BIRCH_MOUSE_BUTTON_LAST BIRCH_MOUSE_BUTTON_8
+// Every button birchWindowIsMouseButtonDown and friends know of, up to and
+// including BIRCH_MOUSE_BUTTON_10
+#define BIRCH_MOUSE_BUTTON_COUNT (BIRCH_MOUSE_BUTTON_10 + 1)
 #define BIRCH_MOUSE_BUTTON_LEFT BIRCH_MOUSE_BUTTON_1
 #define BIRCH_MOUSE_BUTTON_RIGHT BIRCH_MOUSE_BUTTON_2
 #define BIRCH_MOUSE_BUTTON_MIDDLE BIRCH_MOUSE_BUTTON_3
 
+typedef struct BirchWindowState BirchWindowState;
+
+typedef enum
+{
+    /// input is delivered by calling the window's callbacks from inside
+    /// birchWindowUpdate, the default
+    BIRCH_EVENT_MODE_CALLBACKS,
+    /// input is queued and read with birchWindowPollEvents, the callbacks are
+    /// not called
+    BIRCH_EVENT_MODE_QUEUE,
+} BirchEventMode;
+
+typedef enum
+{
+    BIRCH_EVENT_MOUSE_MOVED,
+    BIRCH_EVENT_RESIZE,
+    BIRCH_EVENT_KEY_PRESSED,
+    BIRCH_EVENT_KEY_RELEASED,
+    BIRCH_EVENT_MOUSE_BUTTON_PRESSED,
+    BIRCH_EVENT_MOUSE_BUTTON_RELEASED,
+} BirchEventType;
+
+typedef struct
+{
+    BirchEventType type;
+    /// when the OS reported the event, in nanoseconds of the monotonic clock
+    /// of BirchMouseSample times
+    uint64_t time;
+    union
+    {
+        /// BIRCH_EVENT_MOUSE_MOVED
+        struct
+        {
+            int x;
+            int y;
+        } mouse;
+        /// BIRCH_EVENT_RESIZE
+        struct
+        {
+            int width;
+            int height;
+        } size;
+        /// BIRCH_EVENT_KEY_PRESSED and BIRCH_EVENT_KEY_RELEASED
+        int key;
+        /// BIRCH_EVENT_MOUSE_BUTTON_PRESSED and
+        /// BIRCH_EVENT_MOUSE_BUTTON_RELEASED
+        int button;
+    };
+} BirchEvent;
+
+typedef struct
+{
+    /// position in points, origin in the bottom left corner
+    float x;
+    float y;
+    /// when the OS reported the motion, in nanoseconds of a monotonic clock
+    uint64_t time;
+} BirchMouseSample;
+
 typedef struct
 {
     float width;
@@ -175,8 +244,48 @@ typedef struct
     void (*keyReleasedCallback)(int key);
     void (*mouseButtonPressedCallback)(int button);
     void (*mouseButtonReleasedCallback)(int button);
+    /// state shared by all backends, private to birch
+    BirchWindowState *state;
 } BirchWindow;
 
+typedef struct
+{
+    /// bytes sub-allocated from the streaming buffer
+    size_t bytesStreamed;
+    /// times the CPU had to wait for the GPU to finish with a frame region
+    unsigned int stalls;
+    /// allocations of streaming storage, only non-zero when the stream grows
+    unsigned int allocations;
+    /// sub-allocations that did not fit into the frame region
+    unsigned int overflows;
+    /// size of one frame region in bytes
+    size_t capacity;
+} BirchStreamStats;
+
+typedef struct
+{
+    /// frames measured, up to the last 120
+    unsigned int frames;
+    /// mean time between the ends of consecutive birchWindowUpdate calls, in
+    /// seconds
+    double frameTime;
+    /// standard deviation of the frame time in seconds
+    double jitter;
+    double minFrameTime;
+    double maxFrameTime;
+} BirchFrameStats;
+
+typedef struct
+{
+    /// rectangles presented by the last birchWindowUpdate, 0 if nothing
+    /// changed
+    unsigned int rects;
+    /// pixels inside them, overlaps counted twice
+    size_t pixels;
+    /// pixels of the whole framebuffer
+    size_t totalPixels;
+} BirchDamageStats;
+
 /// @brief Create a new window
 /// @param width width of the window in points (1/72 in)
 /// @param height height of the window in points (1/72 in)
@@ -188,34 +297,219 @@ void birchWindowFree(BirchWindow *window);
 void birchWindowUpdate(BirchWindow *window);
 bool birchWindowShouldClose(BirchWindow *window);
 
+/// @brief Pump the OS events of every window in one pass and deliver them
+/// to each window's callbacks or queue. Call it once per frame before
+/// updating the windows; birchWindowUpdate then leaves events that arrive
+/// later for the next call. Without it, every birchWindowUpdate pumps the
+/// events of all windows itself.
+void birchPollEvents(void);
+
+/// @brief Block until the OS has events for the window, so an idle
+/// application does not spin on birchWindowUpdate. The events are handled
+/// by the next birchWindowUpdate.
+/// @param timeout longest wait in seconds, negative to wait indefinitely
+/// @return true if events are waiting, false on timeout
+bool birchWindowWaitEvents(BirchWindow *window, double timeout);
+
+/// @brief Cap the frame rate: birchWindowUpdate sleeps until the next frame
+/// is due, spinning for the final millisecond or two to hit it accurately.
+/// A frame that runs late starts a new schedule instead of being followed
+/// by a burst of catch-up frames.
+/// @param framesPerSecond the cap, 0 for none
+void birchWindowSetFrameRateLimit(BirchWindow *window, double framesPerSecond);
+
+/// @brief Present on the display's vertical blank. On by default, except on
+/// the headless and xcb backends, which simulate a 60 Hz display when
+/// enabled.
+void birchWindowSetVsync(BirchWindow *window, bool vsync);
+
+/// @brief Get frame pacing statistics over the last 120 frames
+void birchWindowGetFrameStats(BirchWindow *window, BirchFrameStats *stats);
+
+/// most frames birchWindowSetRenderThread lets a window queue
+#define BIRCH_MAX_FRAMES_AHEAD 3
+
+/// @brief Render and present on a thread of the window's own. From then on
+/// birchWindowUpdate pumps events and queues the frame drawn since the last
+/// update, blocking only while `framesAhead` frames are queued or being
+/// rendered, so neither waits for the other: a slow frame of the
+/// application still has queued frames to present, and a slow present no
+/// longer delays input. The statistics of the window then describe the last
+/// frame rendered, which may trail the last one queued.
+/// @param framesAhead frames queued at most, up to BIRCH_MAX_FRAMES_AHEAD. 0
+/// renders inside birchWindowUpdate again, the default.
+/// @return false if the thread could not be started
+bool birchWindowSetRenderThread(BirchWindow *window, unsigned int framesAhead);
+
+/// @brief Wait until every frame queued by birchWindowUpdate is presented.
+/// Returns at once without a render thread.
+void birchWindowFinishFrames(BirchWindow *window);
+
+/// @brief Get pacing statistics of the last 120 frames presented, measured
+/// where they are rendered. Without a render thread they match the frame
+/// statistics.
+void birchWindowGetPresentStats(BirchWindow *window, BirchFrameStats *stats);
+
+typedef struct
+{
+    /// frames measured that responded to input, up to the last 1024
+    unsigned int frames;
+    /// median, 99th percentile and maximum of the time from the OS
+    /// reporting the oldest input event a frame responds to until the frame
+    /// is presented, in seconds
+    double p50;
+    double p99;
+    double max;
+} BirchLatencyStats;
+
+/// @brief Get input-to-present latency statistics. A frame responds to the
+/// events delivered by the birchWindowUpdate before the one that presents
+/// or queues it, since it was drawn after them.
+void birchWindowGetLatencyStats(BirchWindow *window, BirchLatencyStats *stats);
+
+/// @brief Get the vertex/uniform streaming counters of the last finished frame
+/// @param window the window
+/// @param stats receives the counters
+void birchWindowGetStreamStats(BirchWindow *window, BirchStreamStats *stats);
+
+/// @brief Get how much of the framebuffer the last birchWindowUpdate redrew
+/// and presented. Frames identical to the one on screen are skipped. The
+/// headless and xcb backends redraw and present only the 64 pixel tiles that
+/// changed, merged into a few rectangles; the GPU backends redraw all or
+/// nothing.
+void birchWindowGetDamageStats(BirchWindow *window, BirchDamageStats *stats);
+
 void birchWindowSetMouseMovedCallback(
     BirchWindow *window,
     void (*mouseMovedCallback)(int x, int y)
 );
 
+/// @brief Like birchWindowSetMouseMovedCallback, passing `userData` to every
+/// call. Each event has either a callback or a handler, setting one replaces
+/// the other. The others below are the same for their events.
+void birchWindowSetMouseMovedHandler(
+    BirchWindow *window,
+    void (*handler)(void *userData, int x, int y),
+    void *userData
+);
+
 void birchWindowSetResizeCallback(
     BirchWindow *window,
     void (*resizeCallback)(int width, int height)
 );
 
+void birchWindowSetResizeHandler(
+    BirchWindow *window,
+    void (*handler)(void *userData, int width, int height),
+    void *userData
+);
+
 void birchWindowSetKeyPressedCallback(
     BirchWindow *window,
     void (*keyPressedCallback)(int key)
 );
 
+void birchWindowSetKeyPressedHandler(
+    BirchWindow *window,
+    void (*handler)(void *userData, int key),
+    void *userData
+);
+
 void birchWindowSetKeyReleasedCallback(
     BirchWindow *window,
     void (*keyReleasedCallback)(int key)
 );
 
+void birchWindowSetKeyReleasedHandler(
+    BirchWindow *window,
+    void (*handler)(void *userData, int key),
+    void *userData
+);
+
 void birchWindowSetMouseButtonPressedCallback(
     BirchWindow *window,
     void (*mouseButtonPressedCallback)(int button)
 );
 
+void birchWindowSetMouseButtonPressedHandler(
+    BirchWindow *window,
+    void (*handler)(void *userData, int button),
+    void *userData
+);
+
 void birchWindowSetMouseButtonReleasedCallback(
     BirchWindow *window,
     void (*mouseButtonReleasedCallback)(int button)
 );
 
+void birchWindowSetMouseButtonReleasedHandler(
+    BirchWindow *window,
+    void (*handler)(void *userData, int button),
+    void *userData
+);
+
+/// @brief Choose between callbacks and the event queue. Set it from the
+/// thread that calls birchWindowUpdate.
+void birchWindowSetEventMode(BirchWindow *window, BirchEventMode mode);
+
+/// @brief Take up to `max` queued events, oldest first. May be called from a
+/// different thread than birchWindowUpdate, but only from one thread at a
+/// time. Events that arrive while the queue is full are dropped.
+/// @return the number of events written to `events`
+size_t
+birchWindowPollEvents(BirchWindow *window, BirchEvent *events, size_t max);
+
+/// @brief When the OS reported the event whose callback is running, or the
+/// last event delivered, in nanoseconds of the monotonic clock of
+/// BirchMouseSample times. The OS event time where it has one, with
+/// millisecond resolution on X and Win32, otherwise when birch received it.
+uint64_t birchWindowGetEventTime(BirchWindow *window);
+
+/// @brief Number of events dropped because the queue was full
+size_t birchWindowGetDroppedEvents(BirchWindow *window);
+
+/// @brief Number of window sizes dropped for a later one. Resizes are
+/// delivered at most once per birchWindowUpdate, after its other events,
+/// with the last size.
+size_t birchWindowGetCoalescedResizes(BirchWindow *window);
+
+/// @brief Coalesce mouse motion into one mouse moved event per
+/// birchWindowUpdate, reporting the last position. Motion before a key or
+/// button event is still delivered before it. Every sample is kept in the
+/// mouse history.
+void birchWindowSetMouseCoalescing(BirchWindow *window, bool coalesce);
+
+/// @brief Get the mouse motion received during the last birchWindowUpdate,
+/// oldest first, with full precision positions. Only recorded while
+/// coalescing, valid until the next birchWindowUpdate.
+/// @param count receives the number of samples
+const BirchMouseSample *
+birchWindowGetMouseHistory(BirchWindow *window, size_t *count);
+
+/// @brief Whether the key is held, as of the events delivered so far
+/// @param key a BIRCH_KEY_* code, false for anything else
+bool birchWindowIsKeyDown(BirchWindow *window, int key);
+
+/// @brief Whether the key went down during the last birchWindowUpdate. Taps
+/// shorter than a frame report both edges while the key is up.
+bool birchWindowWasKeyPressed(BirchWindow *window, int key);
+
+/// @brief Whether the key went up during the last birchWindowUpdate
+bool birchWindowWasKeyReleased(BirchWindow *window, int key);
+
+/// @brief Whether the mouse button is held
+/// @param button a BIRCH_MOUSE_BUTTON_* code, false for anything else
+bool birchWindowIsMouseButtonDown(BirchWindow *window, int button);
+
+/// @brief Whether the mouse button went down during the last
+/// birchWindowUpdate
+bool birchWindowWasMouseButtonPressed(BirchWindow *window, int button);
+
+/// @brief Whether the mouse button went up during the last birchWindowUpdate
+bool birchWindowWasMouseButtonReleased(BirchWindow *window, int button);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -0,0 +1,327 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BIRCH_WINDOW_HPP
+#define BIRCH_WINDOW_HPP
+
+#include "window.h"
+
+// C++17 ownership of a BirchWindow, with handlers bound without type
+// erasure. Each binding instantiates a thunk that calls the bound member
+// function or callable directly, so the compiler can inline the handler
+// into it and an event costs the single indirect call the C API makes.
+// Handlers must not throw: exceptions cannot unwind through birch.
+
+namespace birch
+{
+    namespace detail
+    {
+        template <typename Method>
+        struct MemberOf
+        {
+            static_assert(
+                sizeof(Method) == 0,
+                "birch handlers must be member functions returning void"
+            );
+        };
+
+        template <typename T, typename... Args>
+        struct MemberOf<void (T::*)(Args...)>
+        {
+            using Type = T;
+        };
+
+        template <typename T, typename... Args>
+        struct MemberOf<void (T::*)(Args...) noexcept>
+        {
+            using Type = T;
+        };
+
+        // const member functions are called through a pointer to const
+        template <typename T, typename... Args>
+        struct MemberOf<void (T::*)(Args...) const>
+        {
+            using Type = const T;
+        };
+
+        template <typename T, typename... Args>
+        struct MemberOf<void (T::*)(Args...) const noexcept>
+        {
+            using Type = const T;
+        };
+
+        /// @brief The class `Method` is a member function of
+        template <auto Method>
+        using ClassOf = typename MemberOf<decltype(Method)>::Type;
+
+        template <auto Method, typename... Args>
+        void callMember(void *userData, Args... args)
+        {
+            (static_cast<ClassOf<Method> *>(userData)->*Method)(args...);
+        }
+
+        template <typename Handler, typename... Args>
+        void callHandler(void *userData, Args... args)
+        {
+            (*static_cast<Handler *>(userData))(args...);
+        }
+
+        /// @brief `object` as the user data of the C API, which never
+        /// writes through it. The thunks cast it back to `T *`.
+        template <typename T>
+        void *userData(T *object)
+        {
+            return const_cast<void *>(static_cast<const void *>(object));
+        }
+    }
+
+    class Window
+    {
+    public:
+        Window() = default;
+
+        Window(unsigned int width, unsigned int height, const char *title) :
+            window(birchWindowNew(width, height, title))
+        {
+        }
+
+        /// @brief Take ownership of a window created with the C API
+        explicit Window(BirchWindow *owned) : window(owned)
+        {
+        }
+
+        Window(const Window&) = delete;
+        Window& operator=(const Window&) = delete;
+
+        Window(Window&& other) noexcept : window(other.release())
+        {
+        }
+
+        Window& operator=(Window&& other) noexcept
+        {
+            if (this != &other)
+            {
+                reset(other.release());
+            }
+            return *this;
+        }
+
+        ~Window()
+        {
+            reset();
+        }
+
+        /// @brief Whether there is a window, false if creating it failed
+        explicit operator bool() const
+        {
+            return window != nullptr;
+        }
+
+        BirchWindow *get() const
+        {
+            return window;
+        }
+
+        /// @brief Give up ownership without freeing the window
+        BirchWindow *release()
+        {
+            BirchWindow *released = window;
+            window = nullptr;
+            return released;
+        }
+
+        /// @brief Free the window, if any, and own `replacement` instead
+        void reset(BirchWindow *replacement = nullptr)
+        {
+            if (window)
+            {
+                birchWindowFree(window);
+            }
+            window = replacement;
+        }
+
+        void update()
+        {
+            birchWindowUpdate(window);
+        }
+
+        bool shouldClose() const
+        {
+            return birchWindowShouldClose(window);
+        }
+
+        bool isKeyDown(int key) const
+        {
+            return birchWindowIsKeyDown(window, key);
+        }
+
+        bool wasKeyPressed(int key) const
+        {
+            return birchWindowWasKeyPressed(window, key);
+        }
+
+        bool wasKeyReleased(int key) const
+        {
+            return birchWindowWasKeyReleased(window, key);
+        }
+
+        bool isMouseButtonDown(int button) const
+        {
+            return birchWindowIsMouseButtonDown(window, button);
+        }
+
+        bool wasMouseButtonPressed(int button) const
+        {
+            return birchWindowWasMouseButtonPressed(window, button);
+        }
+
+        bool wasMouseButtonReleased(int button) const
+        {
+            return birchWindowWasMouseButtonReleased(window, button);
+        }
+
+        // on*<&T::method>(object) calls object->method for the event,
+        // on*(handler) calls a function object, a lambda for instance. Both
+        // may be const, and must outlive the binding. Binding replaces the
+        // callback or handler the event had.
+
+        template <auto Method>
+        void onMouseMoved(detail::ClassOf<Method> *object)
+        {
+            birchWindowSetMouseMovedHandler(
+                window,
+                detail::callMember<Method, int, int>,
+                detail::userData(object)
+            );
+        }
+
+        template <typename Handler>
+        void onMouseMoved(Handler& handler)
+        {
+            birchWindowSetMouseMovedHandler(
+                window,
+                detail::callHandler<Handler, int, int>,
+                detail::userData(&handler)
+            );
+        }
+
+        template <auto Method>
+        void onResize(detail::ClassOf<Method> *object)
+        {
+            birchWindowSetResizeHandler(
+                window,
+                detail::callMember<Method, int, int>,
+                detail::userData(object)
+            );
+        }
+
+        template <typename Handler>
+        void onResize(Handler& handler)
+        {
+            birchWindowSetResizeHandler(
+                window,
+                detail::callHandler<Handler, int, int>,
+                detail::userData(&handler)
+            );
+        }
+
+        template <auto Method>
+        void onKeyPressed(detail::ClassOf<Method> *object)
+        {
+            birchWindowSetKeyPressedHandler(
+                window,
+                detail::callMember<Method, int>,
+                detail::userData(object)
+            );
+        }
+
+        template <typename Handler>
+        void onKeyPressed(Handler& handler)
+        {
+            birchWindowSetKeyPressedHandler(
+                window,
+                detail::callHandler<Handler, int>,
+                detail::userData(&handler)
+            );
+        }
+
+        template <auto Method>
+        void onKeyReleased(detail::ClassOf<Method> *object)
+        {
+            birchWindowSetKeyReleasedHandler(
+                window,
+                detail::callMember<Method, int>,
+                detail::userData(object)
+            );
+        }
+
+        template <typename Handler>
+        void onKeyReleased(Handler& handler)
+        {
+            birchWindowSetKeyReleasedHandler(
+                window,
+                detail::callHandler<Handler, int>,
+                detail::userData(&handler)
+            );
+        }
+
+        template <auto Method>
+        void onMouseButtonPressed(detail::ClassOf<Method> *object)
+        {
+            birchWindowSetMouseButtonPressedHandler(
+                window,
+                detail::callMember<Method, int>,
+                detail::userData(object)
+            );
+        }
+
+        template <typename Handler>
+        void onMouseButtonPressed(Handler& handler)
+        {
+            birchWindowSetMouseButtonPressedHandler(
+                window,
+                detail::callHandler<Handler, int>,
+                detail::userData(&handler)
+            );
+        }
+
+        template <auto Method>
+        void onMouseButtonReleased(detail::ClassOf<Method> *object)
+        {
+            birchWindowSetMouseButtonReleasedHandler(
+                window,
+                detail::callMember<Method, int>,
+                detail::userData(object)
+            );
+        }
+
+        template <typename Handler>
+        void onMouseButtonReleased(Handler& handler)
+        {
+            birchWindowSetMouseButtonReleasedHandler(
+                window,
+                detail::callHandler<Handler, int>,
+                detail::userData(&handler)
+            );
+        }
+
+    private:
+        BirchWindow *window = nullptr;
+    };
+}
+
+#endif
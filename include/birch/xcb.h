@@ -0,0 +1,61 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BIRCH_XCB_H
+#define BIRCH_XCB_H
+
+#include "window.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Only available when birch is built with the XCB backend
+// (BIRCH_PLATFORM=xcb). Frames are rendered on the CPU straight into an
+// MIT-SHM segment shared with the X server, so presenting sends a small
+// request instead of the pixels. When the server cannot share memory with
+// the client, as over a network, or the BIRCH_XCB_SHM environment variable
+// is 0, frames are sent with xcb_put_image instead. Either way only the
+// damaged rectangles are sent (see birchWindowGetDamageStats), and frames
+// without damage are not presented at all.
+
+typedef struct
+{
+    /// true when frames are presented through MIT-SHM
+    bool sharedMemory;
+    /// frames presented, unchanged frames are skipped
+    uint64_t frames;
+    /// image bytes written to the X connection by the last frame, 0 with
+    /// shared memory
+    size_t bytesCopied;
+    /// mean time in seconds from sending a frame until the X server is done
+    /// with it, as observed by birch
+    double presentLatency;
+} BirchXcbPresentStats;
+
+/// @brief Get the presentation counters of a window
+void birchXcbGetPresentStats(BirchWindow *window, BirchXcbPresentStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
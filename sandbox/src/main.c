@@ -18,6 +18,7 @@
  * along with birch.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <birch/draw.h>
 #include <birch/init.h>
 #include <birch/window.h>
 
@@ -29,7 +30,22 @@ int main()
 
     while (!birchWindowShouldClose(window))
     {
+        birchDrawTriangleGradient(
+            window,
+            0,
+            0,
+            72,
+            0,
+            36,
+            72,
+            (BirchColor){1.0, 0.0, 0.0, 1.0},
+            (BirchColor){0.0, 1.0, 0.0, 1.0},
+            (BirchColor){0.0, 0.0, 1.0, 1.0}
+        );
         birchWindowUpdate(window);
+
+        // The scene only changes with input, sleep until there is some
+        birchWindowWaitEvents(window, -1.0);
     }
 
     birchTerminate();
@@ -0,0 +1,111 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "arena.h"
+#include "heap.h"
+#include <stdint.h>
+
+// Blocks start with their header, the data follows aligned
+#define BIRCH_ARENA_HEADER                                                     \
+    ((sizeof(BirchArenaBlock) + BIRCH_ARENA_ALIGNMENT - 1) &                   \
+     ~(size_t)(BIRCH_ARENA_ALIGNMENT - 1))
+
+static BirchArenaBlock *birchArenaAddBlock(BirchArena *arena, size_t size)
+{
+    if (size > SIZE_MAX - BIRCH_ARENA_HEADER)
+    {
+        return NULL;
+    }
+    BirchArenaBlock *block = birchAllocate(BIRCH_ARENA_HEADER + size);
+    if (!block)
+    {
+        return NULL;
+    }
+    block->next = arena->blocks;
+    block->size = size;
+    block->used = 0;
+    arena->blocks = block;
+    arena->capacity += size;
+    return block;
+}
+
+void *birchArenaAllocate(BirchArena *arena, size_t size)
+{
+    if (size > SIZE_MAX - BIRCH_ARENA_ALIGNMENT)
+    {
+        return NULL;
+    }
+    size = (size + BIRCH_ARENA_ALIGNMENT - 1) &
+           ~(size_t)(BIRCH_ARENA_ALIGNMENT - 1);
+
+    BirchArenaBlock *block = arena->blocks;
+    if (!block || block->size - block->used < size)
+    {
+        // Doubling the arena keeps the number of blocks in a frame small
+        size_t blockSize = arena->capacity;
+        if (blockSize < BIRCH_ARENA_MIN_BLOCK)
+        {
+            blockSize = BIRCH_ARENA_MIN_BLOCK;
+        }
+        if (blockSize < size)
+        {
+            blockSize = size;
+        }
+        if (!(block = birchArenaAddBlock(arena, blockSize)))
+        {
+            return NULL;
+        }
+    }
+
+    void *pointer = (uint8_t *)block + BIRCH_ARENA_HEADER + block->used;
+    block->used += size;
+    arena->used += size;
+    return pointer;
+}
+
+void birchArenaReset(BirchArena *arena)
+{
+    arena->used = 0;
+    if (arena->blocks && arena->blocks->next)
+    {
+        // The last frame needed more than one block, make the next one fit
+        // in a single block
+        size_t capacity = arena->capacity;
+        birchArenaRelease(arena);
+        birchArenaAddBlock(arena, capacity);
+    }
+    else if (arena->blocks)
+    {
+        arena->blocks->used = 0;
+    }
+}
+
+void birchArenaRelease(BirchArena *arena)
+{
+    BirchArenaBlock *block = arena->blocks;
+    while (block)
+    {
+        BirchArenaBlock *next = block->next;
+        birchFree(block);
+        block = next;
+    }
+    arena->blocks = NULL;
+    arena->used = 0;
+    arena->capacity = 0;
+}
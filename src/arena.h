@@ -0,0 +1,58 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef BIRCH_ARENA_H
+#define BIRCH_ARENA_H
+
+#include <stddef.h>
+
+// Linear allocator for data that lives for one frame. Allocations bump a
+// pointer through the current block and are all dropped at once by
+// birchArenaReset. A frame that outgrows the arena chains more blocks; the
+// next reset replaces them with one block as large as all of them, so
+// steady state frames never touch the heap.
+
+#define BIRCH_ARENA_ALIGNMENT 16
+#define BIRCH_ARENA_MIN_BLOCK (64 * 1024)
+
+typedef struct BirchArenaBlock
+{
+    struct BirchArenaBlock *next;
+    size_t size;
+    size_t used;
+} BirchArenaBlock;
+
+typedef struct
+{
+    // the block being allocated from, then the earlier ones
+    BirchArenaBlock *blocks;
+    // bytes handed out since the last reset, and the size of every block
+    size_t used;
+    size_t capacity;
+} BirchArena;
+
+/// @brief Allocate `size` bytes aligned to BIRCH_ARENA_ALIGNMENT
+/// @return NULL if out of memory
+void *birchArenaAllocate(BirchArena *arena, size_t size);
+
+/// @brief Drop every allocation, keeping the memory
+void birchArenaReset(BirchArena *arena);
+
+void birchArenaRelease(BirchArena *arena);
+
+#endif
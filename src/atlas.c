@@ -0,0 +1,515 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "atlas.h"
+#include "heap.h"
+#include "stream.h"
+#include "windowInternal.h"
+#include <limits.h>
+#include <string.h>
+
+bool birchSkylineInit(BirchSkyline *skyline, int width, int height)
+{
+    // Every node is at least a pixel wide
+    skyline->nodes =
+        birchAllocate(((size_t)width + 1) * sizeof(BirchSkylineNode));
+    if (!skyline->nodes)
+    {
+        return false;
+    }
+    skyline->width = width;
+    skyline->height = height;
+    birchSkylineReset(skyline);
+    return true;
+}
+
+void birchSkylineRelease(BirchSkyline *skyline)
+{
+    birchFree(skyline->nodes);
+    skyline->nodes = NULL;
+    skyline->count = 0;
+}
+
+void birchSkylineReset(BirchSkyline *skyline)
+{
+    skyline->nodes[0] = (BirchSkylineNode){0, 0, skyline->width};
+    skyline->count = 1;
+}
+
+// The lowest a `width` wide rectangle can sit with its left edge at the
+// start of node `index`
+static int birchSkylineFit(const BirchSkyline *skyline, int index, int width)
+{
+    int y = 0;
+    for (int i = index; width > 0; i++)
+    {
+        const BirchSkylineNode *node = &skyline->nodes[i];
+        y = node->y > y ? node->y : y;
+        width -= node->width;
+    }
+    return y;
+}
+
+static void birchSkylineRemove(BirchSkyline *skyline, int index)
+{
+    memmove(
+        &skyline->nodes[index],
+        &skyline->nodes[index + 1],
+        (size_t)(skyline->count - index - 1) * sizeof(BirchSkylineNode)
+    );
+    skyline->count--;
+}
+
+bool birchSkylinePack(
+    BirchSkyline *skyline,
+    int width,
+    int height,
+    int *x,
+    int *y
+)
+{
+    if (width <= 0 || height <= 0)
+    {
+        return false;
+    }
+
+    BirchSkylineNode *nodes = skyline->nodes;
+    int best = -1;
+    int bestY = INT_MAX;
+    for (int i = 0; i < skyline->count; i++)
+    {
+        if (nodes[i].x + width > skyline->width)
+        {
+            break;
+        }
+        int top = birchSkylineFit(skyline, i, width);
+        if (top + height <= skyline->height && top < bestY)
+        {
+            best = i;
+            bestY = top;
+        }
+    }
+    if (best < 0)
+    {
+        return false;
+    }
+
+    // Replace the nodes under the rectangle with its top edge, cutting the
+    // one it ends in
+    int left = nodes[best].x;
+    int right = left + width;
+    int last = best;
+    while (last < skyline->count &&
+           nodes[last].x + nodes[last].width <= right)
+    {
+        last++;
+    }
+    if (last < skyline->count && nodes[last].x < right)
+    {
+        nodes[last].width -= right - nodes[last].x;
+        nodes[last].x = right;
+    }
+    memmove(
+        &nodes[best + 1],
+        &nodes[last],
+        (size_t)(skyline->count - last) * sizeof(BirchSkylineNode)
+    );
+    skyline->count += best + 1 - last;
+    nodes[best] = (BirchSkylineNode){left, bestY + height, width};
+
+    // Merge with the neighbours at the same height
+    if (best + 1 < skyline->count && nodes[best + 1].y == nodes[best].y)
+    {
+        nodes[best].width += nodes[best + 1].width;
+        birchSkylineRemove(skyline, best + 1);
+    }
+    if (best > 0 && nodes[best - 1].y == nodes[best].y)
+    {
+        nodes[best - 1].width += nodes[best].width;
+        birchSkylineRemove(skyline, best);
+    }
+
+    *x = left;
+    *y = bestY;
+    return true;
+}
+
+// Area of an image in its page, border included
+static inline size_t birchAtlasArea(const BirchImage *image)
+{
+    return (size_t)(image->width + 2 * BIRCH_ATLAS_BORDER) *
+           (image->height + 2 * BIRCH_ATLAS_BORDER);
+}
+
+void birchAtlasInit(BirchAtlas *atlas)
+{
+    birchMutexInit(&atlas->lock);
+}
+
+void birchAtlasRelease(BirchAtlas *atlas)
+{
+    BirchImage *image = atlas->images;
+    while (image)
+    {
+        BirchImage *next = image->next;
+        birchFree(image->pixels);
+        birchFree(image);
+        image = next;
+    }
+    for (unsigned int i = 0; i < atlas->pageCount; i++)
+    {
+        birchSkylineRelease(&atlas->pages[i].skyline);
+        birchFree(atlas->pages[i].pixels);
+    }
+    birchMutexDestroy(&atlas->lock);
+    memset(atlas, 0, sizeof(BirchAtlas));
+}
+
+bool birchAtlasIsResident(const BirchAtlas *atlas, const BirchImage *image)
+{
+    return image->page >= 0 &&
+           atlas->pages[image->page].epoch == image->epoch;
+}
+
+static void birchAtlasMarkDirty(BirchAtlasPage *page, BirchRasterRect rect)
+{
+    if (page->dirtyCount < BIRCH_ATLAS_MAX_DIRTY)
+    {
+        page->dirty[page->dirtyCount++] = rect;
+        return;
+    }
+
+    // Out of rectangles, upload their bounds instead
+    BirchRasterRect *bounds = &page->dirty[0];
+    for (unsigned int i = 1; i <= page->dirtyCount; i++)
+    {
+        const BirchRasterRect *other =
+            i < page->dirtyCount ? &page->dirty[i] : &rect;
+        bounds->minX = other->minX < bounds->minX ? other->minX : bounds->minX;
+        bounds->minY = other->minY < bounds->minY ? other->minY : bounds->minY;
+        bounds->maxX = other->maxX > bounds->maxX ? other->maxX : bounds->maxX;
+        bounds->maxY = other->maxY > bounds->maxY ? other->maxY : bounds->maxY;
+    }
+    page->dirtyCount = 1;
+}
+
+void birchAtlasWrite(BirchAtlas *atlas, const BirchImage *image)
+{
+    const int border = BIRCH_ATLAS_BORDER;
+    BirchAtlasPage *page = &atlas->pages[image->page];
+    uint32_t *origin =
+        page->pixels + (size_t)image->y * BIRCH_ATLAS_SIZE + image->x;
+
+    // The border repeats the edge pixels, corners included
+    for (int row = -border; row < image->height + border; row++)
+    {
+        int source = row < 0 ? 0 : row;
+        source = source < image->height ? source : image->height - 1;
+        const uint32_t *from = image->pixels + (size_t)source * image->width;
+        uint32_t *to = origin + (ptrdiff_t)row * BIRCH_ATLAS_SIZE;
+
+        memcpy(to, from, (size_t)image->width * sizeof(uint32_t));
+        for (int i = 1; i <= border; i++)
+        {
+            to[-i] = from[0];
+            to[image->width - 1 + i] = from[image->width - 1];
+        }
+    }
+
+    birchAtlasMarkDirty(
+        page,
+        (BirchRasterRect){
+            .minX = image->x - border,
+            .minY = image->y - border,
+            .maxX = image->x + image->width + border,
+            .maxY = image->y + image->height + border,
+        }
+    );
+    atlas->textures[image->page].generation = ++atlas->generation;
+}
+
+static bool birchAtlasAddPage(BirchAtlas *atlas)
+{
+    BirchAtlasPage *page = &atlas->pages[atlas->pageCount];
+    memset(page, 0, sizeof(BirchAtlasPage));
+
+    page->pixels = birchAllocateZeroed(
+        (size_t)BIRCH_ATLAS_SIZE * BIRCH_ATLAS_SIZE,
+        sizeof(uint32_t)
+    );
+    if (!page->pixels ||
+        !birchSkylineInit(&page->skyline, BIRCH_ATLAS_SIZE, BIRCH_ATLAS_SIZE))
+    {
+        birchFree(page->pixels);
+        page->pixels = NULL;
+        return false;
+    }
+
+    atlas->textures[atlas->pageCount] = (BirchRasterTexture){
+        .pixels = page->pixels,
+        .width = BIRCH_ATLAS_SIZE,
+        .height = BIRCH_ATLAS_SIZE,
+        .generation = ++atlas->generation,
+    };
+    atlas->pageCount++;
+    return true;
+}
+
+// The page drawn from longest ago that no frame in flight can sample, -1
+// if there is none
+static int birchAtlasFindVictim(const BirchAtlas *atlas)
+{
+    int victim = -1;
+    for (unsigned int i = 0; i < atlas->pageCount; i++)
+    {
+        const BirchAtlasPage *page = &atlas->pages[i];
+        if (page->lastUsed + BIRCH_ATLAS_FRAMES_IN_FLIGHT < atlas->frame &&
+            (victim < 0 || page->lastUsed < atlas->pages[victim].lastUsed))
+        {
+            victim = (int)i;
+        }
+    }
+    return victim;
+}
+
+// Pack an image that is not resident and write its texels
+static int birchAtlasPack(BirchAtlas *atlas, BirchImage *image)
+{
+    int width = image->width + 2 * BIRCH_ATLAS_BORDER;
+    int height = image->height + 2 * BIRCH_ATLAS_BORDER;
+    int x = 0;
+    int y = 0;
+    // Pages drawn from recently first, so the images of a frame gather on
+    // few pages and the others grow old enough to be emptied
+    unsigned int order[BIRCH_ATLAS_MAX_PAGES];
+    for (unsigned int i = 0; i < atlas->pageCount; i++)
+    {
+        unsigned int j = i;
+        for (; j > 0 && atlas->pages[order[j - 1]].lastUsed <
+                            atlas->pages[i].lastUsed;
+             j--)
+        {
+            order[j] = order[j - 1];
+        }
+        order[j] = i;
+    }
+    int index = -1;
+    for (unsigned int i = 0; i < atlas->pageCount && index < 0; i++)
+    {
+        BirchSkyline *skyline = &atlas->pages[order[i]].skyline;
+        if (birchSkylinePack(skyline, width, height, &x, &y))
+        {
+            index = (int)order[i];
+        }
+    }
+    if (index < 0 && atlas->pageCount < BIRCH_ATLAS_MAX_PAGES &&
+        birchAtlasAddPage(atlas))
+    {
+        index = (int)atlas->pageCount - 1;
+        // Empty pages fit every image, birchImageNew checked
+        birchSkylinePack(&atlas->pages[index].skyline, width, height, &x, &y);
+    }
+    else if (index < 0 && (index = birchAtlasFindVictim(atlas)) >= 0)
+    {
+        BirchAtlasPage *page = &atlas->pages[index];
+        birchSkylineReset(&page->skyline);
+        page->epoch++;
+        page->packedArea = 0;
+        // What was not uploaded yet belongs to images that are gone
+        page->dirtyCount = 0;
+        atlas->evictions++;
+        birchSkylinePack(&page->skyline, width, height, &x, &y);
+    }
+    if (index < 0)
+    {
+        atlas->failures++;
+        return -1;
+    }
+
+    BirchAtlasPage *page = &atlas->pages[index];
+    page->packedArea += birchAtlasArea(image);
+    page->lastUsed = atlas->frame;
+    image->page = index;
+    image->epoch = page->epoch;
+    image->x = x + BIRCH_ATLAS_BORDER;
+    image->y = y + BIRCH_ATLAS_BORDER;
+    atlas->misses++;
+
+    birchAtlasWrite(atlas, image);
+    return index;
+}
+
+int birchAtlasPlace(BirchAtlas *atlas, BirchImage *image)
+{
+    if (birchAtlasIsResident(atlas, image))
+    {
+        atlas->pages[image->page].lastUsed = atlas->frame;
+        return image->page;
+    }
+
+    birchMutexLock(&atlas->lock);
+    int index = birchAtlasPack(atlas, image);
+    birchMutexUnlock(&atlas->lock);
+    return index;
+}
+
+void birchAtlasFlush(BirchAtlas *atlas, BirchAtlasUpload upload, void *context)
+{
+    atlas->uploads = 0;
+    atlas->uploadedBytes = 0;
+    for (unsigned int i = 0; i < atlas->pageCount; i++)
+    {
+        BirchAtlasPage *page = &atlas->pages[i];
+        for (unsigned int j = 0; j < page->dirtyCount; j++)
+        {
+            const BirchRasterRect *rect = &page->dirty[j];
+            if (upload)
+            {
+                upload(context, i, &atlas->textures[i], rect);
+            }
+            atlas->uploads++;
+            atlas->uploadedBytes += (size_t)(rect->maxX - rect->minX) *
+                                    (rect->maxY - rect->minY) *
+                                    sizeof(uint32_t);
+        }
+        page->dirtyCount = 0;
+    }
+}
+
+BirchImage *birchImageNew(
+    BirchWindow *window,
+    int width,
+    int height,
+    const uint8_t *pixels
+)
+{
+    const int largest = BIRCH_ATLAS_SIZE - 2 * BIRCH_ATLAS_BORDER;
+    if (width <= 0 || height <= 0 || width > largest || height > largest)
+    {
+        return NULL;
+    }
+
+    BirchImage *image = birchAllocate(sizeof(BirchImage));
+    uint32_t *copy = birchAllocate((size_t)width * height * sizeof(uint32_t));
+    if (!image || !copy)
+    {
+        birchFree(image);
+        birchFree(copy);
+        return NULL;
+    }
+    memcpy(copy, pixels, (size_t)width * height * sizeof(uint32_t));
+
+    BirchAtlas *atlas = &window->state->atlas;
+    *image = (BirchImage){
+        .window = window,
+        .next = atlas->images,
+        .pixels = copy,
+        .width = width,
+        .height = height,
+        .page = -1,
+    };
+    if (atlas->images)
+    {
+        atlas->images->previous = image;
+    }
+    atlas->images = image;
+    atlas->imageCount++;
+    return image;
+}
+
+void birchImageFree(BirchImage *image)
+{
+    if (!image)
+    {
+        return;
+    }
+
+    BirchAtlas *atlas = &image->window->state->atlas;
+    if (birchAtlasIsResident(atlas, image))
+    {
+        // Its space is reused once the page is emptied
+        atlas->pages[image->page].packedArea -= birchAtlasArea(image);
+    }
+    if (image->previous)
+    {
+        image->previous->next = image->next;
+    }
+    else
+    {
+        atlas->images = image->next;
+    }
+    if (image->next)
+    {
+        image->next->previous = image->previous;
+    }
+    atlas->imageCount--;
+
+    birchFree(image->pixels);
+    birchFree(image);
+}
+
+void birchImageUpdate(BirchImage *image, const uint8_t *pixels)
+{
+    memcpy(
+        image->pixels,
+        pixels,
+        (size_t)image->width * image->height * sizeof(uint32_t)
+    );
+
+    BirchAtlas *atlas = &image->window->state->atlas;
+    if (birchAtlasIsResident(atlas, image))
+    {
+        birchMutexLock(&atlas->lock);
+        birchAtlasWrite(atlas, image);
+        birchMutexUnlock(&atlas->lock);
+    }
+}
+
+void birchWindowGetAtlasStats(BirchWindow *window, BirchAtlasStats *stats)
+{
+    BirchAtlas *atlas = &window->state->atlas;
+
+    size_t resident = 0;
+    for (const BirchImage *image = atlas->images; image; image = image->next)
+    {
+        resident += birchAtlasIsResident(atlas, image);
+    }
+    size_t packed = 0;
+    for (unsigned int i = 0; i < atlas->pageCount; i++)
+    {
+        packed += atlas->pages[i].packedArea;
+    }
+    double area = (double)BIRCH_ATLAS_SIZE * BIRCH_ATLAS_SIZE;
+
+    // The uploads are counted by the renderer
+    birchMutexLock(&atlas->lock);
+    *stats = (BirchAtlasStats){
+        .images = atlas->imageCount,
+        .residentImages = resident,
+        .pages = atlas->pageCount,
+        .occupancy =
+            atlas->pageCount ? packed / (area * atlas->pageCount) : 0.0,
+        .uploads = atlas->uploads,
+        .uploadedBytes = atlas->uploadedBytes,
+        .misses = atlas->misses,
+        .evictions = atlas->evictions,
+        .failures = atlas->failures,
+    };
+    birchMutexUnlock(&atlas->lock);
+}
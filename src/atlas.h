@@ -0,0 +1,192 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef BIRCH_ATLAS_H
+#define BIRCH_ATLAS_H
+
+#include "drawList.h"
+#include "image.h"
+#include "raster.h"
+#include "stream.h"
+#include "thread.h"
+#include "window.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Texture atlas behind BirchImage. Images are packed into fixed size pages
+// with a skyline bottom-left packer and framed by a copy of their edge
+// pixels, so bilinear filtering never reads a neighbour. Every page keeps
+// an RGBA shadow of its texels that the CPU rasterizer samples directly;
+// GPU backends mirror the pages in textures and upload the rectangles that
+// changed since the last birchAtlasFlush.
+//
+// A skyline cannot free single rectangles, so pages are recycled whole: when
+// nothing fits anymore, the page least recently drawn from is emptied and
+// the images that were on it are packed again when they are next drawn.
+// Pages drawn from in the last BIRCH_ATLAS_FRAMES_IN_FLIGHT frames are never
+// emptied, a render thread or the GPU may still be reading them.
+//
+// Images are packed on the thread that draws, while a render thread may be
+// reading the pages. Texels, dirty rectangles and textures only change with
+// `lock` held, and renderers hold it while they read them.
+
+#define BIRCH_ATLAS_SIZE 2048
+#define BIRCH_ATLAS_MAX_PAGES 4
+// pixels of edge copied around every image
+#define BIRCH_ATLAS_BORDER 1
+// dirty rectangles per page before they are merged into their bounds
+#define BIRCH_ATLAS_MAX_DIRTY 16
+// frames queued for a render thread, plus the ones the GPU is drawing
+#define BIRCH_ATLAS_FRAMES_IN_FLIGHT                                           \
+    (BIRCH_MAX_FRAMES_AHEAD + BIRCH_STREAM_FRAMES)
+
+typedef struct
+{
+    int x;
+    int y;
+    int width;
+} BirchSkylineNode;
+
+// The top edge of what has been packed so far, as horizontal segments from
+// left to right covering the whole width
+typedef struct
+{
+    BirchSkylineNode *nodes;
+    int count;
+    int width;
+    int height;
+} BirchSkyline;
+
+bool birchSkylineInit(BirchSkyline *skyline, int width, int height);
+void birchSkylineRelease(BirchSkyline *skyline);
+void birchSkylineReset(BirchSkyline *skyline);
+
+/// @brief Find room for a width x height rectangle, the lowest position
+/// first and the leftmost of those, and raise the skyline over it
+/// @return false if it does not fit
+bool birchSkylinePack(
+    BirchSkyline *skyline,
+    int width,
+    int height,
+    int *x,
+    int *y
+);
+
+typedef struct
+{
+    BirchSkyline skyline;
+    uint32_t *pixels;
+    // incremented whenever the page is emptied; images packed into it
+    // before are no longer resident
+    uint64_t epoch;
+    // the last frame an image on the page was drawn
+    uint64_t lastUsed;
+    // area covered by resident images and their borders
+    size_t packedArea;
+    BirchRasterRect dirty[BIRCH_ATLAS_MAX_DIRTY];
+    unsigned int dirtyCount;
+} BirchAtlasPage;
+
+struct BirchImage
+{
+    BirchWindow *window;
+    struct BirchImage *previous;
+    struct BirchImage *next;
+    uint32_t *pixels;
+    int width;
+    int height;
+    // page the image was last packed into, -1 if never, and its epoch then
+    int page;
+    uint64_t epoch;
+    // of the top left pixel inside the page, past the border
+    int x;
+    int y;
+};
+
+typedef struct
+{
+    BirchMutex lock;
+    BirchAtlasPage pages[BIRCH_ATLAS_MAX_PAGES];
+    // what the rasterizer samples, indexed like `pages`. A page's
+    // generation changes with its texels.
+    BirchRasterTexture textures[BIRCH_ATLAS_MAX_PAGES];
+    unsigned int pageCount;
+    // the last generation given to a page, unique across pages. It changes
+    // whenever any texel does.
+    uint64_t generation;
+    // incremented by every birchWindowUpdate
+    uint64_t frame;
+    BirchImage *images;
+    size_t imageCount;
+    size_t misses;
+    size_t evictions;
+    size_t failures;
+    // rectangles and bytes uploaded by the last flush
+    size_t uploads;
+    size_t uploadedBytes;
+} BirchAtlas;
+
+/// @brief Upload `rect` of the texels of `page` to its GPU texture,
+/// creating the texture first if the page is new
+typedef void (*BirchAtlasUpload)(
+    void *context,
+    unsigned int page,
+    const BirchRasterTexture *texture,
+    const BirchRasterRect *rect
+);
+
+/// @brief Initialize an atlas that is zeroed otherwise
+void birchAtlasInit(BirchAtlas *atlas);
+
+/// @brief Free the pages and every image still alive
+void birchAtlasRelease(BirchAtlas *atlas);
+
+/// @brief Make an image resident, packing it if it is not, and mark its
+/// page as used this frame
+/// @return the page, -1 if the image could not be packed
+int birchAtlasPlace(BirchAtlas *atlas, BirchImage *image);
+
+/// @brief Whether `image` is packed into a page that still holds it
+bool birchAtlasIsResident(const BirchAtlas *atlas, const BirchImage *image);
+
+/// @brief Copy the pixels of a resident image into its page again, border
+/// included, and mark them dirty
+void birchAtlasWrite(BirchAtlas *atlas, const BirchImage *image);
+
+/// @brief Hand the dirty rectangles of every page to `upload` and clear
+/// them. Call with `lock` held.
+/// @param upload NULL for CPU backends, which sample the pages directly
+void birchAtlasFlush(BirchAtlas *atlas, BirchAtlasUpload upload, void *context);
+
+/// @brief Draw an image as a quad with a textured pipeline, for
+/// birchDrawImage and glyphs
+/// @param x left edge
+/// @param y bottom edge
+void birchDrawAtlasImage(
+    BirchWindow *window,
+    BirchImage *image,
+    BirchPipeline pipeline,
+    float x,
+    float y,
+    float width,
+    float height,
+    BirchColor color
+);
+
+#endif
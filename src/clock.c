@@ -0,0 +1,133 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "clock.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+uint64_t birchClockNow(void)
+{
+#if defined(_WIN32)
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (!frequency.QuadPart)
+    {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&counter);
+
+    // Split to avoid overflowing counter * 1e9
+    uint64_t seconds = counter.QuadPart / frequency.QuadPart;
+    uint64_t rest = counter.QuadPart % frequency.QuadPart;
+    return seconds * 1000000000 + rest * 1000000000 / frequency.QuadPart;
+#elif defined(__APPLE__)
+    return clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+#endif
+}
+
+#if defined(_WIN32)
+// Created by the first sleep of each thread and kept until the process
+// exits, rather than a kernel object per frame
+static _Thread_local HANDLE birchClockTimer;
+static _Thread_local bool birchClockTimerCreated;
+#endif
+
+static void birchClockSleep(uint64_t nanoseconds)
+{
+#if defined(_WIN32)
+    // High resolution timers exist since Windows 10 1803, Sleep has the
+    // resolution of the system timer
+    if (!birchClockTimerCreated)
+    {
+        birchClockTimerCreated = true;
+        birchClockTimer = CreateWaitableTimerExW(
+            NULL,
+            NULL,
+            CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+            TIMER_ALL_ACCESS
+        );
+    }
+    if (birchClockTimer)
+    {
+        LARGE_INTEGER due;
+        due.QuadPart = -(LONGLONG)(nanoseconds / 100);
+        if (SetWaitableTimer(birchClockTimer, &due, 0, NULL, NULL, FALSE))
+        {
+            WaitForSingleObject(birchClockTimer, INFINITE);
+        }
+        return;
+    }
+    Sleep((DWORD)(nanoseconds / 1000000));
+#else
+    struct timespec duration = {
+        .tv_sec = nanoseconds / 1000000000,
+        .tv_nsec = nanoseconds % 1000000000,
+    };
+    nanosleep(&duration, NULL);
+#endif
+}
+
+void birchClockSleepUntil(uint64_t deadline)
+{
+    uint64_t now = birchClockNow();
+    if (now + BIRCH_CLOCK_SPIN < deadline)
+    {
+        birchClockSleep(deadline - BIRCH_CLOCK_SPIN - now);
+    }
+
+    while (birchClockNow() < deadline)
+    {
+    }
+}
+
+uint64_t birchEventClockConvert(BirchEventClock *clock, uint32_t milliseconds)
+{
+    uint64_t now = birchClockNow();
+    if (!clock->started)
+    {
+        clock->started = true;
+        clock->milliseconds = milliseconds;
+        clock->offset = (int64_t)now - (int64_t)milliseconds * 1000000;
+    }
+    else
+    {
+        // Signed, events may arrive slightly out of order
+        clock->milliseconds += (int32_t)(milliseconds - clock->last);
+    }
+    clock->last = milliseconds;
+
+    int64_t time = clock->milliseconds * 1000000;
+    if ((int64_t)now - time < clock->offset)
+    {
+        clock->offset = (int64_t)now - time;
+    }
+    return (uint64_t)(time + clock->offset);
+}
@@ -0,0 +1,63 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef BIRCH_CLOCK_H
+#define BIRCH_CLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/// @brief Monotonic time in nanoseconds. On macOS this is the uptime clock
+/// NSEvent timestamps are measured in, so event times convert directly.
+uint64_t birchClockNow(void);
+
+// OS sleeps overshoot by up to a scheduler tick, the last stretch before a
+// deadline is spun instead
+#if defined(_WIN32)
+#define BIRCH_CLOCK_SPIN 2000000
+#else
+#define BIRCH_CLOCK_SPIN 1000000
+#endif
+
+// Waits of this many seconds or more, about 31 years, are indefinite: in
+// nanoseconds they would soon overflow a deadline
+#define BIRCH_CLOCK_MAX_WAIT 1e9
+
+/// @brief Sleep until birchClockNow() >= deadline, spinning for the last
+/// BIRCH_CLOCK_SPIN nanoseconds
+void birchClockSleepUntil(uint64_t deadline);
+
+// Converts the 32 bit millisecond timestamps of X and Win32 events, whose
+// clocks start elsewhere and wrap after 49 days. The offset between the
+// clocks is the smallest difference between receiving an event and its
+// timestamp seen so far, so converted times never lie in the future and
+// approach the true offset as soon as one event is delivered promptly.
+typedef struct
+{
+    bool started;
+    uint32_t last;
+    // `last` without wrapping
+    int64_t milliseconds;
+    int64_t offset;
+} BirchEventClock;
+
+/// @brief Convert an event timestamp to birchClockNow nanoseconds
+uint64_t
+birchEventClockConvert(BirchEventClock *clock, uint32_t milliseconds);
+
+#endif
@@ -0,0 +1,221 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "damage.h"
+#include <string.h>
+
+void birchDamageFull(BirchDamage *damage, int width, int height)
+{
+    damage->rects[0] = (BirchRasterRect){0, 0, width, height};
+    damage->count = 1;
+    damage->width = width;
+    damage->height = height;
+}
+
+static void birchDamageAddSpan(BirchDamage *damage, BirchRasterRect span)
+{
+    // Extend a rectangle of the same columns that ends on the row above
+    for (unsigned int i = 0; i < damage->count; i++)
+    {
+        BirchRasterRect *rect = &damage->rects[i];
+        if (rect->minX == span.minX && rect->maxX == span.maxX &&
+            rect->maxY == span.minY)
+        {
+            rect->maxY = span.maxY;
+            return;
+        }
+    }
+
+    if (damage->count < BIRCH_DAMAGE_MAX_RECTS)
+    {
+        damage->rects[damage->count++] = span;
+        return;
+    }
+
+    // Out of rectangles, grow the one that grows the least
+    unsigned int best = 0;
+    long long bestGrowth = -1;
+    for (unsigned int i = 0; i < damage->count; i++)
+    {
+        const BirchRasterRect *rect = &damage->rects[i];
+        int minX = rect->minX < span.minX ? rect->minX : span.minX;
+        int minY = rect->minY < span.minY ? rect->minY : span.minY;
+        int maxX = rect->maxX > span.maxX ? rect->maxX : span.maxX;
+        int maxY = rect->maxY > span.maxY ? rect->maxY : span.maxY;
+        long long growth =
+            (long long)(maxX - minX) * (maxY - minY) -
+            (long long)(rect->maxX - rect->minX) * (rect->maxY - rect->minY);
+        if (bestGrowth < 0 || growth < bestGrowth)
+        {
+            best = i;
+            bestGrowth = growth;
+        }
+    }
+
+    BirchRasterRect *rect = &damage->rects[best];
+    rect->minX = rect->minX < span.minX ? rect->minX : span.minX;
+    rect->minY = rect->minY < span.minY ? rect->minY : span.minY;
+    rect->maxX = rect->maxX > span.maxX ? rect->maxX : span.maxX;
+    rect->maxY = rect->maxY > span.maxY ? rect->maxY : span.maxY;
+}
+
+bool birchDamageCollect(
+    BirchDamage *damage,
+    BirchTileCache *shown,
+    const BirchTiler *tiler,
+    int width,
+    int height
+)
+{
+    if (!birchTileCacheFit(shown, tiler->tilesWide, tiler->tilesHigh))
+    {
+        birchDamageFull(damage, width, height);
+        return false;
+    }
+
+    damage->count = 0;
+    damage->width = width;
+    damage->height = height;
+
+    // Rows of changed tiles become spans, spans over the same columns in
+    // consecutive rows become one rectangle
+    for (int y = 0; y < tiler->tilesHigh; y++)
+    {
+        size_t row = (size_t)y * tiler->tilesWide;
+        int x = 0;
+        while (x < tiler->tilesWide)
+        {
+            if (shown->hashes[row + x] == tiler->tileHashes[row + x])
+            {
+                x++;
+                continue;
+            }
+
+            int start = x;
+            for (; x < tiler->tilesWide &&
+                   shown->hashes[row + x] != tiler->tileHashes[row + x];
+                 x++)
+            {
+                shown->hashes[row + x] = tiler->tileHashes[row + x];
+            }
+            birchDamageAddSpan(
+                damage,
+                (BirchRasterRect){start, y, x, y + 1}
+            );
+        }
+    }
+
+    // Tiles to pixels, the last row and column of tiles may be partial
+    for (unsigned int i = 0; i < damage->count; i++)
+    {
+        BirchRasterRect *rect = &damage->rects[i];
+        rect->minX *= BIRCH_TILE_SIZE;
+        rect->minY *= BIRCH_TILE_SIZE;
+        rect->maxX = rect->maxX * BIRCH_TILE_SIZE < width
+                         ? rect->maxX * BIRCH_TILE_SIZE
+                         : width;
+        rect->maxY = rect->maxY * BIRCH_TILE_SIZE < height
+                         ? rect->maxY * BIRCH_TILE_SIZE
+                         : height;
+    }
+    return true;
+}
+
+static inline uint64_t birchDamageHash(uint64_t hash, uint64_t value)
+{
+    hash = (hash ^ value) * 0x9e3779b97f4a7c15ull;
+    return hash ^ (hash >> 29);
+}
+
+static inline uint64_t birchDamageFloats(float a, float b)
+{
+    uint32_t bitsA, bitsB;
+    memcpy(&bitsA, &a, sizeof(float));
+    memcpy(&bitsB, &b, sizeof(float));
+    return (uint64_t)bitsA << 32 | bitsB;
+}
+
+bool birchDamageCompareFrame(
+    BirchDamage *damage,
+    uint64_t *lastFrame,
+    const BirchDrawList *list,
+    uint64_t textures,
+    const VertexUniforms *uniforms,
+    int width,
+    int height
+)
+{
+    uint64_t hash =
+        birchDamageHash(0, (uint64_t)width << 32 | (uint32_t)height);
+    hash = birchDamageHash(hash, textures);
+    hash = birchDamageHash(
+        hash,
+        birchDamageFloats(uniforms->pointsWide, uniforms->pointsHigh)
+    );
+    // Field by field, independent of the layout of Vertex
+    for (size_t i = 0; i < list->vertexCount; i++)
+    {
+        const Vertex *vertex = &list->vertices[i];
+        hash = birchDamageHash(
+            hash,
+            birchDamageFloats(vertex->position.x, vertex->position.y)
+        );
+        hash = birchDamageHash(
+            hash,
+            birchDamageFloats(vertex->texCoord.x, vertex->texCoord.y)
+        );
+        hash = birchDamageHash(
+            hash,
+            birchDamageFloats(vertex->color.x, vertex->color.y)
+        );
+        hash = birchDamageHash(
+            hash,
+            birchDamageFloats(vertex->color.z, vertex->color.w)
+        );
+    }
+    // Keys decide the draw order
+    for (size_t i = 0; i < list->batchCount; i++)
+    {
+        hash = birchDamageHash(hash, list->batches[i].key);
+        hash = birchDamageHash(hash, list->batches[i].count);
+    }
+    hash |= 1;
+
+    if (hash == *lastFrame)
+    {
+        damage->count = 0;
+        damage->width = width;
+        damage->height = height;
+        return false;
+    }
+    *lastFrame = hash;
+    birchDamageFull(damage, width, height);
+    return true;
+}
+
+size_t birchDamageArea(const BirchDamage *damage)
+{
+    size_t area = 0;
+    for (unsigned int i = 0; i < damage->count; i++)
+    {
+        const BirchRasterRect *rect = &damage->rects[i];
+        area += (size_t)(rect->maxX - rect->minX) * (rect->maxY - rect->minY);
+    }
+    return area;
+}
@@ -0,0 +1,79 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BIRCH_DAMAGE_H
+#define BIRCH_DAMAGE_H
+
+#include "drawList.h"
+#include "raster.h"
+#include "tiler.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Damage tracking, so mostly static frames are neither redrawn nor presented
+// in full. CPU backends render with a tile cache (see tiler.h) and collect
+// the tiles that differ from what is on screen; runs of changed tiles are
+// merged into at most BIRCH_DAMAGE_MAX_RECTS rectangles to present. GPU
+// backends cannot retain their back buffers, so they compare whole frames
+// and either redraw everything or skip the frame.
+
+#define BIRCH_DAMAGE_MAX_RECTS 16
+
+typedef struct
+{
+    // in pixels, top row first, they may overlap
+    BirchRasterRect rects[BIRCH_DAMAGE_MAX_RECTS];
+    unsigned int count;
+    // size of the framebuffer
+    int width;
+    int height;
+} BirchDamage;
+
+/// @brief Damage a whole width x height framebuffer
+void birchDamageFull(BirchDamage *damage, int width, int height);
+
+/// @brief Collect the tiles of the frame `tiler` last rendered with a cache
+/// that differ from `shown`, then record the frame as shown
+/// @return false if out of memory, `damage` covers everything then
+bool birchDamageCollect(
+    BirchDamage *damage,
+    BirchTileCache *shown,
+    const BirchTiler *tiler,
+    int width,
+    int height
+);
+
+/// @brief Compare a draw list, its uniforms and the framebuffer size to the
+/// last frame seen, damaging everything if they differ and nothing otherwise
+/// @param lastFrame hash of the last frame, 0 to damage everything
+/// @param textures changes whenever the textures the list samples do
+/// @return true if the frame changed
+bool birchDamageCompareFrame(
+    BirchDamage *damage,
+    uint64_t *lastFrame,
+    const BirchDrawList *list,
+    uint64_t textures,
+    const VertexUniforms *uniforms,
+    int width,
+    int height
+);
+
+/// @brief Pixels covered by the rectangles, overlaps counted twice
+size_t birchDamageArea(const BirchDamage *damage);
+
+#endif
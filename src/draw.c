@@ -0,0 +1,472 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "draw.h"
+#include "atlas.h"
+#include "drawList.h"
+#include "heap.h"
+#include "windowInternal.h"
+#include <math.h>
+#include <string.h>
+
+void birchDrawListRelease(BirchDrawList *list)
+{
+    birchFree(list->vertices);
+    birchFree(list->batches);
+    birchFree(list->calls);
+    memset(list, 0, sizeof(BirchDrawList));
+}
+
+void birchDrawListReset(BirchDrawList *list)
+{
+    list->vertexCount = 0;
+    list->batchCount = 0;
+    list->primitives = 0;
+    list->layer = 0;
+    list->unsorted = false;
+    list->inputTime = 0;
+}
+
+static bool birchDrawListGrowBatches(BirchDrawList *list)
+{
+    size_t capacity = list->batchCapacity ? list->batchCapacity * 2 : 64;
+
+    BirchDrawBatch *batches =
+        birchReallocate(list->batches, capacity * sizeof(BirchDrawBatch));
+    if (!batches)
+    {
+        return false;
+    }
+    list->batches = batches;
+
+    BirchDrawBatch *calls =
+        birchReallocate(list->calls, capacity * sizeof(BirchDrawBatch));
+    if (!calls)
+    {
+        return false;
+    }
+    list->calls = calls;
+
+    list->batchCapacity = capacity;
+    return true;
+}
+
+Vertex *birchDrawListPush(BirchDrawList *list, uint64_t key, size_t count)
+{
+    if (list->vertexCount + count > list->vertexCapacity)
+    {
+        size_t capacity = list->vertexCapacity ? list->vertexCapacity : 1024;
+        while (capacity < list->vertexCount + count)
+        {
+            capacity *= 2;
+        }
+
+        Vertex *vertices =
+            birchReallocate(list->vertices, capacity * sizeof(Vertex));
+        if (!vertices)
+        {
+            return NULL;
+        }
+        list->vertices = vertices;
+        list->vertexCapacity = capacity;
+    }
+
+    BirchDrawBatch *last =
+        list->batchCount ? &list->batches[list->batchCount - 1] : NULL;
+    if (last && last->key == key)
+    {
+        last->count += count;
+    }
+    else
+    {
+        // Before growing, which moves `last`
+        bool unsorted = last && key < last->key;
+        if (list->batchCount == list->batchCapacity &&
+            !birchDrawListGrowBatches(list))
+        {
+            return NULL;
+        }
+        list->unsorted |= unsorted;
+        list->batches[list->batchCount++] = (BirchDrawBatch){
+            .key = key,
+            .first = list->vertexCount,
+            .count = count,
+        };
+    }
+
+    Vertex *vertices = list->vertices + list->vertexCount;
+    list->vertexCount += count;
+    list->primitives++;
+    return vertices;
+}
+
+// Bottom-up merge sort, qsort is not stable. Sorts the batches into `sorted`
+// using the batches of the list as the other buffer.
+static void birchDrawListSort(BirchDrawList *list, BirchDrawBatch *sorted)
+{
+    BirchDrawBatch *from = list->batches;
+    BirchDrawBatch *to = sorted;
+    size_t count = list->batchCount;
+
+    for (size_t width = 1; width < count; width *= 2)
+    {
+        for (size_t start = 0; start < count; start += width * 2)
+        {
+            size_t middle = start + width < count ? start + width : count;
+            size_t end = middle + width < count ? middle + width : count;
+            size_t i = start;
+            size_t j = middle;
+            size_t k = start;
+
+            while (i < middle && j < end)
+            {
+                to[k++] = from[j].key < from[i].key ? from[j++] : from[i++];
+            }
+            while (i < middle)
+            {
+                to[k++] = from[i++];
+            }
+            while (j < end)
+            {
+                to[k++] = from[j++];
+            }
+        }
+
+        BirchDrawBatch *swap = from;
+        from = to;
+        to = swap;
+    }
+
+    if (from != sorted)
+    {
+        memcpy(sorted, from, count * sizeof(BirchDrawBatch));
+    }
+}
+
+size_t birchDrawListFlatten(
+    BirchDrawList *list,
+    Vertex *out,
+    BirchArena *scratch
+)
+{
+    list->callCount = 0;
+    if (!list->batchCount)
+    {
+        return 0;
+    }
+
+    if (!list->unsorted)
+    {
+        // Already in draw order, the common case
+        memcpy(out, list->vertices, list->vertexCount * sizeof(Vertex));
+        for (size_t i = 0; i < list->batchCount; i++)
+        {
+            list->calls[list->callCount++] = list->batches[i];
+        }
+        return list->callCount;
+    }
+
+    BirchDrawBatch *sorted =
+        birchArenaAllocate(scratch, list->batchCount * sizeof(BirchDrawBatch));
+    if (!sorted)
+    {
+        return 0;
+    }
+    birchDrawListSort(list, sorted);
+
+    uint32_t written = 0;
+    for (size_t i = 0; i < list->batchCount; i++)
+    {
+        BirchDrawBatch batch = sorted[i];
+        memcpy(
+            out + written,
+            list->vertices + batch.first,
+            batch.count * sizeof(Vertex)
+        );
+
+        BirchDrawBatch *last =
+            list->callCount ? &list->calls[list->callCount - 1] : NULL;
+        if (last && last->key == batch.key)
+        {
+            last->count += batch.count;
+        }
+        else
+        {
+            list->calls[list->callCount++] = (BirchDrawBatch){
+                .key = batch.key,
+                .first = written,
+                .count = batch.count,
+            };
+        }
+        written += batch.count;
+    }
+    return list->callCount;
+}
+
+static inline Vertex
+birchDrawVertex(float x, float y, BirchColor color)
+{
+    Vertex vertex;
+    vertex.position.x = x;
+    vertex.position.y = y;
+    vertex.texCoord.x = 0;
+    vertex.texCoord.y = 0;
+    vertex.color.x = color.r;
+    vertex.color.y = color.g;
+    vertex.color.z = color.b;
+    vertex.color.w = color.a;
+    return vertex;
+}
+
+static inline Vertex birchDrawTexturedVertex(
+    float x,
+    float y,
+    float u,
+    float v,
+    BirchColor color
+)
+{
+    Vertex vertex = birchDrawVertex(x, y, color);
+    vertex.texCoord.x = u;
+    vertex.texCoord.y = v;
+    return vertex;
+}
+
+static inline uint64_t birchDrawSolidKey(BirchDrawList *list)
+{
+    return BIRCH_DRAW_KEY(list->layer, BIRCH_PIPELINE_SOLID, 0);
+}
+
+void birchDrawSetLayer(BirchWindow *window, unsigned int layer)
+{
+    window->state->drawList.layer =
+        layer < BIRCH_MAX_LAYER ? layer : BIRCH_MAX_LAYER;
+}
+
+void birchDrawTriangle(
+    BirchWindow *window,
+    float x0,
+    float y0,
+    float x1,
+    float y1,
+    float x2,
+    float y2,
+    BirchColor color
+)
+{
+    BirchDrawList *list = &window->state->drawList;
+
+    Vertex *vertices = birchDrawListPush(list, birchDrawSolidKey(list), 3);
+    if (!vertices)
+    {
+        return;
+    }
+    vertices[0] = birchDrawVertex(x0, y0, color);
+    vertices[1] = birchDrawVertex(x1, y1, color);
+    vertices[2] = birchDrawVertex(x2, y2, color);
+}
+
+void birchDrawTriangleGradient(
+    BirchWindow *window,
+    float x0,
+    float y0,
+    float x1,
+    float y1,
+    float x2,
+    float y2,
+    BirchColor color0,
+    BirchColor color1,
+    BirchColor color2
+)
+{
+    BirchDrawList *list = &window->state->drawList;
+
+    Vertex *vertices = birchDrawListPush(list, birchDrawSolidKey(list), 3);
+    if (!vertices)
+    {
+        return;
+    }
+    vertices[0] = birchDrawVertex(x0, y0, color0);
+    vertices[1] = birchDrawVertex(x1, y1, color1);
+    vertices[2] = birchDrawVertex(x2, y2, color2);
+}
+
+void birchDrawQuad(
+    BirchWindow *window,
+    float x0,
+    float y0,
+    float x1,
+    float y1,
+    float x2,
+    float y2,
+    float x3,
+    float y3,
+    BirchColor color
+)
+{
+    BirchDrawList *list = &window->state->drawList;
+
+    Vertex *vertices = birchDrawListPush(list, birchDrawSolidKey(list), 6);
+    if (!vertices)
+    {
+        return;
+    }
+    vertices[0] = birchDrawVertex(x0, y0, color);
+    vertices[1] = birchDrawVertex(x1, y1, color);
+    vertices[2] = birchDrawVertex(x2, y2, color);
+    vertices[3] = vertices[0];
+    vertices[4] = vertices[2];
+    vertices[5] = birchDrawVertex(x3, y3, color);
+}
+
+void birchDrawRect(
+    BirchWindow *window,
+    float x,
+    float y,
+    float width,
+    float height,
+    BirchColor color
+)
+{
+    birchDrawQuad(
+        window,
+        x,
+        y,
+        x + width,
+        y,
+        x + width,
+        y + height,
+        x,
+        y + height,
+        color
+    );
+}
+
+void birchDrawLine(
+    BirchWindow *window,
+    float x0,
+    float y0,
+    float x1,
+    float y1,
+    float thickness,
+    BirchColor color
+)
+{
+    float dx = x1 - x0;
+    float dy = y1 - y0;
+    float length = sqrtf(dx * dx + dy * dy);
+    if (length == 0)
+    {
+        return;
+    }
+
+    // Offset both ends by half the thickness along the normal
+    float nx = -dy / length * thickness * 0.5f;
+    float ny = dx / length * thickness * 0.5f;
+
+    birchDrawQuad(
+        window,
+        x0 + nx,
+        y0 + ny,
+        x1 + nx,
+        y1 + ny,
+        x1 - nx,
+        y1 - ny,
+        x0 - nx,
+        y0 - ny,
+        color
+    );
+}
+
+void birchDrawAtlasImage(
+    BirchWindow *window,
+    BirchImage *image,
+    BirchPipeline pipeline,
+    float x,
+    float y,
+    float width,
+    float height,
+    BirchColor color
+)
+{
+    BirchDrawList *list = &window->state->drawList;
+
+    int page = birchAtlasPlace(&window->state->atlas, image);
+    if (page < 0)
+    {
+        return;
+    }
+    Vertex *vertices = birchDrawListPush(
+        list,
+        BIRCH_DRAW_KEY(list->layer, pipeline, page + 1),
+        6
+    );
+    if (!vertices)
+    {
+        return;
+    }
+
+    // The first row of the image is at the top
+    float scale = 1.0f / BIRCH_ATLAS_SIZE;
+    float u0 = image->x * scale;
+    float u1 = (image->x + image->width) * scale;
+    float v0 = image->y * scale;
+    float v1 = (image->y + image->height) * scale;
+    vertices[0] = birchDrawTexturedVertex(x, y, u0, v1, color);
+    vertices[1] = birchDrawTexturedVertex(x + width, y, u1, v1, color);
+    vertices[2] =
+        birchDrawTexturedVertex(x + width, y + height, u1, v0, color);
+    vertices[3] = vertices[0];
+    vertices[4] = vertices[2];
+    vertices[5] = birchDrawTexturedVertex(x, y + height, u0, v0, color);
+}
+
+void birchDrawImage(
+    BirchWindow *window,
+    BirchImage *image,
+    float x,
+    float y,
+    float width,
+    float height,
+    BirchColor tint
+)
+{
+    // The image is packed into the atlas of its own window
+    if (window != image->window)
+    {
+        return;
+    }
+    birchDrawAtlasImage(
+        window,
+        image,
+        BIRCH_PIPELINE_TEXTURED,
+        x,
+        y,
+        width,
+        height,
+        tint
+    );
+}
+
+void birchWindowGetDrawStats(BirchWindow *window, BirchDrawStats *stats)
+{
+    birchWindowLockRender(window);
+    *stats = window->state->drawStats;
+    birchWindowUnlockRender(window);
+}
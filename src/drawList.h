@@ -0,0 +1,95 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BIRCH_DRAW_LIST_H
+#define BIRCH_DRAW_LIST_H
+
+#include "arena.h"
+#include "draw.h"
+#include "shaderTypes.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Everything is recorded as triangle lists. A batch is a run of consecutive
+// triangles with the same key; flattening a list stable-sorts the batches by
+// key and merges neighbours with equal keys into one draw call.
+
+typedef enum
+{
+    BIRCH_PIPELINE_SOLID,
+    // colors multiplied with the texture, alpha blended over the target.
+    // The texture of the key is an atlas page plus one.
+    BIRCH_PIPELINE_TEXTURED,
+    // the vertex colors with their alpha scaled by the coverage of a
+    // distance field in the alpha of an atlas page, see
+    // BIRCH_DISTANCE_FIELD_SPREAD. The texture is the page plus one too.
+    BIRCH_PIPELINE_DISTANCE_FIELD,
+} BirchPipeline;
+
+// layer in the high bits so layers are never reordered, 24 bits of it, see
+// BIRCH_MAX_LAYER
+#define BIRCH_DRAW_KEY(layer, pipeline, texture)                               \
+    (((uint64_t)(layer) << 40) | ((uint64_t)(pipeline) << 32) |                \
+     (uint64_t)(texture))
+#define BIRCH_DRAW_KEY_PIPELINE(key) ((BirchPipeline)(((key) >> 32) & 0xff))
+#define BIRCH_DRAW_KEY_TEXTURE(key) ((uint32_t)(key))
+
+typedef struct
+{
+    uint64_t key;
+    uint32_t first;
+    uint32_t count;
+} BirchDrawBatch;
+
+typedef struct
+{
+    Vertex *vertices;
+    size_t vertexCount;
+    size_t vertexCapacity;
+    BirchDrawBatch *batches;
+    size_t batchCount;
+    size_t batchCapacity;
+    // the flattened draw calls
+    BirchDrawBatch *calls;
+    size_t callCount;
+    size_t primitives;
+    unsigned int layer;
+    bool unsorted;
+    // when the OS reported the oldest input the frame responds to, in
+    // birchClockNow nanoseconds, 0 if none
+    uint64_t inputTime;
+} BirchDrawList;
+
+void birchDrawListRelease(BirchDrawList *list);
+void birchDrawListReset(BirchDrawList *list);
+
+/// @brief Append `count` vertices with `key` to the list
+/// @return where to write the vertices, NULL if out of memory
+Vertex *birchDrawListPush(BirchDrawList *list, uint64_t key, size_t count);
+
+/// @brief Copy the vertices of the list to `out` in draw order and build the
+/// merged draw calls in `list->calls`, whose `first` index into `out`
+/// @param scratch where batches that are out of order are sorted
+/// @return the number of draw calls, 0 if out of memory
+size_t birchDrawListFlatten(
+    BirchDrawList *list,
+    Vertex *out,
+    BirchArena *scratch
+);
+
+#endif
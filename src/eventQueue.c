@@ -0,0 +1,98 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "eventQueue.h"
+#include "heap.h"
+#include <string.h>
+
+bool birchEventQueueInit(BirchEventQueue *queue, size_t capacity)
+{
+    size_t size = 1;
+    while (size < capacity)
+    {
+        size *= 2;
+    }
+
+    queue->events = birchAllocate(size * sizeof(BirchEvent));
+    if (!queue->events)
+    {
+        return false;
+    }
+    queue->mask = size - 1;
+    atomic_init(&queue->tail, 0);
+    queue->cachedHead = 0;
+    atomic_init(&queue->dropped, 0);
+    atomic_init(&queue->head, 0);
+    queue->cachedTail = 0;
+    return true;
+}
+
+void birchEventQueueRelease(BirchEventQueue *queue)
+{
+    birchFree(queue->events);
+    queue->events = NULL;
+}
+
+bool birchEventQueuePush(BirchEventQueue *queue, const BirchEvent *event)
+{
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+
+    if (tail - queue->cachedHead > queue->mask)
+    {
+        queue->cachedHead =
+            atomic_load_explicit(&queue->head, memory_order_acquire);
+        if (tail - queue->cachedHead > queue->mask)
+        {
+            atomic_fetch_add_explicit(
+                &queue->dropped,
+                1,
+                memory_order_relaxed
+            );
+            return false;
+        }
+    }
+
+    queue->events[tail & queue->mask] = *event;
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+size_t birchEventQueuePop(BirchEventQueue *queue, BirchEvent *out, size_t max)
+{
+    size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+
+    if (queue->cachedTail - head < max)
+    {
+        queue->cachedTail =
+            atomic_load_explicit(&queue->tail, memory_order_acquire);
+    }
+
+    size_t count = queue->cachedTail - head;
+    count = count < max ? count : max;
+
+    // Copy in at most two runs, split where the ring wraps
+    size_t first = head & queue->mask;
+    size_t run = queue->mask + 1 - first;
+    run = run < count ? run : count;
+    memcpy(out, queue->events + first, run * sizeof(BirchEvent));
+    memcpy(out + run, queue->events, (count - run) * sizeof(BirchEvent));
+
+    atomic_store_explicit(&queue->head, head + count, memory_order_release);
+    return count;
+}
@@ -0,0 +1,63 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef BIRCH_EVENT_QUEUE_H
+#define BIRCH_EVENT_QUEUE_H
+
+#include "window.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Single-producer single-consumer ring of events. The producer is the
+// thread running the OS message pump, the consumer whoever polls. Each
+// side owns one index and keeps a cached copy of the other's, so pushes and
+// pops only touch shared cache lines when the cached view runs out.
+
+#define BIRCH_EVENT_QUEUE_CAPACITY 4096
+
+typedef struct
+{
+    BirchEvent *events;
+    size_t mask;
+
+    // written by the producer
+    _Atomic size_t tail;
+    size_t cachedHead;
+    _Atomic size_t dropped;
+    char producerPadding[64];
+
+    // written by the consumer
+    _Atomic size_t head;
+    size_t cachedTail;
+    char consumerPadding[64];
+} BirchEventQueue;
+
+/// @param capacity rounded up to a power of two
+bool birchEventQueueInit(BirchEventQueue *queue, size_t capacity);
+void birchEventQueueRelease(BirchEventQueue *queue);
+
+/// @brief Producer side, never blocks
+/// @return false if the queue is full and the event was dropped
+bool birchEventQueuePush(BirchEventQueue *queue, const BirchEvent *event);
+
+/// @brief Consumer side, never blocks
+/// @return the number of events written to `out`
+size_t birchEventQueuePop(BirchEventQueue *queue, BirchEvent *out, size_t max);
+
+#endif
@@ -0,0 +1,319 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "glLoader.h"
+#include <stdio.h>
+
+// Every GL function birch calls. Split by return type since a void function
+// may not return a void expression in C.
+#define BIRCH_GL_VOID_FUNCTIONS(X)                                             \
+    X(glAttachShader,                                                          \
+      PFNGLATTACHSHADERPROC,                                                   \
+      (GLuint program, GLuint shader),                                         \
+      (program, shader))                                                       \
+    X(glBindBuffer,                                                            \
+      PFNGLBINDBUFFERPROC,                                                     \
+      (GLenum target, GLuint buffer),                                          \
+      (target, buffer))                                                        \
+    X(glBindBufferRange,                                                       \
+      PFNGLBINDBUFFERRANGEPROC,                                                \
+      (GLenum target,                                                          \
+       GLuint index,                                                           \
+       GLuint buffer,                                                          \
+       GLintptr offset,                                                        \
+       GLsizeiptr size),                                                       \
+      (target, index, buffer, offset, size))                                   \
+    X(glBindTexture,                                                           \
+      PFNGLBINDTEXTUREPROC,                                                    \
+      (GLenum target, GLuint texture),                                         \
+      (target, texture))                                                       \
+    X(glBindVertexArray, PFNGLBINDVERTEXARRAYPROC, (GLuint array), (array))    \
+    X(glBlendFunc,                                                             \
+      PFNGLBLENDFUNCPROC,                                                      \
+      (GLenum sfactor, GLenum dfactor),                                        \
+      (sfactor, dfactor))                                                      \
+    X(glBufferData,                                                            \
+      PFNGLBUFFERDATAPROC,                                                     \
+      (GLenum target, GLsizeiptr size, const void *data, GLenum usage),        \
+      (target, size, data, usage))                                             \
+    X(glBufferStorage,                                                         \
+      PFNGLBUFFERSTORAGEPROC,                                                  \
+      (GLenum target, GLsizeiptr size, const void *data, GLbitfield flags),    \
+      (target, size, data, flags))                                             \
+    X(glBufferSubData,                                                         \
+      PFNGLBUFFERSUBDATAPROC,                                                  \
+      (GLenum target, GLintptr offset, GLsizeiptr size, const void *data),     \
+      (target, offset, size, data))                                            \
+    X(glClear, PFNGLCLEARPROC, (GLbitfield mask), (mask))                      \
+    X(glClearColor,                                                            \
+      PFNGLCLEARCOLORPROC,                                                     \
+      (GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha),               \
+      (red, green, blue, alpha))                                               \
+    X(glCompileShader, PFNGLCOMPILESHADERPROC, (GLuint shader), (shader))      \
+    X(glDeleteBuffers,                                                         \
+      PFNGLDELETEBUFFERSPROC,                                                  \
+      (GLsizei n, const GLuint *buffers),                                      \
+      (n, buffers))                                                            \
+    X(glDeleteProgram, PFNGLDELETEPROGRAMPROC, (GLuint program), (program))    \
+    X(glDeleteShader, PFNGLDELETESHADERPROC, (GLuint shader), (shader))        \
+    X(glDeleteSync, PFNGLDELETESYNCPROC, (GLsync sync), (sync))                \
+    X(glDeleteTextures,                                                        \
+      PFNGLDELETETEXTURESPROC,                                                 \
+      (GLsizei n, const GLuint *textures),                                     \
+      (n, textures))                                                           \
+    X(glDeleteVertexArrays,                                                    \
+      PFNGLDELETEVERTEXARRAYSPROC,                                             \
+      (GLsizei n, const GLuint *arrays),                                       \
+      (n, arrays))                                                             \
+    X(glDisable, PFNGLDISABLEPROC, (GLenum cap), (cap))                        \
+    X(glDrawArrays,                                                            \
+      PFNGLDRAWARRAYSPROC,                                                     \
+      (GLenum mode, GLint first, GLsizei count),                               \
+      (mode, first, count))                                                    \
+    X(glEnable, PFNGLENABLEPROC, (GLenum cap), (cap))                          \
+    X(glEnableVertexAttribArray,                                               \
+      PFNGLENABLEVERTEXATTRIBARRAYPROC,                                        \
+      (GLuint index),                                                          \
+      (index))                                                                 \
+    X(glGenBuffers,                                                            \
+      PFNGLGENBUFFERSPROC,                                                     \
+      (GLsizei n, GLuint *buffers),                                            \
+      (n, buffers))                                                            \
+    X(glGenTextures,                                                           \
+      PFNGLGENTEXTURESPROC,                                                    \
+      (GLsizei n, GLuint *textures),                                           \
+      (n, textures))                                                           \
+    X(glGenVertexArrays,                                                       \
+      PFNGLGENVERTEXARRAYSPROC,                                                \
+      (GLsizei n, GLuint *arrays),                                             \
+      (n, arrays))                                                             \
+    X(glGetIntegerv,                                                           \
+      PFNGLGETINTEGERVPROC,                                                    \
+      (GLenum pname, GLint *data),                                             \
+      (pname, data))                                                           \
+    X(glGetProgramiv,                                                          \
+      PFNGLGETPROGRAMIVPROC,                                                   \
+      (GLuint program, GLenum pname, GLint *params),                           \
+      (program, pname, params))                                                \
+    X(glGetShaderInfoLog,                                                      \
+      PFNGLGETSHADERINFOLOGPROC,                                               \
+      (GLuint shader, GLsizei bufSize, GLsizei *length, GLchar *infoLog),      \
+      (shader, bufSize, length, infoLog))                                      \
+    X(glGetShaderiv,                                                           \
+      PFNGLGETSHADERIVPROC,                                                    \
+      (GLuint shader, GLenum pname, GLint *params),                            \
+      (shader, pname, params))                                                 \
+    X(glLinkProgram, PFNGLLINKPROGRAMPROC, (GLuint program), (program))        \
+    X(glPixelStorei,                                                           \
+      PFNGLPIXELSTOREIPROC,                                                    \
+      (GLenum pname, GLint param),                                             \
+      (pname, param))                                                          \
+    X(glShaderSource,                                                          \
+      PFNGLSHADERSOURCEPROC,                                                   \
+      (GLuint shader,                                                          \
+       GLsizei count,                                                          \
+       const GLchar *const *string,                                            \
+       const GLint *length),                                                   \
+      (shader, count, string, length))                                         \
+    X(glTexImage2D,                                                            \
+      PFNGLTEXIMAGE2DPROC,                                                     \
+      (GLenum target,                                                          \
+       GLint level,                                                            \
+       GLint internalformat,                                                   \
+       GLsizei width,                                                          \
+       GLsizei height,                                                         \
+       GLint border,                                                           \
+       GLenum format,                                                          \
+       GLenum type,                                                            \
+       const void *pixels),                                                    \
+      (target,                                                                 \
+       level,                                                                  \
+       internalformat,                                                         \
+       width,                                                                  \
+       height,                                                                 \
+       border,                                                                 \
+       format,                                                                 \
+       type,                                                                   \
+       pixels))                                                                \
+    X(glTexParameteri,                                                         \
+      PFNGLTEXPARAMETERIPROC,                                                  \
+      (GLenum target, GLenum pname, GLint param),                              \
+      (target, pname, param))                                                  \
+    X(glTexSubImage2D,                                                         \
+      PFNGLTEXSUBIMAGE2DPROC,                                                  \
+      (GLenum target,                                                          \
+       GLint level,                                                            \
+       GLint xoffset,                                                          \
+       GLint yoffset,                                                          \
+       GLsizei width,                                                          \
+       GLsizei height,                                                         \
+       GLenum format,                                                          \
+       GLenum type,                                                            \
+       const void *pixels),                                                    \
+      (target, level, xoffset, yoffset, width, height, format, type, pixels))  \
+    X(glUniformBlockBinding,                                                   \
+      PFNGLUNIFORMBLOCKBINDINGPROC,                                            \
+      (GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding),  \
+      (program, uniformBlockIndex, uniformBlockBinding))                       \
+    X(glUseProgram, PFNGLUSEPROGRAMPROC, (GLuint program), (program))          \
+    X(glVertexAttribPointer,                                                   \
+      PFNGLVERTEXATTRIBPOINTERPROC,                                            \
+      (GLuint index,                                                           \
+       GLint size,                                                             \
+       GLenum type,                                                            \
+       GLboolean normalized,                                                   \
+       GLsizei stride,                                                         \
+       const void *pointer),                                                   \
+      (index, size, type, normalized, stride, pointer))                        \
+    X(glViewport,                                                              \
+      PFNGLVIEWPORTPROC,                                                       \
+      (GLint x, GLint y, GLsizei width, GLsizei height),                       \
+      (x, y, width, height))
+
+#define BIRCH_GL_VALUE_FUNCTIONS(X)                                            \
+    X(glClientWaitSync,                                                        \
+      PFNGLCLIENTWAITSYNCPROC,                                                 \
+      GLenum,                                                                  \
+      (GLsync sync, GLbitfield flags, GLuint64 timeout),                       \
+      (sync, flags, timeout))                                                  \
+    X(glCreateProgram, PFNGLCREATEPROGRAMPROC, GLuint, (void), ())             \
+    X(glCreateShader, PFNGLCREATESHADERPROC, GLuint, (GLenum type), (type))    \
+    X(glFenceSync,                                                             \
+      PFNGLFENCESYNCPROC,                                                      \
+      GLsync,                                                                  \
+      (GLenum condition, GLbitfield flags),                                    \
+      (condition, flags))                                                      \
+    X(glGetUniformBlockIndex,                                                  \
+      PFNGLGETUNIFORMBLOCKINDEXPROC,                                           \
+      GLuint,                                                                  \
+      (GLuint program, const GLchar *uniformBlockName),                        \
+      (program, uniformBlockName))                                             \
+    X(glMapBufferRange,                                                        \
+      PFNGLMAPBUFFERRANGEPROC,                                                 \
+      void *,                                                                  \
+      (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access),  \
+      (target, offset, length, access))                                        \
+    X(glUnmapBuffer,                                                           \
+      PFNGLUNMAPBUFFERPROC,                                                    \
+      GLboolean,                                                               \
+      (GLenum target),                                                         \
+      (target))
+
+static GLADuserptrloadfunc birchGlLookup = NULL;
+static void *birchGlUser = NULL;
+
+#define BIRCH_GL_VOID_STUB(name, type, params, args)                           \
+    static void GLAD_API_PTR birchGlStub_##name params                         \
+    {                                                                          \
+        glad_##name = (type)birchGlLookup(birchGlUser, #name);                 \
+        glad_##name args;                                                      \
+    }
+#define BIRCH_GL_VALUE_STUB(name, type, result, params, args)                  \
+    static result GLAD_API_PTR birchGlStub_##name params                       \
+    {                                                                          \
+        glad_##name = (type)birchGlLookup(birchGlUser, #name);                 \
+        return glad_##name args;                                               \
+    }
+BIRCH_GL_VOID_FUNCTIONS(BIRCH_GL_VOID_STUB)
+BIRCH_GL_VALUE_FUNCTIONS(BIRCH_GL_VALUE_STUB)
+
+static const struct
+{
+    int *flag;
+    int version;
+} birchGlVersions[] = {
+    {&GLAD_GL_VERSION_1_0, GLAD_MAKE_VERSION(1, 0)},
+    {&GLAD_GL_VERSION_1_1, GLAD_MAKE_VERSION(1, 1)},
+    {&GLAD_GL_VERSION_1_2, GLAD_MAKE_VERSION(1, 2)},
+    {&GLAD_GL_VERSION_1_3, GLAD_MAKE_VERSION(1, 3)},
+    {&GLAD_GL_VERSION_1_4, GLAD_MAKE_VERSION(1, 4)},
+    {&GLAD_GL_VERSION_1_5, GLAD_MAKE_VERSION(1, 5)},
+    {&GLAD_GL_VERSION_2_0, GLAD_MAKE_VERSION(2, 0)},
+    {&GLAD_GL_VERSION_2_1, GLAD_MAKE_VERSION(2, 1)},
+    {&GLAD_GL_VERSION_3_0, GLAD_MAKE_VERSION(3, 0)},
+    {&GLAD_GL_VERSION_3_1, GLAD_MAKE_VERSION(3, 1)},
+    {&GLAD_GL_VERSION_3_2, GLAD_MAKE_VERSION(3, 2)},
+    {&GLAD_GL_VERSION_3_3, GLAD_MAKE_VERSION(3, 3)},
+    {&GLAD_GL_VERSION_4_0, GLAD_MAKE_VERSION(4, 0)},
+    {&GLAD_GL_VERSION_4_1, GLAD_MAKE_VERSION(4, 1)},
+    {&GLAD_GL_VERSION_4_2, GLAD_MAKE_VERSION(4, 2)},
+    {&GLAD_GL_VERSION_4_3, GLAD_MAKE_VERSION(4, 3)},
+    {&GLAD_GL_VERSION_4_4, GLAD_MAKE_VERSION(4, 4)},
+    {&GLAD_GL_VERSION_4_5, GLAD_MAKE_VERSION(4, 5)},
+    {&GLAD_GL_VERSION_4_6, GLAD_MAKE_VERSION(4, 6)},
+};
+
+static int birchGlFindVersion(void)
+{
+    const char *string = (const char *)glad_glGetString(GL_VERSION);
+    if (!string)
+    {
+        return 0;
+    }
+
+    // Skip prefixes like "OpenGL ES "
+    while (*string && (*string < '0' || *string > '9'))
+    {
+        string++;
+    }
+    int major = 0;
+    int minor = 0;
+    if (sscanf(string, "%d.%d", &major, &minor) != 2)
+    {
+        return 0;
+    }
+
+    int version = GLAD_MAKE_VERSION(major, minor);
+    for (size_t i = 0; i < sizeof(birchGlVersions) / sizeof(birchGlVersions[0]);
+         i++)
+    {
+        *birchGlVersions[i].flag = version >= birchGlVersions[i].version;
+    }
+    return version;
+}
+
+int birchGlLoad(BirchGlLoadMode mode, GLADuserptrloadfunc load, void *user)
+{
+    birchGlLookup = load;
+    birchGlUser = user;
+
+    glad_glGetString = (PFNGLGETSTRINGPROC)load(user, "glGetString");
+    if (!glad_glGetString)
+    {
+        return 0;
+    }
+    int version = birchGlFindVersion();
+    if (!version)
+    {
+        return 0;
+    }
+
+#define BIRCH_GL_VOID_LOAD(name, type, params, args)                           \
+    glad_##name = mode == BIRCH_GL_LOAD_LAZY ? birchGlStub_##name              \
+                                             : (type)load(user, #name);
+#define BIRCH_GL_VALUE_LOAD(name, type, result, params, args)                  \
+    glad_##name = mode == BIRCH_GL_LOAD_LAZY ? birchGlStub_##name              \
+                                             : (type)load(user, #name);
+    BIRCH_GL_VOID_FUNCTIONS(BIRCH_GL_VOID_LOAD)
+    BIRCH_GL_VALUE_FUNCTIONS(BIRCH_GL_VALUE_LOAD)
+#undef BIRCH_GL_VALUE_LOAD
+#undef BIRCH_GL_VOID_LOAD
+
+    return version;
+}
@@ -0,0 +1,44 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BIRCH_GL_LOADER_H
+#define BIRCH_GL_LOADER_H
+
+#include <glad/gl.h>
+
+// Alternatives to gladLoadGL, which looks up every function of GL 4.6 and
+// of every extension glad was generated with, then parses the extension
+// list, although birch calls fewer than 50 of them. Both fill in the same
+// glad_gl* pointers, so code keeps calling the glad macros, and both set
+// the GLAD_GL_VERSION_* flags. Functions birch does not call are left NULL:
+// add new ones to the table in glLoader.c.
+
+typedef enum
+{
+    // look up the functions birch calls, up front
+    BIRCH_GL_LOAD_LIST,
+    // point them at stubs that look the function up on the first call and
+    // patch the pointer, so only functions that are called are looked up
+    BIRCH_GL_LOAD_LAZY,
+} BirchGlLoadMode;
+
+/// @brief Load GL for the current context
+/// @param load looks functions up, also used later by lazy stubs
+/// @return GLAD_MAKE_VERSION of the context, 0 on failure
+int birchGlLoad(BirchGlLoadMode mode, GLADuserptrloadfunc load, void *user);
+
+#endif
@@ -0,0 +1,160 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "heap.h"
+#include "allocator.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// All NULL for malloc
+static BirchAllocator birchHeapAllocator;
+
+static atomic_size_t birchHeapAllocations;
+static atomic_size_t birchHeapBytes;
+static atomic_size_t birchHeapLive;
+
+bool birchSetAllocator(const BirchAllocator *allocator)
+{
+    if (!allocator)
+    {
+        birchHeapAllocator = (BirchAllocator){0};
+        return true;
+    }
+    // Mixing hooks with malloc would free memory with the wrong allocator
+    if (!allocator->allocate || !allocator->reallocate || !allocator->free)
+    {
+        return false;
+    }
+    birchHeapAllocator = *allocator;
+    return true;
+}
+
+static void birchHeapCount(size_t size, size_t blocks)
+{
+    atomic_fetch_add_explicit(&birchHeapAllocations, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&birchHeapBytes, size, memory_order_relaxed);
+    atomic_fetch_add_explicit(&birchHeapLive, blocks, memory_order_relaxed);
+}
+
+void *birchAllocate(size_t size)
+{
+    void *pointer;
+    if (birchHeapAllocator.allocate)
+    {
+        pointer = birchHeapAllocator.allocate(birchHeapAllocator.user, size);
+    }
+    else
+    {
+        pointer = malloc(size);
+    }
+    if (pointer)
+    {
+        birchHeapCount(size, 1);
+    }
+    return pointer;
+}
+
+void *birchAllocateZeroed(size_t count, size_t size)
+{
+    if (size && count > SIZE_MAX / size)
+    {
+        return NULL;
+    }
+    if (!birchHeapAllocator.allocate)
+    {
+        // calloc gets fresh pages from the OS already zeroed, without
+        // touching them
+        void *pointer = calloc(count, size);
+        if (pointer)
+        {
+            birchHeapCount(count * size, 1);
+        }
+        return pointer;
+    }
+
+    void *pointer = birchAllocate(count * size);
+    if (pointer)
+    {
+        memset(pointer, 0, count * size);
+    }
+    return pointer;
+}
+
+void *birchReallocate(void *pointer, size_t size)
+{
+    void *grown;
+    if (birchHeapAllocator.reallocate)
+    {
+        grown = birchHeapAllocator.reallocate(
+            birchHeapAllocator.user,
+            pointer,
+            size
+        );
+    }
+    else
+    {
+        grown = realloc(pointer, size);
+    }
+    if (grown)
+    {
+        birchHeapCount(size, pointer ? 0 : 1);
+    }
+    return grown;
+}
+
+void birchFree(void *pointer)
+{
+    if (!pointer)
+    {
+        return;
+    }
+    atomic_fetch_sub_explicit(&birchHeapLive, 1, memory_order_relaxed);
+    if (birchHeapAllocator.free)
+    {
+        birchHeapAllocator.free(birchHeapAllocator.user, pointer);
+    }
+    else
+    {
+        free(pointer);
+    }
+}
+
+size_t birchHeapCapacity(size_t capacity, size_t size)
+{
+    if (!capacity)
+    {
+        return size;
+    }
+    if (size <= capacity && size > capacity / 4)
+    {
+        return capacity;
+    }
+    return size + size / 4;
+}
+
+void birchHeapGetCounters(BirchHeapCounters *counters)
+{
+    counters->allocations =
+        atomic_load_explicit(&birchHeapAllocations, memory_order_relaxed);
+    counters->bytes =
+        atomic_load_explicit(&birchHeapBytes, memory_order_relaxed);
+    counters->live = atomic_load_explicit(&birchHeapLive, memory_order_relaxed);
+}
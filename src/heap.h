@@ -0,0 +1,52 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef BIRCH_HEAP_H
+#define BIRCH_HEAP_H
+
+#include <stddef.h>
+
+// The allocator behind every allocation of the library, see allocator.h.
+// Allocations are counted from every thread.
+
+typedef struct
+{
+    // calls to birchAllocate and birchReallocate that succeeded, and the
+    // bytes they asked for
+    size_t allocations;
+    size_t bytes;
+    // blocks allocated and not freed yet
+    size_t live;
+} BirchHeapCounters;
+
+void *birchAllocate(size_t size);
+/// @brief Allocate `count` zeroed elements, NULL if the size overflows
+void *birchAllocateZeroed(size_t count, size_t size);
+void *birchReallocate(void *pointer, size_t size);
+void birchFree(void *pointer);
+
+void birchHeapGetCounters(BirchHeapCounters *counters);
+
+/// @brief Capacity of a buffer that holds `capacity` bytes and must now
+/// hold `size`. The buffer keeps its capacity while `size` fits and uses
+/// more than a quarter of it, otherwise it gets `size` and a quarter more,
+/// so a window resized a step at a time reallocates every few steps. The
+/// first allocation, from a capacity of 0, is exactly `size`.
+size_t birchHeapCapacity(size_t capacity, size_t size);
+
+#endif
@@ -0,0 +1,55 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "init.h"
+#include "initInternal.h"
+#include "thread.h"
+#include <stddef.h>
+
+static BirchThreadPool *birchThreadPool = NULL;
+
+void birchInit(const char *name)
+{
+    birchInitWithOptions(name, NULL);
+}
+
+void birchInitWithOptions(const char *name, const BirchInitOptions *options)
+{
+    unsigned int threadCount = options ? options->threadCount : 0;
+    if (threadCount == 0)
+    {
+        threadCount = birchCpuCount();
+    }
+
+    // Without a pool everything runs on the calling thread
+    birchThreadPool = birchThreadPoolNew(threadCount);
+    birchPlatformInit(name);
+}
+
+void birchTerminate()
+{
+    birchPlatformTerminate();
+    birchThreadPoolFree(birchThreadPool);
+    birchThreadPool = NULL;
+}
+
+BirchThreadPool *birchGetThreadPool(void)
+{
+    return birchThreadPool;
+}
@@ -0,0 +1,35 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef BIRCH_INIT_INTERNAL_H
+#define BIRCH_INIT_INTERNAL_H
+
+#include "threadPool.h"
+
+// Implemented by each backend, called by birchInit and birchTerminate
+void birchPlatformInit(const char *name);
+void birchPlatformTerminate(void);
+
+/// @brief Implemented by each backend: pump the pending OS events of every
+/// window and dispatch them to the window they belong to
+void birchPlatformPollEvents(void);
+
+/// @brief The pool created by birchInit, NULL before birchInit
+BirchThreadPool *birchGetThreadPool(void);
+
+#endif
@@ -0,0 +1,314 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lz4.h"
+#include "heap.h"
+#include <string.h>
+
+#define BIRCH_LZ4_MIN_MATCH 4
+// The last match has to start this far before the end of the input, and
+// the last bytes are always literals
+#define BIRCH_LZ4_MATCH_LIMIT 12
+#define BIRCH_LZ4_LAST_LITERALS 5
+#define BIRCH_LZ4_MAX_OFFSET 65535
+#define BIRCH_LZ4_HASH_BITS 16
+
+// The smallest multiple of every offset below 8 that is at least 8
+static const uint8_t birchLz4Period[8] = {0, 8, 8, 9, 8, 10, 12, 14};
+
+static uint32_t birchLz4Read32(const uint8_t *pointer)
+{
+    uint32_t value;
+    memcpy(&value, pointer, sizeof(value));
+    return value;
+}
+
+static uint32_t birchLz4Hash(uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - BIRCH_LZ4_HASH_BITS);
+}
+
+size_t birchLz4Bound(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+// Write a length that did not fit into its 4 bits of the token
+static uint8_t *birchLz4WriteLength(uint8_t *out, size_t length)
+{
+    for (; length >= 255; length -= 255)
+    {
+        *out++ = 255;
+    }
+    *out++ = (uint8_t)length;
+    return out;
+}
+
+// Append literals and, unless `matchLength` is 0, a match. Returns NULL if
+// the sequence does not fit.
+static uint8_t *birchLz4WriteSequence(
+    uint8_t *out,
+    const uint8_t *end,
+    const uint8_t *literals,
+    size_t literalLength,
+    size_t offset,
+    size_t matchLength
+)
+{
+    size_t needed = 1 + literalLength / 255 + 1 + literalLength + 2 +
+                    matchLength / 255 + 1;
+    if (needed > (size_t)(end - out))
+    {
+        return NULL;
+    }
+
+    uint8_t *token = out++;
+    if (literalLength >= 15)
+    {
+        *token = 15 << 4;
+        out = birchLz4WriteLength(out, literalLength - 15);
+    }
+    else
+    {
+        *token = (uint8_t)(literalLength << 4);
+    }
+    memcpy(out, literals, literalLength);
+    out += literalLength;
+
+    if (matchLength)
+    {
+        *out++ = (uint8_t)offset;
+        *out++ = (uint8_t)(offset >> 8);
+        size_t length = matchLength - BIRCH_LZ4_MIN_MATCH;
+        if (length >= 15)
+        {
+            *token |= 15;
+            out = birchLz4WriteLength(out, length - 15);
+        }
+        else
+        {
+            *token |= (uint8_t)length;
+        }
+    }
+    return out;
+}
+
+size_t birchLz4Compress(
+    const uint8_t *source,
+    size_t size,
+    uint8_t *destination,
+    size_t capacity
+)
+{
+    uint8_t *out = destination;
+    const uint8_t *end = destination + capacity;
+    size_t anchor = 0;
+
+    if (size > BIRCH_LZ4_MATCH_LIMIT)
+    {
+        // Positions plus one of the last sequence seen with every hash
+        size_t *table = birchAllocateZeroed(
+            (size_t)1 << BIRCH_LZ4_HASH_BITS,
+            sizeof(size_t)
+        );
+        if (!table)
+        {
+            return 0;
+        }
+
+        size_t limit = size - BIRCH_LZ4_MATCH_LIMIT;
+        size_t matchEnd = size - BIRCH_LZ4_LAST_LITERALS;
+        size_t i = 0;
+        while (i < limit)
+        {
+            uint32_t sequence = birchLz4Read32(source + i);
+            uint32_t hash = birchLz4Hash(sequence);
+            size_t candidate = table[hash];
+            table[hash] = i + 1;
+
+            if (!candidate || i - (candidate - 1) > BIRCH_LZ4_MAX_OFFSET ||
+                birchLz4Read32(source + candidate - 1) != sequence)
+            {
+                // Skip faster through data that does not compress
+                i += 1 + ((i - anchor) >> 6);
+                continue;
+            }
+
+            size_t match = candidate - 1;
+            size_t length = BIRCH_LZ4_MIN_MATCH;
+            while (i + length < matchEnd &&
+                   source[match + length] == source[i + length])
+            {
+                length++;
+            }
+
+            out = birchLz4WriteSequence(
+                out,
+                end,
+                source + anchor,
+                i - anchor,
+                i - match,
+                length
+            );
+            if (!out)
+            {
+                birchFree(table);
+                return 0;
+            }
+            i += length;
+            anchor = i;
+        }
+        birchFree(table);
+    }
+
+    out = birchLz4WriteSequence(
+        out,
+        end,
+        source + anchor,
+        size - anchor,
+        0,
+        0
+    );
+    return out ? (size_t)(out - destination) : 0;
+}
+
+// Read the rest of a length that filled its 4 bits of the token
+static bool birchLz4ReadLength(
+    const uint8_t **in,
+    const uint8_t *end,
+    size_t *length
+)
+{
+    uint8_t byte;
+    do
+    {
+        if (*in == end)
+        {
+            return false;
+        }
+        byte = *(*in)++;
+        *length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+bool birchLz4Decompress(
+    const uint8_t *source,
+    size_t sourceSize,
+    uint8_t *destination,
+    size_t size
+)
+{
+    const uint8_t *in = source;
+    const uint8_t *inEnd = source + sourceSize;
+    uint8_t *out = destination;
+    uint8_t *outEnd = destination + size;
+
+    while (in < inEnd)
+    {
+        uint8_t token = *in++;
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 &&
+            !birchLz4ReadLength(&in, inEnd, &literalLength))
+        {
+            return false;
+        }
+        if (literalLength > (size_t)(inEnd - in) ||
+            literalLength > (size_t)(outEnd - out))
+        {
+            return false;
+        }
+        // Short runs are copied in one fixed size move where there is room
+        if (literalLength <= 16 && inEnd - in >= 16 && outEnd - out >= 16)
+        {
+            memcpy(out, in, 16);
+        }
+        else
+        {
+            memcpy(out, in, literalLength);
+        }
+        in += literalLength;
+        out += literalLength;
+
+        // The last sequence has no match
+        if (in == inEnd)
+        {
+            break;
+        }
+
+        if (inEnd - in < 2)
+        {
+            return false;
+        }
+        size_t offset = in[0] | (size_t)in[1] << 8;
+        in += 2;
+        if (!offset || offset > (size_t)(out - destination))
+        {
+            return false;
+        }
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15 &&
+            !birchLz4ReadLength(&in, inEnd, &matchLength))
+        {
+            return false;
+        }
+        matchLength += BIRCH_LZ4_MIN_MATCH;
+        if (matchLength > (size_t)(outEnd - out))
+        {
+            return false;
+        }
+
+        // Copying in chunks no larger than the distance repeats the last
+        // `offset` bytes for overlapping matches too, and may write up to
+        // one chunk past the match while there is room. Closer matches
+        // repeat with a period of `offset`, so after the first few bytes
+        // they are copied from the nearest multiple of it at least 8 back.
+        const uint8_t *match = out - offset;
+        size_t i = 0;
+        size_t distance = offset;
+        if (offset < 8)
+        {
+            distance = birchLz4Period[offset];
+            for (; i < distance && i < matchLength; i++)
+            {
+                out[i] = match[i];
+            }
+        }
+        size_t chunk = distance >= 16 ? 16 : 8;
+        if ((size_t)(outEnd - out) >= matchLength + chunk)
+        {
+            for (; i < matchLength; i += chunk)
+            {
+                memcpy(out + i, out + i - distance, chunk);
+            }
+        }
+        else
+        {
+            for (; i < matchLength; i++)
+            {
+                out[i] = match[i];
+            }
+        }
+        out += matchLength;
+    }
+
+    return out == outEnd;
+}
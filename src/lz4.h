@@ -0,0 +1,50 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BIRCH_LZ4_H
+#define BIRCH_LZ4_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// The LZ4 block format, without the frame around it, for asset packs. The
+// compressor is the simple greedy one: it is only run when packs are
+// written, and its output decodes with any LZ4 implementation.
+
+/// @brief Largest compressed size of `size` bytes
+size_t birchLz4Bound(size_t size);
+
+/// @brief Compress `size` bytes from `source` into `destination`
+/// @return the compressed size, 0 if it does not fit in `capacity`
+size_t birchLz4Compress(
+    const uint8_t *source,
+    size_t size,
+    uint8_t *destination,
+    size_t capacity
+);
+
+/// @brief Decompress a block that decodes to exactly `size` bytes. Corrupt
+/// input is detected, it never reads or writes out of bounds.
+bool birchLz4Decompress(
+    const uint8_t *source,
+    size_t sourceSize,
+    uint8_t *destination,
+    size_t size
+);
+
+#endif
@@ -0,0 +1,633 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "pack.h"
+#include "heap.h"
+#include "lz4.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// A pack is laid out as
+//
+//     header
+//     asset data, each aligned and followed by at least one NUL byte
+//     records, sorted by hash
+//     buckets: (1 << bucketBits) + 1 record indices, bucket b holding the
+//              first record whose hash starts with the bits of b
+//     names, NUL terminated
+//
+// Only the header is read when a pack is opened. Everything else is
+// checked as lookups reach it, so a corrupt pack fails lookups instead of
+// crashing.
+
+#define BIRCH_PACK_VERSION 1
+#define BIRCH_PACK_LZ4 1u
+
+static const char birchPackMagic[8] = {'B', 'I', 'R', 'C', 'H', 'P', 'A', 'K'};
+
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint32_t bucketBits;
+    uint32_t reserved;
+    uint64_t recordsOffset;
+    uint64_t bucketsOffset;
+    uint64_t namesOffset;
+    uint64_t namesSize;
+    uint64_t fileSize;
+} BirchPackHeader;
+
+typedef struct
+{
+    uint64_t hash;
+    uint64_t offset;
+    uint64_t storedSize;
+    uint64_t size;
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint32_t flags;
+    uint32_t reserved;
+} BirchPackRecord;
+
+_Static_assert(sizeof(BirchPackHeader) == 64, "pack header layout");
+_Static_assert(sizeof(BirchPackRecord) == 48, "pack record layout");
+
+struct BirchPack
+{
+    const uint8_t *base;
+    size_t size;
+    const BirchPackHeader *header;
+    const BirchPackRecord *records;
+    const uint32_t *buckets;
+    const char *names;
+    // Decompressed data of compressed assets, by record
+    _Atomic(uint8_t *) *decoded;
+};
+
+struct BirchPackWriter
+{
+    FILE *file;
+    char *path;
+    uint64_t offset;
+    BirchPackRecord *records;
+    size_t count;
+    size_t capacity;
+    char *names;
+    size_t namesSize;
+    size_t namesCapacity;
+    bool failed;
+};
+
+// FNV-1a
+static uint64_t birchPackHash(const char *name, size_t length)
+{
+    uint64_t hash = 14695981039346656037u;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ (uint8_t)name[i]) * 1099511628211u;
+    }
+    return hash;
+}
+
+static uint64_t birchPackBucket(uint64_t hash, uint32_t bucketBits)
+{
+    return bucketBits ? hash >> (64 - bucketBits) : 0;
+}
+
+static void birchPackUnmap(const uint8_t *base, size_t size)
+{
+#if defined(_WIN32)
+    UnmapViewOfFile(base);
+#else
+    munmap((void *)base, size);
+#endif
+}
+
+static const uint8_t *birchPackMap(const char *path, size_t *size)
+{
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(
+        path,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL
+    );
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return NULL;
+    }
+
+    LARGE_INTEGER fileSize;
+    HANDLE mapping = NULL;
+    const uint8_t *base = NULL;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0 &&
+        (uint64_t)fileSize.QuadPart <= SIZE_MAX)
+    {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    }
+    if (mapping)
+    {
+        // The view keeps the mapping and the file open
+        base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+    *size = base ? (size_t)fileSize.QuadPart : 0;
+    return base;
+#else
+    int file = open(path, O_RDONLY);
+    if (file < 0)
+    {
+        return NULL;
+    }
+
+    struct stat info;
+    void *base = MAP_FAILED;
+    if (fstat(file, &info) == 0 && info.st_size > 0 &&
+        (uint64_t)info.st_size <= SIZE_MAX)
+    {
+        base = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    }
+    close(file);
+    if (base == MAP_FAILED)
+    {
+        return NULL;
+    }
+    *size = info.st_size;
+    return base;
+#endif
+}
+
+BirchPack *birchPackOpen(const char *path)
+{
+    size_t size;
+    const uint8_t *base = birchPackMap(path, &size);
+    if (!base)
+    {
+        return NULL;
+    }
+
+    const BirchPackHeader *header = (const BirchPackHeader *)base;
+    bool valid =
+        size >= sizeof(BirchPackHeader) &&
+        memcmp(header->magic, birchPackMagic, sizeof(birchPackMagic)) == 0 &&
+        header->version == BIRCH_PACK_VERSION && header->fileSize == size &&
+        header->bucketBits < 32 && header->recordsOffset % 8 == 0 &&
+        header->recordsOffset <= size &&
+        header->count <=
+            (size - header->recordsOffset) / sizeof(BirchPackRecord) &&
+        header->bucketsOffset % 4 == 0 && header->bucketsOffset <= size &&
+        ((uint64_t)1 << header->bucketBits) <
+            (size - header->bucketsOffset) / sizeof(uint32_t) &&
+        header->namesOffset <= size && header->namesSize > 0 &&
+        header->namesSize <= size - header->namesOffset &&
+        base[header->namesOffset + header->namesSize - 1] == '\0';
+
+    BirchPack *pack = valid ? birchAllocate(sizeof(BirchPack)) : NULL;
+    // Zeroed pages are mapped on first write, so this does not touch memory
+    // per asset either
+    _Atomic(uint8_t *) *decoded = NULL;
+    if (pack)
+    {
+        decoded = birchAllocateZeroed(
+            header->count ? header->count : 1,
+            sizeof(*decoded)
+        );
+    }
+    if (!decoded)
+    {
+        birchFree(pack);
+        birchPackUnmap(base, size);
+        return NULL;
+    }
+
+    pack->base = base;
+    pack->size = size;
+    pack->header = header;
+    pack->records = (const BirchPackRecord *)(base + header->recordsOffset);
+    pack->buckets = (const uint32_t *)(base + header->bucketsOffset);
+    pack->names = (const char *)(base + header->namesOffset);
+    pack->decoded = decoded;
+    return pack;
+}
+
+void birchPackClose(BirchPack *pack)
+{
+    for (uint32_t i = 0; i < pack->header->count; i++)
+    {
+        birchFree(atomic_load(&pack->decoded[i]));
+    }
+    birchFree(pack->decoded);
+    birchPackUnmap(pack->base, pack->size);
+    birchFree(pack);
+}
+
+size_t birchPackGetCount(BirchPack *pack)
+{
+    return pack->header->count;
+}
+
+static bool birchPackRecordValid(
+    const BirchPack *pack,
+    const BirchPackRecord *record
+)
+{
+    if (record->offset % BIRCH_PACK_ALIGNMENT != 0 ||
+        record->offset > pack->size ||
+        record->storedSize >= pack->size - record->offset)
+    {
+        return false;
+    }
+    if (record->flags & BIRCH_PACK_LZ4)
+    {
+        return record->size < SIZE_MAX;
+    }
+    // The NUL after the data is part of the format
+    return record->size == record->storedSize &&
+           pack->base[record->offset + record->size] == 0;
+}
+
+static const BirchPackRecord *birchPackFind(BirchPack *pack, const char *name)
+{
+    const BirchPackHeader *header = pack->header;
+    size_t length = strlen(name);
+    uint64_t hash = birchPackHash(name, length);
+    uint64_t bucket = birchPackBucket(hash, header->bucketBits);
+
+    uint32_t begin = pack->buckets[bucket];
+    uint32_t end = pack->buckets[bucket + 1];
+    if (end > header->count)
+    {
+        end = header->count;
+    }
+
+    for (uint32_t i = begin; i < end; i++)
+    {
+        const BirchPackRecord *record = &pack->records[i];
+        if (record->hash == hash && record->nameLength == length &&
+            record->nameOffset < header->namesSize &&
+            length < header->namesSize - record->nameOffset &&
+            memcmp(pack->names + record->nameOffset, name, length) == 0)
+        {
+            return birchPackRecordValid(pack, record) ? record : NULL;
+        }
+    }
+    return NULL;
+}
+
+bool birchPackGetInfo(BirchPack *pack, const char *name, BirchPackInfo *info)
+{
+    const BirchPackRecord *record = birchPackFind(pack, name);
+    if (!record)
+    {
+        return false;
+    }
+    info->size = record->size;
+    info->storedSize = record->storedSize;
+    info->compressed = record->flags & BIRCH_PACK_LZ4;
+    return true;
+}
+
+const void *birchPackGet(BirchPack *pack, const char *name, size_t *size)
+{
+    const BirchPackRecord *record = birchPackFind(pack, name);
+    if (!record)
+    {
+        return NULL;
+    }
+    if (size)
+    {
+        *size = record->size;
+    }
+
+    const uint8_t *stored = pack->base + record->offset;
+    if (!(record->flags & BIRCH_PACK_LZ4))
+    {
+        return stored;
+    }
+
+    _Atomic(uint8_t *) *slot = &pack->decoded[record - pack->records];
+    uint8_t *data = atomic_load_explicit(slot, memory_order_acquire);
+    if (data)
+    {
+        return data;
+    }
+
+    data = birchAllocate(record->size + 1);
+    if (!data ||
+        !birchLz4Decompress(stored, record->storedSize, data, record->size))
+    {
+        birchFree(data);
+        return NULL;
+    }
+    data[record->size] = 0;
+
+    // Another thread may have decompressed it at the same time
+    uint8_t *expected = NULL;
+    if (!atomic_compare_exchange_strong_explicit(
+            slot,
+            &expected,
+            data,
+            memory_order_acq_rel,
+            memory_order_acquire
+        ))
+    {
+        birchFree(data);
+        data = expected;
+    }
+    return data;
+}
+
+bool birchPackRead(
+    BirchPack *pack,
+    const char *name,
+    void *buffer,
+    size_t capacity
+)
+{
+    const BirchPackRecord *record = birchPackFind(pack, name);
+    if (!record || record->size > capacity)
+    {
+        return false;
+    }
+
+    const uint8_t *stored = pack->base + record->offset;
+    if (record->flags & BIRCH_PACK_LZ4)
+    {
+        return birchLz4Decompress(
+            stored,
+            record->storedSize,
+            buffer,
+            record->size
+        );
+    }
+    memcpy(buffer, stored, record->size);
+    return true;
+}
+
+static void birchPackWrite(
+    BirchPackWriter *writer,
+    const void *data,
+    size_t size
+)
+{
+    if (!writer->failed && size &&
+        fwrite(data, 1, size, writer->file) != size)
+    {
+        writer->failed = true;
+    }
+    writer->offset += size;
+}
+
+// Write zeros up to the next multiple of `alignment`, at least `minimum`
+static void birchPackPad(
+    BirchPackWriter *writer,
+    uint64_t alignment,
+    uint64_t minimum
+)
+{
+    static const uint8_t zeros[BIRCH_PACK_ALIGNMENT];
+    uint64_t padding = (alignment - (writer->offset + minimum) % alignment) %
+                           alignment +
+                       minimum;
+    birchPackWrite(writer, zeros, padding);
+}
+
+BirchPackWriter *birchPackWriterNew(const char *path)
+{
+    BirchPackWriter *writer = birchAllocateZeroed(1, sizeof(BirchPackWriter));
+    char *copy = birchAllocate(strlen(path) + 1);
+    FILE *file = writer && copy ? fopen(path, "wb") : NULL;
+    if (!file)
+    {
+        birchFree(copy);
+        birchFree(writer);
+        return NULL;
+    }
+    strcpy(copy, path);
+
+    writer->file = file;
+    writer->path = copy;
+    // The header is written last, once the offsets are known
+    BirchPackHeader header = {0};
+    birchPackWrite(writer, &header, sizeof(header));
+    return writer;
+}
+
+bool birchPackWriterAdd(
+    BirchPackWriter *writer,
+    const char *name,
+    const void *data,
+    size_t size,
+    bool compress
+)
+{
+    size_t length = strlen(name);
+    if (writer->failed || writer->count == UINT32_MAX ||
+        writer->namesSize + length + 1 > UINT32_MAX)
+    {
+        writer->failed = true;
+        return false;
+    }
+
+    if (writer->count == writer->capacity)
+    {
+        size_t capacity = writer->capacity ? writer->capacity * 2 : 64;
+        BirchPackRecord *records = birchReallocate(
+            writer->records,
+            capacity * sizeof(BirchPackRecord)
+        );
+        if (!records)
+        {
+            writer->failed = true;
+            return false;
+        }
+        writer->records = records;
+        writer->capacity = capacity;
+    }
+    if (writer->namesSize + length + 1 > writer->namesCapacity)
+    {
+        size_t capacity = (writer->namesSize + length + 1) * 2;
+        char *names = birchReallocate(writer->names, capacity);
+        if (!names)
+        {
+            writer->failed = true;
+            return false;
+        }
+        writer->names = names;
+        writer->namesCapacity = capacity;
+    }
+
+    BirchPackRecord *record = &writer->records[writer->count++];
+    *record = (BirchPackRecord){
+        .hash = birchPackHash(name, length),
+        .offset = writer->offset,
+        .storedSize = size,
+        .size = size,
+        .nameOffset = (uint32_t)writer->namesSize,
+        .nameLength = (uint32_t)length,
+    };
+    memcpy(writer->names + writer->namesSize, name, length + 1);
+    writer->namesSize += length + 1;
+
+    // Only keep the compressed data if it is smaller
+    uint8_t *compressed = compress && size ? birchAllocate(size) : NULL;
+    size_t compressedSize =
+        compressed ? birchLz4Compress(data, size, compressed, size - 1) : 0;
+    if (compressedSize)
+    {
+        record->storedSize = compressedSize;
+        record->flags = BIRCH_PACK_LZ4;
+        birchPackWrite(writer, compressed, compressedSize);
+    }
+    else
+    {
+        birchPackWrite(writer, data, size);
+    }
+    birchFree(compressed);
+
+    birchPackPad(writer, BIRCH_PACK_ALIGNMENT, 1);
+    return !writer->failed;
+}
+
+static int birchPackCompareRecords(const void *a, const void *b)
+{
+    uint64_t hashA = ((const BirchPackRecord *)a)->hash;
+    uint64_t hashB = ((const BirchPackRecord *)b)->hash;
+    return (hashA > hashB) - (hashA < hashB);
+}
+
+static bool birchPackWriteIndex(BirchPackWriter *writer)
+{
+    qsort(
+        writer->records,
+        writer->count,
+        sizeof(BirchPackRecord),
+        birchPackCompareRecords
+    );
+    for (size_t i = 1; i < writer->count; i++)
+    {
+        const BirchPackRecord *a = &writer->records[i - 1];
+        const BirchPackRecord *b = &writer->records[i];
+        if (a->hash == b->hash && a->nameLength == b->nameLength &&
+            memcmp(
+                writer->names + a->nameOffset,
+                writer->names + b->nameOffset,
+                a->nameLength
+            ) == 0)
+        {
+            fprintf(
+                stderr,
+                "birch: %s is in the pack twice\n",
+                writer->names + a->nameOffset
+            );
+            return false;
+        }
+    }
+
+    // About one record per bucket
+    uint32_t bucketBits = 0;
+    while (((size_t)1 << bucketBits) < writer->count)
+    {
+        bucketBits++;
+    }
+    size_t bucketCount = ((size_t)1 << bucketBits) + 1;
+    uint32_t *buckets = birchAllocate(bucketCount * sizeof(uint32_t));
+    if (!buckets)
+    {
+        return false;
+    }
+    size_t record = 0;
+    for (size_t bucket = 0; bucket < bucketCount; bucket++)
+    {
+        while (record < writer->count &&
+               birchPackBucket(writer->records[record].hash, bucketBits) <
+                   bucket)
+        {
+            record++;
+        }
+        buckets[bucket] = (uint32_t)record;
+    }
+
+    BirchPackHeader header = {
+        .version = BIRCH_PACK_VERSION,
+        .count = (uint32_t)writer->count,
+        .bucketBits = bucketBits,
+    };
+    memcpy(header.magic, birchPackMagic, sizeof(birchPackMagic));
+
+    header.recordsOffset = writer->offset;
+    birchPackWrite(
+        writer,
+        writer->records,
+        writer->count * sizeof(BirchPackRecord)
+    );
+    header.bucketsOffset = writer->offset;
+    birchPackWrite(writer, buckets, bucketCount * sizeof(uint32_t));
+    birchFree(buckets);
+    header.namesOffset = writer->offset;
+    header.namesSize = writer->namesSize;
+    birchPackWrite(writer, writer->names, writer->namesSize);
+    // An empty pack still has a terminated name table
+    if (!writer->namesSize)
+    {
+        header.namesSize = 1;
+        birchPackPad(writer, 1, 1);
+    }
+    header.fileSize = writer->offset;
+
+    return !writer->failed && fseek(writer->file, 0, SEEK_SET) == 0 &&
+           fwrite(&header, sizeof(header), 1, writer->file) == 1;
+}
+
+bool birchPackWriterFinish(BirchPackWriter *writer)
+{
+    bool ok = !writer->failed && birchPackWriteIndex(writer);
+    ok = fclose(writer->file) == 0 && ok;
+    if (!ok)
+    {
+        remove(writer->path);
+    }
+
+    birchFree(writer->records);
+    birchFree(writer->names);
+    birchFree(writer->path);
+    birchFree(writer);
+    return ok;
+}
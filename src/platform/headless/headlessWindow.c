@@ -0,0 +1,545 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "clock.h"
+#include "headless.h"
+#include "heap.h"
+#include "initInternal.h"
+#include "profile.h"
+#include "raster.h"
+#include "thread.h"
+#include "tiler.h"
+#include "window.h"
+#include "windowInternal.h"
+#include <stdint.h>
+#include <string.h>
+
+typedef enum
+{
+    HEADLESS_EVENT_MOUSE_MOVED,
+    HEADLESS_EVENT_RESIZE,
+    HEADLESS_EVENT_KEY_PRESSED,
+    HEADLESS_EVENT_KEY_RELEASED,
+    HEADLESS_EVENT_MOUSE_BUTTON_PRESSED,
+    HEADLESS_EVENT_MOUSE_BUTTON_RELEASED,
+    HEADLESS_EVENT_CLOSE,
+} HeadlessEventType;
+
+typedef struct
+{
+    HeadlessEventType type;
+    int a;
+    int b;
+    // mouse motion
+    float x;
+    float y;
+    uint64_t time;
+} HeadlessEvent;
+
+typedef struct HeadlessWindow
+{
+    BirchWindow base;
+    // the next window alive, for birchPollEvents
+    struct HeadlessWindow *next;
+    uint8_t *pixels;
+    size_t pixelCapacity;
+    unsigned int pixelWidth;
+    unsigned int pixelHeight;
+    BirchTiler tiler;
+    // tiles in the framebuffer, and as last reported damaged
+    BirchTileCache tileCache;
+    BirchTileCache shown;
+    // the last size injected in the events being pumped, applied once
+    // they are all delivered
+    bool resizePending;
+    HeadlessEvent resize;
+    bool shouldClose;
+    bool vsync;
+    // injection may happen on any thread
+    BirchMutex mutex;
+    BirchCond eventsPending;
+    HeadlessEvent *pending;
+    size_t pendingCount;
+    size_t pendingCapacity;
+} HeadlessWindow;
+
+// Refresh rate of the simulated display
+#define HEADLESS_VSYNC_PERIOD (1000000000 / 60)
+
+// Windows are created and freed on the thread that updates them
+static HeadlessWindow *headlessWindows = NULL;
+
+static void *headlessStreamAllocate(void *context, size_t size)
+{
+    return birchAllocate(size);
+}
+
+static void headlessStreamRelease(void *context, void *data)
+{
+    birchFree(data);
+}
+
+// The framebuffer is produced on the CPU before birchWindowUpdate returns,
+// so frames retire immediately and no fences are needed
+static const BirchStreamBackend headlessStreamBackend = {
+    .allocate = headlessStreamAllocate,
+    .release = headlessStreamRelease,
+};
+
+static bool
+headlessResizeFramebuffer(HeadlessWindow *window, int width, int height)
+{
+    unsigned int pixelWidth = width > 0 ? (unsigned int)width : 1;
+    unsigned int pixelHeight = height > 0 ? (unsigned int)height : 1;
+
+    size_t size = (size_t)pixelWidth * pixelHeight * 4;
+    size_t capacity = birchHeapCapacity(window->pixelCapacity, size);
+    if (capacity != window->pixelCapacity)
+    {
+        uint8_t *pixels = birchReallocate(window->pixels, capacity);
+        if (!pixels)
+        {
+            return false;
+        }
+        window->pixels = pixels;
+        window->pixelCapacity = capacity;
+    }
+
+    window->pixelWidth = pixelWidth;
+    window->pixelHeight = pixelHeight;
+    // The rows moved, redraw everything
+    birchTileCacheInvalidate(&window->tileCache);
+    birchTileCacheInvalidate(&window->shown);
+    return true;
+}
+
+static void headlessClear(HeadlessWindow *window)
+{
+    // Matches the default MTKView clear color: opaque black
+    size_t count = (size_t)window->pixelWidth * window->pixelHeight;
+    uint8_t *pixel = window->pixels;
+    for (size_t i = 0; i < count; i++, pixel += 4)
+    {
+        pixel[0] = 0;
+        pixel[1] = 0;
+        pixel[2] = 0;
+        pixel[3] = 255;
+    }
+}
+
+static void headlessPush(BirchWindow *window, HeadlessEvent event)
+{
+    HeadlessWindow *headlessWindow = (HeadlessWindow *)window;
+
+    birchMutexLock(&headlessWindow->mutex);
+    if (headlessWindow->pendingCount == headlessWindow->pendingCapacity)
+    {
+        size_t capacity = headlessWindow->pendingCapacity
+                              ? headlessWindow->pendingCapacity * 2
+                              : 64;
+        HeadlessEvent *pending = birchReallocate(
+            headlessWindow->pending,
+            capacity * sizeof(HeadlessEvent)
+        );
+        if (!pending)
+        {
+            birchMutexUnlock(&headlessWindow->mutex);
+            return;
+        }
+        headlessWindow->pending = pending;
+        headlessWindow->pendingCapacity = capacity;
+    }
+
+    headlessWindow->pending[headlessWindow->pendingCount++] = event;
+    birchCondBroadcast(&headlessWindow->eventsPending);
+    birchMutexUnlock(&headlessWindow->mutex);
+}
+
+static void
+headlessPushInput(BirchWindow *window, HeadlessEventType type, int a, int b)
+{
+    headlessPush(
+        window,
+        (HeadlessEvent){
+            .type = type,
+            .a = a,
+            .b = b,
+            .time = birchClockNow(),
+        }
+    );
+}
+
+BirchWindow *
+birchWindowNew(unsigned int width, unsigned int height, const char *title)
+{
+    HeadlessWindow *window = birchAllocate(sizeof(HeadlessWindow));
+    if (!window)
+    {
+        return NULL;
+    }
+
+    if (!birchWindowInitBase(&window->base, width, height, title))
+    {
+        birchFree(window);
+        return NULL;
+    }
+    birchRasterInit();
+    window->pixels = NULL;
+    window->pixelCapacity = 0;
+    memset(&window->tiler, 0, sizeof(BirchTiler));
+    memset(&window->tileCache, 0, sizeof(BirchTileCache));
+    memset(&window->shown, 0, sizeof(BirchTileCache));
+    window->resizePending = false;
+    window->shouldClose = false;
+    window->vsync = false;
+    birchMutexInit(&window->mutex);
+    birchCondInit(&window->eventsPending);
+    window->pending = NULL;
+    window->pendingCount = 0;
+    window->pendingCapacity = 0;
+
+    if (!headlessResizeFramebuffer(window, width, height) ||
+        !birchStreamInit(
+            &window->base.state->stream,
+            &headlessStreamBackend,
+            window,
+            BIRCH_STREAM_DEFAULT_CAPACITY
+        ))
+    {
+        birchWindowFree((BirchWindow *)window);
+        return NULL;
+    }
+    headlessClear(window);
+
+    window->next = headlessWindows;
+    headlessWindows = window;
+    return (BirchWindow *)window;
+}
+
+void birchWindowFree(BirchWindow *window)
+{
+    HeadlessWindow *headlessWindow = (HeadlessWindow *)window;
+
+    HeadlessWindow **link = &headlessWindows;
+    while (*link && *link != headlessWindow)
+    {
+        link = &(*link)->next;
+    }
+    if (*link)
+    {
+        *link = headlessWindow->next;
+    }
+
+    birchWindowFreeBase(window);
+    birchTilerRelease(&headlessWindow->tiler);
+    birchTileCacheRelease(&headlessWindow->tileCache);
+    birchTileCacheRelease(&headlessWindow->shown);
+    birchCondDestroy(&headlessWindow->eventsPending);
+    birchMutexDestroy(&headlessWindow->mutex);
+    birchFree(headlessWindow->pending);
+    birchFree(headlessWindow->pixels);
+    birchFree(headlessWindow);
+}
+
+static void headlessPumpEvents(HeadlessWindow *headlessWindow)
+{
+    BirchWindow *window = &headlessWindow->base;
+
+    // Callbacks may inject more events, those are delivered in this pass
+    birchMutexLock(&headlessWindow->mutex);
+    for (size_t i = 0; i < headlessWindow->pendingCount; i++)
+    {
+        HeadlessEvent event = headlessWindow->pending[i];
+        birchMutexUnlock(&headlessWindow->mutex);
+
+        switch (event.type)
+        {
+        case HEADLESS_EVENT_MOUSE_MOVED:
+            birchWindowDispatchMouseMoved(
+                window,
+                event.x,
+                event.y,
+                event.time
+            );
+            break;
+        case HEADLESS_EVENT_RESIZE:
+            // Only the last size of the update matters
+            if (headlessWindow->resizePending)
+            {
+                window->state->coalescedResizes++;
+            }
+            headlessWindow->resizePending = true;
+            headlessWindow->resize = event;
+            break;
+        case HEADLESS_EVENT_KEY_PRESSED:
+            birchWindowDispatchKeyPressed(window, event.a, event.time);
+            break;
+        case HEADLESS_EVENT_KEY_RELEASED:
+            birchWindowDispatchKeyReleased(window, event.a, event.time);
+            break;
+        case HEADLESS_EVENT_MOUSE_BUTTON_PRESSED:
+            birchWindowDispatchMouseButtonPressed(
+                window,
+                event.a,
+                event.time
+            );
+            break;
+        case HEADLESS_EVENT_MOUSE_BUTTON_RELEASED:
+            birchWindowDispatchMouseButtonReleased(
+                window,
+                event.a,
+                event.time
+            );
+            break;
+        case HEADLESS_EVENT_CLOSE:
+            headlessWindow->shouldClose = true;
+            break;
+        }
+
+        birchMutexLock(&headlessWindow->mutex);
+    }
+    headlessWindow->pendingCount = 0;
+    birchMutexUnlock(&headlessWindow->mutex);
+
+    if (!headlessWindow->resizePending)
+    {
+        return;
+    }
+    headlessWindow->resizePending = false;
+    HeadlessEvent resize = headlessWindow->resize;
+    birchWindowLockRender(window);
+    bool resized =
+        headlessResizeFramebuffer(headlessWindow, resize.a, resize.b);
+    if (resized)
+    {
+        window->width = resize.a;
+        window->height = resize.b;
+    }
+    birchWindowUnlockRender(window);
+    if (resized)
+    {
+        birchWindowDispatchResize(window, resize.a, resize.b, resize.time);
+    }
+}
+
+void birchPlatformPollEvents(void)
+{
+    for (HeadlessWindow *window = headlessWindows; window;
+         window = window->next)
+    {
+        headlessPumpEvents(window);
+    }
+}
+
+void birchPlatformRender(BirchWindow *window)
+{
+    HeadlessWindow *headlessWindow = (HeadlessWindow *)window;
+
+    BIRCH_PROFILE_BEGIN(render, "render");
+    BirchDrawList *list = &window->state->submitted;
+    size_t vertexBytes = list->vertexCount * sizeof(Vertex);
+
+    BirchStream *stream = &window->state->stream;
+    birchStreamBeginFrame(stream, vertexBytes);
+    window->state->damage.count = 0;
+
+    size_t vertexOffset;
+    Vertex *vertices =
+        birchStreamAlloc(stream, vertexBytes, 16, &vertexOffset);
+    if (vertices)
+    {
+        birchWindowFlattenDraws(window, vertices);
+        // The rasterizer samples the atlas pages directly
+        BirchAtlas *atlas = &window->state->atlas;
+        birchMutexLock(&atlas->lock);
+        birchAtlasFlush(atlas, NULL, NULL);
+
+        BirchRasterTarget target = {
+            .pixels = (uint32_t *)headlessWindow->pixels,
+            .width = headlessWindow->pixelWidth,
+            .height = headlessWindow->pixelHeight,
+            .stride = headlessWindow->pixelWidth,
+        };
+        VertexUniforms uniforms = {
+            .pointsWide = window->width,
+            .pointsHigh = window->height,
+        };
+        // Only the tiles that changed are cleared and redrawn
+        bool drawn = birchTilerRender(
+            &headlessWindow->tiler,
+            birchGetThreadPool(),
+            &target,
+            &headlessWindow->tileCache,
+            vertices,
+            list->vertexCount,
+            list->calls,
+            list->callCount,
+            atlas->textures,
+            &uniforms
+        );
+        birchMutexUnlock(&atlas->lock);
+        if (drawn)
+        {
+            birchDamageCollect(
+                &window->state->damage,
+                &headlessWindow->shown,
+                &headlessWindow->tiler,
+                target.width,
+                target.height
+            );
+        }
+    }
+    birchStreamEndFrame(stream);
+    BIRCH_PROFILE_END(render);
+
+    if (headlessWindow->vsync)
+    {
+        BIRCH_PROFILE_BEGIN(present, "present");
+        uint64_t now = birchClockNow();
+        birchClockSleepUntil(
+            (now / HEADLESS_VSYNC_PERIOD + 1) * HEADLESS_VSYNC_PERIOD
+        );
+        BIRCH_PROFILE_END(present);
+    }
+}
+
+bool birchWindowWaitEvents(BirchWindow *window, double timeout)
+{
+    HeadlessWindow *headlessWindow = (HeadlessWindow *)window;
+    if (timeout >= BIRCH_CLOCK_MAX_WAIT)
+    {
+        timeout = -1;
+    }
+    uint64_t deadline =
+        timeout >= 0 ? birchClockNow() + (uint64_t)(timeout * 1e9) : 0;
+
+    birchMutexLock(&headlessWindow->mutex);
+    while (!headlessWindow->pendingCount)
+    {
+        if (timeout < 0)
+        {
+            birchCondWait(
+                &headlessWindow->eventsPending,
+                &headlessWindow->mutex
+            );
+            continue;
+        }
+
+        uint64_t now = birchClockNow();
+        if (now >= deadline)
+        {
+            break;
+        }
+        birchCondWaitFor(
+            &headlessWindow->eventsPending,
+            &headlessWindow->mutex,
+            deadline - now
+        );
+    }
+    bool ready = headlessWindow->pendingCount > 0;
+    birchMutexUnlock(&headlessWindow->mutex);
+    return ready;
+}
+
+void birchWindowSetVsync(BirchWindow *window, bool vsync)
+{
+    HeadlessWindow *headlessWindow = (HeadlessWindow *)window;
+
+    headlessWindow->vsync = vsync;
+}
+
+bool birchWindowShouldClose(BirchWindow *window)
+{
+    HeadlessWindow *headlessWindow = (HeadlessWindow *)window;
+
+    return headlessWindow->shouldClose;
+}
+
+const uint8_t *birchHeadlessGetFramebuffer(
+    BirchWindow *window,
+    unsigned int *width,
+    unsigned int *height,
+    unsigned int *stride
+)
+{
+    HeadlessWindow *headlessWindow = (HeadlessWindow *)window;
+
+    if (width)
+    {
+        *width = headlessWindow->pixelWidth;
+    }
+    if (height)
+    {
+        *height = headlessWindow->pixelHeight;
+    }
+    if (stride)
+    {
+        *stride = headlessWindow->pixelWidth * 4;
+    }
+    return headlessWindow->pixels;
+}
+
+void birchHeadlessInjectMouseMoved(BirchWindow *window, float x, float y)
+{
+    headlessPush(
+        window,
+        (HeadlessEvent){
+            .type = HEADLESS_EVENT_MOUSE_MOVED,
+            .x = x,
+            .y = y,
+            .time = birchClockNow(),
+        }
+    );
+}
+
+void birchHeadlessInjectResize(BirchWindow *window, int width, int height)
+{
+    // Window sizes are unsigned; the framebuffer is at least a pixel anyway
+    headlessPushInput(
+        window,
+        HEADLESS_EVENT_RESIZE,
+        width > 0 ? width : 0,
+        height > 0 ? height : 0
+    );
+}
+
+void birchHeadlessInjectKeyPressed(BirchWindow *window, int key)
+{
+    headlessPushInput(window, HEADLESS_EVENT_KEY_PRESSED, key, 0);
+}
+
+void birchHeadlessInjectKeyReleased(BirchWindow *window, int key)
+{
+    headlessPushInput(window, HEADLESS_EVENT_KEY_RELEASED, key, 0);
+}
+
+void birchHeadlessInjectMouseButtonPressed(BirchWindow *window, int button)
+{
+    headlessPushInput(window, HEADLESS_EVENT_MOUSE_BUTTON_PRESSED, button, 0);
+}
+
+void birchHeadlessInjectMouseButtonReleased(BirchWindow *window, int button)
+{
+    headlessPushInput(window, HEADLESS_EVENT_MOUSE_BUTTON_RELEASED, button, 0);
+}
+
+void birchHeadlessInjectClose(BirchWindow *window)
+{
+    headlessPushInput(window, HEADLESS_EVENT_CLOSE, 0, 0);
+}
@@ -15,7 +15,7 @@
 // You should have received a copy of the GNU General Public License
 // along with birch.  If not, see <http://www.gnu.org/licenses/>.
 
-#include "init.h"
+#include "initInternal.h"
 #include <Cocoa/Cocoa.h>
 
 @interface AppMenu : NSMenu
@@ -43,7 +43,7 @@
 }
 @end
 
-void birchInit(const char *name)
+void birchPlatformInit(const char *name)
 {
     [NSApplication sharedApplication];
     [NSApp setActivationPolicy:NSApplicationActivationPolicyRegular];
@@ -55,7 +55,7 @@ void birchInit(const char *name)
     [NSApp finishLaunching];
 }
 
-void birchTerminate()
+void birchPlatformTerminate(void)
 {
     [NSApp terminate:nil];
     [NSApp release];
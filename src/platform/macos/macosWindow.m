@@ -15,19 +15,28 @@
 // You should have received a copy of the GNU General Public License
 // along with birch.  If not, see <http://www.gnu.org/licenses/>.
 
+#include "atlas.h"
+#include "clock.h"
+#include "drawList.h"
+#include "heap.h"
+#include "initInternal.h"
+#include "profile.h"
 #include "shaderTypes.h"
 #include "shaders_metallib.h"
+#include "stream.h"
+#include "thread.h"
 #include "window.h"
+#include "windowInternal.h"
 #include <Cocoa/Cocoa.h>
 #include <MetalKit/MetalKit.h>
 #include <dispatch/dispatch.h>
 #include <simd/simd.h>
-#include <stdio.h>
-#include <stdlib.h>
 #include <string.h>
 
 typedef struct MacosWindow MacosWindow;
 
+@class MacosRenderer;
+
 @interface MacosWindowDelegate : NSObject<NSWindowDelegate>
 {
     MacosWindow *window;
@@ -44,8 +53,46 @@ struct MacosWindow
     NSRect rect;
     bool shouldClose;
     MacosWindowDelegate *delegate;
+    MacosRenderer *renderer;
+    CAMetalLayer *layer;
+    // What a render thread needs to know of AppKit, which it must not call.
+    // Written on the main thread with the render lock held.
+    CGSize drawableSize;
+    bool vsync;
+    uint64_t refreshPeriod;
+    // birch points (1/72 in) per AppKit unit on the main screen, measured
+    // when the window is created and when it moves to another screen
+    CGSize pointsPerUnit;
 };
 
+// The physical size of a display is a query to the window server, too slow
+// to repeat on every step of a live resize
+static CGSize macosPointsPerUnit(void)
+{
+    NSScreen *screen = NSScreen.mainScreen;
+    CGDirectDisplayID displayID =
+        ((NSNumber *)screen.deviceDescription[@"NSScreenNumber"])
+            .unsignedIntegerValue;
+
+    // millimeters to points
+    CGSize screenSize = CGDisplayScreenSize(displayID);
+    return CGSizeMake(
+        screenSize.width * 2.8346456693 / NSWidth(screen.frame),
+        screenSize.height * 2.8346456693 / NSHeight(screen.frame)
+    );
+}
+
+static uint64_t macosRefreshPeriod(NSScreen *screen)
+{
+    uint64_t period = 1000000000 / 60;
+    if (@available(macOS 12.0, *))
+    {
+        NSInteger rate = screen.maximumFramesPerSecond;
+        period = rate > 0 ? 1000000000 / rate : period;
+    }
+    return period;
+}
+
 @implementation MacosWindowDelegate
 - (instancetype)initWithWindow:(MacosWindow *)initWindow
 {
@@ -65,31 +112,140 @@ struct MacosWindow
 
 - (NSSize)windowWillResize:(NSWindow *)sender toSize:(NSSize)frameSize
 {
-    CGDirectDisplayID displayID =
-        ((NSNumber *)NSScreen.mainScreen.deviceDescription[@"NSScreenNumber"])
-            .unsignedIntegerValue;
+    birchWindowLockRender(&window->base);
+    window->base.width = frameSize.width * window->pointsPerUnit.width;
+    window->base.height = frameSize.height * window->pointsPerUnit.height;
+    birchWindowUnlockRender(&window->base);
+
+    // Delivered once per birchWindowUpdate with the last size
+    birchWindowDispatchResize(
+        &window->base,
+        window->base.width,
+        window->base.height,
+        birchClockNow()
+    );
+    return frameSize;
+}
 
-    CGSize screenSize = CGDisplayScreenSize(displayID);
+- (void)windowDidChangeScreen:(NSNotification *)notification
+{
+    window->pointsPerUnit = macosPointsPerUnit();
+    uint64_t period = macosRefreshPeriod(window->window.screen);
+    birchWindowLockRender(&window->base);
+    window->refreshPeriod = period;
+    birchWindowUnlockRender(&window->base);
+}
+@end
 
-    window->base.width =
-        ((frameSize.width / NSWidth(NSScreen.mainScreen.frame)) *
-         screenSize.width) *
-        2.8346456693;
-    window->base.height =
-        ((frameSize.height / NSHeight(NSScreen.mainScreen.frame)) *
-         screenSize.height) *
-        2.8346456693;
+// Shared by every window and created with the first one: the device, its
+// pipelines and the command queue
+static struct
+{
+    id<MTLDevice> device;
+    id<MTLRenderPipelineState> pipelineState;
+    // alpha blended, for images
+    id<MTLRenderPipelineState> texturedPipelineState;
+    // alpha blended with coverage from a distance field, for text
+    id<MTLRenderPipelineState> distanceFieldPipelineState;
+    // The command queue used to pass commands to the device.
+    id<MTLCommandQueue> commandQueue;
+    unsigned int windows;
+} macosDevice;
 
-    printf("width: %f\n", window->base.width);
-    printf("height: %f\n", window->base.height);
+static void macosCreateDevice(MTLPixelFormat pixelFormat)
+{
+    NSError *error;
+
+    id<MTLDevice> device = MTLCreateSystemDefaultDevice();
+    macosDevice.device = device;
+
+    // The default destructor copies the buffer; the embedded library
+    // lives as long as the process, so wrap it in place
+    dispatch_data_t data = dispatch_data_create(
+        shaders_metallib_data,
+        shaders_metallib_size,
+        NULL,
+        ^{
+        }
+    );
 
-    if (window->base.resizeCallback)
-    {
-        window->base.resizeCallback(window->base.width, window->base.height);
-    }
-    return frameSize;
+    id<MTLLibrary> library = [device newLibraryWithData:data error:&error];
+
+    NSAssert(library, @"Failed to create library: %@", error);
+
+    id<MTLFunction> vertexFunction =
+        [library newFunctionWithName:@"vertexShader"];
+    id<MTLFunction> fragmentFunction =
+        [library newFunctionWithName:@"fragmentShader"];
+
+    MTLRenderPipelineDescriptor *pipelineDescriptor =
+        [[MTLRenderPipelineDescriptor alloc] init];
+    pipelineDescriptor.label = @"Simple Pipeline";
+    pipelineDescriptor.vertexFunction = vertexFunction;
+    pipelineDescriptor.fragmentFunction = fragmentFunction;
+    pipelineDescriptor.colorAttachments[0].pixelFormat = pixelFormat;
+
+    macosDevice.pipelineState =
+        [device newRenderPipelineStateWithDescriptor:pipelineDescriptor
+                                               error:&error];
+
+    NSAssert(
+        macosDevice.pipelineState,
+        @"Failed to create pipeline state: %@",
+        error
+    );
+
+    pipelineDescriptor.label = @"Textured Pipeline";
+    pipelineDescriptor.fragmentFunction =
+        [library newFunctionWithName:@"texturedFragmentShader"];
+    MTLRenderPipelineColorAttachmentDescriptor *colorAttachment =
+        pipelineDescriptor.colorAttachments[0];
+    colorAttachment.blendingEnabled = YES;
+    colorAttachment.sourceRGBBlendFactor = MTLBlendFactorSourceAlpha;
+    colorAttachment.sourceAlphaBlendFactor = MTLBlendFactorSourceAlpha;
+    colorAttachment.destinationRGBBlendFactor =
+        MTLBlendFactorOneMinusSourceAlpha;
+    colorAttachment.destinationAlphaBlendFactor =
+        MTLBlendFactorOneMinusSourceAlpha;
+
+    macosDevice.texturedPipelineState =
+        [device newRenderPipelineStateWithDescriptor:pipelineDescriptor
+                                               error:&error];
+
+    NSAssert(
+        macosDevice.texturedPipelineState,
+        @"Failed to create pipeline state: %@",
+        error
+    );
+
+    pipelineDescriptor.label = @"Distance Field Pipeline";
+    pipelineDescriptor.fragmentFunction =
+        [library newFunctionWithName:@"distanceFieldFragmentShader"];
+    macosDevice.distanceFieldPipelineState =
+        [device newRenderPipelineStateWithDescriptor:pipelineDescriptor
+                                               error:&error];
+
+    NSAssert(
+        macosDevice.distanceFieldPipelineState,
+        @"Failed to create pipeline state: %@",
+        error
+    );
+
+    [pipelineDescriptor release];
+    [library release];
+
+    macosDevice.commandQueue = [device newCommandQueue];
+}
+
+static void macosReleaseDevice(void)
+{
+    [macosDevice.commandQueue release];
+    [macosDevice.distanceFieldPipelineState release];
+    [macosDevice.texturedPipelineState release];
+    [macosDevice.pipelineState release];
+    [macosDevice.device release];
+    macosDevice.device = nil;
 }
-@end
 
 @interface MacosRenderer : NSObject<MTKViewDelegate>
 {
@@ -97,87 +253,190 @@ struct MacosWindow
 
 - (nonnull instancetype)initWithMetalKitView:(nonnull MTKView *)mtkView
                                       window:(MacosWindow *)initWindow;
+- (void *)streamAllocate:(size_t)size;
+- (void)streamRelease;
+- (void)streamFence:(unsigned int)frame;
+- (bool)streamWait:(unsigned int)frame timeout:(dispatch_time_t)timeout;
+- (void)uploadAtlasPage:(unsigned int)page
+                texture:(const BirchRasterTexture *)texture
+                   rect:(const BirchRasterRect *)rect;
+- (void)encodeFrame:(MTLRenderPassDescriptor *)renderPassDescriptor
+           drawable:(id<MTLDrawable>)drawable
+               size:(CGSize)size;
 @end
 
 @implementation MacosRenderer
 {
-    id<MTLDevice> device;
+    // one per atlas page, created when the page is first uploaded
+    id<MTLTexture> atlasTextures[BIRCH_ATLAS_MAX_PAGES];
 
-    id<MTLRenderPipelineState> pipelineState;
+    MacosWindow *window;
 
-    // The command queue used to pass commands to the device.
-    id<MTLCommandQueue> commandQueue;
+    // Shared storage behind the window's BirchStream, written by the CPU
+    // while the GPU reads the previous frames from the same buffer.
+    id<MTLBuffer> streamBuffer;
+    dispatch_semaphore_t frameSemaphores[BIRCH_STREAM_FRAMES];
+    id<MTLCommandBuffer> frameCommandBuffer;
+}
 
-    MacosWindow *window;
+static void *macosStreamAllocate(void *context, size_t size)
+{
+    return [(MacosRenderer *)context streamAllocate:size];
 }
 
-- (nonnull instancetype)initWithMetalKitView:(nonnull MTKView *)mtkView
-                                      window:(MacosWindow *)initWindow
+static void macosStreamRelease(void *context, void *data)
 {
-    self = [super init];
-    if (self)
-    {
-        window = initWindow;
+    [(MacosRenderer *)context streamRelease];
+}
 
-        NSError *error;
+static void macosStreamFence(void *context, unsigned int frame)
+{
+    [(MacosRenderer *)context streamFence:frame];
+}
 
-        device = mtkView.device;
+static bool macosStreamPoll(void *context, unsigned int frame)
+{
+    return [(MacosRenderer *)context streamWait:frame
+                                        timeout:DISPATCH_TIME_NOW];
+}
 
-        dispatch_data_t data = dispatch_data_create(
-            shaders_metallib_data,
-            shaders_metallib_size,
-            NULL,
-            DISPATCH_DATA_DESTRUCTOR_DEFAULT
-        );
+static void macosStreamWait(void *context, unsigned int frame)
+{
+    [(MacosRenderer *)context streamWait:frame timeout:DISPATCH_TIME_FOREVER];
+}
 
-        id<MTLLibrary> library = [device newLibraryWithData:data error:&error];
+static void macosUploadAtlas(
+    void *context,
+    unsigned int page,
+    const BirchRasterTexture *texture,
+    const BirchRasterRect *rect
+)
+{
+    [(MacosRenderer *)context uploadAtlasPage:page texture:texture rect:rect];
+}
 
-        NSAssert(library, @"Failed to create library: %@", error);
+static const BirchStreamBackend macosStreamBackend = {
+    .allocate = macosStreamAllocate,
+    .release = macosStreamRelease,
+    .fence = macosStreamFence,
+    .poll = macosStreamPoll,
+    .wait = macosStreamWait,
+};
 
-        id<MTLFunction> vertexFunction =
-            [library newFunctionWithName:@"vertexShader"];
-        id<MTLFunction> fragmentFunction =
-            [library newFunctionWithName:@"fragmentShader"];
+- (void *)streamAllocate:(size_t)size
+{
+    streamBuffer = [macosDevice.device
+        newBufferWithLength:size
+                    options:MTLResourceStorageModeShared];
+    return streamBuffer.contents;
+}
 
-        MTLRenderPipelineDescriptor *pipelineDescriptor =
-            [[MTLRenderPipelineDescriptor alloc] init];
-        pipelineDescriptor.label = @"Simple Pipeline";
-        pipelineDescriptor.vertexFunction = vertexFunction;
-        pipelineDescriptor.fragmentFunction = fragmentFunction;
-        pipelineDescriptor.colorAttachments[0].pixelFormat =
-            mtkView.colorPixelFormat;
+- (void)streamRelease
+{
+    [streamBuffer release];
+    streamBuffer = nil;
+}
 
-        pipelineState =
-            [device newRenderPipelineStateWithDescriptor:pipelineDescriptor
-                                                   error:&error];
+- (void)streamFence:(unsigned int)frame
+{
+    dispatch_semaphore_t semaphore = frameSemaphores[frame];
+    [frameCommandBuffer addCompletedHandler:^(id<MTLCommandBuffer> buffer) {
+        dispatch_semaphore_signal(semaphore);
+    }];
+}
 
-        NSAssert(pipelineState, @"Failed to create pipeline state: %@", error);
+- (bool)streamWait:(unsigned int)frame timeout:(dispatch_time_t)timeout
+{
+    return dispatch_semaphore_wait(frameSemaphores[frame], timeout) == 0;
+}
 
-        // Create the command queue
-        commandQueue = [device newCommandQueue];
+- (void)uploadAtlasPage:(unsigned int)page
+                texture:(const BirchRasterTexture *)texture
+                   rect:(const BirchRasterRect *)rect
+{
+    if (!atlasTextures[page])
+    {
+        MTLTextureDescriptor *descriptor = [MTLTextureDescriptor
+            texture2DDescriptorWithPixelFormat:MTLPixelFormatRGBA8Unorm
+                                         width:texture->width
+                                        height:texture->height
+                                     mipmapped:NO];
+        atlasTextures[page] =
+            [macosDevice.device newTextureWithDescriptor:descriptor];
+    }
 
-        CGDirectDisplayID displayID =
-            ((NSNumber *)
-                 NSScreen.mainScreen.deviceDescription[@"NSScreenNumber"])
-                .unsignedIntegerValue;
+    // Rows of the rectangle are strided like the page
+    [atlasTextures[page]
+        replaceRegion:MTLRegionMake2D(
+                          rect->minX,
+                          rect->minY,
+                          rect->maxX - rect->minX,
+                          rect->maxY - rect->minY
+                      )
+          mipmapLevel:0
+            withBytes:texture->pixels + (size_t)rect->minY * texture->width +
+                      rect->minX
+          bytesPerRow:texture->width * sizeof(uint32_t)];
+}
+
+- (nonnull instancetype)initWithMetalKitView:(nonnull MTKView *)mtkView
+                                      window:(MacosWindow *)initWindow
+{
+    self = [super init];
+    if (self)
+    {
+        window = initWindow;
 
-        CGSize screenSize = CGDisplayScreenSize(displayID);
+        for (unsigned int i = 0; i < BIRCH_STREAM_FRAMES; i++)
+        {
+            frameSemaphores[i] = dispatch_semaphore_create(0);
+        }
+        birchStreamInit(
+            &window->base.state->stream,
+            &macosStreamBackend,
+            self,
+            BIRCH_STREAM_DEFAULT_CAPACITY
+        );
     }
 
     return self;
 }
 
+// The stream was released with the window, before the renderer
+- (void)dealloc
+{
+    for (unsigned int i = 0; i < BIRCH_ATLAS_MAX_PAGES; i++)
+    {
+        [atlasTextures[i] release];
+    }
+    for (unsigned int i = 0; i < BIRCH_STREAM_FRAMES; i++)
+    {
+        dispatch_release(frameSemaphores[i]);
+    }
+    [super dealloc];
+}
+
+// The view is paused, frames are only drawn by birchPlatformRender
 - (void)drawInMTKView:(MTKView *)view
 {
-    static const Vertex verticies[] = {
-        {{0, 0},   {1.0, 0.0, 0.0, 1.0}},
-        {{72, 0},  {0.0, 1.0, 0.0, 1.0}},
-        {{36, 72}, {0.0, 0.0, 1.0, 1.0}},
-    };
+}
+
+// Draw the submitted frame into `drawable` and commit it, on any thread.
+// Call with the atlas lock held.
+- (void)encodeFrame:(MTLRenderPassDescriptor *)renderPassDescriptor
+           drawable:(id<MTLDrawable>)drawable
+               size:(CGSize)size
+{
+    BIRCH_PROFILE_BEGIN(encode, "encode");
+    BirchDrawList *list = &window->base.state->submitted;
+    size_t vertexBytes = list->vertexCount * sizeof(Vertex);
 
-    id<MTLCommandBuffer> commandBuffer = [commandQueue commandBuffer];
-    MTLRenderPassDescriptor *renderPassDescriptor =
-        view.currentRenderPassDescriptor;
+    BirchStream *stream = &window->base.state->stream;
+    birchStreamBeginFrame(stream, vertexBytes + 256 + sizeof(VertexUniforms));
+    birchAtlasFlush(&window->base.state->atlas, macosUploadAtlas, self);
+
+    id<MTLCommandBuffer> commandBuffer =
+        [macosDevice.commandQueue commandBuffer];
 
     if (renderPassDescriptor != nil)
     {
@@ -187,54 +446,235 @@ struct MacosWindow
         [renderEncoder setViewport:(MTLViewport
                                    ){0.0,
                                      0.0,
-                                     view.drawableSize.width,
-                                     view.drawableSize.height,
+                                     size.width,
+                                     size.height,
                                      -1.0,
                                      1.0}];
-        [renderEncoder setRenderPipelineState:pipelineState];
-
-        id<MTLBuffer> vertexBuffer;
-        vertexBuffer = [device newBufferWithBytes:verticies
-                                           length:sizeof(verticies)
-                                          options:MTLResourceStorageModeShared];
-
-        [renderEncoder setVertexBuffer:vertexBuffer offset:0 atIndex:0];
-
-        VertexUniforms uniforms = {
-            .pointsWide = window->base.width,
-            .pointsHigh = window->base.height,
-        };
-        id<MTLBuffer> uniformBuffer =
-            [device newBufferWithBytes:&uniforms
-                                length:sizeof(uniforms)
-                               options:MTLResourceStorageModeShared];
 
-        [renderEncoder setVertexBuffer:uniformBuffer offset:0 atIndex:1];
+        // Vertex contains a 16 byte aligned vector_float4
+        size_t vertexOffset;
+        Vertex *vertexData =
+            birchStreamAlloc(stream, vertexBytes, 16, &vertexOffset);
+
+        // Constant buffer offsets have to be 256 byte aligned on macOS
+        size_t uniformOffset;
+        VertexUniforms *uniforms = birchStreamAlloc(
+            stream,
+            sizeof(VertexUniforms),
+            256,
+            &uniformOffset
+        );
 
-        [renderEncoder drawPrimitives:MTLPrimitiveTypeTriangle
-                          vertexStart:0
-                          vertexCount:3];
+        if (vertexData && uniforms)
+        {
+            size_t callCount =
+                birchWindowFlattenDraws(&window->base, vertexData);
+            uniforms->pointsWide = window->base.width;
+            uniforms->pointsHigh = window->base.height;
+
+            [renderEncoder setVertexBuffer:streamBuffer
+                                    offset:vertexOffset
+                                   atIndex:0];
+            [renderEncoder setVertexBuffer:streamBuffer
+                                    offset:uniformOffset
+                                   atIndex:1];
+
+            [renderEncoder
+                setRenderPipelineState:macosDevice.pipelineState];
+            BirchPipeline pipeline = BIRCH_PIPELINE_SOLID;
+            for (size_t i = 0; i < callCount; i++)
+            {
+                BirchDrawBatch call = list->calls[i];
+                if (BIRCH_DRAW_KEY_PIPELINE(call.key) != pipeline)
+                {
+                    pipeline = BIRCH_DRAW_KEY_PIPELINE(call.key);
+                    id<MTLRenderPipelineState> state =
+                        macosDevice.pipelineState;
+                    if (pipeline == BIRCH_PIPELINE_TEXTURED)
+                    {
+                        state = macosDevice.texturedPipelineState;
+                    }
+                    else if (pipeline == BIRCH_PIPELINE_DISTANCE_FIELD)
+                    {
+                        state = macosDevice.distanceFieldPipelineState;
+                    }
+                    [renderEncoder setRenderPipelineState:state];
+                }
+                if (pipeline != BIRCH_PIPELINE_SOLID)
+                {
+                    uint32_t page = BIRCH_DRAW_KEY_TEXTURE(call.key) - 1;
+                    [renderEncoder setFragmentTexture:atlasTextures[page]
+                                              atIndex:0];
+                }
+                [renderEncoder drawPrimitives:MTLPrimitiveTypeTriangle
+                                  vertexStart:call.first
+                                  vertexCount:call.count];
+            }
+        }
 
         [renderEncoder endEncoding];
 
-        [commandBuffer presentDrawable:view.currentDrawable];
+        [commandBuffer presentDrawable:drawable];
 
         // Release stuff
         [commandBuffer addCompletedHandler:^(id<MTLCommandBuffer> buffer) {
-            [vertexBuffer release];
             [renderEncoder release];
         }];
     }
 
+    frameCommandBuffer = commandBuffer;
+    birchStreamEndFrame(stream);
+    frameCommandBuffer = nil;
+    BIRCH_PROFILE_END(encode);
+
+    BIRCH_PROFILE_BEGIN(commit, "commit");
     [commandBuffer commit];
     [commandBuffer release];
+    BIRCH_PROFILE_END(commit);
 }
 
 - (void)mtkView:(MTKView *)view drawableSizeWillChange:(CGSize)size
 {
+    birchWindowLockRender(&window->base);
+    window->drawableSize = size;
+    birchWindowUnlockRender(&window->base);
 }
 @end
 
+// Virtual key codes of NSEvent name keys by their position on an ANSI
+// keyboard whatever the layout. Densified by macosLoadKeymap, 0 marks
+// unknown key codes.
+static const int16_t macosVirtualKeys[128] = {
+    [0x00] = BIRCH_KEY_A,
+    [0x01] = BIRCH_KEY_S,
+    [0x02] = BIRCH_KEY_D,
+    [0x03] = BIRCH_KEY_F,
+    [0x04] = BIRCH_KEY_H,
+    [0x05] = BIRCH_KEY_G,
+    [0x06] = BIRCH_KEY_Z,
+    [0x07] = BIRCH_KEY_X,
+    [0x08] = BIRCH_KEY_C,
+    [0x09] = BIRCH_KEY_V,
+    [0x0b] = BIRCH_KEY_B,
+    [0x0c] = BIRCH_KEY_Q,
+    [0x0d] = BIRCH_KEY_W,
+    [0x0e] = BIRCH_KEY_E,
+    [0x0f] = BIRCH_KEY_R,
+    [0x10] = BIRCH_KEY_Y,
+    [0x11] = BIRCH_KEY_T,
+    [0x12] = BIRCH_KEY_1,
+    [0x13] = BIRCH_KEY_2,
+    [0x14] = BIRCH_KEY_3,
+    [0x15] = BIRCH_KEY_4,
+    [0x16] = BIRCH_KEY_6,
+    [0x17] = BIRCH_KEY_5,
+    [0x18] = BIRCH_KEY_EQUAL,
+    [0x19] = BIRCH_KEY_9,
+    [0x1a] = BIRCH_KEY_7,
+    [0x1b] = BIRCH_KEY_MINUS,
+    [0x1c] = BIRCH_KEY_8,
+    [0x1d] = BIRCH_KEY_0,
+    [0x1e] = BIRCH_KEY_RIGHT_BRACKET,
+    [0x1f] = BIRCH_KEY_O,
+    [0x20] = BIRCH_KEY_U,
+    [0x21] = BIRCH_KEY_LEFT_BRACKET,
+    [0x22] = BIRCH_KEY_I,
+    [0x23] = BIRCH_KEY_P,
+    [0x24] = BIRCH_KEY_ENTER,
+    [0x25] = BIRCH_KEY_L,
+    [0x26] = BIRCH_KEY_J,
+    [0x27] = BIRCH_KEY_APOSTROPHE,
+    [0x28] = BIRCH_KEY_K,
+    [0x29] = BIRCH_KEY_SEMICOLON,
+    [0x2a] = BIRCH_KEY_BACKSLASH,
+    [0x2b] = BIRCH_KEY_COMMA,
+    [0x2c] = BIRCH_KEY_SLASH,
+    [0x2d] = BIRCH_KEY_N,
+    [0x2e] = BIRCH_KEY_M,
+    [0x2f] = BIRCH_KEY_PERIOD,
+    [0x30] = BIRCH_KEY_TAB,
+    [0x31] = BIRCH_KEY_SPACE,
+    [0x32] = BIRCH_KEY_GRAVE_ACCENT,
+    [0x33] = BIRCH_KEY_BACKSPACE,
+    [0x35] = BIRCH_KEY_ESCAPE,
+    [0x36] = BIRCH_KEY_RIGHT_SUPER,
+    [0x37] = BIRCH_KEY_LEFT_SUPER,
+    [0x38] = BIRCH_KEY_LEFT_SHIFT,
+    [0x39] = BIRCH_KEY_CAPS_LOCK,
+    [0x3a] = BIRCH_KEY_LEFT_ALT,
+    [0x3b] = BIRCH_KEY_LEFT_CONTROL,
+    [0x3c] = BIRCH_KEY_RIGHT_SHIFT,
+    [0x3d] = BIRCH_KEY_RIGHT_ALT,
+    [0x3e] = BIRCH_KEY_RIGHT_CONTROL,
+    [0x40] = BIRCH_KEY_F17,
+    [0x41] = BIRCH_KEY_KP_DECIMAL,
+    [0x43] = BIRCH_KEY_KP_MULTIPLY,
+    [0x45] = BIRCH_KEY_KP_ADD,
+    [0x47] = BIRCH_KEY_NUM_LOCK,
+    [0x4b] = BIRCH_KEY_KP_DIVIDE,
+    [0x4c] = BIRCH_KEY_KP_ENTER,
+    [0x4e] = BIRCH_KEY_KP_SUBTRACT,
+    [0x4f] = BIRCH_KEY_F18,
+    [0x50] = BIRCH_KEY_F19,
+    [0x51] = BIRCH_KEY_KP_EQUAL,
+    [0x52] = BIRCH_KEY_KP_0,
+    [0x53] = BIRCH_KEY_KP_1,
+    [0x54] = BIRCH_KEY_KP_2,
+    [0x55] = BIRCH_KEY_KP_3,
+    [0x56] = BIRCH_KEY_KP_4,
+    [0x57] = BIRCH_KEY_KP_5,
+    [0x58] = BIRCH_KEY_KP_6,
+    [0x59] = BIRCH_KEY_KP_7,
+    [0x5a] = BIRCH_KEY_F20,
+    [0x5b] = BIRCH_KEY_KP_8,
+    [0x5c] = BIRCH_KEY_KP_9,
+    [0x60] = BIRCH_KEY_F5,
+    [0x61] = BIRCH_KEY_F6,
+    [0x62] = BIRCH_KEY_F7,
+    [0x63] = BIRCH_KEY_F3,
+    [0x64] = BIRCH_KEY_F8,
+    [0x65] = BIRCH_KEY_F9,
+    [0x67] = BIRCH_KEY_F11,
+    [0x69] = BIRCH_KEY_F13,
+    [0x6a] = BIRCH_KEY_F16,
+    [0x6b] = BIRCH_KEY_F14,
+    [0x6d] = BIRCH_KEY_F10,
+    [0x6e] = BIRCH_KEY_MENU,
+    [0x6f] = BIRCH_KEY_F12,
+    [0x71] = BIRCH_KEY_F15,
+    [0x72] = BIRCH_KEY_INSERT,
+    [0x73] = BIRCH_KEY_HOME,
+    [0x74] = BIRCH_KEY_PAGE_UP,
+    [0x75] = BIRCH_KEY_DELETE,
+    [0x76] = BIRCH_KEY_F4,
+    [0x77] = BIRCH_KEY_END,
+    [0x78] = BIRCH_KEY_F2,
+    [0x79] = BIRCH_KEY_PAGE_DOWN,
+    [0x7a] = BIRCH_KEY_F1,
+    [0x7b] = BIRCH_KEY_LEFT,
+    [0x7c] = BIRCH_KEY_RIGHT,
+    [0x7d] = BIRCH_KEY_DOWN,
+    [0x7e] = BIRCH_KEY_UP,
+};
+
+// macosVirtualKeys with BIRCH_KEY_UNKNOWN for unknown key codes, so
+// translating a key is a single load
+static int16_t macosKeycodes[128];
+
+static void macosLoadKeymap(void)
+{
+    for (int i = 0; i < 128; i++)
+    {
+        macosKeycodes[i] =
+            macosVirtualKeys[i] ? macosVirtualKeys[i] : BIRCH_KEY_UNKNOWN;
+    }
+}
+
+static int macosTranslateKey(NSEvent *event)
+{
+    return macosKeycodes[event.keyCode & 0x7f];
+}
+
 @interface MacosView : MTKView
 {
     MacosWindow *window;
@@ -247,16 +687,19 @@ struct MacosWindow
 @implementation MacosView
 - (instancetype)initWithFrame:(NSRect)frameRect window:(MacosWindow *)initWindow
 {
-    self = [super initWithFrame:frameRect
-                         device:MTLCreateSystemDefaultDevice()];
+    self = [super initWithFrame:frameRect device:macosDevice.device];
     if (self != nil)
     {
         window = initWindow;
-        self.enableSetNeedsDisplay = YES;
-        self.device = MTLCreateSystemDefaultDevice();
+        // Never draw from AppKit: a render thread may be encoding a frame,
+        // and both would take drawables from the layer
+        self.paused = YES;
+        self.enableSetNeedsDisplay = NO;
 
-        self.delegate = [[MacosRenderer alloc] initWithMetalKitView:self
-                                                             window:window];
+        window->renderer =
+            [[MacosRenderer alloc] initWithMetalKitView:self window:window];
+        window->layer = (CAMetalLayer *)self.layer;
+        self.delegate = window->renderer;
 
         [self.delegate mtkView:self drawableSizeWillChange:self.drawableSize];
     }
@@ -265,57 +708,126 @@ struct MacosWindow
 
 - (void)mouseMoved:(NSEvent *)event
 {
-    if (window->base.mouseMovedCallback)
-    {
-        window->base.mouseMovedCallback(
-            event.locationInWindow.x,
-            event.locationInWindow.y
-        );
-    }
+    // NSEvent timestamps are seconds of the uptime clock birchClockNow uses
+    birchWindowDispatchMouseMoved(
+        &window->base,
+        event.locationInWindow.x,
+        event.locationInWindow.y,
+        (uint64_t)(event.timestamp * 1e9)
+    );
+}
+
+- (void)mouseDown:(NSEvent *)event
+{
+    birchWindowDispatchMouseButtonPressed(
+        &window->base,
+        (int)event.buttonNumber,
+        (uint64_t)(event.timestamp * 1e9)
+    );
+}
+
+- (void)mouseUp:(NSEvent *)event
+{
+    birchWindowDispatchMouseButtonReleased(
+        &window->base,
+        (int)event.buttonNumber,
+        (uint64_t)(event.timestamp * 1e9)
+    );
+}
+
+- (void)rightMouseDown:(NSEvent *)event
+{
+    [self mouseDown:event];
+}
+
+- (void)rightMouseUp:(NSEvent *)event
+{
+    [self mouseUp:event];
+}
+
+- (void)otherMouseDown:(NSEvent *)event
+{
+    [self mouseDown:event];
+}
+
+- (void)otherMouseUp:(NSEvent *)event
+{
+    [self mouseUp:event];
+}
+
+- (BOOL)acceptsFirstResponder
+{
+    return YES;
 }
 
 - (void)keyDown:(NSEvent *)event
 {
+    birchWindowDispatchKeyPressed(
+        &window->base,
+        macosTranslateKey(event),
+        (uint64_t)(event.timestamp * 1e9)
+    );
 }
 
 - (void)keyUp:(NSEvent *)event
 {
+    birchWindowDispatchKeyReleased(
+        &window->base,
+        macosTranslateKey(event),
+        (uint64_t)(event.timestamp * 1e9)
+    );
+}
+
+// Modifiers only report that the flags changed, the key went down unless
+// it already was
+- (void)flagsChanged:(NSEvent *)event
+{
+    int key = macosTranslateKey(event);
+    if (key == BIRCH_KEY_UNKNOWN)
+    {
+        return;
+    }
+    if (birchWindowIsKeyDown(&window->base, key))
+    {
+        [self keyUp:event];
+    }
+    else
+    {
+        [self keyDown:event];
+    }
 }
 @end
 
 BirchWindow *
 birchWindowNew(unsigned int width, unsigned int height, const char *title)
 {
-    MacosWindow *window = malloc(sizeof(MacosWindow));
+    MacosWindow *window = birchAllocate(sizeof(MacosWindow));
     if (!window)
     {
         return NULL;
     }
 
-    CGDirectDisplayID displayID =
-        ((NSNumber *)NSScreen.mainScreen.deviceDescription[@"NSScreenNumber"])
-            .unsignedIntegerValue;
-
-    CGSize screenSize = CGDisplayScreenSize(displayID);
-
-    window->base.width = width;
-    window->base.height = height;
-    window->base.title = title;
-    window->base.mouseMovedCallback = NULL;
-    window->base.resizeCallback = NULL;
-    window->base.keyPressedCallback = NULL;
-    window->base.keyReleasedCallback = NULL;
-    window->base.mouseButtonPressedCallback = NULL;
-    window->base.mouseButtonReleasedCallback = NULL;
+    if (!birchWindowInitBase(&window->base, width, height, title))
+    {
+        birchFree(window);
+        return NULL;
+    }
     window->shouldClose = false;
+    window->vsync = true;
+    window->pointsPerUnit = macosPointsPerUnit();
+
+    // MTKView draws to BGRA8 unless told otherwise
+    if (macosDevice.windows++ == 0)
+    {
+        macosCreateDevice(MTLPixelFormatBGRA8Unorm);
+        macosLoadKeymap();
+    }
 
     window->rect = NSMakeRect(
         0,
         0,
-        (width / (screenSize.width * 2.8346456693)) *
-            NSWidth(NSScreen.mainScreen.frame),
-        height / (screenSize.height * 2.8346456693) *
-            NSHeight(NSScreen.mainScreen.frame)
+        width / window->pointsPerUnit.width,
+        height / window->pointsPerUnit.height
     );
     window->window = [[NSWindow alloc]
         initWithContentRect:window->rect
@@ -334,6 +846,7 @@ birchWindowNew(unsigned int width, unsigned int height, const char *title)
     [window->window setAcceptsMouseMovedEvents:YES];
     [window->window makeFirstResponder:window->view];
     [window->window makeKeyAndOrderFront:nil];
+    window->refreshPeriod = macosRefreshPeriod(window->window.screen);
 
     return (BirchWindow *)window;
 }
@@ -341,17 +854,83 @@ birchWindowNew(unsigned int width, unsigned int height, const char *title)
 void birchWindowFree(BirchWindow *window)
 {
     MacosWindow *macosWindow = (MacosWindow *)window;
+    birchWindowFreeBase(window);
     [macosWindow->window release];
     [macosWindow->view release];
     [macosWindow->delegate release];
-    free(macosWindow);
+    [macosWindow->renderer release];
+    birchFree(macosWindow);
     macosWindow = NULL;
+
+    if (--macosDevice.windows == 0)
+    {
+        macosReleaseDevice();
+    }
 }
 
-void birchWindowUpdate(BirchWindow *window)
+void birchPlatformRender(BirchWindow *window)
 {
     MacosWindow *macosWindow = (MacosWindow *)window;
     @autoreleasepool
+    {
+        // Drawables are not retained between frames, so frames are redrawn
+        // in full or, when nothing changed, not at all
+        BIRCH_PROFILE_BEGIN(render, "render");
+        VertexUniforms uniforms = {
+            .pointsWide = window->width,
+            .pointsHigh = window->height,
+        };
+        BirchAtlas *atlas = &window->state->atlas;
+        birchMutexLock(&atlas->lock);
+        bool changed = birchWindowFrameChanged(
+            window,
+            &uniforms,
+            (int)macosWindow->drawableSize.width,
+            (int)macosWindow->drawableSize.height
+        );
+        if (changed)
+        {
+            // From the layer rather than the view, which belongs to the
+            // main thread, so a render thread takes the same path
+            id<CAMetalDrawable> drawable = [macosWindow->layer nextDrawable];
+            if (drawable != nil)
+            {
+                MTLRenderPassDescriptor *renderPassDescriptor =
+                    [MTLRenderPassDescriptor renderPassDescriptor];
+                renderPassDescriptor.colorAttachments[0].texture =
+                    drawable.texture;
+                renderPassDescriptor.colorAttachments[0].loadAction =
+                    MTLLoadActionClear;
+                renderPassDescriptor.colorAttachments[0].clearColor =
+                    MTLClearColorMake(0, 0, 0, 1);
+                renderPassDescriptor.colorAttachments[0].storeAction =
+                    MTLStoreActionStore;
+                [macosWindow->renderer encodeFrame:renderPassDescriptor
+                                          drawable:drawable
+                                              size:macosWindow->drawableSize];
+            }
+            else
+            {
+                // Nothing to draw into, try again next frame
+                window->state->lastFrame = 0;
+            }
+        }
+        birchMutexUnlock(&atlas->lock);
+        if (!changed && macosWindow->vsync)
+        {
+            // Keep the pace waiting for a drawable would have set
+            uint64_t period = macosWindow->refreshPeriod;
+            uint64_t now = birchClockNow();
+            birchClockSleepUntil((now / period + 1) * period);
+        }
+        BIRCH_PROFILE_END(render);
+    }
+}
+
+void birchPlatformPollEvents(void)
+{
+    // NSApp routes every event to the view of its own window
+    @autoreleasepool
     {
         for (;;)
         {
@@ -369,6 +948,33 @@ void birchWindowUpdate(BirchWindow *window)
     }
 }
 
+bool birchWindowWaitEvents(BirchWindow *window, double timeout)
+{
+    @autoreleasepool
+    {
+        NSDate *until = timeout >= 0
+                            ? [NSDate dateWithTimeIntervalSinceNow:timeout]
+                            : [NSDate distantFuture];
+
+        // Leave the event queued for birchWindowUpdate
+        NSEvent *event = [NSApp nextEventMatchingMask:NSEventMaskAny
+                                            untilDate:until
+                                               inMode:NSDefaultRunLoopMode
+                                              dequeue:NO];
+        return event != nil;
+    }
+}
+
+void birchWindowSetVsync(BirchWindow *window, bool vsync)
+{
+    MacosWindow *macosWindow = (MacosWindow *)window;
+
+    birchWindowLockRender(window);
+    macosWindow->vsync = vsync;
+    birchWindowUnlockRender(window);
+    macosWindow->layer.displaySyncEnabled = vsync;
+}
+
 bool birchWindowShouldClose(BirchWindow *window)
 {
     MacosWindow *macosWindow = (MacosWindow *)window;
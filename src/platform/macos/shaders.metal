@@ -7,6 +7,7 @@ using namespace metal;
 struct VertexOut {
     float4 position [[position]];
     float4 color;
+    float2 texCoord;
 };
 
 vertex VertexOut vertexShader(uint vid [[vertex_id]],
@@ -15,9 +16,28 @@ vertex VertexOut vertexShader(uint vid [[vertex_id]],
     VertexOut out;
     out.position = vector_float4(((vertex_array[vid].position.x/uniforms.pointsWide) - 0.5)*2, ((vertex_array[vid].position.y/uniforms.pointsHigh) - 0.5)*2, 0.0, 1.0);
     out.color = vertex_array[vid].color;
+    out.texCoord = vertex_array[vid].texCoord;
     return out;
 }
 
 fragment float4 fragmentShader(VertexOut in [[stage_in]]) {
     return in.color;
 }
+
+fragment float4 texturedFragmentShader(VertexOut in [[stage_in]],
+                                       texture2d<float> atlas [[texture(0)]]) {
+    constexpr sampler linearSampler(filter::linear, address::clamp_to_edge);
+    return atlas.sample(linearSampler, in.texCoord) * in.color;
+}
+
+// Coverage from the distance in alpha, converted from texels to pixels with
+// the screen-space derivative of the texel coordinates
+fragment float4 distanceFieldFragmentShader(VertexOut in [[stage_in]],
+                                            texture2d<float> atlas [[texture(0)]]) {
+    constexpr sampler linearSampler(filter::linear, address::clamp_to_edge);
+    float texels = (atlas.sample(linearSampler, in.texCoord).a - 0.5) * 2.0 * BIRCH_DISTANCE_FIELD_SPREAD;
+    float2 size = float2(atlas.get_width(), atlas.get_height());
+    float perPixel = length(fwidth(in.texCoord * size)) * M_SQRT1_2_F;
+    float coverage = saturate(texels / perPixel + 0.5);
+    return float4(in.color.rgb, in.color.a * coverage);
+}
@@ -0,0 +1,33 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef BIRCH_WIN32_INTERNAL_H
+#define BIRCH_WIN32_INTERNAL_H
+
+#include <windows.h>
+
+/// @brief The window class of every birch window, registered by birchInit
+#define BIRCH_WIN32_CLASS_NAME L"birch"
+
+LRESULT CALLBACK
+birchWindowProc(HWND hwnd, UINT uMsg, WPARAM wparam, LPARAM lparam);
+
+/// @brief Build the scancode to BIRCH_KEY_* table, called by birchInit
+void birchWin32LoadKeymap(void);
+
+#endif
@@ -17,9 +17,25 @@
  * along with birch.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-void birchInit(const char *name)
+#include "initInternal.h"
+#include "win32Internal.h"
+
+// Registered once for all windows, which find their state in the window's
+// user data
+void birchPlatformInit(const char *name)
 {
+    WNDCLASSW wc = {0};
+    wc.lpfnWndProc = birchWindowProc;
+    wc.hInstance = GetModuleHandle(NULL);
+    wc.lpszClassName = BIRCH_WIN32_CLASS_NAME;
+    if (!RegisterClassW(&wc))
+    {
+        MessageBoxW(NULL, L"RegisterClassW() failed", L"Error", MB_ICONERROR);
+    }
+    birchWin32LoadKeymap();
 }
-void birchTerminate()
+
+void birchPlatformTerminate(void)
 {
+    UnregisterClassW(BIRCH_WIN32_CLASS_NAME, GetModuleHandle(NULL));
 }
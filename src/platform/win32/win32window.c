@@ -17,136 +17,159 @@
  * along with birch.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "atlas.h"
+#include "clock.h"
+#include "drawList.h"
+#include "glLoader.h"
+#include "heap.h"
+#include "initInternal.h"
+#include "profile.h"
+#include "shaderTypes.h"
+#include "stream.h"
+#include "thread.h"
 #include "window.h"
+#include "win32Internal.h"
+#include "windowInternal.h"
 #include <glad/gl.h>
 #include <glad/wgl.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
-#include <stdlib.h>
+#include <string.h>
 #include <windows.h>
+#include <windowsx.h>
+// after windows.h
+#include <dwmapi.h>
 
-static int32_t keyMap[] = {
-    [VK_SPACE] = BIRCH_KEY_SPACE,
-    [VK_OEM_7] = BIRCH_KEY_APOSTROPHE,
-    [VK_OEM_COMMA] = BIRCH_KEY_COMMA,
-    [VK_OEM_MINUS] = BIRCH_KEY_MINUS,
-    [VK_OEM_PERIOD] = BIRCH_KEY_PERIOD,
-    [VK_OEM_2] = BIRCH_KEY_SLASH,
-    ['0'] = BIRCH_KEY_0,
-    ['1'] = BIRCH_KEY_1,
-    ['2'] = BIRCH_KEY_2,
-    ['3'] = BIRCH_KEY_3,
-    ['4'] = BIRCH_KEY_4,
-    ['5'] = BIRCH_KEY_5,
-    ['6'] = BIRCH_KEY_6,
-    ['7'] = BIRCH_KEY_7,
-    ['8'] = BIRCH_KEY_8,
-    ['9'] = BIRCH_KEY_9,
-    [VK_OEM_1] = BIRCH_KEY_SEMICOLON,
-    [VK_OEM_PLUS] = BIRCH_KEY_EQUAL,
-    ['A'] = BIRCH_KEY_A,
-    ['B'] = BIRCH_KEY_B,
-    ['C'] = BIRCH_KEY_C,
-    ['D'] = BIRCH_KEY_D,
-    ['E'] = BIRCH_KEY_E,
-    ['F'] = BIRCH_KEY_F,
-    ['G'] = BIRCH_KEY_G,
-    ['H'] = BIRCH_KEY_H,
-    ['I'] = BIRCH_KEY_I,
-    ['J'] = BIRCH_KEY_J,
-    ['K'] = BIRCH_KEY_K,
-    ['L'] = BIRCH_KEY_L,
-    ['M'] = BIRCH_KEY_M,
-    ['N'] = BIRCH_KEY_N,
-    ['O'] = BIRCH_KEY_O,
-    ['P'] = BIRCH_KEY_P,
-    ['Q'] = BIRCH_KEY_Q,
-    ['R'] = BIRCH_KEY_R,
-    ['S'] = BIRCH_KEY_S,
-    ['T'] = BIRCH_KEY_T,
-    ['U'] = BIRCH_KEY_U,
-    ['V'] = BIRCH_KEY_V,
-    ['W'] = BIRCH_KEY_W,
-    ['X'] = BIRCH_KEY_X,
-    ['Y'] = BIRCH_KEY_Y,
-    ['Z'] = BIRCH_KEY_Z,
-    [VK_OEM_4] = BIRCH_KEY_LEFT_BRACKET,
-    [VK_OEM_5] = BIRCH_KEY_BACKSLASH,
-    [VK_OEM_6] = BIRCH_KEY_RIGHT_BRACKET,
-    [VK_OEM_3] = BIRCH_KEY_GRAVE_ACCENT,
-    [VK_ESCAPE] = BIRCH_KEY_ESCAPE,
-    [VK_RETURN] = BIRCH_KEY_ENTER,
-    [VK_TAB] = BIRCH_KEY_TAB,
-    [VK_BACK] = BIRCH_KEY_BACKSPACE,
-    [VK_INSERT] = BIRCH_KEY_INSERT,
-    [VK_DELETE] = BIRCH_KEY_DELETE,
-    [VK_RIGHT] = BIRCH_KEY_RIGHT,
-    [VK_LEFT] = BIRCH_KEY_LEFT,
-    [VK_DOWN] = BIRCH_KEY_DOWN,
-    [VK_UP] = BIRCH_KEY_UP,
-    [VK_PRIOR] = BIRCH_KEY_PAGE_UP,
-    [VK_NEXT] = BIRCH_KEY_PAGE_DOWN,
-    [VK_HOME] = BIRCH_KEY_HOME,
-    [VK_END] = BIRCH_KEY_END,
-    [VK_CAPITAL] = BIRCH_KEY_CAPS_LOCK,
-    [VK_SCROLL] = BIRCH_KEY_SCROLL_LOCK,
-    [VK_NUMLOCK] = BIRCH_KEY_NUM_LOCK,
-    [VK_PRINT] = BIRCH_KEY_PRINT_SCREEN,
-    [VK_MEDIA_PLAY_PAUSE] = BIRCH_KEY_PAUSE,
-    [VK_F1] = BIRCH_KEY_F1,
-    [VK_F2] = BIRCH_KEY_F2,
-    [VK_F3] = BIRCH_KEY_F3,
-    [VK_F4] = BIRCH_KEY_F4,
-    [VK_F5] = BIRCH_KEY_F5,
-    [VK_F6] = BIRCH_KEY_F6,
-    [VK_F7] = BIRCH_KEY_F7,
-    [VK_F8] = BIRCH_KEY_F8,
-    [VK_F9] = BIRCH_KEY_F9,
-    [VK_F10] = BIRCH_KEY_F10,
-    [VK_F11] = BIRCH_KEY_F11,
-    [VK_F12] = BIRCH_KEY_F12,
-    [VK_F13] = BIRCH_KEY_F13,
-    [VK_F14] = BIRCH_KEY_F14,
-    [VK_F15] = BIRCH_KEY_F15,
-    [VK_F16] = BIRCH_KEY_F16,
-    [VK_F17] = BIRCH_KEY_F17,
-    [VK_F18] = BIRCH_KEY_F18,
-    [VK_F19] = BIRCH_KEY_F19,
-    [VK_F20] = BIRCH_KEY_F20,
-    [VK_F21] = BIRCH_KEY_F21,
-    [VK_F22] = BIRCH_KEY_F22,
-    [VK_F23] = BIRCH_KEY_F23,
-    [VK_F24] = BIRCH_KEY_F24,
-    [0] = BIRCH_KEY_F25,
-    [VK_NUMPAD0] = BIRCH_KEY_KP_0,
-    [VK_NUMPAD1] = BIRCH_KEY_KP_1,
-    [VK_NUMPAD2] = BIRCH_KEY_KP_2,
-    [VK_NUMPAD3] = BIRCH_KEY_KP_3,
-    [VK_NUMPAD4] = BIRCH_KEY_KP_4,
-    [VK_NUMPAD5] = BIRCH_KEY_KP_5,
-    [VK_NUMPAD6] = BIRCH_KEY_KP_6,
-    [VK_NUMPAD7] = BIRCH_KEY_KP_7,
-    [VK_NUMPAD8] = BIRCH_KEY_KP_8,
-    [VK_NUMPAD9] = BIRCH_KEY_KP_9,
-    [VK_DECIMAL] = BIRCH_KEY_KP_DECIMAL,
-    [VK_DIVIDE] = BIRCH_KEY_KP_DIVIDE,
-    [VK_MULTIPLY] = BIRCH_KEY_KP_MULTIPLY,
-    [VK_SUBTRACT] = BIRCH_KEY_KP_SUBTRACT,
-    [VK_ADD] = BIRCH_KEY_KP_ADD,
-    [VK_RETURN] = BIRCH_KEY_KP_ENTER,
-    [VK_OEM_PLUS] = BIRCH_KEY_KP_EQUAL,
-    [VK_SHIFT] = BIRCH_KEY_LEFT_SHIFT,
-    [VK_CONTROL] = BIRCH_KEY_LEFT_CONTROL,
-    [VK_LMENU] = BIRCH_KEY_LEFT_ALT,
-    [VK_LWIN] = BIRCH_KEY_LEFT_SUPER,
-    [VK_SHIFT] = BIRCH_KEY_RIGHT_SHIFT,
-    [VK_CONTROL] = BIRCH_KEY_RIGHT_CONTROL,
-    [VK_RMENU] = BIRCH_KEY_RIGHT_ALT,
-    [VK_RWIN] = BIRCH_KEY_RIGHT_SUPER,
-    [VK_MENU] = BIRCH_KEY_MENU,
-    [VK_OEM_102] = BIRCH_KEY_UNKNOWN,
+// Scancodes of the key messages' lparam, with 0x100 set for extended keys,
+// name keys by their position whatever the layout, and tell apart the left
+// and right modifiers and the keypad keys that share virtual keys with
+// others. Densified by birchWin32LoadKeymap, 0 marks unknown scancodes.
+static const int16_t win32Scancodes[512] = {
+    [0x001] = BIRCH_KEY_ESCAPE,
+    [0x002] = BIRCH_KEY_1,
+    [0x003] = BIRCH_KEY_2,
+    [0x004] = BIRCH_KEY_3,
+    [0x005] = BIRCH_KEY_4,
+    [0x006] = BIRCH_KEY_5,
+    [0x007] = BIRCH_KEY_6,
+    [0x008] = BIRCH_KEY_7,
+    [0x009] = BIRCH_KEY_8,
+    [0x00a] = BIRCH_KEY_9,
+    [0x00b] = BIRCH_KEY_0,
+    [0x00c] = BIRCH_KEY_MINUS,
+    [0x00d] = BIRCH_KEY_EQUAL,
+    [0x00e] = BIRCH_KEY_BACKSPACE,
+    [0x00f] = BIRCH_KEY_TAB,
+    [0x010] = BIRCH_KEY_Q,
+    [0x011] = BIRCH_KEY_W,
+    [0x012] = BIRCH_KEY_E,
+    [0x013] = BIRCH_KEY_R,
+    [0x014] = BIRCH_KEY_T,
+    [0x015] = BIRCH_KEY_Y,
+    [0x016] = BIRCH_KEY_U,
+    [0x017] = BIRCH_KEY_I,
+    [0x018] = BIRCH_KEY_O,
+    [0x019] = BIRCH_KEY_P,
+    [0x01a] = BIRCH_KEY_LEFT_BRACKET,
+    [0x01b] = BIRCH_KEY_RIGHT_BRACKET,
+    [0x01c] = BIRCH_KEY_ENTER,
+    [0x01d] = BIRCH_KEY_LEFT_CONTROL,
+    [0x01e] = BIRCH_KEY_A,
+    [0x01f] = BIRCH_KEY_S,
+    [0x020] = BIRCH_KEY_D,
+    [0x021] = BIRCH_KEY_F,
+    [0x022] = BIRCH_KEY_G,
+    [0x023] = BIRCH_KEY_H,
+    [0x024] = BIRCH_KEY_J,
+    [0x025] = BIRCH_KEY_K,
+    [0x026] = BIRCH_KEY_L,
+    [0x027] = BIRCH_KEY_SEMICOLON,
+    [0x028] = BIRCH_KEY_APOSTROPHE,
+    [0x029] = BIRCH_KEY_GRAVE_ACCENT,
+    [0x02a] = BIRCH_KEY_LEFT_SHIFT,
+    [0x02b] = BIRCH_KEY_BACKSLASH,
+    [0x02c] = BIRCH_KEY_Z,
+    [0x02d] = BIRCH_KEY_X,
+    [0x02e] = BIRCH_KEY_C,
+    [0x02f] = BIRCH_KEY_V,
+    [0x030] = BIRCH_KEY_B,
+    [0x031] = BIRCH_KEY_N,
+    [0x032] = BIRCH_KEY_M,
+    [0x033] = BIRCH_KEY_COMMA,
+    [0x034] = BIRCH_KEY_PERIOD,
+    [0x035] = BIRCH_KEY_SLASH,
+    [0x036] = BIRCH_KEY_RIGHT_SHIFT,
+    [0x037] = BIRCH_KEY_KP_MULTIPLY,
+    [0x038] = BIRCH_KEY_LEFT_ALT,
+    [0x039] = BIRCH_KEY_SPACE,
+    [0x03a] = BIRCH_KEY_CAPS_LOCK,
+    [0x03b] = BIRCH_KEY_F1,
+    [0x03c] = BIRCH_KEY_F2,
+    [0x03d] = BIRCH_KEY_F3,
+    [0x03e] = BIRCH_KEY_F4,
+    [0x03f] = BIRCH_KEY_F5,
+    [0x040] = BIRCH_KEY_F6,
+    [0x041] = BIRCH_KEY_F7,
+    [0x042] = BIRCH_KEY_F8,
+    [0x043] = BIRCH_KEY_F9,
+    [0x044] = BIRCH_KEY_F10,
+    [0x045] = BIRCH_KEY_PAUSE,
+    [0x046] = BIRCH_KEY_SCROLL_LOCK,
+    [0x047] = BIRCH_KEY_KP_7,
+    [0x048] = BIRCH_KEY_KP_8,
+    [0x049] = BIRCH_KEY_KP_9,
+    [0x04a] = BIRCH_KEY_KP_SUBTRACT,
+    [0x04b] = BIRCH_KEY_KP_4,
+    [0x04c] = BIRCH_KEY_KP_5,
+    [0x04d] = BIRCH_KEY_KP_6,
+    [0x04e] = BIRCH_KEY_KP_ADD,
+    [0x04f] = BIRCH_KEY_KP_1,
+    [0x050] = BIRCH_KEY_KP_2,
+    [0x051] = BIRCH_KEY_KP_3,
+    [0x052] = BIRCH_KEY_KP_0,
+    [0x053] = BIRCH_KEY_KP_DECIMAL,
+    [0x057] = BIRCH_KEY_F11,
+    [0x058] = BIRCH_KEY_F12,
+    [0x059] = BIRCH_KEY_KP_EQUAL,
+    [0x064] = BIRCH_KEY_F13,
+    [0x065] = BIRCH_KEY_F14,
+    [0x066] = BIRCH_KEY_F15,
+    [0x067] = BIRCH_KEY_F16,
+    [0x068] = BIRCH_KEY_F17,
+    [0x069] = BIRCH_KEY_F18,
+    [0x06a] = BIRCH_KEY_F19,
+    [0x06b] = BIRCH_KEY_F20,
+    [0x06c] = BIRCH_KEY_F21,
+    [0x06d] = BIRCH_KEY_F22,
+    [0x06e] = BIRCH_KEY_F23,
+    [0x076] = BIRCH_KEY_F24,
+    [0x11c] = BIRCH_KEY_KP_ENTER,
+    [0x11d] = BIRCH_KEY_RIGHT_CONTROL,
+    [0x135] = BIRCH_KEY_KP_DIVIDE,
+    [0x137] = BIRCH_KEY_PRINT_SCREEN,
+    [0x138] = BIRCH_KEY_RIGHT_ALT,
+    [0x145] = BIRCH_KEY_NUM_LOCK,
+    [0x146] = BIRCH_KEY_PAUSE,
+    [0x147] = BIRCH_KEY_HOME,
+    [0x148] = BIRCH_KEY_UP,
+    [0x149] = BIRCH_KEY_PAGE_UP,
+    [0x14b] = BIRCH_KEY_LEFT,
+    [0x14d] = BIRCH_KEY_RIGHT,
+    [0x14f] = BIRCH_KEY_END,
+    [0x150] = BIRCH_KEY_DOWN,
+    [0x151] = BIRCH_KEY_PAGE_DOWN,
+    [0x152] = BIRCH_KEY_INSERT,
+    [0x153] = BIRCH_KEY_DELETE,
+    [0x15b] = BIRCH_KEY_LEFT_SUPER,
+    [0x15c] = BIRCH_KEY_RIGHT_SUPER,
+    [0x15d] = BIRCH_KEY_MENU,
 };
 
+// win32Scancodes with BIRCH_KEY_UNKNOWN for unknown scancodes, so
+// translating a key is a single load
+static int16_t win32Keycodes[512];
+
 typedef struct
 {
     BirchWindow base;
@@ -155,117 +178,607 @@ typedef struct
     bool should_close;
     HINSTANCE hinstance;
     HDC hdc;
-    HGLRC rc;
+    // holds a reference to the shared context
     bool hasGl;
+    // one per atlas page, created when the page is first uploaded
+    GLuint textures[BIRCH_ATLAS_MAX_PAGES];
+    GLuint streamBuffer;
+    GLsync streamFences[BIRCH_STREAM_FRAMES];
+    uint8_t *streamStaging;
+    bool vsync;
 } Win32Window;
 
-LRESULT CALLBACK
-birchWindowProc(HWND hwnd, UINT uMsg, WPARAM wparam, LPARAM lparam)
+// One OpenGL context and pipeline for every window, created with the first
+// window and deleted with the last. Every window gets the same pixel format
+// so the context can draw into any of them.
+typedef struct
 {
-    Win32Window *window = (Win32Window *)GetWindowLongPtrW(hwnd, GWLP_USERDATA);
+    HGLRC rc;
+    int pixelFormat;
+    PIXELFORMATDESCRIPTOR pixelFormatDescriptor;
+    GLuint program;
+    GLuint texturedProgram;
+    GLuint distanceFieldProgram;
+    GLuint vao;
+    GLint uniformAlignment;
+    // WGL_EXT_swap_control, NULL if the driver lacks it
+    BOOL(WINAPI *swapInterval)(int interval);
+    unsigned int windows;
+} Win32Device;
 
-    switch (uMsg)
+static Win32Device win32Device;
+// GetMessageTime converted to the birchClockNow clock. Messages of every
+// window are handled on the thread that pumps them.
+static BirchEventClock win32EventClock;
+// Held while the context is current. A context is current on one thread at
+// a time, and with render threads windows draw from several.
+static BirchMutex win32DeviceLock = SRWLOCK_INIT;
+
+// GLSL port of shaders.metal
+static const char *vertexShaderSource =
+    "#version 330 core\n"
+    "layout(location = 0) in vec2 position;\n"
+    "layout(location = 1) in vec4 color;\n"
+    "layout(location = 2) in vec2 texCoord;\n"
+    "layout(std140) uniform VertexUniforms\n"
+    "{\n"
+    "    vec2 points;\n"
+    "};\n"
+    "out vec4 vertexColor;\n"
+    "out vec2 vertexTexCoord;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_Position = vec4((position / points - 0.5) * 2.0, 0.0, 1.0);\n"
+    "    vertexColor = color;\n"
+    "    vertexTexCoord = texCoord;\n"
+    "}\n";
+
+static const char *fragmentShaderSource =
+    "#version 330 core\n"
+    "in vec4 vertexColor;\n"
+    "out vec4 fragColor;\n"
+    "void main()\n"
+    "{\n"
+    "    fragColor = vertexColor;\n"
+    "}\n";
+
+// Samples texture unit 0, the default of every sampler uniform
+static const char *texturedFragmentShaderSource =
+    "#version 330 core\n"
+    "in vec4 vertexColor;\n"
+    "in vec2 vertexTexCoord;\n"
+    "uniform sampler2D atlas;\n"
+    "out vec4 fragColor;\n"
+    "void main()\n"
+    "{\n"
+    "    fragColor = texture(atlas, vertexTexCoord) * vertexColor;\n"
+    "}\n";
+
+// Coverage from the distance in alpha, which changes by 0.5 per
+// BIRCH_DISTANCE_FIELD_SPREAD (4) texels, converted to pixels with the
+// screen-space derivative of the texel coordinates
+static const char *distanceFieldFragmentShaderSource =
+    "#version 330 core\n"
+    "in vec4 vertexColor;\n"
+    "in vec2 vertexTexCoord;\n"
+    "uniform sampler2D atlas;\n"
+    "out vec4 fragColor;\n"
+    "void main()\n"
+    "{\n"
+    "    float texels = (texture(atlas, vertexTexCoord).a - 0.5) * 8.0;\n"
+    "    vec2 size = vec2(textureSize(atlas, 0));\n"
+    "    float perPixel = length(fwidth(vertexTexCoord * size)) * 0.7071;\n"
+    "    float coverage = clamp(texels / perPixel + 0.5, 0.0, 1.0);\n"
+    "    fragColor = vec4(vertexColor.rgb, vertexColor.a * coverage);\n"
+    "}\n";
+
+static GLuint win32CompileShader(GLenum type, const char *source)
+{
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+
+    GLint compiled;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (!compiled)
     {
-    case WM_DESTROY:
-        window->should_close = true;
+        char log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        fprintf(stderr, "birch: failed to compile shader: %s\n", log);
+        glDeleteShader(shader);
         return 0;
-    case WM_SIZE:
-        window->base.width = LOWORD(lparam);
-        window->base.height = HIWORD(lparam);
-        if (window->hasGl)
-        {
-            glViewport(0, 0, window->base.width, window->base.height);
-        }
-        if (window->base.resizeCallback)
-        {
-            window->base.resizeCallback(
-                window->base.width,
-                window->base.height
-            );
-        }
+    }
+    return shader;
+}
+
+static GLuint win32LinkProgram(GLuint vertexShader, GLuint fragmentShader)
+{
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
+
+    GLint linked;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        glDeleteProgram(program);
         return 0;
     }
-    return DefWindowProcW(hwnd, uMsg, wparam, lparam);
+
+    glUniformBlockBinding(
+        program,
+        glGetUniformBlockIndex(program, "VertexUniforms"),
+        1
+    );
+    return program;
 }
 
-BirchWindow *
-birchWindowNew(unsigned int width, unsigned int height, const char *title)
+static bool win32CreatePipeline(void)
 {
-    Win32Window *window = malloc(sizeof(Win32Window));
-    if (!window)
+    GLuint vertexShader =
+        win32CompileShader(GL_VERTEX_SHADER, vertexShaderSource);
+    GLuint fragmentShader =
+        win32CompileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
+    GLuint texturedFragmentShader = win32CompileShader(
+        GL_FRAGMENT_SHADER,
+        texturedFragmentShaderSource
+    );
+    GLuint distanceFieldFragmentShader = win32CompileShader(
+        GL_FRAGMENT_SHADER,
+        distanceFieldFragmentShaderSource
+    );
+    if (vertexShader && fragmentShader && texturedFragmentShader &&
+        distanceFieldFragmentShader)
     {
-        return NULL;
+        win32Device.program = win32LinkProgram(vertexShader, fragmentShader);
+        win32Device.texturedProgram =
+            win32LinkProgram(vertexShader, texturedFragmentShader);
+        win32Device.distanceFieldProgram =
+            win32LinkProgram(vertexShader, distanceFieldFragmentShader);
+    }
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    glDeleteShader(texturedFragmentShader);
+    glDeleteShader(distanceFieldFragmentShader);
+    if (!win32Device.program || !win32Device.texturedProgram ||
+        !win32Device.distanceFieldProgram)
+    {
+        return false;
     }
 
-    // todo transform points to pixels
+    glGetIntegerv(
+        GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT,
+        &win32Device.uniformAlignment
+    );
 
-    window->base.width = width;
-    window->base.height = height;
-    window->base.title = title;
-    window->base.mouseMovedCallback = NULL;
-    window->base.resizeCallback = NULL;
-    window->base.keyPressedCallback = NULL;
-    window->base.keyReleasedCallback = NULL;
-    window->base.mouseButtonPressedCallback = NULL;
-    window->base.mouseButtonReleasedCallback = NULL;
-    window->should_close = false;
-    window->hasGl = false;
+    glGenVertexArrays(1, &win32Device.vao);
+    glBindVertexArray(win32Device.vao);
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
 
-    HINSTANCE hinstance = GetModuleHandle(NULL);
-    window->hinstance = hinstance;
+    // Only the textured pipelines blend, atlas rectangles are uploaded
+    // straight out of their page
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, BIRCH_ATLAS_SIZE);
+    return true;
+}
+
+static void *win32StreamAllocate(void *context, size_t size)
+{
+    Win32Window *window = context;
 
-    const wchar_t CLAS_NAME[] = L"birch";
-    WNDCLASS wc = {0};
-    wc.lpfnWndProc = birchWindowProc;
-    wc.hInstance = hinstance;
-    wc.lpszClassName = CLAS_NAME;
-    wc.cbWndExtra = sizeof(Win32Window *);
+    glGenBuffers(1, &window->streamBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, window->streamBuffer);
 
-    if (!RegisterClassW((const WNDCLASS *)&wc))
+    if (GLAD_GL_VERSION_4_4)
     {
-        MessageBoxW(NULL, L"RegisterClassW() failed", L"Error", MB_ICONERROR);
+        GLbitfield flags =
+            GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+        return glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+    }
 
-        return NULL;
+    // Without buffer storage the stream is written to a staging copy that
+    // is uploaded once per frame by win32StreamFlush
+    glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+    window->streamStaging = birchAllocate(size);
+    return window->streamStaging;
+}
+
+static void win32StreamRelease(void *context, void *data)
+{
+    Win32Window *window = context;
+
+    if (!window->streamStaging)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, window->streamBuffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
     }
+    glDeleteBuffers(1, &window->streamBuffer);
+    birchFree(window->streamStaging);
+    window->streamBuffer = 0;
+    window->streamStaging = NULL;
+}
 
-    size_t title_len = strlen(title) + 1;
-    window->title_w = malloc(title_len * sizeof(wchar_t));
-    mbstowcs_s(NULL, window->title_w, title_len, title, title_len);
+static void win32StreamFlush(void *context, size_t offset, size_t size)
+{
+    Win32Window *window = context;
 
-    window->hwnd = CreateWindowExW(
+    if (window->streamStaging)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, window->streamBuffer);
+        glBufferSubData(
+            GL_ARRAY_BUFFER,
+            offset,
+            size,
+            window->streamStaging + offset
+        );
+    }
+}
+
+static void win32StreamFence(void *context, unsigned int frame)
+{
+    Win32Window *window = context;
+
+    window->streamFences[frame] =
+        glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+static bool win32StreamPoll(void *context, unsigned int frame)
+{
+    Win32Window *window = context;
+
+    GLenum result = glClientWaitSync(window->streamFences[frame], 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED)
+    {
+        return false;
+    }
+    glDeleteSync(window->streamFences[frame]);
+    window->streamFences[frame] = NULL;
+    return true;
+}
+
+static void win32StreamWait(void *context, unsigned int frame)
+{
+    Win32Window *window = context;
+
+    while (glClientWaitSync(
+               window->streamFences[frame],
+               GL_SYNC_FLUSH_COMMANDS_BIT,
+               1000000000
+           ) == GL_TIMEOUT_EXPIRED)
+    {
+    }
+    glDeleteSync(window->streamFences[frame]);
+    window->streamFences[frame] = NULL;
+}
+
+static const BirchStreamBackend win32StreamBackend = {
+    .allocate = win32StreamAllocate,
+    .release = win32StreamRelease,
+    .flush = win32StreamFlush,
+    .fence = win32StreamFence,
+    .poll = win32StreamPoll,
+    .wait = win32StreamWait,
+};
+
+static void win32UploadAtlas(
+    void *context,
+    unsigned int page,
+    const BirchRasterTexture *texture,
+    const BirchRasterRect *rect
+)
+{
+    Win32Window *window = context;
+
+    if (!window->textures[page])
+    {
+        glGenTextures(1, &window->textures[page]);
+        glBindTexture(GL_TEXTURE_2D, window->textures[page]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(
+            GL_TEXTURE_2D,
+            0,
+            GL_RGBA8,
+            texture->width,
+            texture->height,
+            0,
+            GL_RGBA,
+            GL_UNSIGNED_BYTE,
+            NULL
+        );
+    }
+    glBindTexture(GL_TEXTURE_2D, window->textures[page]);
+    glTexSubImage2D(
+        GL_TEXTURE_2D,
         0,
-        CLAS_NAME,
-        window->title_w,
-        WS_OVERLAPPEDWINDOW,
-        CW_USEDEFAULT,
-        CW_USEDEFAULT,
-        width,
-        height,
-        NULL,
-        NULL,
-        hinstance,
-        NULL
+        rect->minX,
+        rect->minY,
+        rect->maxX - rect->minX,
+        rect->maxY - rect->minY,
+        GL_RGBA,
+        GL_UNSIGNED_BYTE,
+        texture->pixels + (size_t)rect->minY * texture->width + rect->minX
     );
-    SetWindowLongPtrW(window->hwnd, GWLP_USERDATA, (LONG_PTR)window);
+}
 
-    if (!window->hwnd)
+static void win32Draw(Win32Window *window)
+{
+    BirchDrawList *list = &window->base.state->submitted;
+    size_t vertexBytes = list->vertexCount * sizeof(Vertex);
+
+    BirchStream *stream = &window->base.state->stream;
+    birchStreamBeginFrame(
+        stream,
+        vertexBytes + win32Device.uniformAlignment + 16
+    );
+
+    glViewport(0, 0, window->base.width, window->base.height);
+    glClearColor(0.0, 0.0, 0.0, 1.0);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    size_t vertexOffset;
+    Vertex *vertexData =
+        birchStreamAlloc(stream, vertexBytes, 16, &vertexOffset);
+
+    // std140 rounds the uniform block up to 16 bytes
+    size_t uniformOffset;
+    VertexUniforms *uniforms = birchStreamAlloc(
+        stream,
+        16,
+        win32Device.uniformAlignment,
+        &uniformOffset
+    );
+
+    if (vertexData && uniforms)
     {
-        MessageBoxW(NULL, L"CreateWindowExW() failed", L"Error", MB_ICONERROR);
+        size_t callCount = birchWindowFlattenDraws(&window->base, vertexData);
+        uniforms->pointsWide = window->base.width;
+        uniforms->pointsHigh = window->base.height;
+        birchStreamFlush(stream);
 
-        return NULL;
+        glUseProgram(win32Device.program);
+        glBindVertexArray(win32Device.vao);
+        glBindBuffer(GL_ARRAY_BUFFER, window->streamBuffer);
+        glVertexAttribPointer(
+            0,
+            2,
+            GL_FLOAT,
+            GL_FALSE,
+            sizeof(Vertex),
+            (const void *)(vertexOffset + offsetof(Vertex, position))
+        );
+        glVertexAttribPointer(
+            1,
+            4,
+            GL_FLOAT,
+            GL_FALSE,
+            sizeof(Vertex),
+            (const void *)(vertexOffset + offsetof(Vertex, color))
+        );
+        glVertexAttribPointer(
+            2,
+            2,
+            GL_FLOAT,
+            GL_FALSE,
+            sizeof(Vertex),
+            (const void *)(vertexOffset + offsetof(Vertex, texCoord))
+        );
+        glBindBufferRange(
+            GL_UNIFORM_BUFFER,
+            1,
+            window->streamBuffer,
+            uniformOffset,
+            16
+        );
+
+        BirchPipeline pipeline = BIRCH_PIPELINE_SOLID;
+        for (size_t i = 0; i < callCount; i++)
+        {
+            BirchDrawBatch call = list->calls[i];
+            if (BIRCH_DRAW_KEY_PIPELINE(call.key) != pipeline)
+            {
+                pipeline = BIRCH_DRAW_KEY_PIPELINE(call.key);
+                if (pipeline == BIRCH_PIPELINE_TEXTURED)
+                {
+                    glUseProgram(win32Device.texturedProgram);
+                    glEnable(GL_BLEND);
+                }
+                else if (pipeline == BIRCH_PIPELINE_DISTANCE_FIELD)
+                {
+                    glUseProgram(win32Device.distanceFieldProgram);
+                    glEnable(GL_BLEND);
+                }
+                else
+                {
+                    glUseProgram(win32Device.program);
+                    glDisable(GL_BLEND);
+                }
+            }
+            if (pipeline != BIRCH_PIPELINE_SOLID)
+            {
+                uint32_t page = BIRCH_DRAW_KEY_TEXTURE(call.key) - 1;
+                glBindTexture(GL_TEXTURE_2D, window->textures[page]);
+            }
+            glDrawArrays(GL_TRIANGLES, call.first, call.count);
+        }
+        glDisable(GL_BLEND);
     }
 
-    window->hdc = GetDC(window->hwnd);
-    ShowWindow(window->hwnd, SW_SHOWDEFAULT);
+    birchStreamEndFrame(stream);
+}
+
+// wglGetProcAddress only knows functions added after GL 1.1, the rest are
+// exported by opengl32.dll. Some drivers return small integers for failure.
+static GLADapiproc win32GlLookup(void *opengl32, const char *name)
+{
+    PROC proc = wglGetProcAddress(name);
+    if ((uintptr_t)proc <= 3 || (intptr_t)proc == -1)
+    {
+        proc = GetProcAddress((HMODULE)opengl32, name);
+    }
+    return (GLADapiproc)proc;
+}
+
+void birchWin32LoadKeymap(void)
+{
+    for (int i = 0; i < 512; i++)
+    {
+        win32Keycodes[i] =
+            win32Scancodes[i] ? win32Scancodes[i] : BIRCH_KEY_UNKNOWN;
+    }
+}
+
+static int win32TranslateKey(WPARAM key, LPARAM lparam)
+{
+    UINT scancode = HIWORD(lparam) & (0xff | KF_EXTENDED);
+    // Keys sent by other programs may lack a scancode
+    if (!scancode)
+    {
+        scancode = MapVirtualKeyW((UINT)key, MAPVK_VK_TO_VSC);
+    }
+    return win32Keycodes[scancode & 0x1ff];
+}
+
+static uint64_t win32MessageTime(void)
+{
+    return birchEventClockConvert(
+        &win32EventClock,
+        (uint32_t)GetMessageTime()
+    );
+}
+
+LRESULT CALLBACK
+birchWindowProc(HWND hwnd, UINT uMsg, WPARAM wparam, LPARAM lparam)
+{
+    if (uMsg == WM_NCCREATE)
+    {
+        // The first message, before CreateWindowExW returns
+        CREATESTRUCTW *create = (CREATESTRUCTW *)lparam;
+        SetWindowLongPtrW(
+            hwnd,
+            GWLP_USERDATA,
+            (LONG_PTR)create->lpCreateParams
+        );
+    }
+    Win32Window *window = (Win32Window *)GetWindowLongPtrW(hwnd, GWLP_USERDATA);
+    if (!window)
+    {
+        return DefWindowProcW(hwnd, uMsg, wparam, lparam);
+    }
+
+    switch (uMsg)
+    {
+    case WM_DESTROY:
+        window->should_close = true;
+        return 0;
+    case WM_PAINT:
+        // Draw the next frame even if it did not change
+        birchWindowLockRender(&window->base);
+        window->base.state->lastFrame = 0;
+        birchWindowUnlockRender(&window->base);
+        break;
+    case WM_SIZE:
+        // Minimizing reports 0x0, keep the size the window restores to
+        if (wparam == SIZE_MINIMIZED)
+        {
+            return 0;
+        }
+        birchWindowLockRender(&window->base);
+        window->base.width = LOWORD(lparam);
+        window->base.height = HIWORD(lparam);
+        birchWindowUnlockRender(&window->base);
+        birchWindowDispatchResize(
+            &window->base,
+            window->base.width,
+            window->base.height,
+            birchClockNow()
+        );
+        return 0;
+    case WM_KEYDOWN:
+    case WM_SYSKEYDOWN:
+        birchWindowDispatchKeyPressed(
+            &window->base,
+            win32TranslateKey(wparam, lparam),
+            win32MessageTime()
+        );
+        break;
+    case WM_KEYUP:
+    case WM_SYSKEYUP:
+        birchWindowDispatchKeyReleased(
+            &window->base,
+            win32TranslateKey(wparam, lparam),
+            win32MessageTime()
+        );
+        break;
+    case WM_MOUSEMOVE:
+        birchWindowDispatchMouseMoved(
+            &window->base,
+            GET_X_LPARAM(lparam),
+            window->base.height - GET_Y_LPARAM(lparam),
+            win32MessageTime()
+        );
+        return 0;
+    case WM_LBUTTONDOWN:
+    case WM_RBUTTONDOWN:
+    case WM_MBUTTONDOWN:
+        birchWindowDispatchMouseButtonPressed(
+            &window->base,
+            uMsg == WM_LBUTTONDOWN   ? BIRCH_MOUSE_BUTTON_LEFT
+            : uMsg == WM_RBUTTONDOWN ? BIRCH_MOUSE_BUTTON_RIGHT
+                                     : BIRCH_MOUSE_BUTTON_MIDDLE,
+            win32MessageTime()
+        );
+        return 0;
+    case WM_LBUTTONUP:
+    case WM_RBUTTONUP:
+    case WM_MBUTTONUP:
+        birchWindowDispatchMouseButtonReleased(
+            &window->base,
+            uMsg == WM_LBUTTONUP   ? BIRCH_MOUSE_BUTTON_LEFT
+            : uMsg == WM_RBUTTONUP ? BIRCH_MOUSE_BUTTON_RIGHT
+                                   : BIRCH_MOUSE_BUTTON_MIDDLE,
+            win32MessageTime()
+        );
+        return 0;
+    }
+    return DefWindowProcW(hwnd, uMsg, wparam, lparam);
+}
 
-    // OpenGL Context creation
+// Make the context current on the calling thread, drawing into `window`
+static void win32Acquire(Win32Window *window)
+{
+    birchMutexLock(&win32DeviceLock);
+    wglMakeCurrent(window->hdc, win32Device.rc);
+    // Drivers keep the swap interval with the drawable or the context,
+    // set it for whichever it is
+    if (win32Device.swapInterval)
+    {
+        win32Device.swapInterval(window->vsync ? 1 : 0);
+    }
+}
+
+static void win32Release(void)
+{
+    wglMakeCurrent(NULL, NULL);
+    birchMutexUnlock(&win32DeviceLock);
+}
 
+// Create the shared context on the first window. Extended pixel formats and
+// core contexts need WGL extensions, which need a current context first, so
+// a throwaway window and context are made to load them.
+static bool win32CreateDevice(HDC hdc, HINSTANCE hinstance)
+{
     const wchar_t FAKE_CLAS_NAME[] = L"birch_fake";
     WNDCLASS fake_wc = {0};
     fake_wc.lpfnWndProc = DefWindowProcW;
     fake_wc.hInstance = hinstance;
     fake_wc.lpszClassName = FAKE_CLAS_NAME;
-    fake_wc.cbWndExtra = sizeof(Win32Window *);
 
     if (!RegisterClassW((const WNDCLASS *)&fake_wc))
     {
@@ -276,7 +789,7 @@ birchWindowNew(unsigned int width, unsigned int height, const char *title)
             MB_ICONERROR
         );
 
-        return NULL;
+        return false;
     }
 
     HWND fake_hwnd = CreateWindowW(
@@ -301,8 +814,8 @@ birchWindowNew(unsigned int width, unsigned int height, const char *title)
             L"Error",
             MB_ICONERROR
         );
-
-        return NULL;
+        UnregisterClassW(FAKE_CLAS_NAME, hinstance);
+        return false;
     }
 
     HDC fake_hdc = GetDC(fake_hwnd);
@@ -317,165 +830,272 @@ birchWindowNew(unsigned int width, unsigned int height, const char *title)
     fakePFD.cAlphaBits = 8;
     fakePFD.cDepthBits = 24;
 
+    HGLRC fake_rc = NULL;
+    const wchar_t *error = NULL;
     int fakePFDID = ChoosePixelFormat(fake_hdc, &fakePFD);
     if (fakePFDID == 0)
     {
-        MessageBoxW(
+        error = L"Failed to choose fake pixel format";
+    }
+    else if (!SetPixelFormat(fake_hdc, fakePFDID, &fakePFD))
+    {
+        error = L"Failed to set fake pixel format";
+    }
+    else if (!(fake_rc = wglCreateContext(fake_hdc)))
+    {
+        error = L"Failed to create fake OpenGL context";
+    }
+    else if (!wglMakeCurrent(fake_hdc, fake_rc))
+    {
+        error = L"Failed to make fake OpenGL context current";
+    }
+
+    if (!error)
+    {
+        gladLoaderLoadWGL(fake_hdc);
+
+        const int pixel_attribs[] = {
+            WGL_DRAW_TO_WINDOW_ARB,
+            GL_TRUE,
+            WGL_SUPPORT_OPENGL_ARB,
+            GL_TRUE,
+            WGL_DOUBLE_BUFFER_ARB,
+            GL_TRUE,
+            WGL_PIXEL_TYPE_ARB,
+            WGL_TYPE_RGBA_ARB,
+            WGL_ACCELERATION_ARB,
+            WGL_FULL_ACCELERATION_ARB,
+            WGL_COLOR_BITS_ARB,
+            32,
+            WGL_ALPHA_BITS_ARB,
+            8,
+            WGL_DEPTH_BITS_ARB,
+            24,
+            WGL_STENCIL_BITS_ARB,
+            8,
+            WGL_SAMPLE_BUFFERS_ARB,
+            GL_TRUE,
+            WGL_SAMPLES_ARB,
+            4,
+            0
+        };
+        UINT num_formats;
+        bool status = wglChoosePixelFormatARB(
+            hdc,
+            pixel_attribs,
             NULL,
-            L"Failed to choose fake pixel format",
-            L"Error",
-            MB_ICONERROR
+            1,
+            &win32Device.pixelFormat,
+            &num_formats
         );
-        DestroyWindow(fake_hwnd);
-        UnregisterClassW(FAKE_CLAS_NAME, hinstance);
-        return NULL;
+        if (!status || num_formats == 0)
+        {
+            error = L"Failed to choose pixel format";
+        }
     }
 
-    if (!SetPixelFormat(fake_hdc, fakePFDID, &fakePFD))
+    if (!error)
     {
-        MessageBoxW(
-            NULL,
-            L"Failed to set fake pixel format",
-            L"Error",
-            MB_ICONERROR
+        DescribePixelFormat(
+            hdc,
+            win32Device.pixelFormat,
+            sizeof(PIXELFORMATDESCRIPTOR),
+            &win32Device.pixelFormatDescriptor
         );
-        DestroyWindow(fake_hwnd);
-        UnregisterClassW(FAKE_CLAS_NAME, hinstance);
-        return NULL;
+        SetPixelFormat(
+            hdc,
+            win32Device.pixelFormat,
+            &win32Device.pixelFormatDescriptor
+        );
+
+        const int context_attribs[] = {
+            WGL_CONTEXT_MAJOR_VERSION_ARB,
+            3,
+            WGL_CONTEXT_MINOR_VERSION_ARB,
+            3,
+            WGL_CONTEXT_PROFILE_MASK_ARB,
+            WGL_CONTEXT_CORE_PROFILE_BIT_ARB,
+            0
+        };
+        win32Device.rc = wglCreateContextAttribsARB(hdc, NULL, context_attribs);
+        if (!win32Device.rc)
+        {
+            error = L"Failed to create OpenGL context";
+        }
     }
 
-    HGLRC fake_rc = wglCreateContext(fake_hdc);
-    if (!fake_rc)
+    wglMakeCurrent(NULL, NULL);
+    if (fake_rc)
+    {
+        wglDeleteContext(fake_rc);
+    }
+    ReleaseDC(fake_hwnd, fake_hdc);
+    DestroyWindow(fake_hwnd);
+    UnregisterClassW(FAKE_CLAS_NAME, hinstance);
+
+    if (!error && !wglMakeCurrent(hdc, win32Device.rc))
+    {
+        error = L"Failed to make OpenGL context current";
+    }
+    if (error)
+    {
+        MessageBoxW(NULL, error, L"Error", MB_ICONERROR);
+        if (win32Device.rc)
+        {
+            wglDeleteContext(win32Device.rc);
+        }
+        memset(&win32Device, 0, sizeof(Win32Device));
+        return false;
+    }
+
+#if defined(BIRCH_GL_LOADER_LIST) || defined(BIRCH_GL_LOADER_LAZY)
+    int glVersion = birchGlLoad(
+#if defined(BIRCH_GL_LOADER_LAZY)
+        BIRCH_GL_LOAD_LAZY,
+#else
+        BIRCH_GL_LOAD_LIST,
+#endif
+        win32GlLookup,
+        GetModuleHandleW(L"opengl32.dll")
+    );
+#else
+    int glVersion = gladLoaderLoadGL();
+#endif
+    if (!glVersion || !win32CreatePipeline())
     {
         MessageBoxW(
             NULL,
-            L"Failed to create fake OpenGL context",
+            glVersion ? L"Failed to create OpenGL resources"
+                      : L"Failed to load OpenGL",
             L"Error",
             MB_ICONERROR
         );
-        DestroyWindow(fake_hwnd);
-        UnregisterClassW(FAKE_CLAS_NAME, hinstance);
+        wglMakeCurrent(NULL, NULL);
+        wglDeleteContext(win32Device.rc);
+        memset(&win32Device, 0, sizeof(Win32Device));
+        return false;
+    }
+
+    win32Device.swapInterval =
+        (BOOL(WINAPI *)(int))wglGetProcAddress("wglSwapIntervalEXT");
+    if (win32Device.swapInterval)
+    {
+        win32Device.swapInterval(1);
+    }
+    return true;
+}
+
+static void win32DestroyDevice(void)
+{
+    glDeleteVertexArrays(1, &win32Device.vao);
+    glDeleteProgram(win32Device.program);
+    glDeleteProgram(win32Device.texturedProgram);
+    glDeleteProgram(win32Device.distanceFieldProgram);
+    wglMakeCurrent(NULL, NULL);
+    wglDeleteContext(win32Device.rc);
+    memset(&win32Device, 0, sizeof(Win32Device));
+}
+
+BirchWindow *
+birchWindowNew(unsigned int width, unsigned int height, const char *title)
+{
+    Win32Window *window = birchAllocateZeroed(1, sizeof(Win32Window));
+    if (!window)
+    {
         return NULL;
     }
 
-    if (!wglMakeCurrent(fake_hdc, fake_rc))
+    // todo transform points to pixels
+
+    if (!birchWindowInitBase(&window->base, width, height, title))
     {
-        MessageBoxW(
-            NULL,
-            L"Failed to make fake OpenGL context current",
-            L"Error",
-            MB_ICONERROR
-        );
-        DestroyWindow(fake_hwnd);
-        UnregisterClassW(FAKE_CLAS_NAME, hinstance);
-        wglDeleteContext(fake_rc);
+        birchFree(window);
         return NULL;
     }
+    window->hinstance = GetModuleHandle(NULL);
 
-    gladLoaderLoadWGL(fake_hdc);
-
-    const int pixel_attribs[] = {
-        WGL_DRAW_TO_WINDOW_ARB,
-        GL_TRUE,
-        WGL_SUPPORT_OPENGL_ARB,
-        GL_TRUE,
-        WGL_DOUBLE_BUFFER_ARB,
-        GL_TRUE,
-        WGL_PIXEL_TYPE_ARB,
-        WGL_TYPE_RGBA_ARB,
-        WGL_ACCELERATION_ARB,
-        WGL_FULL_ACCELERATION_ARB,
-        WGL_COLOR_BITS_ARB,
-        32,
-        WGL_ALPHA_BITS_ARB,
-        8,
-        WGL_DEPTH_BITS_ARB,
-        24,
-        WGL_STENCIL_BITS_ARB,
-        8,
-        WGL_SAMPLE_BUFFERS_ARB,
-        GL_TRUE,
-        WGL_SAMPLES_ARB,
-        4,
-        0
-    };
-    int pixel_format_id;
-    UINT num_formats;
-    bool status = wglChoosePixelFormatARB(
-        window->hdc,
-        pixel_attribs,
+    size_t title_len = strlen(title) + 1;
+    window->title_w = birchAllocate(title_len * sizeof(wchar_t));
+    if (!window->title_w)
+    {
+        birchWindowFree((BirchWindow *)window);
+        return NULL;
+    }
+    mbstowcs_s(NULL, window->title_w, title_len, title, title_len);
+
+    // The class is registered by birchInit
+    window->hwnd = CreateWindowExW(
+        0,
+        BIRCH_WIN32_CLASS_NAME,
+        window->title_w,
+        WS_OVERLAPPEDWINDOW,
+        CW_USEDEFAULT,
+        CW_USEDEFAULT,
+        width,
+        height,
         NULL,
-        1,
-        &pixel_format_id,
-        &num_formats
+        NULL,
+        window->hinstance,
+        window
     );
-    if (!status || num_formats == 0)
+    if (!window->hwnd)
     {
-        MessageBoxW(
-            NULL,
-            L"Failed to choose pixel format",
-            L"Error",
-            MB_ICONERROR
-        );
-        DestroyWindow(fake_hwnd);
-        UnregisterClassW(FAKE_CLAS_NAME, hinstance);
-        wglDeleteContext(fake_rc);
+        MessageBoxW(NULL, L"CreateWindowExW() failed", L"Error", MB_ICONERROR);
+        birchWindowFree((BirchWindow *)window);
         return NULL;
     }
 
-    PIXELFORMATDESCRIPTOR PFD;
-    DescribePixelFormat(window->hdc, pixel_format_id, sizeof(PFD), &PFD);
-    SetPixelFormat(window->hdc, pixel_format_id, &PFD);
-
-    const int context_attribs[] = {
-        WGL_CONTEXT_MAJOR_VERSION_ARB,
-        3,
-        WGL_CONTEXT_MINOR_VERSION_ARB,
-        3,
-        WGL_CONTEXT_PROFILE_MASK_ARB,
-        WGL_CONTEXT_CORE_PROFILE_BIT_ARB,
-        0
-    };
+    window->hdc = GetDC(window->hwnd);
+    ShowWindow(window->hwnd, SW_SHOWDEFAULT);
 
-    window->rc = wglCreateContextAttribsARB(window->hdc, NULL, context_attribs);
-    if (!window->rc)
+    // Other windows may be drawing on their render threads
+    birchMutexLock(&win32DeviceLock);
+    bool ready;
+    if (win32Device.windows)
     {
-        MessageBoxW(
-            NULL,
-            L"Failed to create OpenGL context",
-            L"Error",
-            MB_ICONERROR
+        ready = SetPixelFormat(
+            window->hdc,
+            win32Device.pixelFormat,
+            &win32Device.pixelFormatDescriptor
         );
-        DestroyWindow(fake_hwnd);
-        UnregisterClassW(FAKE_CLAS_NAME, hinstance);
-        wglDeleteContext(fake_rc);
+    }
+    else
+    {
+        ready = win32CreateDevice(window->hdc, window->hinstance);
+    }
+    if (ready)
+    {
+        win32Device.windows++;
+        window->hasGl = true;
+        window->vsync = win32Device.swapInterval != NULL;
+    }
+    birchMutexUnlock(&win32DeviceLock);
+    if (!ready)
+    {
+        birchWindowFree((BirchWindow *)window);
         return NULL;
     }
 
-    wglMakeCurrent(NULL, NULL);
-    wglDeleteContext(fake_rc);
-    DestroyWindow(fake_hwnd);
-    UnregisterClassW(FAKE_CLAS_NAME, hinstance);
-
-    if (!wglMakeCurrent(window->hdc, window->rc))
+    win32Acquire(window);
+    ready = birchStreamInit(
+        &window->base.state->stream,
+        &win32StreamBackend,
+        window,
+        BIRCH_STREAM_DEFAULT_CAPACITY
+    );
+    win32Release();
+    if (!ready)
     {
         MessageBoxW(
             NULL,
-            L"Failed to make OpenGL context current",
+            L"Failed to create OpenGL resources",
             L"Error",
             MB_ICONERROR
         );
+        birchWindowFree((BirchWindow *)window);
         return NULL;
     }
 
-    if (!gladLoaderLoadGL())
-    {
-        MessageBoxW(NULL, L"Failed to load OpenGL", L"Error", MB_ICONERROR);
-        return NULL;
-    }
-
-    window->hasGl = true;
-
     return (BirchWindow *)window;
 }
 
@@ -483,26 +1103,116 @@ void birchWindowFree(BirchWindow *window)
 {
     Win32Window *win32_window = (Win32Window *)window;
 
-    DestroyWindow(win32_window->hwnd);
-    UnregisterClassW(L"birch", win32_window->hinstance);
-    ReleaseDC(win32_window->hwnd, win32_window->hdc);
-    wglDeleteContext(win32_window->rc);
-    free(win32_window->title_w);
-    free(win32_window);
+    // The stream and atlas textures are deleted on the shared context,
+    // which the render thread would wait for
+    birchWindowSetRenderThread(window, 0);
+    if (win32_window->hasGl)
+    {
+        win32Acquire(win32_window);
+    }
+    birchWindowFreeBase(window);
+    if (win32_window->hasGl)
+    {
+        glDeleteTextures(BIRCH_ATLAS_MAX_PAGES, win32_window->textures);
+        if (--win32Device.windows == 0)
+        {
+            win32DestroyDevice();
+        }
+        win32Release();
+    }
+    if (win32_window->hwnd)
+    {
+        ReleaseDC(win32_window->hwnd, win32_window->hdc);
+        DestroyWindow(win32_window->hwnd);
+    }
+    birchFree(win32_window->title_w);
+    birchFree(win32_window);
 }
 
-void birchWindowUpdate(BirchWindow *window)
+// Every window of the process is on the thread's queue
+void birchPlatformPollEvents(void)
 {
-    Win32Window *win32_window = (Win32Window *)window;
-
     MSG msg;
-    while (PeekMessageW(&msg, win32_window->hwnd, 0, 0, PM_REMOVE))
+    while (PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE))
     {
         TranslateMessage(&msg);
         DispatchMessageW(&msg);
     }
+}
+
+void birchPlatformRender(BirchWindow *window)
+{
+    Win32Window *win32_window = (Win32Window *)window;
+
+    // The back buffer is undefined after a swap, so frames are redrawn in
+    // full or, when nothing changed, not at all
+    BIRCH_PROFILE_BEGIN(render, "render");
+    win32Acquire(win32_window);
+    BirchAtlas *atlas = &window->state->atlas;
+    birchMutexLock(&atlas->lock);
+    birchAtlasFlush(atlas, win32UploadAtlas, win32_window);
+    VertexUniforms uniforms = {
+        .pointsWide = window->width,
+        .pointsHigh = window->height,
+    };
+    bool changed = birchWindowFrameChanged(
+        window,
+        &uniforms,
+        (int)window->width,
+        (int)window->height
+    );
+    birchMutexUnlock(&atlas->lock);
+    if (changed)
+    {
+        win32Draw(win32_window);
+    }
+    BIRCH_PROFILE_END(render);
 
-    wglSwapLayerBuffers(win32_window->hdc, WGL_SWAP_MAIN_PLANE);
+    // A swap waiting for vsync keeps the context, so windows with vsync
+    // take turns
+    BIRCH_PROFILE_BEGIN(present, "present");
+    if (changed)
+    {
+        wglSwapLayerBuffers(win32_window->hdc, WGL_SWAP_MAIN_PLANE);
+    }
+    win32Release();
+    if (!changed && win32_window->vsync)
+    {
+        // Keep the pace a swap would have set
+        DwmFlush();
+    }
+    BIRCH_PROFILE_END(present);
+}
+
+bool birchWindowWaitEvents(BirchWindow *window, double timeout)
+{
+    // Waits of INFINITE milliseconds or more do not fit a DWORD, and
+    // would be about as long
+    double rounded = timeout * 1000 + 0.5;
+    DWORD milliseconds =
+        timeout >= 0 && rounded < INFINITE ? (DWORD)rounded : INFINITE;
+
+    // Returns as soon as a message is queued, without removing it
+    return MsgWaitForMultipleObjectsEx(
+               0,
+               NULL,
+               milliseconds,
+               QS_ALLINPUT,
+               MWMO_INPUTAVAILABLE
+           ) == WAIT_OBJECT_0;
+}
+
+void birchWindowSetVsync(BirchWindow *window, bool vsync)
+{
+    Win32Window *win32_window = (Win32Window *)window;
+
+    // Applied when the window next takes the context
+    if (win32Device.swapInterval)
+    {
+        birchWindowLockRender(window);
+        win32_window->vsync = vsync;
+        birchWindowUnlockRender(window);
+    }
 }
 
 bool birchWindowShouldClose(BirchWindow *window)
@@ -0,0 +1,41 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "initInternal.h"
+#include "xcbInternal.h"
+
+static const char *xcbName = "birch";
+
+void birchPlatformInit(const char *name)
+{
+    if (name)
+    {
+        xcbName = name;
+    }
+}
+
+void birchPlatformTerminate(void)
+{
+    xcbName = "birch";
+}
+
+const char *xcbApplicationName(void)
+{
+    return xcbName;
+}
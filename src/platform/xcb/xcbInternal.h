@@ -1,33 +1,24 @@
 // Copyright (C) 2024 Devin Rockwell
-// 
+//
 // This file is part of birch.
-// 
+//
 // birch is free software: you can redistribute it and/or modify
 // it under the terms of the GNU General Public License as published by
 // the Free Software Foundation, either version 3 of the License, or
 // (at your option) any later version.
-// 
+//
 // birch is distributed in the hope that it will be useful,
 // but WITHOUT ANY WARRANTY; without even the implied warranty of
 // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
 // GNU General Public License for more details.
-// 
+//
 // You should have received a copy of the GNU General Public License
 // along with birch.  If not, see <http://www.gnu.org/licenses/>.
 
-#ifndef BIRCH_MACOS_SHADERTYPES_H
-#define BIRCH_MACOS_SHADERTYPES_H
+#ifndef BIRCH_XCB_INTERNAL_H
+#define BIRCH_XCB_INTERNAL_H
 
-#include <simd/simd.h>
-
-typedef struct {
-    vector_float2 position;
-    vector_float4 color;
-} Vertex;
-
-typedef struct {
-    float pointsWide;
-    float pointsHigh;
-} VertexUniforms;
+/// @brief The name given to birchInit, used as the window class
+const char *xcbApplicationName(void);
 
 #endif
@@ -0,0 +1,1290 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "clock.h"
+#include "heap.h"
+#include "initInternal.h"
+#include "profile.h"
+#include "raster.h"
+#include "tiler.h"
+#include "window.h"
+#include "windowInternal.h"
+#include "xcb.h"
+#include "xcbInternal.h"
+#include <limits.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <xcb/shm.h>
+#include <xcb/xcb.h>
+#include <xcb/xcbext.h>
+
+// Frames in flight with MIT-SHM: the server reads one segment while birch
+// renders into the other
+#define XCB_BUFFER_COUNT 2
+
+// Refresh rate of the simulated display, the core protocol has no vblank
+#define XCB_VSYNC_PERIOD (1000000000 / 60)
+
+typedef struct
+{
+    uint32_t *pixels;
+    // 0 for memory that is not shared with the server
+    xcb_shm_seg_t segment;
+    // presented and not yet released by the server. A GetInputFocus follows
+    // every frame presented from a segment, its reply means the server has
+    // processed the images.
+    // Unlike ShmCompletion events, replies can be waited for on a render
+    // thread without taking events from the updating thread.
+    bool busy;
+    xcb_get_input_focus_cookie_t fence;
+    uint64_t sent;
+    // the tiles of the frame it holds
+    BirchTileCache tiles;
+} XcbBuffer;
+
+typedef struct XcbWindow
+{
+    BirchWindow base;
+    // the next window on the connection
+    struct XcbWindow *next;
+    xcb_connection_t *connection;
+    xcb_window_t window;
+    xcb_gcontext_t gc;
+    // cleared when the server cannot attach this window's segments
+    bool sharedMemory;
+    XcbBuffer buffers[XCB_BUFFER_COUNT];
+    // bytes of every buffer, more than the window needs after a resize
+    size_t bufferCapacity;
+    unsigned int current;
+    unsigned int pixelWidth;
+    unsigned int pixelHeight;
+    // the tiles on screen, and rows of damage copied out for xcb_put_image
+    BirchTileCache shown;
+    uint32_t *scratch;
+    size_t scratchCapacity;
+    BirchTiler tiler;
+    bool shouldClose;
+    bool vsync;
+    BirchXcbPresentStats stats;
+    uint64_t latencyTotal;
+    uint64_t latencySamples;
+    // Frames presented with xcb_put_image need no fence. One of them at a
+    // time is followed by a GetInputFocus anyway, whose reply is polled for
+    // to measure their latency without rendering waiting on it.
+    bool probing;
+    xcb_get_input_focus_cookie_t probe;
+    uint64_t probeSent;
+} XcbWindow;
+
+// One connection for every window of the process, opened with the first
+// window and closed with the last. Windows are created, updated and freed
+// on one thread.
+typedef struct
+{
+    xcb_connection_t *connection;
+    xcb_screen_t *screen;
+    uint8_t depth;
+    bool bgra;
+    bool sharedMemory;
+    size_t maxRequestBytes;
+    xcb_atom_t wmProtocols;
+    xcb_atom_t wmDeleteWindow;
+    xcb_atom_t netWmName;
+    xcb_atom_t utf8String;
+    int keycodes[256];
+    // server timestamps converted to the birchClockNow clock
+    BirchEventClock clock;
+    // read by birchWindowWaitEvents, handled by the next pump
+    xcb_generic_event_t *peeked;
+    // every window, newest first
+    XcbWindow *windows;
+} XcbDisplay;
+
+static XcbDisplay xcbDisplay;
+
+// Keysyms 0xff00 to 0xffff: TTY, cursor, keypad, function and modifier keys
+static const int xcbFunctionKeys[256] = {
+    [0x08] = BIRCH_KEY_BACKSPACE,
+    [0x09] = BIRCH_KEY_TAB,
+    [0x0d] = BIRCH_KEY_ENTER,
+    [0x13] = BIRCH_KEY_PAUSE,
+    [0x14] = BIRCH_KEY_SCROLL_LOCK,
+    [0x1b] = BIRCH_KEY_ESCAPE,
+    [0x50] = BIRCH_KEY_HOME,
+    [0x51] = BIRCH_KEY_LEFT,
+    [0x52] = BIRCH_KEY_UP,
+    [0x53] = BIRCH_KEY_RIGHT,
+    [0x54] = BIRCH_KEY_DOWN,
+    [0x55] = BIRCH_KEY_PAGE_UP,
+    [0x56] = BIRCH_KEY_PAGE_DOWN,
+    [0x57] = BIRCH_KEY_END,
+    [0x61] = BIRCH_KEY_PRINT_SCREEN,
+    [0x63] = BIRCH_KEY_INSERT,
+    [0x67] = BIRCH_KEY_MENU,
+    [0x7f] = BIRCH_KEY_NUM_LOCK,
+    [0x8d] = BIRCH_KEY_KP_ENTER,
+    [0xaa] = BIRCH_KEY_KP_MULTIPLY,
+    [0xab] = BIRCH_KEY_KP_ADD,
+    [0xad] = BIRCH_KEY_KP_SUBTRACT,
+    [0xae] = BIRCH_KEY_KP_DECIMAL,
+    [0xaf] = BIRCH_KEY_KP_DIVIDE,
+    [0xb0] = BIRCH_KEY_KP_0,
+    [0xb1] = BIRCH_KEY_KP_1,
+    [0xb2] = BIRCH_KEY_KP_2,
+    [0xb3] = BIRCH_KEY_KP_3,
+    [0xb4] = BIRCH_KEY_KP_4,
+    [0xb5] = BIRCH_KEY_KP_5,
+    [0xb6] = BIRCH_KEY_KP_6,
+    [0xb7] = BIRCH_KEY_KP_7,
+    [0xb8] = BIRCH_KEY_KP_8,
+    [0xb9] = BIRCH_KEY_KP_9,
+    [0xbd] = BIRCH_KEY_KP_EQUAL,
+    [0xbe] = BIRCH_KEY_F1,
+    [0xbf] = BIRCH_KEY_F2,
+    [0xc0] = BIRCH_KEY_F3,
+    [0xc1] = BIRCH_KEY_F4,
+    [0xc2] = BIRCH_KEY_F5,
+    [0xc3] = BIRCH_KEY_F6,
+    [0xc4] = BIRCH_KEY_F7,
+    [0xc5] = BIRCH_KEY_F8,
+    [0xc6] = BIRCH_KEY_F9,
+    [0xc7] = BIRCH_KEY_F10,
+    [0xc8] = BIRCH_KEY_F11,
+    [0xc9] = BIRCH_KEY_F12,
+    [0xca] = BIRCH_KEY_F13,
+    [0xcb] = BIRCH_KEY_F14,
+    [0xcc] = BIRCH_KEY_F15,
+    [0xcd] = BIRCH_KEY_F16,
+    [0xce] = BIRCH_KEY_F17,
+    [0xcf] = BIRCH_KEY_F18,
+    [0xd0] = BIRCH_KEY_F19,
+    [0xd1] = BIRCH_KEY_F20,
+    [0xd2] = BIRCH_KEY_F21,
+    [0xd3] = BIRCH_KEY_F22,
+    [0xd4] = BIRCH_KEY_F23,
+    [0xd5] = BIRCH_KEY_F24,
+    [0xd6] = BIRCH_KEY_F25,
+    [0xe1] = BIRCH_KEY_LEFT_SHIFT,
+    [0xe2] = BIRCH_KEY_RIGHT_SHIFT,
+    [0xe3] = BIRCH_KEY_LEFT_CONTROL,
+    [0xe4] = BIRCH_KEY_RIGHT_CONTROL,
+    [0xe5] = BIRCH_KEY_CAPS_LOCK,
+    [0xe9] = BIRCH_KEY_LEFT_ALT,
+    [0xea] = BIRCH_KEY_RIGHT_ALT,
+    [0xeb] = BIRCH_KEY_LEFT_SUPER,
+    [0xec] = BIRCH_KEY_RIGHT_SUPER,
+    [0xff] = BIRCH_KEY_DELETE,
+};
+
+static int xcbTranslateKeysym(xcb_keysym_t keysym)
+{
+    // Latin-1 keysyms are their character, the BIRCH_KEY_* codes of
+    // printable keys are the unshifted US character too
+    if (keysym >= 'a' && keysym <= 'z')
+    {
+        return BIRCH_KEY_A + (keysym - 'a');
+    }
+    if ((keysym >= '0' && keysym <= '9') || keysym == ' ' ||
+        keysym == '\'' || (keysym >= ',' && keysym <= '/') || keysym == ';' ||
+        keysym == '=' || (keysym >= '[' && keysym <= ']') || keysym == '`')
+    {
+        return (int)keysym;
+    }
+    if ((keysym & 0xff00) == 0xff00 && xcbFunctionKeys[keysym & 0xff])
+    {
+        return xcbFunctionKeys[keysym & 0xff];
+    }
+    return BIRCH_KEY_UNKNOWN;
+}
+
+static bool xcbLoadKeymap(void)
+{
+    xcb_connection_t *connection = xcbDisplay.connection;
+    const xcb_setup_t *setup = xcb_get_setup(connection);
+    uint8_t count = setup->max_keycode - setup->min_keycode + 1;
+
+    for (int i = 0; i < 256; i++)
+    {
+        xcbDisplay.keycodes[i] = BIRCH_KEY_UNKNOWN;
+    }
+
+    xcb_get_keyboard_mapping_reply_t *reply = xcb_get_keyboard_mapping_reply(
+        connection,
+        xcb_get_keyboard_mapping(
+            connection,
+            setup->min_keycode,
+            count
+        ),
+        NULL
+    );
+    if (!reply)
+    {
+        return false;
+    }
+
+    const xcb_keysym_t *keysyms = xcb_get_keyboard_mapping_keysyms(reply);
+    int perKeycode = reply->keysyms_per_keycode;
+    for (int i = 0; i < count && perKeycode > 0; i++)
+    {
+        const xcb_keysym_t *symbols = keysyms + i * perKeycode;
+
+        // Keypad keys are named by their Num Lock symbol, the second one
+        xcb_keysym_t keysym = symbols[0];
+        if (perKeycode > 1 && symbols[1] >= 0xff80 && symbols[1] <= 0xffbd)
+        {
+            keysym = symbols[1];
+        }
+        xcbDisplay.keycodes[setup->min_keycode + i] =
+            xcbTranslateKeysym(keysym);
+    }
+    free(reply);
+    return true;
+}
+
+static int xcbTranslateButton(xcb_button_t button)
+{
+    switch (button)
+    {
+    case 1:
+        return BIRCH_MOUSE_BUTTON_LEFT;
+    case 2:
+        return BIRCH_MOUSE_BUTTON_MIDDLE;
+    case 3:
+        return BIRCH_MOUSE_BUTTON_RIGHT;
+    case 8:
+        return BIRCH_MOUSE_BUTTON_4;
+    case 9:
+        return BIRCH_MOUSE_BUTTON_5;
+    default:
+        // 4 to 7 are the scroll wheel
+        return -1;
+    }
+}
+
+static void *xcbStreamAllocate(void *context, size_t size)
+{
+    return birchAllocate(size);
+}
+
+static void xcbStreamRelease(void *context, void *data)
+{
+    birchFree(data);
+}
+
+// Frames are rendered on the CPU before birchWindowUpdate returns, so
+// vertex memory retires immediately
+static const BirchStreamBackend xcbStreamBackend = {
+    .allocate = xcbStreamAllocate,
+    .release = xcbStreamRelease,
+};
+
+static void xcbBufferRelease(XcbWindow *window, XcbBuffer *buffer)
+{
+    if (buffer->busy)
+    {
+        xcb_discard_reply(window->connection, buffer->fence.sequence);
+    }
+    if (buffer->segment)
+    {
+        // The server handles requests in order, so it is done with every
+        // image of the segment by the time it detaches
+        xcb_shm_detach(window->connection, buffer->segment);
+        shmdt(buffer->pixels);
+    }
+    else
+    {
+        birchFree(buffer->pixels);
+    }
+    birchTileCacheRelease(&buffer->tiles);
+    memset(buffer, 0, sizeof(XcbBuffer));
+}
+
+static bool xcbBufferAttach(XcbWindow *window, XcbBuffer *buffer, size_t size)
+{
+    int id = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+    if (id < 0)
+    {
+        return false;
+    }
+
+    void *pixels = shmat(id, NULL, 0);
+    xcb_generic_error_t *error = NULL;
+    xcb_shm_seg_t segment = xcb_generate_id(window->connection);
+    if (pixels != (void *)-1)
+    {
+        error = xcb_request_check(
+            window->connection,
+            xcb_shm_attach_checked(window->connection, segment, id, 0)
+        );
+    }
+
+    // Destroyed once both sides have detached
+    shmctl(id, IPC_RMID, NULL);
+    if (pixels == (void *)-1)
+    {
+        return false;
+    }
+    if (error)
+    {
+        free(error);
+        shmdt(pixels);
+        return false;
+    }
+
+    buffer->pixels = pixels;
+    buffer->segment = segment;
+    return true;
+}
+
+static bool
+xcbResizeBuffers(XcbWindow *window, unsigned int width, unsigned int height)
+{
+    size_t size = (size_t)width * height * 4;
+    size_t capacity = birchHeapCapacity(window->bufferCapacity, size);
+
+    // The rows moved, redraw and present everything
+    birchTileCacheInvalidate(&window->shown);
+    if (window->buffers[0].pixels && capacity == window->bufferCapacity)
+    {
+        for (int i = 0; i < XCB_BUFFER_COUNT; i++)
+        {
+            birchTileCacheInvalidate(&window->buffers[i].tiles);
+        }
+        window->pixelWidth = width;
+        window->pixelHeight = height;
+        return true;
+    }
+
+    for (int i = 0; i < XCB_BUFFER_COUNT; i++)
+    {
+        xcbBufferRelease(window, &window->buffers[i]);
+    }
+    window->current = 0;
+    window->pixelWidth = 0;
+    window->pixelHeight = 0;
+    window->bufferCapacity = 0;
+
+    if (window->sharedMemory)
+    {
+        bool attached = true;
+        for (int i = 0; i < XCB_BUFFER_COUNT && attached; i++)
+        {
+            attached =
+                xcbBufferAttach(window, &window->buffers[i], capacity);
+        }
+        if (!attached)
+        {
+            // The server cannot reach our memory, e.g. from another
+            // container. Stop trying.
+            for (int i = 0; i < XCB_BUFFER_COUNT; i++)
+            {
+                xcbBufferRelease(window, &window->buffers[i]);
+            }
+            window->sharedMemory = false;
+        }
+    }
+    if (!window->sharedMemory)
+    {
+        window->buffers[0].pixels = birchAllocate(capacity);
+        if (!window->buffers[0].pixels)
+        {
+            return false;
+        }
+    }
+
+    window->bufferCapacity = capacity;
+    window->pixelWidth = width;
+    window->pixelHeight = height;
+    return true;
+}
+
+static void xcbRecordLatency(XcbWindow *window, uint64_t sent)
+{
+    window->latencyTotal += birchClockNow() - sent;
+    window->latencySamples++;
+}
+
+// The window an event is about, XCB_WINDOW_NONE for the rest
+static xcb_window_t xcbEventWindow(const xcb_generic_event_t *event)
+{
+    switch (event->response_type & 0x7f)
+    {
+    case XCB_KEY_PRESS:
+    case XCB_KEY_RELEASE:
+    case XCB_BUTTON_PRESS:
+    case XCB_BUTTON_RELEASE:
+    case XCB_MOTION_NOTIFY:
+        // All laid out like a key press
+        return ((const xcb_key_press_event_t *)event)->event;
+    case XCB_CONFIGURE_NOTIFY:
+        return ((const xcb_configure_notify_event_t *)event)->window;
+    case XCB_EXPOSE:
+        return ((const xcb_expose_event_t *)event)->window;
+    case XCB_CLIENT_MESSAGE:
+        return ((const xcb_client_message_event_t *)event)->window;
+    default:
+        return XCB_WINDOW_NONE;
+    }
+}
+
+static void xcbHandleEvent(xcb_generic_event_t *event)
+{
+    uint8_t type = event->response_type & 0x7f;
+
+    // Processes have a handful of windows, a list is fast enough
+    xcb_window_t id = xcbEventWindow(event);
+    XcbWindow *window = xcbDisplay.windows;
+    while (window && window->window != id)
+    {
+        window = window->next;
+    }
+    if (!window)
+    {
+        return;
+    }
+
+    switch (type)
+    {
+    case XCB_KEY_PRESS:
+    {
+        xcb_key_press_event_t *key = (xcb_key_press_event_t *)event;
+        birchWindowDispatchKeyPressed(
+            &window->base,
+            xcbDisplay.keycodes[key->detail],
+            birchEventClockConvert(&xcbDisplay.clock, key->time)
+        );
+        break;
+    }
+    case XCB_KEY_RELEASE:
+    {
+        xcb_key_release_event_t *key = (xcb_key_release_event_t *)event;
+        birchWindowDispatchKeyReleased(
+            &window->base,
+            xcbDisplay.keycodes[key->detail],
+            birchEventClockConvert(&xcbDisplay.clock, key->time)
+        );
+        break;
+    }
+    case XCB_BUTTON_PRESS:
+    {
+        xcb_button_press_event_t *press = (xcb_button_press_event_t *)event;
+        int button = xcbTranslateButton(press->detail);
+        if (button >= 0)
+        {
+            birchWindowDispatchMouseButtonPressed(
+                &window->base,
+                button,
+                birchEventClockConvert(&xcbDisplay.clock, press->time)
+            );
+        }
+        break;
+    }
+    case XCB_BUTTON_RELEASE:
+    {
+        xcb_button_release_event_t *release =
+            (xcb_button_release_event_t *)event;
+        int button = xcbTranslateButton(release->detail);
+        if (button >= 0)
+        {
+            birchWindowDispatchMouseButtonReleased(
+                &window->base,
+                button,
+                birchEventClockConvert(&xcbDisplay.clock, release->time)
+            );
+        }
+        break;
+    }
+    case XCB_MOTION_NOTIFY:
+    {
+        xcb_motion_notify_event_t *motion =
+            (xcb_motion_notify_event_t *)event;
+        birchWindowDispatchMouseMoved(
+            &window->base,
+            motion->event_x,
+            window->base.height - motion->event_y,
+            birchEventClockConvert(&xcbDisplay.clock, motion->time)
+        );
+        break;
+    }
+    case XCB_CONFIGURE_NOTIFY:
+    {
+        xcb_configure_notify_event_t *configure =
+            (xcb_configure_notify_event_t *)event;
+        if (configure->width != window->base.width ||
+            configure->height != window->base.height)
+        {
+            birchWindowLockRender(&window->base);
+            window->base.width = configure->width;
+            window->base.height = configure->height;
+            birchWindowUnlockRender(&window->base);
+            birchWindowDispatchResize(
+                &window->base,
+                configure->width,
+                configure->height,
+                birchClockNow()
+            );
+        }
+        break;
+    }
+    case XCB_EXPOSE:
+        // The server lost part of the window, present all of it again
+        birchWindowLockRender(&window->base);
+        birchTileCacheInvalidate(&window->shown);
+        birchWindowUnlockRender(&window->base);
+        break;
+    case XCB_CLIENT_MESSAGE:
+    {
+        xcb_client_message_event_t *message =
+            (xcb_client_message_event_t *)event;
+        if (message->data.data32[0] == xcbDisplay.wmDeleteWindow)
+        {
+            window->shouldClose = true;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+// Notice the buffers the server is done with, blocking for `wait` if it is
+// still busy
+static void xcbReleaseBuffers(XcbWindow *window, XcbBuffer *wait)
+{
+    for (int i = 0; i < XCB_BUFFER_COUNT; i++)
+    {
+        XcbBuffer *buffer = &window->buffers[i];
+        if (!buffer->busy)
+        {
+            continue;
+        }
+
+        void *reply = NULL;
+        xcb_generic_error_t *error = NULL;
+        if (buffer == wait)
+        {
+            // NULL if the connection broke, the pump closes the window
+            reply = xcb_get_input_focus_reply(
+                window->connection,
+                buffer->fence,
+                NULL
+            );
+        }
+        else if (!xcb_poll_for_reply(
+                     window->connection,
+                     buffer->fence.sequence,
+                     &reply,
+                     &error
+                 ))
+        {
+            continue;
+        }
+        free(reply);
+        free(error);
+        buffer->busy = false;
+        xcbRecordLatency(window, buffer->sent);
+    }
+
+    void *reply = NULL;
+    xcb_generic_error_t *error = NULL;
+    if (window->probing &&
+        xcb_poll_for_reply(
+            window->connection,
+            window->probe.sequence,
+            &reply,
+            &error
+        ))
+    {
+        free(reply);
+        free(error);
+        window->probing = false;
+        xcbRecordLatency(window, window->probeSent);
+    }
+}
+
+static xcb_atom_t xcbAtom(xcb_connection_t *connection, const char *name)
+{
+    xcb_intern_atom_reply_t *reply = xcb_intern_atom_reply(
+        connection,
+        xcb_intern_atom(connection, 0, strlen(name), name),
+        NULL
+    );
+    xcb_atom_t atom = reply ? reply->atom : XCB_ATOM_NONE;
+    free(reply);
+    return atom;
+}
+
+// Find how the root visual lays out pixels. Only 32 bits per pixel, least
+// significant byte first layouts that the rasterizer can write directly are
+// supported, which covers the visuals of every common X server.
+static bool xcbChooseFormat(int screenNumber)
+{
+    const xcb_setup_t *setup = xcb_get_setup(xcbDisplay.connection);
+    if (setup->image_byte_order != XCB_IMAGE_ORDER_LSB_FIRST)
+    {
+        return false;
+    }
+
+    xcb_screen_iterator_t screens = xcb_setup_roots_iterator(setup);
+    for (int i = 0; i < screenNumber && screens.rem; i++)
+    {
+        xcb_screen_next(&screens);
+    }
+    if (!screens.rem)
+    {
+        return false;
+    }
+    xcbDisplay.screen = screens.data;
+    xcbDisplay.depth = xcbDisplay.screen->root_depth;
+
+    bool bits32 = false;
+    xcb_format_iterator_t formats = xcb_setup_pixmap_formats_iterator(setup);
+    for (; formats.rem; xcb_format_next(&formats))
+    {
+        if (formats.data->depth == xcbDisplay.depth)
+        {
+            bits32 = formats.data->bits_per_pixel == 32;
+        }
+    }
+    if (!bits32)
+    {
+        return false;
+    }
+
+    xcb_depth_iterator_t depths =
+        xcb_screen_allowed_depths_iterator(xcbDisplay.screen);
+    for (; depths.rem; xcb_depth_next(&depths))
+    {
+        xcb_visualtype_iterator_t visuals =
+            xcb_depth_visuals_iterator(depths.data);
+        for (; visuals.rem; xcb_visualtype_next(&visuals))
+        {
+            xcb_visualtype_t *visual = visuals.data;
+            if (visual->visual_id != xcbDisplay.screen->root_visual)
+            {
+                continue;
+            }
+            if (visual->red_mask == 0xff0000 && visual->green_mask == 0xff00 &&
+                visual->blue_mask == 0xff)
+            {
+                xcbDisplay.bgra = true;
+                return true;
+            }
+            if (visual->red_mask == 0xff && visual->green_mask == 0xff00 &&
+                visual->blue_mask == 0xff0000)
+            {
+                xcbDisplay.bgra = false;
+                return true;
+            }
+            return false;
+        }
+    }
+    return false;
+}
+
+static void xcbQuerySharedMemory(void)
+{
+    const char *enabled = getenv("BIRCH_XCB_SHM");
+    if (enabled && strcmp(enabled, "0") == 0)
+    {
+        return;
+    }
+
+    const xcb_query_extension_reply_t *extension =
+        xcb_get_extension_data(xcbDisplay.connection, &xcb_shm_id);
+    if (!extension || !extension->present)
+    {
+        return;
+    }
+
+    xcb_shm_query_version_reply_t *version = xcb_shm_query_version_reply(
+        xcbDisplay.connection,
+        xcb_shm_query_version(xcbDisplay.connection),
+        NULL
+    );
+    if (version)
+    {
+        xcbDisplay.sharedMemory = true;
+    }
+    free(version);
+}
+
+static void xcbCloseDisplay(void)
+{
+    if (xcbDisplay.connection)
+    {
+        // xcb_disconnect drops requests that are still buffered
+        xcb_flush(xcbDisplay.connection);
+        xcb_disconnect(xcbDisplay.connection);
+    }
+    free(xcbDisplay.peeked);
+    memset(&xcbDisplay, 0, sizeof(XcbDisplay));
+}
+
+// Connect and look up everything the windows share, once
+static bool xcbOpenDisplay(void)
+{
+    int screenNumber = 0;
+    xcbDisplay.connection = xcb_connect(NULL, &screenNumber);
+    xcb_connection_t *connection = xcbDisplay.connection;
+    if (xcb_connection_has_error(connection) ||
+        !xcbChooseFormat(screenNumber) || !xcbLoadKeymap())
+    {
+        xcbCloseDisplay();
+        return false;
+    }
+
+    xcbQuerySharedMemory();
+    xcbDisplay.maxRequestBytes =
+        (size_t)xcb_get_maximum_request_length(connection) * 4;
+    xcbDisplay.wmProtocols = xcbAtom(connection, "WM_PROTOCOLS");
+    xcbDisplay.wmDeleteWindow = xcbAtom(connection, "WM_DELETE_WINDOW");
+    xcbDisplay.netWmName = xcbAtom(connection, "_NET_WM_NAME");
+    xcbDisplay.utf8String = xcbAtom(connection, "UTF8_STRING");
+    return true;
+}
+
+static bool xcbCreateWindow(
+    XcbWindow *window,
+    unsigned int width,
+    unsigned int height,
+    const char *title
+)
+{
+    xcb_connection_t *connection = window->connection;
+
+    window->window = xcb_generate_id(connection);
+    uint32_t events = XCB_EVENT_MASK_KEY_PRESS | XCB_EVENT_MASK_KEY_RELEASE |
+                      XCB_EVENT_MASK_BUTTON_PRESS |
+                      XCB_EVENT_MASK_BUTTON_RELEASE |
+                      XCB_EVENT_MASK_POINTER_MOTION |
+                      XCB_EVENT_MASK_EXPOSURE |
+                      XCB_EVENT_MASK_STRUCTURE_NOTIFY;
+    xcb_create_window(
+        connection,
+        xcbDisplay.depth,
+        window->window,
+        xcbDisplay.screen->root,
+        0,
+        0,
+        width,
+        height,
+        0,
+        XCB_WINDOW_CLASS_INPUT_OUTPUT,
+        xcbDisplay.screen->root_visual,
+        XCB_CW_EVENT_MASK,
+        &events
+    );
+
+    // No NoExpose events for every image
+    uint32_t exposures = 0;
+    window->gc = xcb_generate_id(connection);
+    xcb_create_gc(
+        connection,
+        window->gc,
+        window->window,
+        XCB_GC_GRAPHICS_EXPOSURES,
+        &exposures
+    );
+
+    xcb_change_property(
+        connection,
+        XCB_PROP_MODE_REPLACE,
+        window->window,
+        xcbDisplay.wmProtocols,
+        XCB_ATOM_ATOM,
+        32,
+        1,
+        &xcbDisplay.wmDeleteWindow
+    );
+    xcb_change_property(
+        connection,
+        XCB_PROP_MODE_REPLACE,
+        window->window,
+        xcbDisplay.netWmName,
+        xcbDisplay.utf8String,
+        8,
+        strlen(title),
+        title
+    );
+    xcb_change_property(
+        connection,
+        XCB_PROP_MODE_REPLACE,
+        window->window,
+        XCB_ATOM_WM_NAME,
+        XCB_ATOM_STRING,
+        8,
+        strlen(title),
+        title
+    );
+
+    // Instance and class name, both NUL terminated
+    const char *name = xcbApplicationName();
+    size_t nameLength = strlen(name) + 1;
+    char *windowClass = birchAllocate(nameLength * 2);
+    if (windowClass)
+    {
+        memcpy(windowClass, name, nameLength);
+        memcpy(windowClass + nameLength, name, nameLength);
+        xcb_change_property(
+            connection,
+            XCB_PROP_MODE_REPLACE,
+            window->window,
+            XCB_ATOM_WM_CLASS,
+            XCB_ATOM_STRING,
+            8,
+            nameLength * 2,
+            windowClass
+        );
+        birchFree(windowClass);
+    }
+
+    window->sharedMemory = xcbDisplay.sharedMemory;
+    if (!xcbResizeBuffers(window, width, height))
+    {
+        return false;
+    }
+
+    xcb_map_window(connection, window->window);
+    xcb_flush(connection);
+    return !xcb_connection_has_error(connection);
+}
+
+BirchWindow *
+birchWindowNew(unsigned int width, unsigned int height, const char *title)
+{
+    XcbWindow *window = birchAllocateZeroed(1, sizeof(XcbWindow));
+    if (!window)
+    {
+        return NULL;
+    }
+
+    if (!birchWindowInitBase(&window->base, width, height, title))
+    {
+        birchFree(window);
+        return NULL;
+    }
+    birchRasterInit();
+
+    if (!xcbDisplay.connection && !xcbOpenDisplay())
+    {
+        birchWindowFreeBase(&window->base);
+        birchFree(window);
+        return NULL;
+    }
+    window->connection = xcbDisplay.connection;
+    window->next = xcbDisplay.windows;
+    xcbDisplay.windows = window;
+
+    if (!xcbCreateWindow(window, width, height, title) ||
+        !birchStreamInit(
+            &window->base.state->stream,
+            &xcbStreamBackend,
+            window,
+            BIRCH_STREAM_DEFAULT_CAPACITY
+        ))
+    {
+        birchWindowFree((BirchWindow *)window);
+        return NULL;
+    }
+
+    return (BirchWindow *)window;
+}
+
+void birchWindowFree(BirchWindow *window)
+{
+    XcbWindow *xcbWindow = (XcbWindow *)window;
+
+    XcbWindow **link = &xcbDisplay.windows;
+    while (*link && *link != xcbWindow)
+    {
+        link = &(*link)->next;
+    }
+    if (*link)
+    {
+        *link = xcbWindow->next;
+    }
+
+    birchWindowFreeBase(window);
+    birchTilerRelease(&xcbWindow->tiler);
+    birchTileCacheRelease(&xcbWindow->shown);
+    birchFree(xcbWindow->scratch);
+    for (int i = 0; i < XCB_BUFFER_COUNT; i++)
+    {
+        xcbBufferRelease(xcbWindow, &xcbWindow->buffers[i]);
+    }
+    if (xcbWindow->probing)
+    {
+        xcb_discard_reply(xcbWindow->connection, xcbWindow->probe.sequence);
+    }
+    if (xcbWindow->gc)
+    {
+        xcb_free_gc(xcbWindow->connection, xcbWindow->gc);
+    }
+    if (xcbWindow->window)
+    {
+        xcb_destroy_window(xcbWindow->connection, xcbWindow->window);
+    }
+    if (xcbDisplay.windows)
+    {
+        xcb_flush(xcbWindow->connection);
+    }
+    else
+    {
+        xcbCloseDisplay();
+    }
+    birchFree(xcbWindow);
+}
+
+static void xcbRender(XcbWindow *window)
+{
+    BirchWindow *base = &window->base;
+    unsigned int width = base->width > 1 ? (unsigned int)base->width : 1;
+    unsigned int height = base->height > 1 ? (unsigned int)base->height : 1;
+
+    base->state->damage.count = 0;
+    if ((width != window->pixelWidth || height != window->pixelHeight) &&
+        !xcbResizeBuffers(window, width, height))
+    {
+        return;
+    }
+
+    XcbBuffer *buffer = &window->buffers[window->current];
+    BirchRasterTarget target = {
+        .pixels = buffer->pixels,
+        .width = width,
+        .height = height,
+        .stride = width,
+        .bgra = xcbDisplay.bgra,
+    };
+
+    BirchDrawList *list = &base->state->submitted;
+    size_t vertexBytes = list->vertexCount * sizeof(Vertex);
+    BirchStream *stream = &base->state->stream;
+    birchStreamBeginFrame(stream, vertexBytes);
+
+    size_t vertexOffset;
+    Vertex *vertices =
+        birchStreamAlloc(stream, vertexBytes, 16, &vertexOffset);
+    if (vertices)
+    {
+        birchWindowFlattenDraws(base, vertices);
+        // The rasterizer samples the atlas pages directly
+        BirchAtlas *atlas = &base->state->atlas;
+        birchMutexLock(&atlas->lock);
+        birchAtlasFlush(atlas, NULL, NULL);
+
+        VertexUniforms uniforms = {
+            .pointsWide = base->width,
+            .pointsHigh = base->height,
+        };
+        // The buffer may be a frame behind the screen, so what has to be
+        // redrawn can be more than what has to be presented
+        bool drawn = birchTilerRender(
+            &window->tiler,
+            birchGetThreadPool(),
+            &target,
+            &buffer->tiles,
+            vertices,
+            list->vertexCount,
+            list->calls,
+            list->callCount,
+            atlas->textures,
+            &uniforms
+        );
+        birchMutexUnlock(&atlas->lock);
+        if (drawn)
+        {
+            birchDamageCollect(
+                &base->state->damage,
+                &window->shown,
+                &window->tiler,
+                target.width,
+                target.height
+            );
+        }
+    }
+    birchStreamEndFrame(stream);
+}
+
+// Copy the rows of a rectangle out of the buffer, xcb_put_image needs them
+// contiguous
+static const uint8_t *xcbGatherRows(
+    XcbWindow *window,
+    const uint32_t *pixels,
+    const BirchRasterRect *rect,
+    int y,
+    size_t rows
+)
+{
+    size_t width = rect->maxX - rect->minX;
+    const uint32_t *first =
+        pixels + (size_t)y * window->pixelWidth + rect->minX;
+    if (width == window->pixelWidth)
+    {
+        return (const uint8_t *)first;
+    }
+
+    if (width * rows > window->scratchCapacity)
+    {
+        uint32_t *scratch =
+            birchReallocate(window->scratch, width * rows * 4);
+        if (!scratch)
+        {
+            return NULL;
+        }
+        window->scratch = scratch;
+        window->scratchCapacity = width * rows;
+    }
+    for (size_t row = 0; row < rows; row++)
+    {
+        memcpy(
+            window->scratch + row * width,
+            first + row * window->pixelWidth,
+            width * 4
+        );
+    }
+    return (const uint8_t *)window->scratch;
+}
+
+static void xcbPresent(XcbWindow *window)
+{
+    XcbBuffer *buffer = &window->buffers[window->current];
+    const BirchDamage *damage = &window->base.state->damage;
+    window->stats.bytesCopied = 0;
+    if (!buffer->pixels || !damage->count)
+    {
+        // Nothing changed, keep rendering into the same buffer
+        return;
+    }
+
+    uint64_t now = birchClockNow();
+    if (buffer->segment)
+    {
+        // Only the requests go over the socket, the server reads the
+        // pixels from the segment
+        for (unsigned int i = 0; i < damage->count; i++)
+        {
+            const BirchRasterRect *rect = &damage->rects[i];
+            xcb_shm_put_image(
+                window->connection,
+                window->window,
+                window->gc,
+                window->pixelWidth,
+                window->pixelHeight,
+                rect->minX,
+                rect->minY,
+                rect->maxX - rect->minX,
+                rect->maxY - rect->minY,
+                rect->minX,
+                rect->minY,
+                xcbDisplay.depth,
+                XCB_IMAGE_FORMAT_Z_PIXMAP,
+                0,
+                buffer->segment,
+                0
+            );
+        }
+    }
+    else
+    {
+        // Split every rectangle into bands of rows that fit in a request
+        size_t header = sizeof(xcb_put_image_request_t);
+        for (unsigned int i = 0; i < damage->count; i++)
+        {
+            const BirchRasterRect *rect = &damage->rects[i];
+            size_t stride = (size_t)(rect->maxX - rect->minX) * 4;
+            size_t rows = (xcbDisplay.maxRequestBytes - header) / stride;
+            rows = rows ? rows : 1;
+            for (int y = rect->minY; y < rect->maxY; y += rows)
+            {
+                size_t bandRows = (size_t)(rect->maxY - y) < rows
+                                      ? (size_t)(rect->maxY - y)
+                                      : rows;
+                const uint8_t *data =
+                    xcbGatherRows(window, buffer->pixels, rect, y, bandRows);
+                if (!data)
+                {
+                    continue;
+                }
+                xcb_put_image(
+                    window->connection,
+                    XCB_IMAGE_FORMAT_Z_PIXMAP,
+                    window->window,
+                    window->gc,
+                    rect->maxX - rect->minX,
+                    bandRows,
+                    rect->minX,
+                    y,
+                    0,
+                    xcbDisplay.depth,
+                    bandRows * stride,
+                    data
+                );
+                window->stats.bytesCopied += bandRows * stride;
+            }
+        }
+    }
+
+    // xcb_put_image copied the pixels into the requests, only a segment
+    // is still read by the server
+    if (buffer->segment)
+    {
+        buffer->fence = xcb_get_input_focus(window->connection);
+        buffer->busy = true;
+        buffer->sent = now;
+        window->current = (window->current + 1) % XCB_BUFFER_COUNT;
+    }
+    else if (!window->probing)
+    {
+        window->probe = xcb_get_input_focus(window->connection);
+        window->probing = true;
+        window->probeSent = now;
+    }
+
+    xcb_flush(window->connection);
+    window->stats.frames++;
+}
+
+void birchPlatformPollEvents(void)
+{
+    xcb_connection_t *connection = xcbDisplay.connection;
+    if (!connection)
+    {
+        return;
+    }
+
+    xcb_generic_event_t *event = xcbDisplay.peeked;
+    xcbDisplay.peeked = NULL;
+    if (!event)
+    {
+        event = xcb_poll_for_event(connection);
+    }
+    while (event)
+    {
+        xcbHandleEvent(event);
+        free(event);
+        event = xcb_poll_for_event(connection);
+    }
+    if (xcb_connection_has_error(connection))
+    {
+        for (XcbWindow *window = xcbDisplay.windows; window;
+             window = window->next)
+        {
+            window->shouldClose = true;
+        }
+    }
+}
+
+void birchPlatformRender(BirchWindow *window)
+{
+    XcbWindow *xcbWindow = (XcbWindow *)window;
+
+    BIRCH_PROFILE_BEGIN(render, "render");
+    // The server may still be reading the buffer this frame renders into
+    xcbReleaseBuffers(xcbWindow, &xcbWindow->buffers[xcbWindow->current]);
+    xcbRender(xcbWindow);
+    BIRCH_PROFILE_END(render);
+
+    BIRCH_PROFILE_BEGIN(present, "present");
+    xcbPresent(xcbWindow);
+    if (xcbWindow->vsync)
+    {
+        uint64_t now = birchClockNow();
+        birchClockSleepUntil((now / XCB_VSYNC_PERIOD + 1) * XCB_VSYNC_PERIOD);
+    }
+    BIRCH_PROFILE_END(present);
+}
+
+bool birchWindowWaitEvents(BirchWindow *window, double timeout)
+{
+    xcb_connection_t *connection = xcbDisplay.connection;
+    if (timeout >= BIRCH_CLOCK_MAX_WAIT)
+    {
+        timeout = -1;
+    }
+    uint64_t deadline =
+        timeout >= 0 ? birchClockNow() + (uint64_t)(timeout * 1e9) : 0;
+
+    while (!xcbDisplay.peeked)
+    {
+        xcbDisplay.peeked = xcb_poll_for_event(connection);
+        if (xcbDisplay.peeked)
+        {
+            break;
+        }
+        if (xcb_connection_has_error(connection))
+        {
+            // Let the next update notice
+            return true;
+        }
+
+        int wait = -1;
+        if (timeout >= 0)
+        {
+            uint64_t now = birchClockNow();
+            if (now >= deadline)
+            {
+                return false;
+            }
+            uint64_t milliseconds = (deadline - now + 999999) / 1000000;
+            wait = milliseconds < INT_MAX ? (int)milliseconds : INT_MAX;
+        }
+        struct pollfd descriptor = {
+            .fd = xcb_get_file_descriptor(connection),
+            .events = POLLIN,
+        };
+        poll(&descriptor, 1, wait);
+    }
+    return true;
+}
+
+void birchWindowSetVsync(BirchWindow *window, bool vsync)
+{
+    XcbWindow *xcbWindow = (XcbWindow *)window;
+
+    xcbWindow->vsync = vsync;
+}
+
+bool birchWindowShouldClose(BirchWindow *window)
+{
+    XcbWindow *xcbWindow = (XcbWindow *)window;
+
+    return xcbWindow->shouldClose;
+}
+
+void birchXcbGetPresentStats(BirchWindow *window, BirchXcbPresentStats *stats)
+{
+    XcbWindow *xcbWindow = (XcbWindow *)window;
+
+    birchWindowLockRender(window);
+    *stats = xcbWindow->stats;
+    stats->sharedMemory = xcbWindow->sharedMemory;
+    stats->presentLatency =
+        xcbWindow->latencySamples
+            ? xcbWindow->latencyTotal / 1e9 / xcbWindow->latencySamples
+            : 0;
+    birchWindowUnlockRender(window);
+}
@@ -0,0 +1,294 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "profile.h"
+
+#if defined(BIRCH_PROFILE) && BIRCH_PROFILE
+
+#include "clock.h"
+#include "heap.h"
+#include <stdatomic.h>
+#include <stdio.h>
+
+// The timestamp counter is several times cheaper to read than the OS clock;
+// ticks are converted to nanoseconds when the trace is written
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||             \
+    defined(_M_IX86)
+#define BIRCH_PROFILE_TSC 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+#define BIRCH_PROFILE_CAPACITY 65536
+
+typedef struct
+{
+    const char *name;
+    uint64_t start;
+    uint64_t end;
+} BirchProfileEvent;
+
+// One per thread, written only by that thread. Buffers are never freed, so
+// zones of threads that exited still appear in traces.
+typedef struct BirchProfileBuffer
+{
+    struct BirchProfileBuffer *next;
+    unsigned int thread;
+    _Atomic(const char *) threadName;
+    // events written so far, the last BIRCH_PROFILE_CAPACITY are kept
+    _Atomic uint64_t head;
+    BirchProfileEvent events[BIRCH_PROFILE_CAPACITY];
+} BirchProfileBuffer;
+
+static _Atomic(BirchProfileBuffer *) birchProfileBuffers = NULL;
+static atomic_uint birchProfileThreads = 0;
+static _Thread_local BirchProfileBuffer *birchProfileBuffer = NULL;
+
+// The first timestamp taken and the clock at that moment, for converting
+// ticks to nanoseconds. Taken by the first thread to record a zone and
+// published by the state: 0 before, 1 while being taken, 2 once taken.
+static atomic_int birchProfileBaseState = 0;
+static uint64_t birchProfileTickBase = 0;
+static uint64_t birchProfileClockBase = 0;
+
+uint64_t birchProfileNow(void)
+{
+#if defined(BIRCH_PROFILE_TSC)
+    return __rdtsc();
+#else
+    return birchClockNow();
+#endif
+}
+
+// Threads recording their first zone at the same time wait for whichever
+// takes the base, a few hundred nanoseconds at most
+static void birchProfileTakeBase(void)
+{
+    int expected = 0;
+    if (atomic_compare_exchange_strong(&birchProfileBaseState, &expected, 1))
+    {
+        birchProfileClockBase = birchClockNow();
+        birchProfileTickBase = birchProfileNow();
+        atomic_store_explicit(&birchProfileBaseState, 2, memory_order_release);
+        return;
+    }
+    while (atomic_load_explicit(
+               &birchProfileBaseState,
+               memory_order_acquire
+           ) != 2)
+    {
+    }
+}
+
+static BirchProfileBuffer *birchProfileBufferNew(void)
+{
+    BirchProfileBuffer *buffer = birchAllocate(sizeof(BirchProfileBuffer));
+    if (!buffer)
+    {
+        return NULL;
+    }
+
+    birchProfileTakeBase();
+
+    buffer->thread = atomic_fetch_add(&birchProfileThreads, 1) + 1;
+    atomic_init(&buffer->threadName, NULL);
+    atomic_init(&buffer->head, 0);
+
+    // Push onto the list of all buffers
+    buffer->next = atomic_load(&birchProfileBuffers);
+    while (!atomic_compare_exchange_weak(
+        &birchProfileBuffers,
+        &buffer->next,
+        buffer
+    ))
+    {
+    }
+
+    birchProfileBuffer = buffer;
+    return buffer;
+}
+
+void birchProfileRecord(const char *name, uint64_t start, uint64_t end)
+{
+    BirchProfileBuffer *buffer = birchProfileBuffer;
+    if (!buffer && !(buffer = birchProfileBufferNew()))
+    {
+        return;
+    }
+
+    uint64_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+    buffer->events[head & (BIRCH_PROFILE_CAPACITY - 1)] =
+        (BirchProfileEvent){name, start, end};
+    atomic_store_explicit(&buffer->head, head + 1, memory_order_release);
+}
+
+void birchProfileSetThreadName(const char *name)
+{
+    BirchProfileBuffer *buffer = birchProfileBuffer;
+    if (!buffer && !(buffer = birchProfileBufferNew()))
+    {
+        return;
+    }
+    atomic_store(&buffer->threadName, name);
+}
+
+static void birchProfileWriteString(FILE *file, const char *string)
+{
+    fputc('"', file);
+    for (; *string; string++)
+    {
+        unsigned char c = *string;
+        if (c == '"' || c == '\\')
+        {
+            fprintf(file, "\\%c", c);
+        }
+        else if (c < 0x20)
+        {
+            fprintf(file, "\\u%04x", c);
+        }
+        else
+        {
+            fputc(c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+bool birchProfileWriteTrace(const char *path)
+{
+    FILE *file = fopen(path, "w");
+    BirchProfileEvent *events =
+        birchAllocate(BIRCH_PROFILE_CAPACITY * sizeof(BirchProfileEvent));
+    if (!file || !events)
+    {
+        if (file)
+        {
+            fclose(file);
+        }
+        birchFree(events);
+        return false;
+    }
+
+    // Without a base no zone was recorded yet
+    bool based = atomic_load_explicit(
+                     &birchProfileBaseState,
+                     memory_order_acquire
+                 ) == 2;
+    uint64_t tickBase = based ? birchProfileTickBase : 0;
+    uint64_t clockBase = based ? birchProfileClockBase : 0;
+    double nanosecondsPerTick = 1.0;
+#if defined(BIRCH_PROFILE_TSC)
+    uint64_t clock = birchClockNow();
+    uint64_t tick = birchProfileNow();
+    if (tick > tickBase && clock > clockBase)
+    {
+        nanosecondsPerTick = (double)(clock - clockBase) / (tick - tickBase);
+    }
+#endif
+
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    bool first = true;
+    for (BirchProfileBuffer *buffer = atomic_load(&birchProfileBuffers);
+         buffer;
+         buffer = buffer->next)
+    {
+        const char *threadName = atomic_load(&buffer->threadName);
+        if (threadName)
+        {
+            fprintf(
+                file,
+                "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                "\"tid\":%u,\"args\":{\"name\":",
+                first ? "" : ",",
+                buffer->thread
+            );
+            birchProfileWriteString(file, threadName);
+            fprintf(file, "}}");
+            first = false;
+        }
+
+        // The owner keeps writing while we copy; afterwards drop whatever
+        // it may have overwritten in the meantime
+        uint64_t head =
+            atomic_load_explicit(&buffer->head, memory_order_acquire);
+        uint64_t begin =
+            head > BIRCH_PROFILE_CAPACITY ? head - BIRCH_PROFILE_CAPACITY : 0;
+        for (uint64_t i = begin; i < head; i++)
+        {
+            events[i - begin] =
+                buffer->events[i & (BIRCH_PROFILE_CAPACITY - 1)];
+        }
+        uint64_t after =
+            atomic_load_explicit(&buffer->head, memory_order_acquire);
+        uint64_t valid = after + 1 > BIRCH_PROFILE_CAPACITY
+                             ? after + 1 - BIRCH_PROFILE_CAPACITY
+                             : 0;
+
+        for (uint64_t i = begin > valid ? begin : valid; i < head; i++)
+        {
+            const BirchProfileEvent *event = &events[i - begin];
+            // The first zone may have started before the base was taken
+            double start = (double)(int64_t)(event->start - tickBase) *
+                               nanosecondsPerTick +
+                           clockBase;
+            double duration =
+                (double)(event->end - event->start) * nanosecondsPerTick;
+
+            fprintf(file, "%s\n{\"name\":", first ? "" : ",");
+            birchProfileWriteString(file, event->name);
+            fprintf(
+                file,
+                ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                buffer->thread,
+                start / 1000,
+                duration / 1000
+            );
+            first = false;
+        }
+    }
+    fprintf(file, "\n]}\n");
+
+    birchFree(events);
+    return fclose(file) == 0;
+}
+
+#else
+
+uint64_t birchProfileNow(void)
+{
+    return 0;
+}
+
+void birchProfileRecord(const char *name, uint64_t start, uint64_t end)
+{
+}
+
+void birchProfileSetThreadName(const char *name)
+{
+}
+
+bool birchProfileWriteTrace(const char *path)
+{
+    return false;
+}
+
+#endif
@@ -0,0 +1,727 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "raster.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(BIRCH_RASTER_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static BirchRasterSpanFn birchRasterSpan = birchRasterSpanScalar;
+static const char *birchRasterSpanName = "scalar";
+
+#if defined(BIRCH_RASTER_AVX2)
+static bool birchRasterHasAvx2(void)
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+
+    // The OS has to save the YMM registers too
+    __cpuid(info, 1);
+    bool osxsave = info[2] & (1 << 27);
+    bool avx = info[2] & (1 << 28);
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+    {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+    return info[1] & (1 << 5);
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+void birchRasterInit(void)
+{
+    const char *forced = getenv("BIRCH_RASTER_ISA");
+
+    birchRasterSpan = birchRasterSpanScalar;
+    birchRasterSpanName = "scalar";
+    if (forced && strcmp(forced, "scalar") == 0)
+    {
+        return;
+    }
+
+#if defined(BIRCH_RASTER_X86)
+    birchRasterSpan = birchRasterSpanSse2;
+    birchRasterSpanName = "sse2";
+    if (forced && strcmp(forced, "sse2") == 0)
+    {
+        return;
+    }
+#endif
+
+#if defined(BIRCH_RASTER_AVX2)
+    if (birchRasterHasAvx2())
+    {
+        birchRasterSpan = birchRasterSpanAvx2;
+        birchRasterSpanName = "avx2";
+    }
+#endif
+}
+
+const char *birchRasterIsa(void)
+{
+    return birchRasterSpanName;
+}
+
+void birchRasterSpanScalar(
+    uint32_t *row,
+    int x,
+    int end,
+    const int32_t edge[3],
+    const int32_t step[3],
+    const float color[4],
+    const float colorDx[4]
+)
+{
+    int32_t e0 = edge[0];
+    int32_t e1 = edge[1];
+    int32_t e2 = edge[2];
+
+    for (; x < end; x++)
+    {
+        if ((e0 | e1 | e2) >= 0)
+        {
+            row[x] = birchRasterShade(color, colorDx, x);
+        }
+        e0 += step[0];
+        e1 += step[1];
+        e2 += step[2];
+    }
+}
+
+// Blend two RGBA8 pixels, `weight` of 256 giving `b`. Red and blue, then
+// green and alpha, are weighted together in one multiply.
+static inline uint32_t
+birchRasterLerp(uint32_t a, uint32_t b, uint32_t weight)
+{
+    uint32_t rb = (a & 0xff00ff) * (256 - weight) + (b & 0xff00ff) * weight;
+    uint32_t ga = ((a >> 8) & 0xff00ff) * (256 - weight) +
+                  ((b >> 8) & 0xff00ff) * weight;
+    return ((rb >> 8) & 0xff00ff) | (ga & 0xff00ff00);
+}
+
+// Bilinear filtering of 16.16 fixed point texel coordinates, already moved
+// back half a texel, with 8 bit weights. Clamped to the edges unless the
+// caller knows that all four texels are inside.
+static inline uint32_t birchRasterSample(
+    const BirchRasterTexture *texture,
+    int32_t u,
+    int32_t v,
+    bool clamp
+)
+{
+    int32_t x0 = u >> 16;
+    int32_t y0 = v >> 16;
+    int32_t x1 = x0 + 1;
+    int32_t y1 = y0 + 1;
+    if (clamp)
+    {
+        int32_t maxX = texture->width - 1;
+        int32_t maxY = texture->height - 1;
+        x0 = x0 < 0 ? 0 : x0 > maxX ? maxX : x0;
+        y0 = y0 < 0 ? 0 : y0 > maxY ? maxY : y0;
+        x1 = x1 < 0 ? 0 : x1 > maxX ? maxX : x1;
+        y1 = y1 < 0 ? 0 : y1 > maxY ? maxY : y1;
+    }
+
+    const uint32_t *row0 = texture->pixels + (size_t)y0 * texture->width;
+    const uint32_t *row1 = texture->pixels + (size_t)y1 * texture->width;
+    uint32_t weightX = (u >> 8) & 0xff;
+    uint32_t weightY = (v >> 8) & 0xff;
+    return birchRasterLerp(
+        birchRasterLerp(row0[x0], row0[x1], weightX),
+        birchRasterLerp(row1[x0], row1[x1], weightX),
+        weightY
+    );
+}
+
+// Whether every coordinate from `start` stepping `step` `count` - 1 times
+// samples inside [0, size - 1)
+static inline bool
+birchRasterInside(int32_t start, int32_t step, int count, int size)
+{
+    int64_t last = start + (int64_t)step * (count - 1);
+    int64_t limit = (int64_t)(size - 1) << 16;
+    return start >= 0 && last >= 0 && start < limit && last < limit;
+}
+
+static inline int32_t birchRasterFixed(float value)
+{
+    return (int32_t)lrintf(value * 65536.0f);
+}
+
+// Textures hold RGBA, `color` and `colorDx` are in RGBA order too; the
+// result is swapped to the order of the target before blending. The
+// coordinates and colors are stepped in 16.16 fixed point.
+static void birchRasterSpanTextured(
+    uint32_t *row,
+    int x,
+    int end,
+    const int32_t edge[3],
+    const int32_t step[3],
+    const float color[4],
+    const float colorDx[4],
+    const float texCoord[2],
+    const float texCoordDx[2],
+    const BirchRasterTexture *texture,
+    bool bgra
+)
+{
+    int32_t e0 = edge[0];
+    int32_t e1 = edge[1];
+    int32_t e2 = edge[2];
+
+    float xf = (float)x + 0.5f;
+    int32_t u = birchRasterFixed(texCoord[0] + texCoordDx[0] * xf - 0.5f);
+    int32_t v = birchRasterFixed(texCoord[1] + texCoordDx[1] * xf - 0.5f);
+    int32_t du = birchRasterFixed(texCoordDx[0]);
+    int32_t dv = birchRasterFixed(texCoordDx[1]);
+    // Colors from 0 to 256
+    int32_t c[4];
+    int32_t dc[4];
+    bool tinted = false;
+    for (int i = 0; i < 4; i++)
+    {
+        c[i] = birchRasterFixed((color[i] + colorDx[i] * xf) * 256.0f);
+        dc[i] = birchRasterFixed(colorDx[i] * 256.0f);
+        tinted = tinted || dc[i] || c[i] >> 16 < 256;
+    }
+    // Sprites usually sample well inside their border
+    bool clamp = !birchRasterInside(u, du, end - x, texture->width) ||
+                 !birchRasterInside(v, dv, end - x, texture->height);
+
+    for (; x < end; x++)
+    {
+        if ((e0 | e1 | e2) >= 0)
+        {
+            uint32_t source = birchRasterSample(texture, u, v, clamp);
+            if (tinted)
+            {
+                uint32_t texel = source;
+                source = 0;
+                for (int i = 0; i < 4; i++)
+                {
+                    int32_t scale = c[i] >> 16;
+                    scale = scale < 0 ? 0 : scale > 256 ? 256 : scale;
+                    uint32_t channel = (texel >> (i * 8)) & 0xff;
+                    source |= ((channel * (uint32_t)scale) >> 8) << (i * 8);
+                }
+            }
+            if (bgra)
+            {
+                source = (source & 0xff00ff00) | ((source >> 16) & 0xff) |
+                         ((source & 0xff) << 16);
+            }
+
+            // Alpha from 0 to 256 for the lerp
+            uint32_t alpha = source >> 24;
+            if (alpha == 255)
+            {
+                row[x] = source;
+            }
+            else
+            {
+                row[x] = birchRasterLerp(row[x], source, alpha + (alpha >> 7));
+            }
+        }
+        e0 += step[0];
+        e1 += step[1];
+        e2 += step[2];
+        u += du;
+        v += dv;
+        if (tinted)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                c[i] += dc[i];
+            }
+        }
+    }
+}
+
+// Distance fields only use alpha: the vertex colors are blended with their
+// alpha scaled by the coverage of the pixel, from how far inside the edge
+// its centre is
+static void birchRasterSpanDistance(
+    uint32_t *row,
+    int x,
+    int end,
+    const int32_t edge[3],
+    const int32_t step[3],
+    const float color[4],
+    const float colorDx[4],
+    const float texCoord[2],
+    const float texCoordDx[2],
+    const BirchRasterTexture *texture,
+    float distanceScale,
+    bool bgra
+)
+{
+    int32_t e0 = edge[0];
+    int32_t e1 = edge[1];
+    int32_t e2 = edge[2];
+
+    float xf = (float)x + 0.5f;
+    int32_t u = birchRasterFixed(texCoord[0] + texCoordDx[0] * xf - 0.5f);
+    int32_t v = birchRasterFixed(texCoord[1] + texCoordDx[1] * xf - 0.5f);
+    int32_t du = birchRasterFixed(texCoordDx[0]);
+    int32_t dv = birchRasterFixed(texCoordDx[1]);
+    float c[4];
+    for (int i = 0; i < 4; i++)
+    {
+        c[i] = color[i] + colorDx[i] * xf;
+    }
+    bool clamp = !birchRasterInside(u, du, end - x, texture->width) ||
+                 !birchRasterInside(v, dv, end - x, texture->height);
+
+    for (; x < end; x++)
+    {
+        if ((e0 | e1 | e2) >= 0)
+        {
+            uint32_t texel = birchRasterSample(texture, u, v, clamp);
+            float alpha = (float)(texel >> 24);
+            float coverage = (alpha - 127.5f) * distanceScale + 0.5f;
+            float opacity = coverage < 1.0f ? coverage * c[3] : c[3];
+            if (opacity > 0.0f)
+            {
+                uint32_t source = 0xff000000;
+                for (int i = 0; i < 3; i++)
+                {
+                    float channel = c[i] < 0.0f ? 0.0f : c[i];
+                    channel = channel > 1.0f ? 1.0f : channel;
+                    int shift = bgra ? 16 - i * 8 : i * 8;
+                    source |= (uint32_t)(channel * 255.0f + 0.5f) << shift;
+                }
+                uint32_t weight = (uint32_t)(opacity * 256.0f + 0.5f);
+                if (weight >= 256)
+                {
+                    row[x] = source;
+                }
+                else
+                {
+                    row[x] = birchRasterLerp(row[x], source, weight);
+                }
+            }
+        }
+        e0 += step[0];
+        e1 += step[1];
+        e2 += step[2];
+        u += du;
+        v += dv;
+        for (int i = 0; i < 4; i++)
+        {
+            c[i] += colorDx[i];
+        }
+    }
+}
+
+static inline int32_t birchRasterSnap(float pixels, int size)
+{
+    if (!(pixels > -BIRCH_RASTER_GUARD_BAND))
+    {
+        pixels = -BIRCH_RASTER_GUARD_BAND;
+    }
+    if (pixels > (float)size + BIRCH_RASTER_GUARD_BAND)
+    {
+        pixels = (float)size + BIRCH_RASTER_GUARD_BAND;
+    }
+    return (int32_t)lrintf(pixels * (1 << BIRCH_RASTER_SUBPIXEL_BITS));
+}
+
+bool birchRasterSetup(
+    BirchRasterTriangle *triangle,
+    const Vertex *vertices,
+    const VertexUniforms *uniforms,
+    int width,
+    int height,
+    const BirchRasterTexture *texture,
+    float spread
+)
+{
+    int32_t x[3];
+    int32_t y[3];
+    const Vertex *ordered[3];
+
+    for (int i = 0; i < 3; i++)
+    {
+        // vertexShader maps points to NDC, the viewport maps NDC to pixels
+        // with y flipped
+        float px = vertices[i].position.x / uniforms->pointsWide * width;
+        float py = (1.0f - vertices[i].position.y / uniforms->pointsHigh) *
+                   height;
+        x[i] = birchRasterSnap(px, width);
+        y[i] = birchRasterSnap(py, height);
+        ordered[i] = &vertices[i];
+    }
+
+    int64_t area = (int64_t)(x[1] - x[0]) * (y[2] - y[0]) -
+                   (int64_t)(y[1] - y[0]) * (x[2] - x[0]);
+    if (area == 0)
+    {
+        return false;
+    }
+
+    // Make the edge functions positive inside whatever the winding
+    if (area < 0)
+    {
+        int32_t swap = x[1];
+        x[1] = x[2];
+        x[2] = swap;
+        swap = y[1];
+        y[1] = y[2];
+        y[2] = swap;
+        const Vertex *swapVertex = ordered[1];
+        ordered[1] = ordered[2];
+        ordered[2] = swapVertex;
+    }
+
+    int32_t minX = x[0] < x[1] ? x[0] : x[1];
+    minX = minX < x[2] ? minX : x[2];
+    int32_t maxX = x[0] > x[1] ? x[0] : x[1];
+    maxX = maxX > x[2] ? maxX : x[2];
+    int32_t minY = y[0] < y[1] ? y[0] : y[1];
+    minY = minY < y[2] ? minY : y[2];
+    int32_t maxY = y[0] > y[1] ? y[0] : y[1];
+    maxY = maxY > y[2] ? maxY : y[2];
+
+    BirchRasterRect bounds = {
+        .minX = minX >> BIRCH_RASTER_SUBPIXEL_BITS,
+        .minY = minY >> BIRCH_RASTER_SUBPIXEL_BITS,
+        .maxX = (maxX >> BIRCH_RASTER_SUBPIXEL_BITS) + 1,
+        .maxY = (maxY >> BIRCH_RASTER_SUBPIXEL_BITS) + 1,
+    };
+    bounds.minX = bounds.minX > 0 ? bounds.minX : 0;
+    bounds.minY = bounds.minY > 0 ? bounds.minY : 0;
+    bounds.maxX = bounds.maxX < width ? bounds.maxX : width;
+    bounds.maxY = bounds.maxY < height ? bounds.maxY : height;
+    if (bounds.minX >= bounds.maxX || bounds.minY >= bounds.maxY)
+    {
+        return false;
+    }
+    triangle->bounds = bounds;
+
+    for (int i = 0; i < 3; i++)
+    {
+        int j = (i + 1) % 3;
+        int64_t a = (int64_t)y[i] - y[j];
+        int64_t b = (int64_t)x[j] - x[i];
+
+        // Top-left rule: pixel centres exactly on an edge belong to the
+        // triangle only for left edges (E grows with x) and top edges
+        // (horizontal, E grows downwards)
+        bool topLeft = a > 0 || (a == 0 && b > 0);
+
+        triangle->a[i] = a;
+        triangle->b[i] = b;
+        triangle->c[i] = -a * x[i] - b * y[i] - (topLeft ? 0 : 1);
+    }
+
+    float fx[3];
+    float fy[3];
+    for (int i = 0; i < 3; i++)
+    {
+        fx[i] = (float)x[i] / (1 << BIRCH_RASTER_SUBPIXEL_BITS);
+        fy[i] = (float)y[i] / (1 << BIRCH_RASTER_SUBPIXEL_BITS);
+    }
+
+    float x10 = fx[1] - fx[0];
+    float y10 = fy[1] - fy[0];
+    float x20 = fx[2] - fx[0];
+    float y20 = fy[2] - fy[0];
+    float det = x10 * y20 - x20 * y10;
+    const float *c0 = &ordered[0]->color.x;
+    const float *c1 = &ordered[1]->color.x;
+    const float *c2 = &ordered[2]->color.x;
+
+    for (int i = 0; i < 4; i++)
+    {
+        float d10 = c1[i] - c0[i];
+        float d20 = c2[i] - c0[i];
+        float dx = (d10 * y20 - d20 * y10) / det;
+        float dy = (d20 * x10 - d10 * x20) / det;
+
+        triangle->colorDx[i] = dx;
+        triangle->colorDy[i] = dy;
+        triangle->color[i] = c0[i] - dx * fx[0] - dy * fy[0];
+    }
+
+    triangle->texture = texture;
+    triangle->distanceScale = 0;
+    for (int i = 0; i < 2; i++)
+    {
+        triangle->texCoord[i] = 0;
+        triangle->texCoordDx[i] = 0;
+        triangle->texCoordDy[i] = 0;
+    }
+    if (texture)
+    {
+        const float *t0 = &ordered[0]->texCoord.x;
+        const float *t1 = &ordered[1]->texCoord.x;
+        const float *t2 = &ordered[2]->texCoord.x;
+        float size[2] = {(float)texture->width, (float)texture->height};
+
+        for (int i = 0; i < 2; i++)
+        {
+            float d10 = (t1[i] - t0[i]) * size[i];
+            float d20 = (t2[i] - t0[i]) * size[i];
+            float dx = (d10 * y20 - d20 * y10) / det;
+            float dy = (d20 * x10 - d10 * x20) / det;
+
+            triangle->texCoordDx[i] = dx;
+            triangle->texCoordDy[i] = dy;
+            triangle->texCoord[i] = t0[i] * size[i] - dx * fx[0] - dy * fy[0];
+        }
+
+        if (spread > 0)
+        {
+            // Distances are stored in texels; convert them to pixels with
+            // the average texels per pixel, like fwidth does on the GPU
+            float texels = sqrtf(
+                (triangle->texCoordDx[0] * triangle->texCoordDx[0] +
+                 triangle->texCoordDy[0] * triangle->texCoordDy[0] +
+                 triangle->texCoordDx[1] * triangle->texCoordDx[1] +
+                 triangle->texCoordDy[1] * triangle->texCoordDy[1]) *
+                0.5f
+            );
+            texels = texels > 1e-6f ? texels : 1e-6f;
+            triangle->distanceScale = spread / (127.5f * texels);
+        }
+    }
+    return true;
+}
+
+static inline int32_t birchRasterClampEdge(int64_t edge)
+{
+    // Within the guard band an edge function changes by less than 2^30
+    // over a chunk, so clamping to +-2^30 keeps its sign for every pixel of
+    // the chunk and cannot overflow
+    const int64_t limit = (int64_t)1 << 30;
+    if (edge > limit)
+    {
+        return (int32_t)limit;
+    }
+    if (edge < -limit)
+    {
+        return (int32_t)-limit;
+    }
+    return (int32_t)edge;
+}
+
+void birchRasterTriangle(
+    const BirchRasterTarget *target,
+    const BirchRasterTriangle *triangle,
+    const BirchRasterRect *clip
+)
+{
+    const int64_t one = 1 << BIRCH_RASTER_SUBPIXEL_BITS;
+    const int64_t half = one / 2;
+
+    int minX = triangle->bounds.minX > clip->minX ? triangle->bounds.minX
+                                                  : clip->minX;
+    int maxX = triangle->bounds.maxX < clip->maxX ? triangle->bounds.maxX
+                                                  : clip->maxX;
+    int minY = triangle->bounds.minY > clip->minY ? triangle->bounds.minY
+                                                  : clip->minY;
+    int maxY = triangle->bounds.maxY < clip->maxY ? triangle->bounds.maxY
+                                                  : clip->maxY;
+    if (minX >= maxX || minY >= maxY)
+    {
+        return;
+    }
+
+    int32_t step[3];
+    for (int i = 0; i < 3; i++)
+    {
+        step[i] = (int32_t)(triangle->a[i] * one);
+    }
+
+    // Swapping the red and blue planes swaps the channels the span
+    // functions pack; the textured spans swap their results themselves
+    const BirchRasterTexture *texture = triangle->texture;
+    bool swap = target->bgra && !texture;
+    float colorDx[4];
+    float colorDy[4];
+    float colorBase[4];
+    for (int i = 0; i < 4; i++)
+    {
+        int plane = swap && i != 1 && i != 3 ? 2 - i : i;
+        colorDx[i] = triangle->colorDx[plane];
+        colorDy[i] = triangle->colorDy[plane];
+        colorBase[i] = triangle->color[plane];
+    }
+
+    for (int y = minY; y < maxY; y++)
+    {
+        int64_t centreY = y * one + half;
+        int64_t edge[3];
+        for (int i = 0; i < 3; i++)
+        {
+            edge[i] = triangle->a[i] * (minX * one + half) +
+                      triangle->b[i] * centreY + triangle->c[i];
+        }
+
+        // Narrow wide rows to the run of pixels inside every edge, so thin
+        // diagonal triangles do not walk their whole bounding box
+        int start = minX;
+        int end = maxX;
+        if (maxX - minX > 16)
+        {
+            bool empty = false;
+            for (int i = 0; i < 3 && !empty; i++)
+            {
+                int64_t a = triangle->a[i] * one;
+                if (a > 0 && edge[i] < 0)
+                {
+                    int64_t skip = (-edge[i] + a - 1) / a;
+                    if (minX + skip > start)
+                    {
+                        start = skip < maxX - minX ? minX + (int)skip : maxX;
+                    }
+                }
+                else if (a < 0)
+                {
+                    int64_t last = edge[i] < 0 ? -1 : edge[i] / -a;
+                    if (minX + last + 1 < end)
+                    {
+                        end = minX + (int)last + 1;
+                    }
+                }
+                else if (a == 0 && edge[i] < 0)
+                {
+                    empty = true;
+                }
+            }
+            if (empty || start >= end)
+            {
+                continue;
+            }
+        }
+
+        float color[4];
+        for (int i = 0; i < 4; i++)
+        {
+            color[i] = colorBase[i] + colorDy[i] * ((float)y + 0.5f);
+        }
+        float texCoord[2];
+        for (int i = 0; i < 2; i++)
+        {
+            texCoord[i] = triangle->texCoord[i] +
+                          triangle->texCoordDy[i] * ((float)y + 0.5f);
+        }
+
+        uint32_t *row = target->pixels + (size_t)y * target->stride;
+        for (int x = start; x < end; x += BIRCH_RASTER_CHUNK)
+        {
+            int chunkEnd =
+                end - x > BIRCH_RASTER_CHUNK ? x + BIRCH_RASTER_CHUNK : end;
+            int32_t chunkEdge[3];
+            for (int i = 0; i < 3; i++)
+            {
+                chunkEdge[i] = birchRasterClampEdge(
+                    edge[i] + triangle->a[i] * one * (x - minX)
+                );
+            }
+            if (triangle->distanceScale > 0)
+            {
+                birchRasterSpanDistance(
+                    row,
+                    x,
+                    chunkEnd,
+                    chunkEdge,
+                    step,
+                    color,
+                    colorDx,
+                    texCoord,
+                    triangle->texCoordDx,
+                    texture,
+                    triangle->distanceScale,
+                    target->bgra
+                );
+            }
+            else if (texture)
+            {
+                birchRasterSpanTextured(
+                    row,
+                    x,
+                    chunkEnd,
+                    chunkEdge,
+                    step,
+                    color,
+                    colorDx,
+                    texCoord,
+                    triangle->texCoordDx,
+                    texture,
+                    target->bgra
+                );
+            }
+            else
+            {
+                birchRasterSpan(
+                    row,
+                    x,
+                    chunkEnd,
+                    chunkEdge,
+                    step,
+                    color,
+                    colorDx
+                );
+            }
+        }
+    }
+}
+
+void birchRasterTriangles(
+    const BirchRasterTarget *target,
+    const Vertex *vertices,
+    size_t count,
+    const VertexUniforms *uniforms
+)
+{
+    BirchRasterRect clip = {0, 0, target->width, target->height};
+
+    for (size_t i = 0; i + 3 <= count; i += 3)
+    {
+        BirchRasterTriangle triangle;
+        if (birchRasterSetup(
+                &triangle,
+                vertices + i,
+                uniforms,
+                target->width,
+                target->height,
+                NULL,
+                0
+            ))
+        {
+            birchRasterTriangle(target, &triangle, &clip);
+        }
+    }
+}
@@ -0,0 +1,212 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BIRCH_RASTER_H
+#define BIRCH_RASTER_H
+
+#include "shaderTypes.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Software rasterizer for the Vertex/VertexUniforms model of shaders.metal:
+// points are mapped to pixels through NDC exactly like vertexShader and the
+// Metal viewport do (y up in points, top row first in the framebuffer), and
+// colors are interpolated linearly across the triangle.
+//
+// Vertices are snapped to 1/16 pixel and coverage is decided by integer
+// edge functions with a top-left fill rule. Rows are walked in chunks of at
+// most BIRCH_RASTER_CHUNK pixels; within a chunk the edge functions fit in
+// 32 bits, which is what the SIMD span functions evaluate 4 or 8 pixels at a
+// time. Every span function computes the same per-pixel values, so output
+// does not depend on the instruction set or on how a triangle is clipped.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||             \
+    defined(_M_IX86)
+#define BIRCH_RASTER_X86 1
+#endif
+
+#define BIRCH_RASTER_SUBPIXEL_BITS 4
+#define BIRCH_RASTER_CHUNK 64
+// Vertices are clamped to this many pixels outside of the target, which
+// keeps the edge function coefficients within 20 bits
+#define BIRCH_RASTER_GUARD_BAND 16384
+
+typedef struct
+{
+    // RGBA8 pixels packed as r | g << 8 | b << 16 | a << 24, top row first
+    uint32_t *pixels;
+    int width;
+    int height;
+    // distance between rows in pixels
+    int stride;
+    // pack pixels as b | g << 8 | r << 16 | a << 24 instead, the layout of
+    // most X11 visuals
+    bool bgra;
+} BirchRasterTarget;
+
+// Sampled by textured triangles with bilinear filtering, clamped to the
+// edges
+typedef struct
+{
+    // RGBA8 texels packed like target pixels in RGBA order, top row first
+    const uint32_t *pixels;
+    int width;
+    int height;
+    // changes whenever the texels do, tile hashes include it
+    uint64_t generation;
+} BirchRasterTexture;
+
+// Half-open pixel rectangle
+typedef struct
+{
+    int minX;
+    int minY;
+    int maxX;
+    int maxY;
+} BirchRasterRect;
+
+typedef struct
+{
+    BirchRasterRect bounds;
+    // E(x, y) = a * x + b * y + c in subpixel units, inside where E >= 0.
+    // The fill rule bias is folded into c.
+    int64_t a[3];
+    int64_t b[3];
+    int64_t c[3];
+    // Color planes, channel = colorDx * x + colorDy * y + color at pixel
+    // centres
+    float color[4];
+    float colorDx[4];
+    float colorDy[4];
+    // Texel coordinate planes, in texels, and the texture to multiply the
+    // colors with. All zero for solid triangles.
+    float texCoord[2];
+    float texCoordDx[2];
+    float texCoordDy[2];
+    // For distance field textures, coverage gained per unit of alpha; zero
+    // when the texels are colors
+    float distanceScale;
+    const BirchRasterTexture *texture;
+} BirchRasterTriangle;
+
+// Shade the pixels [x, end) of a row, end - x <= BIRCH_RASTER_CHUNK. `edge`
+// holds the edge functions at pixel x, `step` their change per pixel and
+// `color` the color planes evaluated at x = 0 for this row.
+typedef void (*BirchRasterSpanFn)(
+    uint32_t *row,
+    int x,
+    int end,
+    const int32_t edge[3],
+    const int32_t step[3],
+    const float color[4],
+    const float colorDx[4]
+);
+
+void birchRasterSpanScalar(
+    uint32_t *row,
+    int x,
+    int end,
+    const int32_t edge[3],
+    const int32_t step[3],
+    const float color[4],
+    const float colorDx[4]
+);
+#if defined(BIRCH_RASTER_X86)
+void birchRasterSpanSse2(
+    uint32_t *row,
+    int x,
+    int end,
+    const int32_t edge[3],
+    const int32_t step[3],
+    const float color[4],
+    const float colorDx[4]
+);
+#endif
+#if defined(BIRCH_RASTER_AVX2)
+void birchRasterSpanAvx2(
+    uint32_t *row,
+    int x,
+    int end,
+    const int32_t edge[3],
+    const int32_t step[3],
+    const float color[4],
+    const float colorDx[4]
+);
+#endif
+
+/// @brief Pick the fastest span function the CPU supports. The
+/// BIRCH_RASTER_ISA environment variable (scalar, sse2 or avx2) can force a
+/// slower one.
+void birchRasterInit(void);
+
+/// @brief Name of the span function in use
+const char *birchRasterIsa(void);
+
+/// @brief Set up a triangle for rasterization into a width x height target
+/// @param texture NULL to fill with the vertex colors. Textured triangles
+/// are shaded by a scalar span function on every instruction set and blend
+/// with the target like glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA).
+/// @param spread 0 if the texels are colors. Otherwise the texture holds a
+/// signed distance field in alpha, 127.5 on edges and changing by 127.5 per
+/// `spread` texels; the triangle is filled with the vertex colors where the
+/// field is inside, with edges antialiased over one pixel at any scale.
+/// @return false if the triangle covers no pixel centre of the target
+bool birchRasterSetup(
+    BirchRasterTriangle *triangle,
+    const Vertex *vertices,
+    const VertexUniforms *uniforms,
+    int width,
+    int height,
+    const BirchRasterTexture *texture,
+    float spread
+);
+
+/// @brief Rasterize the part of a triangle that lies within `clip`
+void birchRasterTriangle(
+    const BirchRasterTarget *target,
+    const BirchRasterTriangle *triangle,
+    const BirchRasterRect *clip
+);
+
+/// @brief Set up and rasterize a triangle list into the whole target
+void birchRasterTriangles(
+    const BirchRasterTarget *target,
+    const Vertex *vertices,
+    size_t count,
+    const VertexUniforms *uniforms
+);
+
+// Shared by the span functions so their tails shade exactly like their
+// vector bodies. Mirrors _mm_max_ps/_mm_min_ps/_mm_cvttps_epi32.
+static inline uint32_t
+birchRasterShade(const float color[4], const float colorDx[4], int x)
+{
+    float xf = (float)x + 0.5f;
+    uint32_t pixel = 0;
+
+    for (int i = 0; i < 4; i++)
+    {
+        float c = color[i] + colorDx[i] * xf;
+        c = c > 0.0f ? c : 0.0f;
+        c = c < 1.0f ? c : 1.0f;
+        pixel |= (uint32_t)(int32_t)(c * 255.0f + 0.5f) << (i * 8);
+    }
+    return pixel;
+}
+
+#endif
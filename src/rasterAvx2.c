@@ -0,0 +1,118 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "raster.h"
+
+#if defined(BIRCH_RASTER_AVX2)
+#include <immintrin.h>
+
+// Pack eight lanes of clamped channels into RGBA8, matching birchRasterShade
+static inline __m256i birchRasterPackAvx2(
+    __m256 xf,
+    const float color[4],
+    const float colorDx[4]
+)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 scale = _mm256_set1_ps(255.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    __m256i pixel = _mm256_setzero_si256();
+
+    for (int i = 0; i < 4; i++)
+    {
+        // No FMA, the rounding has to match the scalar and SSE2 paths
+        __m256 c = _mm256_add_ps(
+            _mm256_set1_ps(color[i]),
+            _mm256_mul_ps(_mm256_set1_ps(colorDx[i]), xf)
+        );
+        c = _mm256_min_ps(_mm256_max_ps(c, zero), one);
+        __m256i channel = _mm256_cvttps_epi32(
+            _mm256_add_ps(_mm256_mul_ps(c, scale), half)
+        );
+        pixel = _mm256_or_si256(pixel, _mm256_slli_epi32(channel, i * 8));
+    }
+    return pixel;
+}
+
+void birchRasterSpanAvx2(
+    uint32_t *row,
+    int x,
+    int end,
+    const int32_t edge[3],
+    const int32_t step[3],
+    const float color[4],
+    const float colorDx[4]
+)
+{
+    const __m256i lanes = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    __m256i e0 = _mm256_add_epi32(
+        _mm256_set1_epi32(edge[0]),
+        _mm256_mullo_epi32(lanes, _mm256_set1_epi32(step[0]))
+    );
+    __m256i e1 = _mm256_add_epi32(
+        _mm256_set1_epi32(edge[1]),
+        _mm256_mullo_epi32(lanes, _mm256_set1_epi32(step[1]))
+    );
+    __m256i e2 = _mm256_add_epi32(
+        _mm256_set1_epi32(edge[2]),
+        _mm256_mullo_epi32(lanes, _mm256_set1_epi32(step[2]))
+    );
+    const __m256i step0 = _mm256_set1_epi32(step[0] * 8);
+    const __m256i step1 = _mm256_set1_epi32(step[1] * 8);
+    const __m256i step2 = _mm256_set1_epi32(step[2] * 8);
+    __m256 xf = _mm256_add_ps(
+        _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(x), lanes)),
+        _mm256_set1_ps(0.5f)
+    );
+    const __m256 eight = _mm256_set1_ps(8.0f);
+
+    for (; x < end; x += 8)
+    {
+        // Negative edge functions have the sign bit set, so the sign of the
+        // or of all three is the outside mask; maskstore writes the lanes
+        // whose sign bit is set
+        __m256i inside = _mm256_xor_si256(
+            _mm256_or_si256(_mm256_or_si256(e0, e1), e2),
+            _mm256_set1_epi32(-1)
+        );
+        if (end - x < 8)
+        {
+            __m256i remaining = _mm256_cmpgt_epi32(
+                _mm256_set1_epi32(end - x),
+                lanes
+            );
+            inside = _mm256_and_si256(inside, remaining);
+        }
+        if (_mm256_movemask_ps(_mm256_castsi256_ps(inside)))
+        {
+            _mm256_maskstore_epi32(
+                (int *)(row + x),
+                inside,
+                birchRasterPackAvx2(xf, color, colorDx)
+            );
+        }
+
+        e0 = _mm256_add_epi32(e0, step0);
+        e1 = _mm256_add_epi32(e1, step1);
+        e2 = _mm256_add_epi32(e2, step2);
+        xf = _mm256_add_ps(xf, eight);
+    }
+}
+#endif
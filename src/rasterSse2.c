@@ -0,0 +1,122 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "raster.h"
+
+#if defined(BIRCH_RASTER_X86)
+#include <emmintrin.h>
+
+// Pack four lanes of clamped channels into RGBA8, matching birchRasterShade
+static inline __m128i birchRasterPackSse2(
+    __m128 xf,
+    const float color[4],
+    const float colorDx[4]
+)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(255.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    __m128i pixel = _mm_setzero_si128();
+
+    for (int i = 0; i < 4; i++)
+    {
+        __m128 c = _mm_add_ps(
+            _mm_set1_ps(color[i]),
+            _mm_mul_ps(_mm_set1_ps(colorDx[i]), xf)
+        );
+        c = _mm_min_ps(_mm_max_ps(c, zero), one);
+        __m128i channel =
+            _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(c, scale), half));
+        pixel = _mm_or_si128(pixel, _mm_slli_epi32(channel, i * 8));
+    }
+    return pixel;
+}
+
+// Edge functions of the pixels x .. x + 3
+static inline __m128i birchRasterEdgeSse2(int32_t edge, int32_t step)
+{
+    return _mm_set_epi32(
+        edge + step * 3,
+        edge + step * 2,
+        edge + step,
+        edge
+    );
+}
+
+void birchRasterSpanSse2(
+    uint32_t *row,
+    int x,
+    int end,
+    const int32_t edge[3],
+    const int32_t step[3],
+    const float color[4],
+    const float colorDx[4]
+)
+{
+    __m128i e0 = birchRasterEdgeSse2(edge[0], step[0]);
+    __m128i e1 = birchRasterEdgeSse2(edge[1], step[1]);
+    __m128i e2 = birchRasterEdgeSse2(edge[2], step[2]);
+    const __m128i step0 = _mm_set1_epi32(step[0] * 4);
+    const __m128i step1 = _mm_set1_epi32(step[1] * 4);
+    const __m128i step2 = _mm_set1_epi32(step[2] * 4);
+    __m128 xf = _mm_add_ps(
+        _mm_cvtepi32_ps(_mm_set_epi32(x + 3, x + 2, x + 1, x)),
+        _mm_set1_ps(0.5f)
+    );
+    const __m128 four = _mm_set1_ps(4.0f);
+
+    for (; x + 4 <= end; x += 4)
+    {
+        // A pixel is outside if any of its edge functions is negative
+        __m128i outside = _mm_srai_epi32(
+            _mm_or_si128(_mm_or_si128(e0, e1), e2),
+            31
+        );
+        if (_mm_movemask_epi8(outside) != 0xffff)
+        {
+            __m128i *target = (__m128i *)(row + x);
+            __m128i pixel = birchRasterPackSse2(xf, color, colorDx);
+            __m128i old = _mm_loadu_si128(target);
+            _mm_storeu_si128(
+                target,
+                _mm_or_si128(
+                    _mm_and_si128(outside, old),
+                    _mm_andnot_si128(outside, pixel)
+                )
+            );
+        }
+
+        e0 = _mm_add_epi32(e0, step0);
+        e1 = _mm_add_epi32(e1, step1);
+        e2 = _mm_add_epi32(e2, step2);
+        xf = _mm_add_ps(xf, four);
+    }
+
+    if (x < end)
+    {
+        int32_t tail[3] = {
+            _mm_cvtsi128_si32(e0),
+            _mm_cvtsi128_si32(e1),
+            _mm_cvtsi128_si32(e2),
+        };
+        birchRasterSpanScalar(row, x, end, tail, step, color, colorDx);
+    }
+}
+#endif
@@ -0,0 +1,146 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "renderThread.h"
+#include "profile.h"
+#include "windowInternal.h"
+
+static void birchRenderThreadMain(void *argument)
+{
+    BirchRenderThread *thread = argument;
+
+    birchProfileSetThreadName("birch render");
+    birchMutexLock(&thread->mutex);
+    for (;;)
+    {
+        while (!thread->count && !thread->stopping)
+        {
+            birchCondWait(&thread->changed, &thread->mutex);
+        }
+        if (!thread->count)
+        {
+            break;
+        }
+        // The updating thread leaves queued frames alone
+        BirchDrawList *frame = &thread->frames[thread->head];
+        birchMutexUnlock(&thread->mutex);
+
+        birchWindowRenderFrame(thread->window, frame);
+
+        birchMutexLock(&thread->mutex);
+        thread->head = (thread->head + 1) % BIRCH_MAX_FRAMES_AHEAD;
+        thread->count--;
+        birchCondBroadcast(&thread->changed);
+    }
+    birchMutexUnlock(&thread->mutex);
+}
+
+bool birchRenderThreadStart(
+    BirchRenderThread *thread,
+    BirchWindow *window,
+    unsigned int capacity
+)
+{
+    if (thread->capacity)
+    {
+        birchMutexLock(&thread->mutex);
+        thread->capacity = capacity;
+        birchMutexUnlock(&thread->mutex);
+        return true;
+    }
+
+    birchMutexInit(&thread->mutex);
+    birchCondInit(&thread->changed);
+    thread->window = window;
+    thread->head = 0;
+    thread->count = 0;
+    thread->stopping = false;
+    if (!birchThreadStart(&thread->thread, birchRenderThreadMain, thread))
+    {
+        birchCondDestroy(&thread->changed);
+        birchMutexDestroy(&thread->mutex);
+        return false;
+    }
+    thread->capacity = capacity;
+    return true;
+}
+
+void birchRenderThreadStop(BirchRenderThread *thread)
+{
+    if (!thread->capacity)
+    {
+        return;
+    }
+
+    birchMutexLock(&thread->mutex);
+    thread->stopping = true;
+    birchCondBroadcast(&thread->changed);
+    birchMutexUnlock(&thread->mutex);
+    birchThreadJoin(&thread->thread);
+
+    birchCondDestroy(&thread->changed);
+    birchMutexDestroy(&thread->mutex);
+    thread->capacity = 0;
+}
+
+void birchRenderThreadSubmit(BirchRenderThread *thread, BirchDrawList *list)
+{
+    birchMutexLock(&thread->mutex);
+    while (thread->count >= thread->capacity)
+    {
+        BIRCH_PROFILE_BEGIN(wait, "wait for render thread");
+        birchCondWait(&thread->changed, &thread->mutex);
+        BIRCH_PROFILE_END(wait);
+    }
+    BirchDrawList *slot =
+        &thread->frames[(thread->head + thread->count) %
+                        BIRCH_MAX_FRAMES_AHEAD];
+    BirchDrawList frame = *slot;
+    *slot = *list;
+    *list = frame;
+    thread->count++;
+    birchCondBroadcast(&thread->changed);
+    birchMutexUnlock(&thread->mutex);
+
+    // What comes back is a frame rendered a while ago
+    birchDrawListReset(list);
+}
+
+void birchRenderThreadFinish(BirchRenderThread *thread)
+{
+    if (!thread->capacity)
+    {
+        return;
+    }
+
+    birchMutexLock(&thread->mutex);
+    while (thread->count)
+    {
+        birchCondWait(&thread->changed, &thread->mutex);
+    }
+    birchMutexUnlock(&thread->mutex);
+}
+
+void birchRenderThreadRelease(BirchRenderThread *thread)
+{
+    for (unsigned int i = 0; i < BIRCH_MAX_FRAMES_AHEAD; i++)
+    {
+        birchDrawListRelease(&thread->frames[i]);
+    }
+}
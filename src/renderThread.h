@@ -0,0 +1,71 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef BIRCH_RENDER_THREAD_H
+#define BIRCH_RENDER_THREAD_H
+
+#include "drawList.h"
+#include "thread.h"
+#include "window.h"
+#include <stdbool.h>
+
+// Frames recorded by the updating thread and rendered on a thread of the
+// window's own, for birchWindowSetRenderThread. birchWindowUpdate swaps the
+// draw list it recorded into a ring and keeps the empty list it gets back;
+// the render thread renders the oldest frame of the ring with
+// birchWindowRenderFrame. Draw lists keep their memory as they go round.
+
+typedef struct
+{
+    BirchWindow *window;
+    BirchThread thread;
+    BirchMutex mutex;
+    BirchCond changed;
+    BirchDrawList frames[BIRCH_MAX_FRAMES_AHEAD];
+    // the oldest frame and how many are queued, the one rendering included
+    unsigned int head;
+    unsigned int count;
+    // most frames queued at once, 0 while the window renders on the
+    // updating thread
+    unsigned int capacity;
+    bool stopping;
+} BirchRenderThread;
+
+/// @brief Start rendering the frames of `window` on a new thread, or change
+/// how many may be queued if it is running
+/// @param capacity 1 to BIRCH_MAX_FRAMES_AHEAD
+bool birchRenderThreadStart(
+    BirchRenderThread *thread,
+    BirchWindow *window,
+    unsigned int capacity
+);
+
+/// @brief Render the frames still queued and join the thread
+void birchRenderThreadStop(BirchRenderThread *thread);
+
+/// @brief Queue the frame in `list`, waiting while the ring is full, and
+/// leave an empty list in its place
+void birchRenderThreadSubmit(BirchRenderThread *thread, BirchDrawList *list);
+
+/// @brief Wait until every queued frame is rendered
+void birchRenderThreadFinish(BirchRenderThread *thread);
+
+/// @brief Free the memory of the ring, once the thread is stopped
+void birchRenderThreadRelease(BirchRenderThread *thread);
+
+#endif
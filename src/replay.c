@@ -0,0 +1,479 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "replay.h"
+#include "clock.h"
+#include "heap.h"
+#include "replayInternal.h"
+#include "windowInternal.h"
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+// A log is a header followed by records of
+//
+//     type         1 byte, a BirchEventType or BIRCH_RECORD_FRAME
+//     time         zigzag varint, nanoseconds since the previous record
+//     payload      varints depending on the type:
+//                  motion: zigzag x and y in 1/64 points, relative to the
+//                          previous motion
+//                  resize: width and height
+//                  keys and buttons: zigzag key or button
+//                  frame: nothing
+//
+// Varints are little endian base 128, zigzag maps signed numbers to
+// unsigned ones so small magnitudes of either sign stay short. Timestamps
+// are signed differences because OS motion times may run slightly behind
+// the clock read for other events.
+
+#define BIRCH_REPLAY_VERSION 1
+#define BIRCH_RECORD_FRAME 0xff
+#define BIRCH_RECORD_POSITION_SCALE 64.0f
+// the longest record: type, time and two 32 bit payloads
+#define BIRCH_RECORD_MAX_SIZE (1 + 10 + 5 + 5)
+#define BIRCH_RECORDER_BUFFER_SIZE 65536
+
+static const char birchReplayMagic[8] =
+    {'B', 'I', 'R', 'C', 'H', 'I', 'N', 'P'};
+
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+} BirchReplayHeader;
+
+struct BirchRecorder
+{
+    FILE *file;
+    bool failed;
+    uint64_t time;
+    int32_t x;
+    int32_t y;
+    size_t used;
+    uint8_t buffer[BIRCH_RECORDER_BUFFER_SIZE];
+};
+
+typedef struct
+{
+    unsigned int type;
+    uint64_t time;
+    // motion in points
+    float x;
+    float y;
+    // resize width and height, or the key or button in a
+    int a;
+    int b;
+} BirchReplayRecord;
+
+struct BirchReplay
+{
+    uint8_t *data;
+    size_t size;
+    size_t offset;
+    BirchReplayMode mode;
+    // decoding state
+    uint64_t time;
+    int32_t x;
+    int32_t y;
+    // the next record, decoded but not yet due
+    bool pending;
+    BirchReplayRecord next;
+    // the recorded time of the first record and when it was replayed, 0
+    // before the first update
+    uint64_t recordStart;
+    uint64_t replayStart;
+};
+
+static uint8_t *birchVarintWrite(uint8_t *out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        *out++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (uint8_t)value;
+    return out;
+}
+
+static uint64_t birchZigzag(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t birchUnzigzag(uint64_t value)
+{
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static void birchRecorderFlush(BirchRecorder *recorder)
+{
+    if (recorder->used &&
+        fwrite(recorder->buffer, 1, recorder->used, recorder->file) !=
+            recorder->used)
+    {
+        recorder->failed = true;
+    }
+    recorder->used = 0;
+}
+
+// Start a record, returning where its payload goes
+static uint8_t *
+birchRecorderBegin(BirchRecorder *recorder, unsigned int type, uint64_t time)
+{
+    if (recorder->used + BIRCH_RECORD_MAX_SIZE > BIRCH_RECORDER_BUFFER_SIZE)
+    {
+        birchRecorderFlush(recorder);
+    }
+
+    uint8_t *out = recorder->buffer + recorder->used;
+    *out++ = (uint8_t)type;
+    out = birchVarintWrite(out, birchZigzag((int64_t)(time - recorder->time)));
+    recorder->time = time;
+    return out;
+}
+
+static void birchRecorderEnd(BirchRecorder *recorder, const uint8_t *end)
+{
+    recorder->used = end - recorder->buffer;
+}
+
+void birchRecorderWriteEvent(
+    BirchRecorder *recorder,
+    const BirchEvent *event,
+    uint64_t time
+)
+{
+    uint8_t *out = birchRecorderBegin(recorder, event->type, time);
+    switch (event->type)
+    {
+    case BIRCH_EVENT_RESIZE:
+        out = birchVarintWrite(out, (uint32_t)event->size.width);
+        out = birchVarintWrite(out, (uint32_t)event->size.height);
+        break;
+    case BIRCH_EVENT_KEY_PRESSED:
+    case BIRCH_EVENT_KEY_RELEASED:
+        out = birchVarintWrite(out, birchZigzag(event->key));
+        break;
+    default:
+        out = birchVarintWrite(out, birchZigzag(event->button));
+        break;
+    }
+    birchRecorderEnd(recorder, out);
+}
+
+void birchRecorderWriteMotion(
+    BirchRecorder *recorder,
+    float x,
+    float y,
+    uint64_t time
+)
+{
+    // Truncated like the conversion to the callbacks' integers, which
+    // therefore see the recorded positions exactly
+    int32_t fixedX = (int32_t)(x * BIRCH_RECORD_POSITION_SCALE);
+    int32_t fixedY = (int32_t)(y * BIRCH_RECORD_POSITION_SCALE);
+
+    uint8_t *out =
+        birchRecorderBegin(recorder, BIRCH_EVENT_MOUSE_MOVED, time);
+    out = birchVarintWrite(out, birchZigzag((int64_t)fixedX - recorder->x));
+    out = birchVarintWrite(out, birchZigzag((int64_t)fixedY - recorder->y));
+    birchRecorderEnd(recorder, out);
+    recorder->x = fixedX;
+    recorder->y = fixedY;
+}
+
+void birchRecorderWriteFrame(BirchRecorder *recorder, uint64_t time)
+{
+    birchRecorderEnd(
+        recorder,
+        birchRecorderBegin(recorder, BIRCH_RECORD_FRAME, time)
+    );
+}
+
+bool birchWindowStartRecording(BirchWindow *window, const char *path)
+{
+    birchWindowStopRecording(window);
+
+    BirchRecorder *recorder = birchAllocateZeroed(1, sizeof(BirchRecorder));
+    if (!recorder)
+    {
+        return false;
+    }
+    recorder->file = fopen(path, "wb");
+    BirchReplayHeader header = {.version = BIRCH_REPLAY_VERSION};
+    memcpy(header.magic, birchReplayMagic, sizeof(header.magic));
+    if (!recorder->file ||
+        fwrite(&header, sizeof(header), 1, recorder->file) != 1)
+    {
+        if (recorder->file)
+        {
+            fclose(recorder->file);
+        }
+        birchFree(recorder);
+        return false;
+    }
+
+    // Times are stored relative to the start of the recording
+    recorder->time = birchClockNow();
+    window->state->recorder = recorder;
+    return true;
+}
+
+bool birchWindowStopRecording(BirchWindow *window)
+{
+    BirchRecorder *recorder = window->state->recorder;
+    if (!recorder)
+    {
+        return true;
+    }
+
+    birchRecorderFlush(recorder);
+    bool ok = !recorder->failed && fclose(recorder->file) == 0;
+    birchFree(recorder);
+    window->state->recorder = NULL;
+    return ok;
+}
+
+static bool birchReplayReadVarint(BirchReplay *replay, uint64_t *value)
+{
+    *value = 0;
+    for (unsigned int shift = 0; shift < 64; shift += 7)
+    {
+        if (replay->offset == replay->size)
+        {
+            return false;
+        }
+        uint8_t byte = replay->data[replay->offset++];
+        *value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Decode the next record. A truncated log, as left by a process that
+// crashed while recording, ends at the last complete record, and so does a
+// corrupt one at the first value out of range.
+static bool birchReplayDecode(BirchReplay *replay, BirchReplayRecord *record)
+{
+    if (replay->offset == replay->size)
+    {
+        return false;
+    }
+    record->type = replay->data[replay->offset++];
+
+    uint64_t delta;
+    uint64_t a = 0;
+    uint64_t b = 0;
+    if (!birchReplayReadVarint(replay, &delta))
+    {
+        return false;
+    }
+    switch (record->type)
+    {
+    case BIRCH_RECORD_FRAME:
+        break;
+    case BIRCH_EVENT_MOUSE_MOVED:
+    case BIRCH_EVENT_RESIZE:
+        if (!birchReplayReadVarint(replay, &a) ||
+            !birchReplayReadVarint(replay, &b))
+        {
+            return false;
+        }
+        break;
+    case BIRCH_EVENT_KEY_PRESSED:
+    case BIRCH_EVENT_KEY_RELEASED:
+    case BIRCH_EVENT_MOUSE_BUTTON_PRESSED:
+    case BIRCH_EVENT_MOUSE_BUTTON_RELEASED:
+        if (!birchReplayReadVarint(replay, &a))
+        {
+            return false;
+        }
+        break;
+    default:
+        return false;
+    }
+
+    replay->time += (uint64_t)birchUnzigzag(delta);
+    record->time = replay->time;
+    if (record->type == BIRCH_EVENT_MOUSE_MOVED)
+    {
+        // Wrapping like the recorder's deltas did
+        replay->x = (int32_t)((uint32_t)replay->x + (uint32_t)birchUnzigzag(a));
+        replay->y = (int32_t)((uint32_t)replay->y + (uint32_t)birchUnzigzag(b));
+        record->x = replay->x / BIRCH_RECORD_POSITION_SCALE;
+        record->y = replay->y / BIRCH_RECORD_POSITION_SCALE;
+    }
+    else if (record->type == BIRCH_EVENT_RESIZE)
+    {
+        if (a > INT_MAX || b > INT_MAX)
+        {
+            return false;
+        }
+        record->a = (int)a;
+        record->b = (int)b;
+    }
+    else
+    {
+        int64_t code = birchUnzigzag(a);
+        if (code < INT_MIN || code > INT_MAX)
+        {
+            return false;
+        }
+        record->a = (int)code;
+    }
+    return true;
+}
+
+static void birchReplayDispatch(
+    BirchWindow *window,
+    const BirchReplayRecord *record,
+    uint64_t time
+)
+{
+    switch (record->type)
+    {
+    case BIRCH_EVENT_MOUSE_MOVED:
+        birchWindowDispatchMouseMoved(window, record->x, record->y, time);
+        break;
+    case BIRCH_EVENT_RESIZE:
+        birchWindowDispatchResize(window, record->a, record->b, time);
+        break;
+    case BIRCH_EVENT_KEY_PRESSED:
+        birchWindowDispatchKeyPressed(window, record->a, time);
+        break;
+    case BIRCH_EVENT_KEY_RELEASED:
+        birchWindowDispatchKeyReleased(window, record->a, time);
+        break;
+    case BIRCH_EVENT_MOUSE_BUTTON_PRESSED:
+        birchWindowDispatchMouseButtonPressed(window, record->a, time);
+        break;
+    case BIRCH_EVENT_MOUSE_BUTTON_RELEASED:
+        birchWindowDispatchMouseButtonReleased(window, record->a, time);
+        break;
+    }
+}
+
+bool birchReplayFeed(BirchReplay *replay, BirchWindow *window)
+{
+    uint64_t now = birchClockNow();
+    for (;;)
+    {
+        if (!replay->pending && !birchReplayDecode(replay, &replay->next))
+        {
+            return false;
+        }
+        replay->pending = true;
+
+        BirchReplayRecord *record = &replay->next;
+        if (!replay->replayStart)
+        {
+            replay->recordStart = record->time;
+            replay->replayStart = now;
+        }
+        // Where the record falls on the clock of this run
+        uint64_t time =
+            replay->replayStart + (record->time - replay->recordStart);
+        if (replay->mode == BIRCH_REPLAY_REAL_TIME && time > now)
+        {
+            return true;
+        }
+
+        replay->pending = false;
+        if (record->type == BIRCH_RECORD_FRAME)
+        {
+            if (replay->mode == BIRCH_REPLAY_FAST)
+            {
+                return true;
+            }
+            continue;
+        }
+        birchReplayDispatch(
+            window,
+            record,
+            replay->mode == BIRCH_REPLAY_FAST ? now : time
+        );
+    }
+}
+
+bool birchWindowStartReplay(
+    BirchWindow *window,
+    const char *path,
+    BirchReplayMode mode
+)
+{
+    birchWindowStopReplay(window);
+
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        return false;
+    }
+    BirchReplay *replay = birchAllocateZeroed(1, sizeof(BirchReplay));
+    BirchReplayHeader header;
+    long size = -1;
+    if (replay && fread(&header, sizeof(header), 1, file) == 1 &&
+        memcmp(header.magic, birchReplayMagic, sizeof(header.magic)) == 0 &&
+        header.version == BIRCH_REPLAY_VERSION &&
+        fseek(file, 0, SEEK_END) == 0)
+    {
+        size = ftell(file) - (long)sizeof(header);
+    }
+    if (size >= 0 && fseek(file, sizeof(header), SEEK_SET) == 0)
+    {
+        replay->data = birchAllocate(size ? size : 1);
+        if (replay->data && fread(replay->data, 1, size, file) == (size_t)size)
+        {
+            replay->size = size;
+            replay->mode = mode;
+            window->state->replay = replay;
+        }
+    }
+    fclose(file);
+
+    if (!window->state->replay)
+    {
+        if (replay)
+        {
+            birchFree(replay->data);
+        }
+        birchFree(replay);
+        return false;
+    }
+    return true;
+}
+
+void birchWindowStopReplay(BirchWindow *window)
+{
+    BirchReplay *replay = window->state->replay;
+    if (replay)
+    {
+        birchFree(replay->data);
+        birchFree(replay);
+        window->state->replay = NULL;
+    }
+}
+
+bool birchWindowIsReplaying(BirchWindow *window)
+{
+    return window->state->replay != NULL;
+}
@@ -0,0 +1,56 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef BIRCH_REPLAY_INTERNAL_H
+#define BIRCH_REPLAY_INTERNAL_H
+
+#include "replay.h"
+#include "window.h"
+#include <stdint.h>
+
+// The recording and replaying sides of birch/replay.h, attached to a
+// window's state while in use
+
+typedef struct BirchRecorder BirchRecorder;
+typedef struct BirchReplay BirchReplay;
+
+/// @brief Log a dispatched event other than mouse motion, `time` in
+/// birchClockNow nanoseconds
+void birchRecorderWriteEvent(
+    BirchRecorder *recorder,
+    const BirchEvent *event,
+    uint64_t time
+);
+
+/// @brief Log mouse motion at full precision
+void birchRecorderWriteMotion(
+    BirchRecorder *recorder,
+    float x,
+    float y,
+    uint64_t time
+);
+
+/// @brief Log the end of a birchWindowUpdate
+void birchRecorderWriteFrame(BirchRecorder *recorder, uint64_t time);
+
+/// @brief Dispatch the events due in this update through the
+/// birchWindowDispatch* functions
+/// @return false once the log is exhausted
+bool birchReplayFeed(BirchReplay *replay, BirchWindow *window);
+
+#endif
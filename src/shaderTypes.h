@@ -0,0 +1,62 @@
+// Copyright (C) 2024 Devin Rockwell
+// 
+// This file is part of birch.
+// 
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BIRCH_SHADERTYPES_H
+#define BIRCH_SHADERTYPES_H
+
+#if defined(__METAL_VERSION__) || defined(__APPLE__)
+#include <simd/simd.h>
+#else
+// Stand-ins for the simd types with the same size and alignment, so Vertex
+// has the same layout on every backend.
+#if defined(_MSC_VER)
+#define BIRCH_ALIGNED(n) __declspec(align(n))
+#else
+#define BIRCH_ALIGNED(n) __attribute__((aligned(n)))
+#endif
+
+typedef struct BIRCH_ALIGNED(8) {
+    float x;
+    float y;
+} vector_float2;
+
+typedef struct BIRCH_ALIGNED(16) {
+    float x;
+    float y;
+    float z;
+    float w;
+} vector_float4;
+#endif
+
+typedef struct {
+    vector_float2 position;
+    // into the bound texture, 0 to 1 with the first row at 0. Fills what
+    // was padding before color, so Vertex stays 32 bytes.
+    vector_float2 texCoord;
+    vector_float4 color;
+} Vertex;
+
+// Texels from an edge at which a distance field reaches 0 or 255 in alpha,
+// with 127.5 on the edge
+#define BIRCH_DISTANCE_FIELD_SPREAD 4.0f
+
+typedef struct {
+    float pointsWide;
+    float pointsHigh;
+} VertexUniforms;
+
+#endif
@@ -0,0 +1,169 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stream.h"
+#include <string.h>
+
+static void birchStreamRetire(BirchStream *stream, unsigned int frame)
+{
+    if (!stream->pending[frame])
+    {
+        return;
+    }
+
+    if (stream->backend->poll && !stream->backend->poll(stream->context, frame))
+    {
+        stream->current.stalls++;
+        stream->backend->wait(stream->context, frame);
+    }
+    stream->pending[frame] = false;
+}
+
+static bool birchStreamAllocate(BirchStream *stream, size_t frameCapacity)
+{
+    void *data = stream->backend->allocate(
+        stream->context,
+        frameCapacity * BIRCH_STREAM_FRAMES
+    );
+    if (!data)
+    {
+        return false;
+    }
+
+    stream->data = data;
+    stream->frameCapacity = frameCapacity;
+    stream->current.allocations++;
+    stream->current.capacity = frameCapacity;
+    return true;
+}
+
+bool birchStreamInit(
+    BirchStream *stream,
+    const BirchStreamBackend *backend,
+    void *context,
+    size_t frameCapacity
+)
+{
+    memset(stream, 0, sizeof(BirchStream));
+    stream->backend = backend;
+    stream->context = context;
+
+    return birchStreamAllocate(stream, frameCapacity);
+}
+
+void birchStreamRelease(BirchStream *stream)
+{
+    if (!stream->data)
+    {
+        return;
+    }
+
+    for (unsigned int i = 0; i < BIRCH_STREAM_FRAMES; i++)
+    {
+        birchStreamRetire(stream, i);
+    }
+    stream->backend->release(stream->context, stream->data);
+    stream->data = NULL;
+}
+
+void birchStreamBeginFrame(BirchStream *stream, size_t reserve)
+{
+    stream->last = stream->current;
+    memset(&stream->current, 0, sizeof(BirchStreamStats));
+    stream->current.capacity = stream->frameCapacity;
+
+    stream->frame = (stream->frame + 1) % BIRCH_STREAM_FRAMES;
+    stream->offset = 0;
+    stream->flushed = 0;
+
+    size_t needed = reserve;
+    if (stream->overflowed && needed <= stream->frameCapacity)
+    {
+        needed = stream->frameCapacity + 1;
+    }
+    stream->overflowed = false;
+
+    if (needed > stream->frameCapacity)
+    {
+        size_t frameCapacity = stream->frameCapacity
+                                   ? stream->frameCapacity
+                                   : BIRCH_STREAM_DEFAULT_CAPACITY;
+        while (frameCapacity < needed)
+        {
+            frameCapacity *= 2;
+        }
+
+        // The whole buffer is replaced, so every frame has to retire first
+        size_t oldCapacity = stream->frameCapacity;
+        birchStreamRelease(stream);
+        if (!birchStreamAllocate(stream, frameCapacity) &&
+            !birchStreamAllocate(stream, oldCapacity))
+        {
+            stream->frameCapacity = 0;
+        }
+        return;
+    }
+
+    birchStreamRetire(stream, stream->frame);
+}
+
+void *birchStreamAlloc(
+    BirchStream *stream,
+    size_t size,
+    size_t alignment,
+    size_t *offset
+)
+{
+    size_t start = (stream->offset + alignment - 1) & ~(alignment - 1);
+    if (start + size > stream->frameCapacity)
+    {
+        stream->overflowed = true;
+        stream->current.overflows++;
+        return NULL;
+    }
+
+    stream->offset = start + size;
+    stream->current.bytesStreamed += size;
+
+    size_t base = stream->frameCapacity * stream->frame;
+    *offset = base + start;
+    return stream->data + base + start;
+}
+
+void birchStreamFlush(BirchStream *stream)
+{
+    if (stream->backend->flush && stream->offset > stream->flushed)
+    {
+        stream->backend->flush(
+            stream->context,
+            stream->frameCapacity * stream->frame + stream->flushed,
+            stream->offset - stream->flushed
+        );
+    }
+    stream->flushed = stream->offset;
+}
+
+void birchStreamEndFrame(BirchStream *stream)
+{
+    if (stream->backend->fence)
+    {
+        stream->backend->fence(stream->context, stream->frame);
+        stream->pending[stream->frame] = true;
+    }
+}
@@ -0,0 +1,102 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BIRCH_STREAM_H
+#define BIRCH_STREAM_H
+
+#include "window.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Per-frame data (vertices, uniforms) is streamed through one persistently
+// mapped buffer split into BIRCH_STREAM_FRAMES regions. Each frame
+// sub-allocates linearly from its own region, and the backend puts a fence
+// after the frame's commands so the region is only reused once the GPU has
+// finished reading it.
+
+#define BIRCH_STREAM_FRAMES 3
+#define BIRCH_STREAM_DEFAULT_CAPACITY (1024 * 1024)
+
+typedef struct
+{
+    // Create the backing storage and return a pointer to its persistently
+    // mapped memory. When the stream has to grow, every frame is retired and
+    // the old storage released before the new one is allocated.
+    void *(*allocate)(void *context, size_t size);
+    void (*release)(void *context, void *data);
+    // Optional, for backends that cannot map their storage persistently.
+    // Called by birchStreamFlush with the byte range written since the
+    // previous flush.
+    void (*flush)(void *context, size_t offset, size_t size);
+    // Optional fences. When missing, frames retire as soon as they end,
+    // which is what CPU consumers want. `poll` must not block.
+    void (*fence)(void *context, unsigned int frame);
+    bool (*poll)(void *context, unsigned int frame);
+    void (*wait)(void *context, unsigned int frame);
+} BirchStreamBackend;
+
+typedef struct
+{
+    const BirchStreamBackend *backend;
+    void *context;
+    uint8_t *data;
+    size_t frameCapacity;
+    unsigned int frame;
+    size_t offset;
+    size_t flushed;
+    bool pending[BIRCH_STREAM_FRAMES];
+    bool overflowed;
+    BirchStreamStats current;
+    BirchStreamStats last;
+} BirchStream;
+
+bool birchStreamInit(
+    BirchStream *stream,
+    const BirchStreamBackend *backend,
+    void *context,
+    size_t frameCapacity
+);
+void birchStreamRelease(BirchStream *stream);
+
+/// @brief Start writing the next frame region, waiting for the GPU if it is
+/// still reading it
+/// @param reserve bytes the frame is going to need; the stream grows if its
+/// regions are smaller than that
+void birchStreamBeginFrame(BirchStream *stream, size_t reserve);
+
+/// @brief Sub-allocate from the current frame region
+/// @param offset receives the offset of the allocation from the start of the
+/// backing storage, for binding
+/// @return the mapped memory, or NULL if the region is full. The stream grows
+/// at the start of the next frame in that case.
+void *birchStreamAlloc(
+    BirchStream *stream,
+    size_t size,
+    size_t alignment,
+    size_t *offset
+);
+
+/// @brief Make the data written so far visible to the GPU. Must be called
+/// before issuing the draws that read it.
+void birchStreamFlush(BirchStream *stream);
+
+/// @brief Finish the current frame and fence it, after its draws have been
+/// issued
+void birchStreamEndFrame(BirchStream *stream);
+
+#endif
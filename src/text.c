@@ -0,0 +1,590 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "text.h"
+#include "atlas.h"
+#include "clock.h"
+#include "heap.h"
+#include "truetype.h"
+#include "windowInternal.h"
+#include <math.h>
+
+// Distance fields are rendered at this many pixels per em whatever size the
+// text is drawn at; edges stay sharp when magnified several times
+#define BIRCH_TEXT_FIELD_SIZE 32
+#define BIRCH_TEXT_REPLACEMENT 0xfffd
+#define BIRCH_TEXT_EMPTY UINT32_MAX
+
+typedef struct
+{
+    // the glyph index, BIRCH_TEXT_EMPTY for a free slot
+    uint32_t glyph;
+    // in ems
+    float advance;
+    // top left corner of the distance field relative to the pen on the
+    // baseline, in field pixels with y up
+    float left;
+    float top;
+    // NULL for glyphs without an outline
+    BirchImage *image;
+    // the kerning pairs with the glyph on the left
+    uint32_t kernFirst;
+    uint32_t kernCount;
+} BirchGlyph;
+
+struct BirchFont
+{
+    BirchWindow *window;
+    struct BirchFont *previous;
+    struct BirchFont *next;
+    BirchTrueType face;
+    // open addressing with linear probing, at most half full
+    BirchGlyph *glyphs;
+    size_t glyphCount;
+    size_t glyphCapacity;
+    // the glyph of every ASCII character
+    uint16_t ascii[128];
+    // bytes counted in the window's text stats
+    size_t memory;
+    BirchTrueTypeOutline outline;
+};
+
+static size_t birchFontSlot(const BirchFont *font, uint32_t glyph)
+{
+    size_t mask = font->glyphCapacity - 1;
+    size_t slot = (glyph * 0x9e3779b1u) & mask;
+    while (font->glyphs[slot].glyph != BIRCH_TEXT_EMPTY &&
+           font->glyphs[slot].glyph != glyph)
+    {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+static void birchFontAddMemory(BirchFont *font, size_t bytes)
+{
+    font->memory += bytes;
+    font->window->state->textStats.memory += bytes;
+}
+
+static bool birchFontGrow(BirchFont *font)
+{
+    size_t capacity = font->glyphCapacity ? font->glyphCapacity * 2 : 256;
+    BirchGlyph *glyphs = birchAllocate(capacity * sizeof(BirchGlyph));
+    if (!glyphs)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < capacity; i++)
+    {
+        glyphs[i].glyph = BIRCH_TEXT_EMPTY;
+    }
+
+    BirchGlyph *old = font->glyphs;
+    size_t oldCapacity = font->glyphCapacity;
+    font->glyphs = glyphs;
+    font->glyphCapacity = capacity;
+    for (size_t i = 0; i < oldCapacity; i++)
+    {
+        if (old[i].glyph != BIRCH_TEXT_EMPTY)
+        {
+            font->glyphs[birchFontSlot(font, old[i].glyph)] = old[i];
+        }
+    }
+    birchFree(old);
+    birchFontAddMemory(font, (capacity - oldCapacity) * sizeof(BirchGlyph));
+    return true;
+}
+
+typedef struct
+{
+    float x;
+    int direction;
+} BirchTextCrossing;
+
+// The signed distance from every pixel centre to the outline, positive
+// inside by the nonzero rule, mapped to alpha. Outline coordinates are in
+// field pixels with y up from the bottom edge. Distances beyond the spread
+// all map to 0 or 255, so every segment only visits the pixels within the
+// spread of its bounds, and insideness comes from one scanline per row.
+static bool birchFontDistanceField(
+    const BirchTrueTypeOutline *outline,
+    int width,
+    int height,
+    uint8_t *pixels
+)
+{
+    const float spread = BIRCH_DISTANCE_FIELD_SPREAD;
+    size_t pixelCount = (size_t)width * height;
+    float *nearest = birchAllocate(pixelCount * sizeof(float));
+    BirchTextCrossing *crossings =
+        birchAllocate((outline->count + 1) * sizeof(BirchTextCrossing));
+    if (!nearest || !crossings)
+    {
+        birchFree(nearest);
+        birchFree(crossings);
+        return false;
+    }
+    for (size_t i = 0; i < pixelCount; i++)
+    {
+        nearest[i] = spread * spread;
+    }
+
+    for (size_t i = 0; i < outline->count; i++)
+    {
+        const BirchTrueTypeSegment *s = &outline->segments[i];
+        float dx = s->x1 - s->x0;
+        float dy = s->y1 - s->y0;
+        float length = dx * dx + dy * dy;
+        float minX = s->x0 < s->x1 ? s->x0 : s->x1;
+        float maxX = s->x0 > s->x1 ? s->x0 : s->x1;
+        float minY = s->y0 < s->y1 ? s->y0 : s->y1;
+        float maxY = s->y0 > s->y1 ? s->y0 : s->y1;
+
+        // Pixel centres are at column + 0.5 and height - row - 0.5
+        int firstColumn = (int)floorf(minX - spread - 0.5f);
+        int lastColumn = (int)ceilf(maxX + spread - 0.5f);
+        int firstRow = (int)floorf(height - 0.5f - maxY - spread);
+        int lastRow = (int)ceilf(height - 0.5f - minY + spread);
+        firstColumn = firstColumn > 0 ? firstColumn : 0;
+        lastColumn = lastColumn < width - 1 ? lastColumn : width - 1;
+        firstRow = firstRow > 0 ? firstRow : 0;
+        lastRow = lastRow < height - 1 ? lastRow : height - 1;
+
+        for (int row = firstRow; row <= lastRow; row++)
+        {
+            float py = (float)(height - row) - 0.5f - s->y0;
+            float *distances = nearest + (size_t)row * width;
+            for (int column = firstColumn; column <= lastColumn; column++)
+            {
+                float px = (float)column + 0.5f - s->x0;
+                float t = length > 0 ? (px * dx + py * dy) / length : 0;
+                t = t < 0 ? 0 : t > 1 ? 1 : t;
+                float ex = px - t * dx;
+                float ey = py - t * dy;
+                float distance = ex * ex + ey * ey;
+                if (distance < distances[column])
+                {
+                    distances[column] = distance;
+                }
+            }
+        }
+    }
+
+    for (int row = 0; row < height; row++)
+    {
+        // Where the outline crosses the row, upwards or downwards, sorted
+        // from left to right
+        float y = (float)(height - row) - 0.5f;
+        size_t crossingCount = 0;
+        for (size_t i = 0; i < outline->count; i++)
+        {
+            const BirchTrueTypeSegment *s = &outline->segments[i];
+            int direction = 0;
+            if (s->y0 <= y && s->y1 > y)
+            {
+                direction = 1;
+            }
+            else if (s->y1 <= y && s->y0 > y)
+            {
+                direction = -1;
+            }
+            if (!direction)
+            {
+                continue;
+            }
+            float x = s->x0 + (y - s->y0) * (s->x1 - s->x0) / (s->y1 - s->y0);
+            size_t j = crossingCount++;
+            for (; j > 0 && crossings[j - 1].x > x; j--)
+            {
+                crossings[j] = crossings[j - 1];
+            }
+            crossings[j] = (BirchTextCrossing){x, direction};
+        }
+
+        int winding = 0;
+        size_t next = 0;
+        for (int column = 0; column < width; column++)
+        {
+            float x = (float)column + 0.5f;
+            while (next < crossingCount && crossings[next].x < x)
+            {
+                winding += crossings[next++].direction;
+            }
+
+            size_t index = (size_t)row * width + column;
+            float distance = sqrtf(nearest[index]);
+            if (winding == 0)
+            {
+                distance = -distance;
+            }
+            float alpha = 127.5f + distance * 127.5f / spread;
+            alpha = alpha < 0 ? 0 : alpha > 255 ? 255 : alpha;
+            uint8_t *pixel = pixels + index * 4;
+            pixel[0] = 255;
+            pixel[1] = 255;
+            pixel[2] = 255;
+            pixel[3] = (uint8_t)lrintf(alpha);
+        }
+    }
+
+    birchFree(nearest);
+    birchFree(crossings);
+    return true;
+}
+
+// Fill `entry` with the metrics and distance field of a glyph. A glyph whose
+// field cannot be made is cached without one and draws nothing.
+static void
+birchFontRender(BirchFont *font, uint16_t glyph, BirchGlyph *entry)
+{
+    const BirchTrueType *face = &font->face;
+    int advance, leftBearing;
+    birchTrueTypeMetrics(face, glyph, &advance, &leftBearing);
+    entry->glyph = glyph;
+    entry->advance = (float)advance / face->unitsPerEm;
+    entry->left = 0;
+    entry->top = 0;
+    entry->image = NULL;
+    birchTrueTypeKerningPairs(
+        face,
+        glyph,
+        &entry->kernFirst,
+        &entry->kernCount
+    );
+
+    int minX, minY, maxX, maxY;
+    if (!birchTrueTypeBounds(face, glyph, &minX, &minY, &maxX, &maxY))
+    {
+        return;
+    }
+    uint64_t start = birchClockNow();
+
+    // Padded by the spread so the field fades out before the edges
+    float scale = (float)BIRCH_TEXT_FIELD_SIZE / face->unitsPerEm;
+    int padding = (int)ceilf(BIRCH_DISTANCE_FIELD_SPREAD);
+    int left = (int)floorf(minX * scale) - padding;
+    int bottom = (int)floorf(minY * scale) - padding;
+    int width = (int)ceilf(maxX * scale) + padding - left;
+    int height = (int)ceilf(maxY * scale) + padding - bottom;
+    const int largest = BIRCH_ATLAS_SIZE - 2 * BIRCH_ATLAS_BORDER;
+    if (width > largest || height > largest)
+    {
+        return;
+    }
+
+    uint8_t *pixels = birchAllocate((size_t)width * height * 4);
+    if (!pixels || !birchTrueTypeOutline(
+                       face,
+                       glyph,
+                       scale,
+                       (float)-left,
+                       (float)-bottom,
+                       &font->outline
+                   ))
+    {
+        birchFree(pixels);
+        return;
+    }
+    if (birchFontDistanceField(&font->outline, width, height, pixels))
+    {
+        entry->image = birchImageNew(font->window, width, height, pixels);
+    }
+    birchFree(pixels);
+
+    BirchTextStats *stats = &font->window->state->textStats;
+    if (entry->image)
+    {
+        entry->left = (float)left;
+        entry->top = (float)(bottom + height);
+        birchFontAddMemory(font, (size_t)width * height * 4);
+    }
+    stats->rasterizeTime += (birchClockNow() - start) / 1e9;
+}
+
+static BirchGlyph *birchFontGlyph(BirchFont *font, uint16_t glyph)
+{
+    BirchTextStats *stats = &font->window->state->textStats;
+    stats->lookups++;
+    size_t slot = birchFontSlot(font, glyph);
+    if (font->glyphs[slot].glyph == glyph)
+    {
+        stats->hits++;
+        return &font->glyphs[slot];
+    }
+
+    stats->misses++;
+    if ((font->glyphCount + 1) * 2 > font->glyphCapacity)
+    {
+        if (!birchFontGrow(font))
+        {
+            return NULL;
+        }
+        slot = birchFontSlot(font, glyph);
+    }
+    birchFontRender(font, glyph, &font->glyphs[slot]);
+    font->glyphCount++;
+    stats->cachedGlyphs++;
+    return &font->glyphs[slot];
+}
+
+BirchFont *birchFontNew(BirchWindow *window, const uint8_t *data, size_t size)
+{
+    BirchFont *font = birchAllocateZeroed(1, sizeof(BirchFont));
+    if (!font)
+    {
+        return NULL;
+    }
+    if (!birchTrueTypeInit(&font->face, data, size))
+    {
+        birchFree(font);
+        return NULL;
+    }
+    font->window = window;
+    for (uint32_t c = 0; c < 128; c++)
+    {
+        font->ascii[c] = birchTrueTypeGlyph(&font->face, c);
+    }
+
+    BirchWindowState *state = window->state;
+    font->next = state->fonts;
+    if (state->fonts)
+    {
+        state->fonts->previous = font;
+    }
+    state->fonts = font;
+    birchFontAddMemory(font, sizeof(BirchFont));
+
+    if (!birchFontGrow(font))
+    {
+        birchFontFree(font);
+        return NULL;
+    }
+    return font;
+}
+
+void birchFontFree(BirchFont *font)
+{
+    if (!font)
+    {
+        return;
+    }
+    BirchWindowState *state = font->window->state;
+    for (size_t i = 0; i < font->glyphCapacity; i++)
+    {
+        if (font->glyphs[i].glyph != BIRCH_TEXT_EMPTY)
+        {
+            birchImageFree(font->glyphs[i].image);
+        }
+    }
+    state->textStats.cachedGlyphs -= font->glyphCount;
+    state->textStats.memory -= font->memory;
+
+    if (font->previous)
+    {
+        font->previous->next = font->next;
+    }
+    else
+    {
+        state->fonts = font->next;
+    }
+    if (font->next)
+    {
+        font->next->previous = font->previous;
+    }
+    birchTrueTypeOutlineRelease(&font->outline);
+    birchFree(font->glyphs);
+    birchFree(font);
+}
+
+float birchFontGetLineHeight(BirchFont *font, float size)
+{
+    const BirchTrueType *face = &font->face;
+    return (float)(face->ascender - face->descender + face->lineGap) * size /
+           face->unitsPerEm;
+}
+
+// The next code point of UTF-8 text, advancing past it. Malformed, overlong
+// and surrogate sequences decode to U+FFFD; the text ends at the first NUL
+// byte even inside a sequence.
+static uint32_t birchTextDecode(const unsigned char **text)
+{
+    const unsigned char *s = *text;
+    uint32_t codepoint = s[0];
+    int length;
+    uint32_t smallest;
+    if (codepoint < 0x80)
+    {
+        *text = s + 1;
+        return codepoint;
+    }
+    else if ((codepoint & 0xe0) == 0xc0)
+    {
+        length = 2;
+        codepoint &= 0x1f;
+        smallest = 0x80;
+    }
+    else if ((codepoint & 0xf0) == 0xe0)
+    {
+        length = 3;
+        codepoint &= 0x0f;
+        smallest = 0x800;
+    }
+    else if ((codepoint & 0xf8) == 0xf0)
+    {
+        length = 4;
+        codepoint &= 0x07;
+        smallest = 0x10000;
+    }
+    else
+    {
+        *text = s + 1;
+        return BIRCH_TEXT_REPLACEMENT;
+    }
+
+    for (int i = 1; i < length; i++)
+    {
+        if ((s[i] & 0xc0) != 0x80)
+        {
+            *text = s + i;
+            return BIRCH_TEXT_REPLACEMENT;
+        }
+        codepoint = codepoint << 6 | (s[i] & 0x3f);
+    }
+    *text = s + length;
+    if (codepoint < smallest || codepoint > 0x10ffff ||
+        (codepoint >= 0xd800 && codepoint <= 0xdfff))
+    {
+        return BIRCH_TEXT_REPLACEMENT;
+    }
+    return codepoint;
+}
+
+// Lay out `text`, drawing it into `window` unless that is NULL
+static float birchTextLayout(
+    BirchWindow *window,
+    BirchFont *font,
+    const char *text,
+    float x,
+    float y,
+    float size,
+    BirchColor color
+)
+{
+    const BirchTrueType *face = &font->face;
+    float unit = size / face->unitsPerEm;
+    float fieldPixel = size / BIRCH_TEXT_FIELD_SIZE;
+    float lineHeight = birchFontGetLineHeight(font, size);
+    float pen = x;
+    float widest = 0;
+    // the kerning pairs of the glyph before, copied as the cache may grow
+    uint32_t kernFirst = 0;
+    uint32_t kernCount = 0;
+    size_t drawn = 0;
+
+    const unsigned char *s = (const unsigned char *)text;
+    while (*s)
+    {
+        uint32_t codepoint = birchTextDecode(&s);
+        if (codepoint == '\n')
+        {
+            widest = pen - x > widest ? pen - x : widest;
+            pen = x;
+            y -= lineHeight;
+            kernCount = 0;
+            continue;
+        }
+
+        uint16_t index;
+        if (codepoint < 128)
+        {
+            index = font->ascii[codepoint];
+        }
+        else
+        {
+            index = birchTrueTypeGlyph(face, codepoint);
+        }
+        BirchGlyph *glyph = birchFontGlyph(font, index);
+        if (!glyph)
+        {
+            continue;
+        }
+        if (kernCount)
+        {
+            int kerning =
+                birchTrueTypeKerning(face, kernFirst, kernCount, index);
+            pen += kerning * unit;
+        }
+        if (window && glyph->image)
+        {
+            float width = glyph->image->width * fieldPixel;
+            float height = glyph->image->height * fieldPixel;
+            birchDrawAtlasImage(
+                window,
+                glyph->image,
+                BIRCH_PIPELINE_DISTANCE_FIELD,
+                pen + glyph->left * fieldPixel,
+                y + glyph->top * fieldPixel - height,
+                width,
+                height,
+                color
+            );
+            drawn++;
+        }
+        pen += glyph->advance * size;
+        kernFirst = glyph->kernFirst;
+        kernCount = glyph->kernCount;
+    }
+
+    if (window)
+    {
+        window->state->glyphsRecorded += drawn;
+    }
+    return pen - x > widest ? pen - x : widest;
+}
+
+float birchTextMeasure(BirchFont *font, const char *text, float size)
+{
+    return birchTextLayout(NULL, font, text, 0, 0, size, (BirchColor){0});
+}
+
+float birchDrawText(
+    BirchWindow *window,
+    BirchFont *font,
+    const char *text,
+    float x,
+    float y,
+    float size,
+    BirchColor color
+)
+{
+    // The glyphs are packed into the atlas of the font's window
+    if (window != font->window)
+    {
+        return 0;
+    }
+    return birchTextLayout(window, font, text, x, y, size, color);
+}
+
+void birchWindowGetTextStats(BirchWindow *window, BirchTextStats *stats)
+{
+    *stats = window->state->textStats;
+    stats->hitRate =
+        stats->lookups ? (double)stats->hits / stats->lookups : 0.0;
+}
@@ -0,0 +1,245 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if defined(__linux__)
+// sched_getaffinity
+#define _GNU_SOURCE
+#endif
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "thread.h"
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+#if !defined(_WIN32)
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+static DWORD WINAPI birchThreadMain(LPVOID argument)
+{
+    BirchThread *thread = argument;
+    thread->function(thread->argument);
+    return 0;
+}
+
+bool birchThreadStart(
+    BirchThread *thread,
+    BirchThreadFn function,
+    void *argument
+)
+{
+    thread->function = function;
+    thread->argument = argument;
+    thread->handle = CreateThread(NULL, 0, birchThreadMain, thread, 0, NULL);
+    return thread->handle != NULL;
+}
+
+void birchThreadJoin(BirchThread *thread)
+{
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+}
+
+void birchMutexInit(BirchMutex *mutex)
+{
+    InitializeSRWLock(mutex);
+}
+
+void birchMutexDestroy(BirchMutex *mutex)
+{
+}
+
+void birchMutexLock(BirchMutex *mutex)
+{
+    AcquireSRWLockExclusive(mutex);
+}
+
+void birchMutexUnlock(BirchMutex *mutex)
+{
+    ReleaseSRWLockExclusive(mutex);
+}
+
+void birchCondInit(BirchCond *cond)
+{
+    InitializeConditionVariable(cond);
+}
+
+void birchCondDestroy(BirchCond *cond)
+{
+}
+
+void birchCondWait(BirchCond *cond, BirchMutex *mutex)
+{
+    SleepConditionVariableSRW(cond, mutex, INFINITE, 0);
+}
+
+void birchCondWaitFor(
+    BirchCond *cond,
+    BirchMutex *mutex,
+    uint64_t nanoseconds
+)
+{
+    uint64_t milliseconds = (nanoseconds + 999999) / 1000000;
+    SleepConditionVariableSRW(
+        cond,
+        mutex,
+        milliseconds < INFINITE ? (DWORD)milliseconds : INFINITE - 1,
+        0
+    );
+}
+
+void birchCondBroadcast(BirchCond *cond)
+{
+    WakeAllConditionVariable(cond);
+}
+
+unsigned int birchCpuCount(void)
+{
+    // The processors of the process's group it may run on
+    DWORD_PTR processMask;
+    DWORD_PTR systemMask;
+    if (GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask))
+    {
+        unsigned int count = 0;
+        for (; processMask; processMask &= processMask - 1)
+        {
+            count++;
+        }
+        if (count)
+        {
+            return count;
+        }
+    }
+
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+}
+#else
+static void *birchThreadMain(void *argument)
+{
+    BirchThread *thread = argument;
+    thread->function(thread->argument);
+    return NULL;
+}
+
+bool birchThreadStart(
+    BirchThread *thread,
+    BirchThreadFn function,
+    void *argument
+)
+{
+    thread->function = function;
+    thread->argument = argument;
+    return pthread_create(&thread->handle, NULL, birchThreadMain, thread) ==
+           0;
+}
+
+void birchThreadJoin(BirchThread *thread)
+{
+    pthread_join(thread->handle, NULL);
+}
+
+void birchMutexInit(BirchMutex *mutex)
+{
+    pthread_mutex_init(mutex, NULL);
+}
+
+void birchMutexDestroy(BirchMutex *mutex)
+{
+    pthread_mutex_destroy(mutex);
+}
+
+void birchMutexLock(BirchMutex *mutex)
+{
+    pthread_mutex_lock(mutex);
+}
+
+void birchMutexUnlock(BirchMutex *mutex)
+{
+    pthread_mutex_unlock(mutex);
+}
+
+void birchCondInit(BirchCond *cond)
+{
+    pthread_cond_init(cond, NULL);
+}
+
+void birchCondDestroy(BirchCond *cond)
+{
+    pthread_cond_destroy(cond);
+}
+
+void birchCondWait(BirchCond *cond, BirchMutex *mutex)
+{
+    pthread_cond_wait(cond, mutex);
+}
+
+void birchCondWaitFor(
+    BirchCond *cond,
+    BirchMutex *mutex,
+    uint64_t nanoseconds
+)
+{
+    struct timespec duration = {
+        .tv_sec = nanoseconds / 1000000000,
+        .tv_nsec = nanoseconds % 1000000000,
+    };
+#if defined(__APPLE__)
+    pthread_cond_timedwait_relative_np(cond, mutex, &duration);
+#else
+    // The condition variable uses the realtime clock, callers recheck their
+    // deadline against birchClockNow
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += duration.tv_sec;
+    deadline.tv_nsec += duration.tv_nsec;
+    if (deadline.tv_nsec >= 1000000000)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    pthread_cond_timedwait(cond, mutex, &deadline);
+#endif
+}
+
+void birchCondBroadcast(BirchCond *cond)
+{
+    pthread_cond_broadcast(cond);
+}
+
+unsigned int birchCpuCount(void)
+{
+#if defined(__linux__)
+    // Pinned processes and cpuset containers see fewer CPUs than are online
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0 && CPU_COUNT(&set) > 0)
+    {
+        return (unsigned int)CPU_COUNT(&set);
+    }
+#endif
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (unsigned int)count : 1;
+}
+#endif
@@ -0,0 +1,81 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef BIRCH_THREAD_H
+#define BIRCH_THREAD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Just enough of pthreads and Win32 threads for the thread pool
+
+#if defined(_WIN32)
+#include <windows.h>
+
+typedef SRWLOCK BirchMutex;
+typedef CONDITION_VARIABLE BirchCond;
+#else
+#include <pthread.h>
+
+typedef pthread_mutex_t BirchMutex;
+typedef pthread_cond_t BirchCond;
+#endif
+
+typedef void (*BirchThreadFn)(void *argument);
+
+typedef struct
+{
+#if defined(_WIN32)
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+    BirchThreadFn function;
+    void *argument;
+} BirchThread;
+
+/// @brief Start a thread running function(argument). `thread` must stay at
+/// the same address until it is joined.
+bool birchThreadStart(
+    BirchThread *thread,
+    BirchThreadFn function,
+    void *argument
+);
+void birchThreadJoin(BirchThread *thread);
+
+void birchMutexInit(BirchMutex *mutex);
+void birchMutexDestroy(BirchMutex *mutex);
+void birchMutexLock(BirchMutex *mutex);
+void birchMutexUnlock(BirchMutex *mutex);
+
+void birchCondInit(BirchCond *cond);
+void birchCondDestroy(BirchCond *cond);
+void birchCondWait(BirchCond *cond, BirchMutex *mutex);
+/// @brief birchCondWait giving up after about `nanoseconds`
+void birchCondWaitFor(
+    BirchCond *cond,
+    BirchMutex *mutex,
+    uint64_t nanoseconds
+);
+void birchCondBroadcast(BirchCond *cond);
+
+/// @brief Number of CPUs the process may run on, at least 1: its affinity
+/// mask on Linux and Windows, the CPUs online elsewhere
+unsigned int birchCpuCount(void);
+
+#endif
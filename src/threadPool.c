@@ -0,0 +1,296 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "threadPool.h"
+#include "heap.h"
+#include "profile.h"
+#include "thread.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// A worker's remaining indices [begin, end) packed as begin | end << 32, so
+// the owner taking the front and thieves taking the back both update it with
+// one compare-exchange
+typedef struct
+{
+    _Atomic uint64_t range;
+    // keep every worker's range on its own cache line
+    char padding[64 - sizeof(uint64_t)];
+} BirchWorkerRange;
+
+typedef struct
+{
+    BirchThreadPool *pool;
+    unsigned int index;
+} BirchWorker;
+
+struct BirchThreadPool
+{
+    unsigned int threadCount;
+    BirchThread *threads;
+    BirchWorker *workers;
+    BirchWorkerRange *ranges;
+
+    // held for a whole run, render threads of several windows take turns
+    BirchMutex run;
+    BirchMutex mutex;
+    BirchCond wake;
+    BirchCond done;
+    unsigned int generation;
+    unsigned int busy;
+    bool stopping;
+
+    BirchTaskFn task;
+    void *context;
+};
+
+static inline uint64_t birchRangePack(uint32_t begin, uint32_t end)
+{
+    return (uint64_t)begin | (uint64_t)end << 32;
+}
+
+static bool birchRangePop(BirchWorkerRange *range, uint32_t *index)
+{
+    uint64_t value = atomic_load(&range->range);
+
+    for (;;)
+    {
+        uint32_t begin = (uint32_t)value;
+        uint32_t end = (uint32_t)(value >> 32);
+        if (begin >= end)
+        {
+            return false;
+        }
+        if (atomic_compare_exchange_weak(
+                &range->range,
+                &value,
+                birchRangePack(begin + 1, end)
+            ))
+        {
+            *index = begin;
+            return true;
+        }
+    }
+}
+
+// Move the back half of some other worker's range into `worker`'s, which
+// is empty
+static bool birchRangeSteal(BirchThreadPool *pool, unsigned int worker)
+{
+    for (unsigned int i = 1; i < pool->threadCount; i++)
+    {
+        BirchWorkerRange *victim =
+            &pool->ranges[(worker + i) % pool->threadCount];
+        uint64_t value = atomic_load(&victim->range);
+
+        for (;;)
+        {
+            uint32_t begin = (uint32_t)value;
+            uint32_t end = (uint32_t)(value >> 32);
+            if (begin >= end)
+            {
+                break;
+            }
+
+            uint32_t take = (end - begin + 1) / 2;
+            if (atomic_compare_exchange_weak(
+                    &victim->range,
+                    &value,
+                    birchRangePack(begin, end - take)
+                ))
+            {
+                atomic_store(
+                    &pool->ranges[worker].range,
+                    birchRangePack(end - take, end)
+                );
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static void birchThreadPoolWork(BirchThreadPool *pool, unsigned int worker)
+{
+    do
+    {
+        uint32_t index;
+        while (birchRangePop(&pool->ranges[worker], &index))
+        {
+            pool->task(pool->context, index);
+        }
+    } while (birchRangeSteal(pool, worker));
+}
+
+static void birchThreadPoolMain(void *argument)
+{
+    BirchWorker *worker = argument;
+    BirchThreadPool *pool = worker->pool;
+    unsigned int generation = 0;
+
+    birchProfileSetThreadName("birch worker");
+    birchMutexLock(&pool->mutex);
+    for (;;)
+    {
+        while (!pool->stopping && pool->generation == generation)
+        {
+            birchCondWait(&pool->wake, &pool->mutex);
+        }
+        if (pool->stopping)
+        {
+            break;
+        }
+        generation = pool->generation;
+        birchMutexUnlock(&pool->mutex);
+
+        birchThreadPoolWork(pool, worker->index);
+
+        birchMutexLock(&pool->mutex);
+        if (--pool->busy == 0)
+        {
+            birchCondBroadcast(&pool->done);
+        }
+    }
+    birchMutexUnlock(&pool->mutex);
+}
+
+BirchThreadPool *birchThreadPoolNew(unsigned int threadCount)
+{
+    if (threadCount <= 1)
+    {
+        return NULL;
+    }
+
+    BirchThreadPool *pool = birchAllocateZeroed(1, sizeof(BirchThreadPool));
+    if (!pool)
+    {
+        return NULL;
+    }
+    pool->threads = birchAllocateZeroed(threadCount, sizeof(BirchThread));
+    pool->workers = birchAllocateZeroed(threadCount, sizeof(BirchWorker));
+    pool->ranges = birchAllocateZeroed(threadCount, sizeof(BirchWorkerRange));
+    if (!pool->threads || !pool->workers || !pool->ranges)
+    {
+        birchFree(pool->threads);
+        birchFree(pool->workers);
+        birchFree(pool->ranges);
+        birchFree(pool);
+        return NULL;
+    }
+
+    birchMutexInit(&pool->run);
+    birchMutexInit(&pool->mutex);
+    birchCondInit(&pool->wake);
+    birchCondInit(&pool->done);
+    for (unsigned int i = 0; i < threadCount; i++)
+    {
+        pool->workers[i] = (BirchWorker){pool, i};
+        atomic_init(&pool->ranges[i].range, 0);
+    }
+
+    // Worker 0 is whoever calls birchThreadPoolRun
+    pool->threadCount = 1;
+    for (unsigned int i = 1; i < threadCount; i++)
+    {
+        if (!birchThreadStart(
+                &pool->threads[i],
+                birchThreadPoolMain,
+                &pool->workers[i]
+            ))
+        {
+            break;
+        }
+        pool->threadCount++;
+    }
+    return pool;
+}
+
+void birchThreadPoolFree(BirchThreadPool *pool)
+{
+    if (!pool)
+    {
+        return;
+    }
+
+    birchMutexLock(&pool->mutex);
+    pool->stopping = true;
+    birchCondBroadcast(&pool->wake);
+    birchMutexUnlock(&pool->mutex);
+    for (unsigned int i = 1; i < pool->threadCount; i++)
+    {
+        birchThreadJoin(&pool->threads[i]);
+    }
+
+    birchCondDestroy(&pool->done);
+    birchCondDestroy(&pool->wake);
+    birchMutexDestroy(&pool->mutex);
+    birchMutexDestroy(&pool->run);
+    birchFree(pool->threads);
+    birchFree(pool->workers);
+    birchFree(pool->ranges);
+    birchFree(pool);
+}
+
+unsigned int birchThreadPoolSize(const BirchThreadPool *pool)
+{
+    return pool ? pool->threadCount : 1;
+}
+
+void birchThreadPoolRun(
+    BirchThreadPool *pool,
+    size_t count,
+    BirchTaskFn task,
+    void *context
+)
+{
+    if (!pool || pool->threadCount == 1 || count <= 1)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            task(context, i);
+        }
+        return;
+    }
+
+    birchMutexLock(&pool->run);
+    birchMutexLock(&pool->mutex);
+    pool->task = task;
+    pool->context = context;
+    for (unsigned int i = 0; i < pool->threadCount; i++)
+    {
+        uint32_t begin = (uint32_t)(count * i / pool->threadCount);
+        uint32_t end = (uint32_t)(count * (i + 1) / pool->threadCount);
+        atomic_store(&pool->ranges[i].range, birchRangePack(begin, end));
+    }
+    pool->busy = pool->threadCount - 1;
+    pool->generation++;
+    birchCondBroadcast(&pool->wake);
+    birchMutexUnlock(&pool->mutex);
+
+    birchThreadPoolWork(pool, 0);
+
+    birchMutexLock(&pool->mutex);
+    while (pool->busy)
+    {
+        birchCondWait(&pool->done, &pool->mutex);
+    }
+    birchMutexUnlock(&pool->mutex);
+    birchMutexUnlock(&pool->run);
+}
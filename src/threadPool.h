@@ -0,0 +1,52 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef BIRCH_THREAD_POOL_H
+#define BIRCH_THREAD_POOL_H
+
+#include <stddef.h>
+
+// Fork-join pool for data-parallel loops. Each run splits its index range
+// evenly between the workers; a worker that runs out of indices steals the
+// back half of another worker's remaining range, so uneven tasks still keep
+// every thread busy. The thread calling birchThreadPoolRun works too.
+
+typedef struct BirchThreadPool BirchThreadPool;
+
+typedef void (*BirchTaskFn)(void *context, size_t index);
+
+/// @brief Create a pool of `threadCount` workers, the caller included
+/// @return NULL if threads cannot be created or `threadCount` is 1
+BirchThreadPool *birchThreadPoolNew(unsigned int threadCount);
+void birchThreadPoolFree(BirchThreadPool *pool);
+
+/// @brief Number of workers, 1 for a NULL pool
+unsigned int birchThreadPoolSize(const BirchThreadPool *pool);
+
+/// @brief Call task(context, i) for every i in [0, count) and wait for all of
+/// them. The order and thread of the calls is unspecified. A NULL pool runs
+/// the tasks in order on the calling thread. Runs started from several
+/// threads at once run one after the other; tasks must not start runs.
+void birchThreadPoolRun(
+    BirchThreadPool *pool,
+    size_t count,
+    BirchTaskFn task,
+    void *context
+);
+
+#endif
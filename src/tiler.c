@@ -0,0 +1,451 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tiler.h"
+#include "heap.h"
+#include "profile.h"
+#include <stddef.h>
+#include <string.h>
+
+void birchTilerRelease(BirchTiler *tiler)
+{
+    birchFree(tiler->triangles);
+    birchFree(tiler->counts);
+    birchFree(tiler->tileStarts);
+    birchFree(tiler->bins);
+    birchFree(tiler->triangleHashes);
+    birchFree(tiler->tileHashes);
+    memset(tiler, 0, sizeof(BirchTiler));
+}
+
+void birchTileCacheRelease(BirchTileCache *cache)
+{
+    birchFree(cache->hashes);
+    memset(cache, 0, sizeof(BirchTileCache));
+}
+
+void birchTileCacheInvalidate(BirchTileCache *cache)
+{
+    cache->tilesWide = 0;
+    cache->tilesHigh = 0;
+}
+
+static bool
+birchTilerReserve(void **data, size_t *capacity, size_t count, size_t size)
+{
+    if (count <= *capacity)
+    {
+        return true;
+    }
+
+    size_t grown = *capacity ? *capacity : 256;
+    while (grown < count)
+    {
+        grown *= 2;
+    }
+
+    // The old contents are never needed, skip realloc's copy
+    void *grownData = birchAllocate(grown * size);
+    if (!grownData)
+    {
+        return false;
+    }
+    birchFree(*data);
+    *data = grownData;
+    *capacity = grown;
+    return true;
+}
+
+bool birchTileCacheFit(BirchTileCache *cache, int tilesWide, int tilesHigh)
+{
+    if (cache->hashes && cache->tilesWide == tilesWide &&
+        cache->tilesHigh == tilesHigh)
+    {
+        return true;
+    }
+
+    size_t tileCount = (size_t)tilesWide * tilesHigh;
+    if (!birchTilerReserve(
+            (void **)&cache->hashes,
+            &cache->capacity,
+            tileCount,
+            sizeof(uint64_t)
+        ))
+    {
+        birchTileCacheRelease(cache);
+        return false;
+    }
+    memset(cache->hashes, 0, tileCount * sizeof(uint64_t));
+    cache->tilesWide = tilesWide;
+    cache->tilesHigh = tilesHigh;
+    return true;
+}
+
+static inline uint64_t birchTilerHash(uint64_t hash, uint64_t value)
+{
+    hash = (hash ^ value) * 0x9e3779b97f4a7c15ull;
+    return hash ^ (hash >> 29);
+}
+
+static uint64_t birchTilerHashTriangle(const BirchRasterTriangle *triangle)
+{
+    // The planes are hashed as words; distanceScale on its own, as the
+    // struct pads it
+    uint64_t words[offsetof(BirchRasterTriangle, distanceScale) /
+                   sizeof(uint64_t)];
+    memcpy(words, triangle, sizeof(words));
+
+    uint64_t hash = 0;
+    for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); i++)
+    {
+        hash = birchTilerHash(hash, words[i]);
+    }
+    uint32_t distanceScale;
+    memcpy(&distanceScale, &triangle->distanceScale, sizeof(distanceScale));
+    hash = birchTilerHash(hash, distanceScale);
+    if (triangle->texture)
+    {
+        hash = birchTilerHash(hash, triangle->texture->generation);
+    }
+    return hash;
+}
+
+// The texture of the draw call `*call` if it contains `vertex`, advancing
+// `*call` to the one that does, and the spread of its distance field if it
+// holds one. Calls are sorted by their first vertex.
+static const BirchRasterTexture *birchTilerTexture(
+    const BirchTiler *tiler,
+    size_t *call,
+    size_t vertex,
+    float *spread
+)
+{
+    *spread = 0;
+    if (!tiler->calls)
+    {
+        return NULL;
+    }
+    while (*call + 1 < tiler->callCount &&
+           tiler->calls[*call + 1].first <= vertex)
+    {
+        (*call)++;
+    }
+
+    uint64_t key = tiler->calls[*call].key;
+    uint32_t texture = BIRCH_DRAW_KEY_TEXTURE(key);
+    uint32_t pipeline = BIRCH_DRAW_KEY_PIPELINE(key);
+    if (!texture || (pipeline != BIRCH_PIPELINE_TEXTURED &&
+                     pipeline != BIRCH_PIPELINE_DISTANCE_FIELD))
+    {
+        return NULL;
+    }
+    if (pipeline == BIRCH_PIPELINE_DISTANCE_FIELD)
+    {
+        *spread = BIRCH_DISTANCE_FIELD_SPREAD;
+    }
+    return &tiler->textures[texture - 1];
+}
+
+// The last draw call starting at or before `vertex`
+static size_t birchTilerFindCall(const BirchTiler *tiler, size_t vertex)
+{
+    size_t low = 0;
+    size_t high = tiler->callCount;
+    while (high - low > 1)
+    {
+        size_t middle = (low + high) / 2;
+        if (tiler->calls[middle].first <= vertex)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+static inline void birchTilerTileRange(
+    const BirchRasterRect *bounds,
+    int *minX,
+    int *minY,
+    int *maxX,
+    int *maxY
+)
+{
+    *minX = bounds->minX / BIRCH_TILE_SIZE;
+    *minY = bounds->minY / BIRCH_TILE_SIZE;
+    *maxX = (bounds->maxX - 1) / BIRCH_TILE_SIZE;
+    *maxY = (bounds->maxY - 1) / BIRCH_TILE_SIZE;
+}
+
+static void birchTilerSetupTask(void *context, size_t task)
+{
+    BirchTiler *tiler = context;
+    size_t first = task * BIRCH_TILER_BIN_TRIANGLES;
+    size_t last = first + BIRCH_TILER_BIN_TRIANGLES;
+    last = last < tiler->triangleCount ? last : tiler->triangleCount;
+    size_t tileCount = (size_t)tiler->tilesWide * tiler->tilesHigh;
+    uint32_t *counts = tiler->counts + task * tileCount;
+
+    memset(counts, 0, tileCount * sizeof(uint32_t));
+    size_t call = tiler->calls ? birchTilerFindCall(tiler, first * 3) : 0;
+    for (size_t i = first; i < last; i++)
+    {
+        BirchRasterTriangle *triangle = &tiler->triangles[i];
+        float spread;
+        const BirchRasterTexture *texture =
+            birchTilerTexture(tiler, &call, i * 3, &spread);
+        if (!birchRasterSetup(
+                triangle,
+                tiler->vertices + i * 3,
+                tiler->uniforms,
+                tiler->target->width,
+                tiler->target->height,
+                texture,
+                spread
+            ))
+        {
+            // Culled, an empty rectangle bins nowhere
+            triangle->bounds = (BirchRasterRect){0, 0, 0, 0};
+            continue;
+        }
+        if (tiler->cache)
+        {
+            tiler->triangleHashes[i] = birchTilerHashTriangle(triangle);
+        }
+
+        int minX, minY, maxX, maxY;
+        birchTilerTileRange(&triangle->bounds, &minX, &minY, &maxX, &maxY);
+        for (int y = minY; y <= maxY; y++)
+        {
+            for (int x = minX; x <= maxX; x++)
+            {
+                counts[(size_t)y * tiler->tilesWide + x]++;
+            }
+        }
+    }
+}
+
+static void birchTilerBinTask(void *context, size_t task)
+{
+    BirchTiler *tiler = context;
+    size_t first = task * BIRCH_TILER_BIN_TRIANGLES;
+    size_t last = first + BIRCH_TILER_BIN_TRIANGLES;
+    last = last < tiler->triangleCount ? last : tiler->triangleCount;
+    size_t tileCount = (size_t)tiler->tilesWide * tiler->tilesHigh;
+    uint32_t *offsets = tiler->counts + task * tileCount;
+
+    for (size_t i = first; i < last; i++)
+    {
+        const BirchRasterTriangle *triangle = &tiler->triangles[i];
+        if (triangle->bounds.minX >= triangle->bounds.maxX)
+        {
+            continue;
+        }
+
+        int minX, minY, maxX, maxY;
+        birchTilerTileRange(&triangle->bounds, &minX, &minY, &maxX, &maxY);
+        for (int y = minY; y <= maxY; y++)
+        {
+            for (int x = minX; x <= maxX; x++)
+            {
+                tiler->bins[offsets[(size_t)y * tiler->tilesWide + x]++] =
+                    (uint32_t)i;
+            }
+        }
+    }
+}
+
+static void birchTilerRasterTask(void *context, size_t tile)
+{
+    BirchTiler *tiler = context;
+    int tileX = (int)(tile % tiler->tilesWide) * BIRCH_TILE_SIZE;
+    int tileY = (int)(tile / tiler->tilesWide) * BIRCH_TILE_SIZE;
+    BirchRasterRect clip = {
+        .minX = tileX,
+        .minY = tileY,
+        .maxX = tileX + BIRCH_TILE_SIZE < tiler->target->width
+                    ? tileX + BIRCH_TILE_SIZE
+                    : tiler->target->width,
+        .maxY = tileY + BIRCH_TILE_SIZE < tiler->target->height
+                    ? tileY + BIRCH_TILE_SIZE
+                    : tiler->target->height,
+    };
+
+    uint32_t first = tiler->tileStarts[tile];
+    uint32_t last = tiler->tileStarts[tile + 1];
+    if (tiler->cache)
+    {
+        uint64_t hash = 0;
+        for (uint32_t i = first; i < last; i++)
+        {
+            hash = birchTilerHash(hash, tiler->triangleHashes[tiler->bins[i]]);
+        }
+        // 0 is reserved for tiles in an unknown state
+        hash |= 1;
+        tiler->tileHashes[tile] = hash;
+        if (tiler->cache->hashes[tile] == hash)
+        {
+            return;
+        }
+        tiler->cache->hashes[tile] = hash;
+
+        const BirchRasterTarget *target = tiler->target;
+        for (int y = clip.minY; y < clip.maxY; y++)
+        {
+            uint32_t *row = target->pixels + (size_t)y * target->stride;
+            for (int x = clip.minX; x < clip.maxX; x++)
+            {
+                // Opaque black is the same in RGBA and BGRA
+                row[x] = 0xff000000;
+            }
+        }
+    }
+
+    BIRCH_PROFILE_BEGIN(tile, "raster tile");
+    for (uint32_t i = first; i < last; i++)
+    {
+        birchRasterTriangle(
+            tiler->target,
+            &tiler->triangles[tiler->bins[i]],
+            &clip
+        );
+    }
+    BIRCH_PROFILE_END(tile);
+}
+
+bool birchTilerRender(
+    BirchTiler *tiler,
+    BirchThreadPool *pool,
+    const BirchRasterTarget *target,
+    BirchTileCache *cache,
+    const Vertex *vertices,
+    size_t count,
+    const BirchDrawBatch *calls,
+    size_t callCount,
+    const BirchRasterTexture *textures,
+    const VertexUniforms *uniforms
+)
+{
+    // With a cache even an empty frame has to clear the tiles drawn before
+    size_t triangleCount = count / 3;
+    if ((!triangleCount && !cache) || target->width <= 0 ||
+        target->height <= 0)
+    {
+        return true;
+    }
+
+    int tilesWide = (target->width + BIRCH_TILE_SIZE - 1) / BIRCH_TILE_SIZE;
+    int tilesHigh = (target->height + BIRCH_TILE_SIZE - 1) / BIRCH_TILE_SIZE;
+    size_t tileCount = (size_t)tilesWide * tilesHigh;
+    size_t binTasks = (triangleCount + BIRCH_TILER_BIN_TRIANGLES - 1) /
+                      BIRCH_TILER_BIN_TRIANGLES;
+
+    if (!birchTilerReserve(
+            (void **)&tiler->triangles,
+            &tiler->triangleCapacity,
+            triangleCount,
+            sizeof(BirchRasterTriangle)
+        ) ||
+        !birchTilerReserve(
+            (void **)&tiler->counts,
+            &tiler->countCapacity,
+            binTasks * tileCount,
+            sizeof(uint32_t)
+        ) ||
+        !birchTilerReserve(
+            (void **)&tiler->tileStarts,
+            &tiler->tileCapacity,
+            tileCount + 1,
+            sizeof(uint32_t)
+        ))
+    {
+        return false;
+    }
+    if (cache &&
+        (!birchTilerReserve(
+             (void **)&tiler->triangleHashes,
+             &tiler->triangleHashCapacity,
+             triangleCount,
+             sizeof(uint64_t)
+         ) ||
+         !birchTilerReserve(
+             (void **)&tiler->tileHashes,
+             &tiler->tileHashCapacity,
+             tileCount,
+             sizeof(uint64_t)
+         ) ||
+         !birchTileCacheFit(cache, tilesWide, tilesHigh)))
+    {
+        return false;
+    }
+
+    tiler->target = target;
+    tiler->vertices = vertices;
+    tiler->calls = callCount ? calls : NULL;
+    tiler->callCount = callCount;
+    tiler->textures = textures;
+    tiler->uniforms = uniforms;
+    tiler->cache = cache;
+    tiler->triangleCount = triangleCount;
+    tiler->binTasks = binTasks;
+    tiler->tilesWide = tilesWide;
+    tiler->tilesHigh = tilesHigh;
+
+    BIRCH_PROFILE_BEGIN(setup, "tiler setup");
+    birchThreadPoolRun(pool, binTasks, birchTilerSetupTask, tiler);
+    BIRCH_PROFILE_END(setup);
+
+    // Turn the counts into write offsets, tile-major and in task order
+    // within a tile so every bin lists its triangles in submission order
+    size_t binCount = 0;
+    for (size_t tile = 0; tile < tileCount; tile++)
+    {
+        tiler->tileStarts[tile] = (uint32_t)binCount;
+        for (size_t task = 0; task < binTasks; task++)
+        {
+            uint32_t *counts = &tiler->counts[task * tileCount + tile];
+            uint32_t tileCounts = *counts;
+            *counts = (uint32_t)binCount;
+            binCount += tileCounts;
+        }
+    }
+    tiler->tileStarts[tileCount] = (uint32_t)binCount;
+
+    if (!birchTilerReserve(
+            (void **)&tiler->bins,
+            &tiler->binCapacity,
+            binCount,
+            sizeof(uint32_t)
+        ))
+    {
+        return false;
+    }
+
+    BIRCH_PROFILE_BEGIN(bin, "tiler bin");
+    birchThreadPoolRun(pool, binTasks, birchTilerBinTask, tiler);
+    BIRCH_PROFILE_END(bin);
+
+    BIRCH_PROFILE_BEGIN(raster, "tiler raster");
+    birchThreadPoolRun(pool, tileCount, birchTilerRasterTask, tiler);
+    BIRCH_PROFILE_END(raster);
+    return true;
+}
@@ -0,0 +1,125 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef BIRCH_TILER_H
+#define BIRCH_TILER_H
+
+#include "drawList.h"
+#include "raster.h"
+#include "shaderTypes.h"
+#include "threadPool.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Sort-middle CPU renderer on top of raster.h. Triangles are set up and
+// binned into BIRCH_TILE_SIZE square tiles in parallel, then the tiles are
+// rasterized in parallel. Every tile draws its triangles in submission
+// order and a triangle's pixels do not depend on how it is clipped, so the
+// output is the same for any number of threads.
+//
+// Given a tile cache, every tile is also hashed from the setup of the
+// triangles binned into it, in order. Since a tile's pixels depend on
+// nothing else, tiles whose hash matches what the target already holds are
+// skipped; the rest are cleared and redrawn. The hash of a textured
+// triangle includes the generation of its texture.
+
+#define BIRCH_TILE_SIZE 64
+// Triangles set up and binned by one task
+#define BIRCH_TILER_BIN_TRIANGLES 1024
+
+// What a target holds: the hash of every tile as last rendered into it, 0
+// where unknown
+typedef struct
+{
+    uint64_t *hashes;
+    size_t capacity;
+    int tilesWide;
+    int tilesHigh;
+} BirchTileCache;
+
+typedef struct
+{
+    BirchRasterTriangle *triangles;
+    size_t triangleCapacity;
+    // per binning task and tile: triangle count, then write offset into bins
+    uint32_t *counts;
+    size_t countCapacity;
+    // first bin of every tile, plus one past the last
+    uint32_t *tileStarts;
+    size_t tileCapacity;
+    // triangle indices, grouped by tile
+    uint32_t *bins;
+    size_t binCapacity;
+    // per triangle and per tile, only computed when rendering with a cache
+    uint64_t *triangleHashes;
+    size_t triangleHashCapacity;
+    uint64_t *tileHashes;
+    size_t tileHashCapacity;
+
+    // the frame being rendered
+    const BirchRasterTarget *target;
+    const Vertex *vertices;
+    const BirchDrawBatch *calls;
+    size_t callCount;
+    const BirchRasterTexture *textures;
+    const VertexUniforms *uniforms;
+    BirchTileCache *cache;
+    size_t triangleCount;
+    size_t binTasks;
+    int tilesWide;
+    int tilesHigh;
+} BirchTiler;
+
+void birchTilerRelease(BirchTiler *tiler);
+
+void birchTileCacheRelease(BirchTileCache *cache);
+
+/// @brief Forget every tile, keeping the memory for the next
+/// birchTileCacheFit
+void birchTileCacheInvalidate(BirchTileCache *cache);
+
+/// @brief Size `cache` for a tilesWide x tilesHigh grid, forgetting every
+/// tile if the grid changed
+/// @return false if out of memory, the cache is then empty
+bool birchTileCacheFit(BirchTileCache *cache, int tilesWide, int tilesHigh);
+
+/// @brief Rasterize a triangle list into `target`, in order
+/// @param pool threads to use, NULL renders on the calling thread
+/// @param calls the draw calls of a flattened draw list, giving the
+/// pipeline and texture of every triangle. NULL fills every triangle with
+/// its vertex colors.
+/// @param textures indexed by the texture of a draw key minus one
+/// @param cache NULL to draw over the whole target, otherwise the tiles
+/// `target` holds. Only the tiles that changed are cleared to opaque black
+/// and redrawn, and `tiler->tileHashes` describes the frame afterwards.
+/// @return false if out of memory, the target is left untouched then
+bool birchTilerRender(
+    BirchTiler *tiler,
+    BirchThreadPool *pool,
+    const BirchRasterTarget *target,
+    BirchTileCache *cache,
+    const Vertex *vertices,
+    size_t count,
+    const BirchDrawBatch *calls,
+    size_t callCount,
+    const BirchRasterTexture *textures,
+    const VertexUniforms *uniforms
+);
+
+#endif
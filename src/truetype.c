@@ -0,0 +1,845 @@
+/**
+ * Copyright (C) 2024 Devin Rockwell
+ *
+ * This file is part of birch.
+ *
+ * birch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * birch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with birch.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "truetype.h"
+#include "heap.h"
+#include <math.h>
+#include <string.h>
+
+#define BIRCH_TRUETYPE_TAG(a, b, c, d)                                         \
+    ((uint32_t)(a) << 24 | (uint32_t)(b) << 16 | (uint32_t)(c) << 8 |          \
+     (uint32_t)(d))
+
+// Composite glyphs nest at most this deep, which also stops cycles
+#define BIRCH_TRUETYPE_MAX_DEPTH 8
+// Curves are flattened to within this distance of the curve, in the units
+// of the outline after scaling
+#define BIRCH_TRUETYPE_TOLERANCE 0.1f
+
+static inline uint8_t birchTrueTypeU8(const BirchTrueType *font, size_t offset)
+{
+    return offset < font->size ? font->data[offset] : 0;
+}
+
+static inline uint16_t
+birchTrueTypeU16(const BirchTrueType *font, size_t offset)
+{
+    if (offset >= font->size || font->size - offset < 2)
+    {
+        return 0;
+    }
+    const uint8_t *p = font->data + offset;
+    return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static inline int16_t birchTrueTypeI16(const BirchTrueType *font, size_t offset)
+{
+    return (int16_t)birchTrueTypeU16(font, offset);
+}
+
+static inline uint32_t
+birchTrueTypeU32(const BirchTrueType *font, size_t offset)
+{
+    if (offset >= font->size || font->size - offset < 4)
+    {
+        return 0;
+    }
+    const uint8_t *p = font->data + offset;
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 |
+           p[3];
+}
+
+// 2.14 fixed point, the scales of composite glyphs
+static inline float
+birchTrueTypeF2Dot14(const BirchTrueType *font, size_t offset)
+{
+    return birchTrueTypeI16(font, offset) / 16384.0f;
+}
+
+static uint32_t birchTrueTypeFindTable(
+    const BirchTrueType *font,
+    uint32_t directory,
+    const char *name
+)
+{
+    uint32_t tag = BIRCH_TRUETYPE_TAG(name[0], name[1], name[2], name[3]);
+    uint16_t tableCount = birchTrueTypeU16(font, directory + 4);
+    for (uint16_t i = 0; i < tableCount; i++)
+    {
+        uint32_t record = directory + 12 + 16 * (uint32_t)i;
+        if (birchTrueTypeU32(font, record) != tag)
+        {
+            continue;
+        }
+        uint32_t offset = birchTrueTypeU32(font, record + 8);
+        uint32_t length = birchTrueTypeU32(font, record + 12);
+        if (offset == 0 || offset > font->size ||
+            length > font->size - offset)
+        {
+            return 0;
+        }
+        return offset;
+    }
+    return 0;
+}
+
+// Prefer full Unicode (format 12) to the Basic Multilingual Plane (format
+// 4), from the Unicode or the Windows Unicode encodings
+static void birchTrueTypeFindCmap(BirchTrueType *font, uint32_t cmap)
+{
+    int best = 0;
+    uint16_t subtableCount = birchTrueTypeU16(font, cmap + 2);
+    for (uint16_t i = 0; i < subtableCount; i++)
+    {
+        uint32_t record = cmap + 4 + 8 * (uint32_t)i;
+        uint16_t platform = birchTrueTypeU16(font, record);
+        uint16_t encoding = birchTrueTypeU16(font, record + 2);
+        uint32_t subtable = cmap + birchTrueTypeU32(font, record + 4);
+        uint16_t format = birchTrueTypeU16(font, subtable);
+        bool windows = platform == 3 && (encoding == 1 || encoding == 10);
+        if (platform != 0 && !windows)
+        {
+            continue;
+        }
+
+        int score = format == 12 ? 2 : format == 4 ? 1 : 0;
+        if (score > best)
+        {
+            best = score;
+            font->cmap = subtable;
+            font->cmapFormat = format;
+        }
+    }
+}
+
+// Only the first subtable is used, and only if it holds ordered pairs for
+// horizontal text
+static void birchTrueTypeFindKerning(BirchTrueType *font, uint32_t kern)
+{
+    if (birchTrueTypeU16(font, kern) != 0 ||
+        birchTrueTypeU16(font, kern + 2) == 0)
+    {
+        return;
+    }
+    uint32_t subtable = kern + 4;
+    uint16_t coverage = birchTrueTypeU16(font, subtable + 4);
+    if ((coverage & 0xff07) != 0x0001)
+    {
+        return;
+    }
+    font->kern = subtable + 14;
+    font->kernPairs = birchTrueTypeU16(font, subtable + 6);
+}
+
+bool birchTrueTypeInit(BirchTrueType *font, const uint8_t *data, size_t size)
+{
+    memset(font, 0, sizeof(BirchTrueType));
+    font->data = data;
+    font->size = size;
+
+    // The first font of a collection
+    uint32_t directory = 0;
+    if (birchTrueTypeU32(font, 0) == BIRCH_TRUETYPE_TAG('t', 't', 'c', 'f'))
+    {
+        directory = birchTrueTypeU32(font, 12);
+    }
+    uint32_t version = birchTrueTypeU32(font, directory);
+    if (version != 0x00010000 &&
+        version != BIRCH_TRUETYPE_TAG('t', 'r', 'u', 'e'))
+    {
+        return false;
+    }
+
+    uint32_t head = birchTrueTypeFindTable(font, directory, "head");
+    uint32_t hhea = birchTrueTypeFindTable(font, directory, "hhea");
+    uint32_t maxp = birchTrueTypeFindTable(font, directory, "maxp");
+    uint32_t cmap = birchTrueTypeFindTable(font, directory, "cmap");
+    uint32_t kern = birchTrueTypeFindTable(font, directory, "kern");
+    font->glyf = birchTrueTypeFindTable(font, directory, "glyf");
+    font->loca = birchTrueTypeFindTable(font, directory, "loca");
+    font->hmtx = birchTrueTypeFindTable(font, directory, "hmtx");
+    if (!head || !hhea || !maxp || !cmap || !font->glyf || !font->loca ||
+        !font->hmtx)
+    {
+        return false;
+    }
+
+    font->unitsPerEm = birchTrueTypeU16(font, head + 18);
+    font->longLoca = birchTrueTypeI16(font, head + 50) != 0;
+    font->ascender = birchTrueTypeI16(font, hhea + 4);
+    font->descender = birchTrueTypeI16(font, hhea + 6);
+    font->lineGap = birchTrueTypeI16(font, hhea + 8);
+    font->numberOfHMetrics = birchTrueTypeU16(font, hhea + 34);
+    font->numGlyphs = birchTrueTypeU16(font, maxp + 4);
+    birchTrueTypeFindCmap(font, cmap);
+    if (kern)
+    {
+        birchTrueTypeFindKerning(font, kern);
+    }
+    return font->unitsPerEm != 0 && font->numberOfHMetrics != 0 &&
+           font->numGlyphs != 0 && font->cmap != 0;
+}
+
+static uint16_t
+birchTrueTypeGlyphFormat4(const BirchTrueType *font, uint32_t codepoint)
+{
+    if (codepoint > 0xffff)
+    {
+        return 0;
+    }
+    uint32_t cmap = font->cmap;
+    uint32_t segmentCount = birchTrueTypeU16(font, cmap + 6) / 2;
+    uint32_t ends = cmap + 14;
+    uint32_t starts = ends + 2 * segmentCount + 2;
+    uint32_t deltas = starts + 2 * segmentCount;
+    uint32_t rangeOffsets = deltas + 2 * segmentCount;
+
+    // The first segment ending at or after the code point
+    uint32_t low = 0;
+    uint32_t high = segmentCount;
+    while (low < high)
+    {
+        uint32_t middle = (low + high) / 2;
+        if (birchTrueTypeU16(font, ends + 2 * middle) < codepoint)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    if (low == segmentCount)
+    {
+        return 0;
+    }
+
+    uint16_t start = birchTrueTypeU16(font, starts + 2 * low);
+    if (codepoint < start)
+    {
+        return 0;
+    }
+    uint16_t delta = birchTrueTypeU16(font, deltas + 2 * low);
+    uint32_t rangeOffset = rangeOffsets + 2 * low;
+    uint16_t range = birchTrueTypeU16(font, rangeOffset);
+    if (range == 0)
+    {
+        return (uint16_t)(codepoint + delta);
+    }
+    // idRangeOffset is relative to where it is stored
+    uint16_t glyph = birchTrueTypeU16(
+        font,
+        rangeOffset + range + 2 * (codepoint - start)
+    );
+    return glyph ? (uint16_t)(glyph + delta) : 0;
+}
+
+static uint16_t
+birchTrueTypeGlyphFormat12(const BirchTrueType *font, uint32_t codepoint)
+{
+    uint32_t groupCount = birchTrueTypeU32(font, font->cmap + 12);
+    uint32_t groups = font->cmap + 16;
+    uint32_t low = 0;
+    uint32_t high = groupCount;
+    while (low < high)
+    {
+        uint32_t middle = low + (high - low) / 2;
+        uint32_t group = groups + 12 * middle;
+        if (codepoint < birchTrueTypeU32(font, group))
+        {
+            high = middle;
+        }
+        else if (codepoint > birchTrueTypeU32(font, group + 4))
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            uint32_t glyph = birchTrueTypeU32(font, group + 8) + codepoint -
+                             birchTrueTypeU32(font, group);
+            return glyph <= 0xffff ? (uint16_t)glyph : 0;
+        }
+    }
+    return 0;
+}
+
+uint16_t birchTrueTypeGlyph(const BirchTrueType *font, uint32_t codepoint)
+{
+    uint16_t glyph = font->cmapFormat == 12
+                         ? birchTrueTypeGlyphFormat12(font, codepoint)
+                         : birchTrueTypeGlyphFormat4(font, codepoint);
+    return glyph < font->numGlyphs ? glyph : 0;
+}
+
+void birchTrueTypeMetrics(
+    const BirchTrueType *font,
+    uint16_t glyph,
+    int *advance,
+    int *leftBearing
+)
+{
+    // Glyphs past the last full metric share its advance
+    uint32_t metrics = font->numberOfHMetrics;
+    if (glyph < metrics)
+    {
+        *advance = birchTrueTypeU16(font, font->hmtx + 4 * (uint32_t)glyph);
+        *leftBearing =
+            birchTrueTypeI16(font, font->hmtx + 4 * (uint32_t)glyph + 2);
+        return;
+    }
+    *advance = birchTrueTypeU16(font, font->hmtx + 4 * (metrics - 1));
+    *leftBearing = birchTrueTypeI16(
+        font,
+        font->hmtx + 4 * metrics + 2 * (uint32_t)(glyph - metrics)
+    );
+}
+
+// Pairs are sorted by left glyph, then right glyph
+void birchTrueTypeKerningPairs(
+    const BirchTrueType *font,
+    uint16_t left,
+    uint32_t *first,
+    uint32_t *count
+)
+{
+    uint32_t low = 0;
+    uint32_t high = font->kernPairs;
+    while (low < high)
+    {
+        uint32_t middle = (low + high) / 2;
+        if (birchTrueTypeU16(font, font->kern + 6 * middle) < left)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    *first = low;
+
+    high = font->kernPairs;
+    while (low < high)
+    {
+        uint32_t middle = (low + high) / 2;
+        if (birchTrueTypeU16(font, font->kern + 6 * middle) <= left)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    *count = low - *first;
+}
+
+int birchTrueTypeKerning(
+    const BirchTrueType *font,
+    uint32_t first,
+    uint32_t count,
+    uint16_t right
+)
+{
+    uint32_t low = first;
+    uint32_t high = first + count;
+    while (low < high)
+    {
+        uint32_t middle = (low + high) / 2;
+        uint32_t pair = font->kern + 6 * middle;
+        uint16_t pairRight = birchTrueTypeU16(font, pair + 2);
+        if (pairRight < right)
+        {
+            low = middle + 1;
+        }
+        else if (pairRight > right)
+        {
+            high = middle;
+        }
+        else
+        {
+            return birchTrueTypeI16(font, pair + 4);
+        }
+    }
+    return 0;
+}
+
+// Where the glyph's data starts in the font, 0 if it has none
+static uint32_t
+birchTrueTypeGlyphOffset(const BirchTrueType *font, uint16_t glyph)
+{
+    if (glyph >= font->numGlyphs)
+    {
+        return 0;
+    }
+    uint32_t start, end;
+    if (font->longLoca)
+    {
+        start = birchTrueTypeU32(font, font->loca + 4 * (uint32_t)glyph);
+        end = birchTrueTypeU32(font, font->loca + 4 * (uint32_t)glyph + 4);
+    }
+    else
+    {
+        start = 2u * birchTrueTypeU16(font, font->loca + 2 * (uint32_t)glyph);
+        end = 2u * birchTrueTypeU16(font, font->loca + 2 * (uint32_t)glyph + 2);
+    }
+    // The header alone is 10 bytes
+    if (end <= start || end - start < 10 ||
+        start > font->size - font->glyf ||
+        end - start > font->size - font->glyf - start)
+    {
+        return 0;
+    }
+    return font->glyf + start;
+}
+
+bool birchTrueTypeBounds(
+    const BirchTrueType *font,
+    uint16_t glyph,
+    int *minX,
+    int *minY,
+    int *maxX,
+    int *maxY
+)
+{
+    uint32_t offset = birchTrueTypeGlyphOffset(font, glyph);
+    if (!offset || birchTrueTypeI16(font, offset) == 0)
+    {
+        return false;
+    }
+    *minX = birchTrueTypeI16(font, offset + 2);
+    *minY = birchTrueTypeI16(font, offset + 4);
+    *maxX = birchTrueTypeI16(font, offset + 6);
+    *maxY = birchTrueTypeI16(font, offset + 8);
+    return *minX < *maxX && *minY < *maxY;
+}
+
+typedef struct
+{
+    float x;
+    float y;
+    bool onCurve;
+} BirchTrueTypePoint;
+
+static bool birchTrueTypeLine(
+    BirchTrueTypeOutline *outline,
+    float x0,
+    float y0,
+    float x1,
+    float y1
+)
+{
+    if (x0 == x1 && y0 == y1)
+    {
+        return true;
+    }
+    if (outline->count == outline->capacity)
+    {
+        size_t capacity = outline->capacity ? outline->capacity * 2 : 64;
+        BirchTrueTypeSegment *segments = birchReallocate(
+            outline->segments,
+            capacity * sizeof(BirchTrueTypeSegment)
+        );
+        if (!segments)
+        {
+            return false;
+        }
+        outline->segments = segments;
+        outline->capacity = capacity;
+    }
+    outline->segments[outline->count++] =
+        (BirchTrueTypeSegment){x0, y0, x1, y1};
+    return true;
+}
+
+static bool birchTrueTypeCurve(
+    BirchTrueTypeOutline *outline,
+    float x0,
+    float y0,
+    float cx,
+    float cy,
+    float x1,
+    float y1
+)
+{
+    // A quadratic flattened into n lines strays at most |p0 - 2c + p1| / 8n²
+    // from the curve
+    float dx = x0 - 2 * cx + x1;
+    float dy = y0 - 2 * cy + y1;
+    float deviation = sqrtf(dx * dx + dy * dy);
+    int steps = (int)ceilf(sqrtf(deviation / (8 * BIRCH_TRUETYPE_TOLERANCE)));
+    steps = steps < 1 ? 1 : steps > 32 ? 32 : steps;
+
+    float lastX = x0;
+    float lastY = y0;
+    for (int i = 1; i <= steps; i++)
+    {
+        float t = (float)i / steps;
+        float s = 1 - t;
+        float x = s * s * x0 + 2 * s * t * cx + t * t * x1;
+        float y = s * s * y0 + 2 * s * t * cy + t * t * y1;
+        if (!birchTrueTypeLine(outline, lastX, lastY, x, y))
+        {
+            return false;
+        }
+        lastX = x;
+        lastY = y;
+    }
+    return true;
+}
+
+// Two off-curve points in a row imply an on-curve point halfway between
+// them. A contour without any on-curve point starts at such a midpoint.
+static bool birchTrueTypeContour(
+    BirchTrueTypeOutline *outline,
+    const BirchTrueTypePoint *points,
+    size_t count
+)
+{
+    if (count < 2)
+    {
+        return true;
+    }
+    size_t first = 0;
+    while (first < count && !points[first].onCurve)
+    {
+        first++;
+    }
+
+    float startX, startY;
+    size_t next;
+    if (first < count)
+    {
+        startX = points[first].x;
+        startY = points[first].y;
+        next = first + 1;
+    }
+    else
+    {
+        startX = (points[count - 1].x + points[0].x) / 2;
+        startY = (points[count - 1].y + points[0].y) / 2;
+        next = 0;
+    }
+
+    float x = startX;
+    float y = startY;
+    bool control = false;
+    float controlX = 0;
+    float controlY = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        const BirchTrueTypePoint *point = &points[(next + i) % count];
+        bool ok = true;
+        if (point->onCurve)
+        {
+            if (control)
+            {
+                ok = birchTrueTypeCurve(
+                    outline,
+                    x,
+                    y,
+                    controlX,
+                    controlY,
+                    point->x,
+                    point->y
+                );
+            }
+            else
+            {
+                ok = birchTrueTypeLine(outline, x, y, point->x, point->y);
+            }
+            x = point->x;
+            y = point->y;
+            control = false;
+        }
+        else
+        {
+            if (control)
+            {
+                float middleX = (controlX + point->x) / 2;
+                float middleY = (controlY + point->y) / 2;
+                ok = birchTrueTypeCurve(
+                    outline,
+                    x,
+                    y,
+                    controlX,
+                    controlY,
+                    middleX,
+                    middleY
+                );
+                x = middleX;
+                y = middleY;
+            }
+            controlX = point->x;
+            controlY = point->y;
+            control = true;
+        }
+        if (!ok)
+        {
+            return false;
+        }
+    }
+
+    if (control)
+    {
+        return birchTrueTypeCurve(
+            outline,
+            x,
+            y,
+            controlX,
+            controlY,
+            startX,
+            startY
+        );
+    }
+    return birchTrueTypeLine(outline, x, y, startX, startY);
+}
+
+// `matrix` maps font units to the outline: x' = m0 x + m2 y + m4,
+// y' = m1 x + m3 y + m5
+static bool birchTrueTypeSimple(
+    const BirchTrueType *font,
+    uint32_t offset,
+    int contourCount,
+    const float matrix[6],
+    BirchTrueTypeOutline *outline
+)
+{
+    uint32_t endPoints = offset + 10;
+    size_t pointCount =
+        (size_t)birchTrueTypeU16(font, endPoints + 2 * (contourCount - 1)) + 1;
+    uint32_t instructions = endPoints + 2 * contourCount;
+    size_t p = instructions + 2 + birchTrueTypeU16(font, instructions);
+
+    uint8_t *flags = birchAllocate(pointCount);
+    BirchTrueTypePoint *points =
+        birchAllocate(pointCount * sizeof(BirchTrueTypePoint));
+    if (!flags || !points)
+    {
+        birchFree(flags);
+        birchFree(points);
+        return false;
+    }
+
+    for (size_t i = 0; i < pointCount;)
+    {
+        uint8_t flag = birchTrueTypeU8(font, p++);
+        flags[i++] = flag;
+        if (flag & 0x08)
+        {
+            for (uint8_t repeat = birchTrueTypeU8(font, p++);
+                 repeat > 0 && i < pointCount;
+                 repeat--)
+            {
+                flags[i++] = flag;
+            }
+        }
+    }
+
+    // Coordinates are deltas: a byte with the sign in the flags, nothing
+    // for a repeat of the last value, or a signed 16 bit word. All the x
+    // come before all the y.
+    int32_t value = 0;
+    for (size_t i = 0; i < pointCount; i++)
+    {
+        if (flags[i] & 0x02)
+        {
+            uint8_t delta = birchTrueTypeU8(font, p++);
+            value += flags[i] & 0x10 ? delta : -delta;
+        }
+        else if (!(flags[i] & 0x10))
+        {
+            value += birchTrueTypeI16(font, p);
+            p += 2;
+        }
+        points[i].x = (float)value;
+        points[i].onCurve = flags[i] & 0x01;
+    }
+    value = 0;
+    for (size_t i = 0; i < pointCount; i++)
+    {
+        if (flags[i] & 0x04)
+        {
+            uint8_t delta = birchTrueTypeU8(font, p++);
+            value += flags[i] & 0x20 ? delta : -delta;
+        }
+        else if (!(flags[i] & 0x20))
+        {
+            value += birchTrueTypeI16(font, p);
+            p += 2;
+        }
+        float x = points[i].x;
+        float y = (float)value;
+        points[i].x = matrix[0] * x + matrix[2] * y + matrix[4];
+        points[i].y = matrix[1] * x + matrix[3] * y + matrix[5];
+    }
+
+    bool ok = true;
+    size_t start = 0;
+    for (int i = 0; i < contourCount && ok; i++)
+    {
+        size_t end = birchTrueTypeU16(font, endPoints + 2 * i);
+        if (end < start || end >= pointCount)
+        {
+            break;
+        }
+        ok = birchTrueTypeContour(outline, points + start, end - start + 1);
+        start = end + 1;
+    }
+
+    birchFree(flags);
+    birchFree(points);
+    return ok;
+}
+
+static bool birchTrueTypeGlyphOutline(
+    const BirchTrueType *font,
+    uint16_t glyph,
+    const float matrix[6],
+    BirchTrueTypeOutline *outline,
+    int depth
+);
+
+// Composite glyphs place other glyphs, each moved and optionally scaled or
+// transformed. Aligning components by point numbers is not supported,
+// those are placed unmoved.
+static bool birchTrueTypeComposite(
+    const BirchTrueType *font,
+    uint32_t offset,
+    const float matrix[6],
+    BirchTrueTypeOutline *outline,
+    int depth
+)
+{
+    size_t p = offset + 10;
+    uint16_t flags;
+    do
+    {
+        flags = birchTrueTypeU16(font, p);
+        uint16_t component = birchTrueTypeU16(font, p + 2);
+        p += 4;
+
+        float dx, dy;
+        if (flags & 0x0001)
+        {
+            dx = birchTrueTypeI16(font, p);
+            dy = birchTrueTypeI16(font, p + 2);
+            p += 4;
+        }
+        else
+        {
+            dx = (int8_t)birchTrueTypeU8(font, p);
+            dy = (int8_t)birchTrueTypeU8(font, p + 1);
+            p += 2;
+        }
+        if (!(flags & 0x0002))
+        {
+            dx = 0;
+            dy = 0;
+        }
+
+        float a = 1, b = 0, c = 0, d = 1;
+        if (flags & 0x0008)
+        {
+            a = d = birchTrueTypeF2Dot14(font, p);
+            p += 2;
+        }
+        else if (flags & 0x0040)
+        {
+            a = birchTrueTypeF2Dot14(font, p);
+            d = birchTrueTypeF2Dot14(font, p + 2);
+            p += 4;
+        }
+        else if (flags & 0x0080)
+        {
+            a = birchTrueTypeF2Dot14(font, p);
+            b = birchTrueTypeF2Dot14(font, p + 2);
+            c = birchTrueTypeF2Dot14(font, p + 4);
+            d = birchTrueTypeF2Dot14(font, p + 6);
+            p += 8;
+        }
+
+        float placed[6] = {
+            matrix[0] * a + matrix[2] * b,
+            matrix[1] * a + matrix[3] * b,
+            matrix[0] * c + matrix[2] * d,
+            matrix[1] * c + matrix[3] * d,
+            matrix[0] * dx + matrix[2] * dy + matrix[4],
+            matrix[1] * dx + matrix[3] * dy + matrix[5],
+        };
+        if (!birchTrueTypeGlyphOutline(
+                font,
+                component,
+                placed,
+                outline,
+                depth + 1
+            ))
+        {
+            return false;
+        }
+    } while ((flags & 0x0020) && p < font->size);
+    return true;
+}
+
+static bool birchTrueTypeGlyphOutline(
+    const BirchTrueType *font,
+    uint16_t glyph,
+    const float matrix[6],
+    BirchTrueTypeOutline *outline,
+    int depth
+)
+{
+    uint32_t offset = birchTrueTypeGlyphOffset(font, glyph);
+    if (!offset || depth > BIRCH_TRUETYPE_MAX_DEPTH)
+    {
+        return true;
+    }
+    int contourCount = birchTrueTypeI16(font, offset);
+    if (contourCount > 0)
+    {
+        return birchTrueTypeSimple(font, offset, contourCount, matrix, outline);
+    }
+    if (contourCount < 0)
+    {
+        return birchTrueTypeComposite(font, offset, matrix, outline, depth);
+    }
+    return true;
+}
+
+bool birchTrueTypeOutline(
+    const BirchTrueType *font,
+    uint16_t glyph,
+    float scale,
+    float x,
+    float y,
+    BirchTrueTypeOutline *outline
+)
+{
+    float matrix[6] = {scale, 0, 0, scale, x, y};
+    outline->count = 0;
+    return birchTrueTypeGlyphOutline(font, glyph, matrix, outline, 0);
+}
+
+void birchTrueTypeOutlineRelease(BirchTrueTypeOutline *outline)
+{
+    birchFree(outline->segments);
+    outline->segments = NULL;
+    outline->count = 0;
+    outline->capacity = 0;
+}
@@ -0,0 +1,130 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef BIRCH_TRUETYPE_H
+#define BIRCH_TRUETYPE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Just enough of TrueType to draw text: character to glyph mapping through
+// cmap formats 4 and 12, horizontal metrics, pair kerning from the kern
+// table, and glyph outlines from glyf, composites included. OpenType
+// layout tables (GSUB, GPOS) and CFF outlines are not read. Every read is
+// bounds checked, a corrupt font yields empty glyphs rather than reading out
+// of bounds. The font data is not copied.
+
+typedef struct
+{
+    const uint8_t *data;
+    size_t size;
+    // table offsets, 0 when the font has none
+    uint32_t glyf;
+    uint32_t loca;
+    uint32_t hmtx;
+    uint32_t kern;
+    // the cmap subtable in use, format 4 or 12
+    uint32_t cmap;
+    uint16_t cmapFormat;
+    uint16_t numGlyphs;
+    uint16_t numberOfHMetrics;
+    uint16_t kernPairs;
+    bool longLoca;
+    uint16_t unitsPerEm;
+    int16_t ascender;
+    int16_t descender;
+    int16_t lineGap;
+} BirchTrueType;
+
+typedef struct
+{
+    float x0;
+    float y0;
+    float x1;
+    float y1;
+} BirchTrueTypeSegment;
+
+// Outline flattened to line segments, y up
+typedef struct
+{
+    BirchTrueTypeSegment *segments;
+    size_t count;
+    size_t capacity;
+} BirchTrueTypeOutline;
+
+/// @brief Read the tables of a TrueType font
+/// @return false if `data` is not a TrueType font birch can use
+bool birchTrueTypeInit(BirchTrueType *font, const uint8_t *data, size_t size);
+
+/// @brief The glyph of a Unicode code point, 0 (.notdef) if missing
+uint16_t birchTrueTypeGlyph(const BirchTrueType *font, uint32_t codepoint);
+
+/// @brief Advance width and left side bearing of a glyph in font units
+void birchTrueTypeMetrics(
+    const BirchTrueType *font,
+    uint16_t glyph,
+    int *advance,
+    int *leftBearing
+);
+
+/// @brief Find the kerning pairs whose left glyph is `left`
+/// @param first receives the index of the first pair
+/// @param count receives the number of pairs, 0 if the glyph has none
+void birchTrueTypeKerningPairs(
+    const BirchTrueType *font,
+    uint16_t left,
+    uint32_t *first,
+    uint32_t *count
+);
+
+/// @brief Adjustment of the advance between a left glyph, given by its
+/// pairs from birchTrueTypeKerningPairs, and `right`, in font units
+int birchTrueTypeKerning(
+    const BirchTrueType *font,
+    uint32_t first,
+    uint32_t count,
+    uint16_t right
+);
+
+/// @brief Bounding box of a glyph in font units
+/// @return false if the glyph has no outline, like a space
+bool birchTrueTypeBounds(
+    const BirchTrueType *font,
+    uint16_t glyph,
+    int *minX,
+    int *minY,
+    int *maxX,
+    int *maxY
+);
+
+/// @brief Flatten the outline of a glyph, scaled by `scale` and moved by
+/// `x`, `y`, into `outline`, which is emptied first
+/// @return false if out of memory
+bool birchTrueTypeOutline(
+    const BirchTrueType *font,
+    uint16_t glyph,
+    float scale,
+    float x,
+    float y,
+    BirchTrueTypeOutline *outline
+);
+
+void birchTrueTypeOutlineRelease(BirchTrueTypeOutline *outline);
+
+#endif
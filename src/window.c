@@ -17,14 +17,34 @@
  * along with birch.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "allocator.h"
+#include "clock.h"
+#include "heap.h"
+#include "initInternal.h"
+#include "profile.h"
+#include "replayInternal.h"
 #include "window.h"
+#include "windowInternal.h"
+#include <math.h>
 #include <stdlib.h>
+#include <string.h>
 
 void
 birchWindowSetMouseMovedCallback(BirchWindow *window,
                                  void (*mouseMovedCallback)(int x, int y))
 {
   window->mouseMovedCallback = mouseMovedCallback;
+  window->state->handlers.mouseMoved = NULL;
+}
+
+void
+birchWindowSetMouseMovedHandler(BirchWindow *window,
+                                void (*handler)(void *userData, int x, int y),
+                                void *userData)
+{
+  window->mouseMovedCallback = NULL;
+  window->state->handlers.mouseMoved = handler;
+  window->state->handlers.mouseMovedData = userData;
 }
 
 void
@@ -32,6 +52,17 @@ birchWindowSetResizeCallback(BirchWindow *window,
                              void (*resizeCallback)(int width, int height))
 {
   window->resizeCallback = resizeCallback;
+  window->state->handlers.resize = NULL;
+}
+
+void
+birchWindowSetResizeHandler(
+    BirchWindow *window, void (*handler)(void *userData, int width, int height),
+    void *userData)
+{
+  window->resizeCallback = NULL;
+  window->state->handlers.resize = handler;
+  window->state->handlers.resizeData = userData;
 }
 
 void
@@ -39,6 +70,17 @@ birchWindowSetKeyPressedCallback(BirchWindow *window,
                                  void (*keyPressedCallback)(int key))
 {
   window->keyPressedCallback = keyPressedCallback;
+  window->state->handlers.keyPressed = NULL;
+}
+
+void
+birchWindowSetKeyPressedHandler(BirchWindow *window,
+                                void (*handler)(void *userData, int key),
+                                void *userData)
+{
+  window->keyPressedCallback = NULL;
+  window->state->handlers.keyPressed = handler;
+  window->state->handlers.keyPressedData = userData;
 }
 
 void
@@ -46,6 +88,17 @@ birchWindowSetKeyReleasedCallback(BirchWindow *window,
                                   void (*keyReleasedCallback)(int key))
 {
   window->keyReleasedCallback = keyReleasedCallback;
+  window->state->handlers.keyReleased = NULL;
+}
+
+void
+birchWindowSetKeyReleasedHandler(BirchWindow *window,
+                                 void (*handler)(void *userData, int key),
+                                 void *userData)
+{
+  window->keyReleasedCallback = NULL;
+  window->state->handlers.keyReleased = handler;
+  window->state->handlers.keyReleasedData = userData;
 }
 
 void
@@ -53,6 +106,17 @@ birchWindowSetMouseButtonPressedCallback(
     BirchWindow *window, void (*mouseButtonPressedCallback)(int button))
 {
   window->mouseButtonPressedCallback = mouseButtonPressedCallback;
+  window->state->handlers.mouseButtonPressed = NULL;
+}
+
+void
+birchWindowSetMouseButtonPressedHandler(
+    BirchWindow *window, void (*handler)(void *userData, int button),
+    void *userData)
+{
+  window->mouseButtonPressedCallback = NULL;
+  window->state->handlers.mouseButtonPressed = handler;
+  window->state->handlers.mouseButtonPressedData = userData;
 }
 
 void
@@ -60,4 +124,810 @@ birchWindowSetMouseButtonReleasedCallback(
     BirchWindow *window, void (*mouseButtonReleasedCallback)(int button))
 {
   window->mouseButtonReleasedCallback = mouseButtonReleasedCallback;
+  window->state->handlers.mouseButtonReleased = NULL;
+}
+
+void
+birchWindowSetMouseButtonReleasedHandler(
+    BirchWindow *window, void (*handler)(void *userData, int button),
+    void *userData)
+{
+  window->mouseButtonReleasedCallback = NULL;
+  window->state->handlers.mouseButtonReleased = handler;
+  window->state->handlers.mouseButtonReleasedData = userData;
+}
+
+// birchPollEvents calls so far
+static uint64_t birchPolls = 0;
+
+bool
+birchWindowInitBase(BirchWindow *window, unsigned int width,
+                    unsigned int height, const char *title)
+{
+  window->width = width;
+  window->height = height;
+  window->title = title;
+  window->mouseMovedCallback = NULL;
+  window->resizeCallback = NULL;
+  window->keyPressedCallback = NULL;
+  window->keyReleasedCallback = NULL;
+  window->mouseButtonPressedCallback = NULL;
+  window->mouseButtonReleasedCallback = NULL;
+
+  window->state = birchAllocateZeroed(1, sizeof(BirchWindowState));
+  if (!window->state)
+    {
+      return false;
+    }
+
+  window->state->eventMode = BIRCH_EVENT_MODE_CALLBACKS;
+  window->state->polls = birchPolls;
+  birchHeapGetCounters(&window->state->frameStart);
+  if (!birchEventQueueInit(&window->state->events,
+                           BIRCH_EVENT_QUEUE_CAPACITY))
+    {
+      birchFree(window->state);
+      window->state = NULL;
+      return false;
+    }
+  birchMutexInit(&window->state->renderLock);
+  birchAtlasInit(&window->state->atlas);
+  return true;
+}
+
+void
+birchWindowFreeBase(BirchWindow *window)
+{
+  // First, so backends free their part of the window afterwards
+  birchRenderThreadStop(&window->state->renderThread);
+  birchRenderThreadRelease(&window->state->renderThread);
+  birchStreamRelease(&window->state->stream);
+  while (window->state->fonts)
+    {
+      birchFontFree(window->state->fonts);
+    }
+  birchAtlasRelease(&window->state->atlas);
+  birchDrawListRelease(&window->state->drawList);
+  birchDrawListRelease(&window->state->submitted);
+  birchEventQueueRelease(&window->state->events);
+  birchWindowStopRecording(window);
+  birchWindowStopReplay(window);
+  birchArenaRelease(&window->state->arena);
+  birchArenaRelease(&window->state->renderArena);
+  birchMutexDestroy(&window->state->renderLock);
+  birchFree(window->state->recordingHistory.samples);
+  birchFree(window->state->mouseHistory.samples);
+  birchFree(window->state);
+  window->state = NULL;
+}
+
+void
+birchWindowLockRender(BirchWindow *window)
+{
+  birchMutexLock(&window->state->renderLock);
+}
+
+void
+birchWindowUnlockRender(BirchWindow *window)
+{
+  birchMutexUnlock(&window->state->renderLock);
+}
+
+static void
+birchFrameTimesRecord(BirchFrameTimes *times, uint64_t end)
+{
+  if (times->last)
+    {
+      times->times[times->index] = end - times->last;
+      times->index = (times->index + 1) % BIRCH_FRAME_STATS_FRAMES;
+      if (times->count < BIRCH_FRAME_STATS_FRAMES)
+        {
+          times->count++;
+        }
+    }
+  times->last = end;
+}
+
+void
+birchWindowRenderFrame(BirchWindow *window, BirchDrawList *frame)
+{
+  BirchWindowState *state = window->state;
+
+  birchMutexLock(&state->renderLock);
+  BirchDrawList submitted = state->submitted;
+  state->submitted = *frame;
+  *frame = submitted;
+
+  birchPlatformRender(window);
+  uint64_t presented = birchClockNow();
+  birchFrameTimesRecord(&state->presentTimes, presented);
+  uint64_t input = state->submitted.inputTime;
+  if (input)
+    {
+      BirchLatencyTimes *latencies = &state->latencies;
+      latencies->times[latencies->index]
+          = presented > input ? presented - input : 0;
+      latencies->index = (latencies->index + 1) % BIRCH_LATENCY_FRAMES;
+      if (latencies->count < BIRCH_LATENCY_FRAMES)
+        {
+          latencies->count++;
+        }
+    }
+  birchArenaReset(&state->renderArena);
+  birchMutexUnlock(&state->renderLock);
+}
+
+size_t
+birchWindowFlattenDraws(BirchWindow *window, Vertex *out)
+{
+  BirchDrawList *list = &window->state->submitted;
+  size_t calls = birchDrawListFlatten(list, out, &window->state->renderArena);
+
+  window->state->drawStats = (BirchDrawStats){
+    .primitives = list->primitives,
+    .vertices = list->vertexCount,
+    .batches = list->batchCount,
+    .drawCalls = calls,
+  };
+  return calls;
+}
+
+void
+birchWindowGetStreamStats(BirchWindow *window, BirchStreamStats *stats)
+{
+  birchWindowLockRender(window);
+  *stats = window->state->stream.last;
+  birchWindowUnlockRender(window);
+}
+
+bool
+birchWindowFrameChanged(BirchWindow *window, const VertexUniforms *uniforms,
+                        int width, int height)
+{
+  BirchWindowState *state = window->state;
+
+  return birchDamageCompareFrame(&state->damage, &state->lastFrame,
+                                 &state->submitted, state->atlas.generation,
+                                 uniforms, width, height);
+}
+
+void
+birchWindowGetDamageStats(BirchWindow *window, BirchDamageStats *stats)
+{
+  const BirchDamage *damage = &window->state->damage;
+
+  birchWindowLockRender(window);
+  *stats = (BirchDamageStats){
+    .rects = damage->count,
+    .pixels = birchDamageArea(damage),
+    .totalPixels = (size_t)damage->width * damage->height,
+  };
+  birchWindowUnlockRender(window);
+}
+
+void
+birchWindowSetEventMode(BirchWindow *window, BirchEventMode mode)
+{
+  window->state->eventMode = mode;
+}
+
+size_t
+birchWindowPollEvents(BirchWindow *window, BirchEvent *events, size_t max)
+{
+  return birchEventQueuePop(&window->state->events, events, max);
+}
+
+uint64_t
+birchWindowGetEventTime(BirchWindow *window)
+{
+  return window->state->eventTime;
+}
+
+size_t
+birchWindowGetCoalescedResizes(BirchWindow *window)
+{
+  return window->state->coalescedResizes;
+}
+
+size_t
+birchWindowGetDroppedEvents(BirchWindow *window)
+{
+  return atomic_load_explicit(&window->state->events.dropped,
+                              memory_order_relaxed);
+}
+
+static bool
+birchWindowQueueing(BirchWindow *window)
+{
+  return window->state->eventMode == BIRCH_EVENT_MODE_QUEUE;
+}
+
+// Note when an event about to be delivered was reported
+static void
+birchWindowNoteInput(BirchWindow *window, uint64_t time)
+{
+  BirchWindowState *state = window->state;
+
+  state->eventTime = time;
+  if (!state->updateInput || time < state->updateInput)
+    {
+      state->updateInput = time;
+    }
+}
+
+// Log the event if the window is recording
+static void
+birchWindowRecord(BirchWindow *window, const BirchEvent *event)
+{
+  if (window->state->recorder)
+    {
+      birchRecorderWriteEvent(window->state->recorder, event, event->time);
+    }
+}
+
+static void
+birchWindowEmitMouseMoved(BirchWindow *window, int x, int y, uint64_t time)
+{
+  birchWindowNoteInput(window, time);
+  if (birchWindowQueueing(window))
+    {
+      BirchEvent event = { .type = BIRCH_EVENT_MOUSE_MOVED,
+                           .time = time,
+                           .mouse = { x, y } };
+      birchEventQueuePush(&window->state->events, &event);
+    }
+  else if (window->mouseMovedCallback)
+    {
+      window->mouseMovedCallback(x, y);
+    }
+  else if (window->state->handlers.mouseMoved)
+    {
+      BirchWindowHandlers *handlers = &window->state->handlers;
+      handlers->mouseMoved(handlers->mouseMovedData, x, y);
+    }
+}
+
+static void
+birchWindowFlushMotion(BirchWindow *window)
+{
+  BirchWindowState *state = window->state;
+
+  if (state->motionPending)
+    {
+      state->motionPending = false;
+      birchWindowEmitMouseMoved(window, (int)state->motion.x,
+                                (int)state->motion.y, state->motion.time);
+    }
+}
+
+static void
+birchWindowRecordMotion(BirchWindow *window, BirchMouseSample sample)
+{
+  BirchMouseHistory *history = &window->state->recordingHistory;
+
+  if (history->count == history->capacity)
+    {
+      size_t capacity = history->capacity ? history->capacity * 2 : 256;
+      BirchMouseSample *samples
+          = birchReallocate(history->samples,
+                            capacity * sizeof(BirchMouseSample));
+      if (!samples)
+        {
+          return;
+        }
+      history->samples = samples;
+      history->capacity = capacity;
+    }
+  history->samples[history->count++] = sample;
+}
+
+void
+birchWindowDispatchMouseMoved(BirchWindow *window, float x, float y,
+                              uint64_t time)
+{
+  BirchWindowState *state = window->state;
+
+  if (state->recorder)
+    {
+      birchRecorderWriteMotion(state->recorder, x, y, time);
+    }
+  if (!state->coalesceMouse)
+    {
+      birchWindowEmitMouseMoved(window, (int)x, (int)y, time);
+      return;
+    }
+
+  // Delivered later, but it is the oldest input of the update
+  birchWindowNoteInput(window, time);
+  BirchMouseSample sample = { x, y, time };
+  birchWindowRecordMotion(window, sample);
+  state->motion = sample;
+  state->motionPending = true;
+}
+
+void
+birchWindowSetMouseCoalescing(BirchWindow *window, bool coalesce)
+{
+  if (!coalesce)
+    {
+      birchWindowFlushMotion(window);
+    }
+  window->state->coalesceMouse = coalesce;
+}
+
+const BirchMouseSample *
+birchWindowGetMouseHistory(BirchWindow *window, size_t *count)
+{
+  *count = window->state->mouseHistory.count;
+  return window->state->mouseHistory.samples;
+}
+
+static void
+birchKeyStateSet(BirchKeyState *keys, int code, int last, bool down)
+{
+  if (code < 0 || code > last)
+    {
+      return;
+    }
+  uint64_t bit = (uint64_t)1 << (code % 64);
+  uint64_t *word = &keys->down[code / 64];
+  // Auto repeat presses keys that are already down
+  if (down && !(*word & bit))
+    {
+      *word |= bit;
+      keys->pressed[code / 64] |= bit;
+    }
+  else if (!down && (*word & bit))
+    {
+      *word &= ~bit;
+      keys->released[code / 64] |= bit;
+    }
+}
+
+static void
+birchKeyStateClearEdges(BirchKeyState *keys)
+{
+  memset(keys->pressed, 0, sizeof(keys->pressed));
+  memset(keys->released, 0, sizeof(keys->released));
+}
+
+static bool
+birchKeyStateTest(const uint64_t *words, int code, int last)
+{
+  return (unsigned int)code <= (unsigned int)last
+         && (words[code / 64] >> (code % 64) & 1);
+}
+
+bool
+birchWindowIsKeyDown(BirchWindow *window, int key)
+{
+  return birchKeyStateTest(window->state->keys.down, key, BIRCH_KEY_LAST);
+}
+
+bool
+birchWindowWasKeyPressed(BirchWindow *window, int key)
+{
+  return birchKeyStateTest(window->state->keys.pressed, key, BIRCH_KEY_LAST);
+}
+
+bool
+birchWindowWasKeyReleased(BirchWindow *window, int key)
+{
+  return birchKeyStateTest(window->state->keys.released, key,
+                           BIRCH_KEY_LAST);
+}
+
+bool
+birchWindowIsMouseButtonDown(BirchWindow *window, int button)
+{
+  return birchKeyStateTest(window->state->buttons.down, button,
+                           BIRCH_MOUSE_BUTTON_COUNT - 1);
+}
+
+bool
+birchWindowWasMouseButtonPressed(BirchWindow *window, int button)
+{
+  return birchKeyStateTest(window->state->buttons.pressed, button,
+                           BIRCH_MOUSE_BUTTON_COUNT - 1);
+}
+
+bool
+birchWindowWasMouseButtonReleased(BirchWindow *window, int button)
+{
+  return birchKeyStateTest(window->state->buttons.released, button,
+                           BIRCH_MOUSE_BUTTON_COUNT - 1);
+}
+
+static void
+birchWindowFlushResize(BirchWindow *window)
+{
+  BirchWindowState *state = window->state;
+
+  if (!state->resizePending)
+    {
+      return;
+    }
+  state->resizePending = false;
+
+  BirchEvent event = state->resize;
+  int width = event.size.width;
+  int height = event.size.height;
+  birchWindowRecord(window, &event);
+  if (birchWindowQueueing(window))
+    {
+      birchEventQueuePush(&state->events, &event);
+    }
+  else if (window->resizeCallback)
+    {
+      window->resizeCallback(width, height);
+    }
+  else if (state->handlers.resize)
+    {
+      state->handlers.resize(state->handlers.resizeData, width, height);
+    }
+}
+
+void
+birchWindowDispatchResize(BirchWindow *window, int width, int height,
+                          uint64_t time)
+{
+  BirchWindowState *state = window->state;
+
+  // Live resizing reports a size per step, applications only need the
+  // last one of the update
+  birchWindowNoteInput(window, time);
+  if (state->resizePending)
+    {
+      state->coalescedResizes++;
+    }
+  state->resize = (BirchEvent){ .type = BIRCH_EVENT_RESIZE,
+                                .time = time,
+                                .size = { width, height } };
+  state->resizePending = true;
+}
+
+void
+birchWindowDispatchKeyPressed(BirchWindow *window, int key, uint64_t time)
+{
+  BirchEvent event
+      = { .type = BIRCH_EVENT_KEY_PRESSED, .time = time, .key = key };
+
+  birchWindowFlushMotion(window);
+  birchWindowNoteInput(window, time);
+  birchKeyStateSet(&window->state->keys, key, BIRCH_KEY_LAST, true);
+  birchWindowRecord(window, &event);
+  if (birchWindowQueueing(window))
+    {
+      birchEventQueuePush(&window->state->events, &event);
+    }
+  else if (window->keyPressedCallback)
+    {
+      window->keyPressedCallback(key);
+    }
+  else if (window->state->handlers.keyPressed)
+    {
+      BirchWindowHandlers *handlers = &window->state->handlers;
+      handlers->keyPressed(handlers->keyPressedData, key);
+    }
+}
+
+void
+birchWindowDispatchKeyReleased(BirchWindow *window, int key, uint64_t time)
+{
+  BirchEvent event
+      = { .type = BIRCH_EVENT_KEY_RELEASED, .time = time, .key = key };
+
+  birchWindowFlushMotion(window);
+  birchWindowNoteInput(window, time);
+  birchKeyStateSet(&window->state->keys, key, BIRCH_KEY_LAST, false);
+  birchWindowRecord(window, &event);
+  if (birchWindowQueueing(window))
+    {
+      birchEventQueuePush(&window->state->events, &event);
+    }
+  else if (window->keyReleasedCallback)
+    {
+      window->keyReleasedCallback(key);
+    }
+  else if (window->state->handlers.keyReleased)
+    {
+      BirchWindowHandlers *handlers = &window->state->handlers;
+      handlers->keyReleased(handlers->keyReleasedData, key);
+    }
+}
+
+void
+birchWindowDispatchMouseButtonPressed(BirchWindow *window, int button,
+                                      uint64_t time)
+{
+  BirchEvent event = { .type = BIRCH_EVENT_MOUSE_BUTTON_PRESSED,
+                       .time = time,
+                       .button = button };
+
+  birchWindowFlushMotion(window);
+  birchWindowNoteInput(window, time);
+  birchKeyStateSet(&window->state->buttons, button,
+                   BIRCH_MOUSE_BUTTON_COUNT - 1, true);
+  birchWindowRecord(window, &event);
+  if (birchWindowQueueing(window))
+    {
+      birchEventQueuePush(&window->state->events, &event);
+    }
+  else if (window->mouseButtonPressedCallback)
+    {
+      window->mouseButtonPressedCallback(button);
+    }
+  else if (window->state->handlers.mouseButtonPressed)
+    {
+      BirchWindowHandlers *handlers = &window->state->handlers;
+      handlers->mouseButtonPressed(handlers->mouseButtonPressedData, button);
+    }
+}
+
+void
+birchWindowDispatchMouseButtonReleased(BirchWindow *window, int button,
+                                       uint64_t time)
+{
+  BirchEvent event = { .type = BIRCH_EVENT_MOUSE_BUTTON_RELEASED,
+                       .time = time,
+                       .button = button };
+
+  birchWindowFlushMotion(window);
+  birchWindowNoteInput(window, time);
+  birchKeyStateSet(&window->state->buttons, button,
+                   BIRCH_MOUSE_BUTTON_COUNT - 1, false);
+  birchWindowRecord(window, &event);
+  if (birchWindowQueueing(window))
+    {
+      birchEventQueuePush(&window->state->events, &event);
+    }
+  else if (window->mouseButtonReleasedCallback)
+    {
+      window->mouseButtonReleasedCallback(button);
+    }
+  else if (window->state->handlers.mouseButtonReleased)
+    {
+      BirchWindowHandlers *handlers = &window->state->handlers;
+      handlers->mouseButtonReleased(handlers->mouseButtonReleasedData, button);
+    }
+}
+
+void
+birchPollEvents(void)
+{
+  birchPlatformPollEvents();
+  birchPolls++;
+}
+
+static void
+birchWindowPumpEvents(BirchWindow *window)
+{
+  // Events that arrived after birchPollEvents wait for its next call, so
+  // every window of a frame sees the same pass
+  if (window->state->polls == birchPolls)
+    {
+      birchPlatformPollEvents();
+    }
+  window->state->polls = birchPolls;
+
+  BirchReplay *replay = window->state->replay;
+  if (replay && !birchReplayFeed(replay, window))
+    {
+      birchWindowStopReplay(window);
+    }
+}
+
+static void
+birchWindowEndEvents(BirchWindow *window)
+{
+  BirchWindowState *state = window->state;
+
+  birchWindowFlushMotion(window);
+  birchWindowFlushResize(window);
+
+  BirchMouseHistory history = state->mouseHistory;
+  state->mouseHistory = state->recordingHistory;
+  state->recordingHistory = history;
+  state->recordingHistory.count = 0;
+}
+
+void
+birchWindowSetFrameRateLimit(BirchWindow *window, double framesPerSecond)
+{
+  BirchWindowState *state = window->state;
+
+  state->framePeriod
+      = framesPerSecond > 0 ? (uint64_t)(1e9 / framesPerSecond) : 0;
+  state->nextFrame = 0;
+}
+
+static void
+birchWindowEndFrame(BirchWindow *window)
+{
+  BirchWindowState *state = window->state;
+
+  if (state->framePeriod)
+    {
+      uint64_t now = birchClockNow();
+      if (!state->nextFrame || now > state->nextFrame + state->framePeriod)
+        {
+          // First frame, or more than a frame late: restart the schedule
+          state->nextFrame = now + state->framePeriod;
+        }
+      else
+        {
+          BIRCH_PROFILE_BEGIN(limiter, "frame limiter");
+          birchClockSleepUntil(state->nextFrame);
+          BIRCH_PROFILE_END(limiter);
+          state->nextFrame += state->framePeriod;
+        }
+    }
+
+  birchFrameTimesRecord(&state->updateTimes, birchClockNow());
+
+  BirchHeapCounters counters;
+  birchHeapGetCounters(&counters);
+  state->allocationStats = (BirchAllocationStats){
+    .frameAllocations = counters.allocations - state->frameStart.allocations,
+    .frameBytes = counters.bytes - state->frameStart.bytes,
+    .arenaBytes = state->arena.used,
+    .arenaCapacity = state->arena.capacity,
+  };
+  state->frameStart = counters;
+  birchArenaReset(&state->arena);
+}
+
+void *
+birchWindowFrameAllocate(BirchWindow *window, size_t size)
+{
+  return birchArenaAllocate(&window->state->arena, size);
+}
+
+void
+birchWindowGetAllocationStats(BirchWindow *window,
+                              BirchAllocationStats *stats)
+{
+  BirchHeapCounters counters;
+  birchHeapGetCounters(&counters);
+  *stats = window->state->allocationStats;
+  stats->totalAllocations = counters.allocations;
+  stats->liveAllocations = counters.live;
+}
+
+static void
+birchFrameTimesGetStats(const BirchFrameTimes *times, BirchFrameStats *stats)
+{
+  *stats = (BirchFrameStats){ .frames = times->count };
+  if (!times->count)
+    {
+      return;
+    }
+
+  double sum = 0;
+  stats->minFrameTime = INFINITY;
+  for (unsigned int i = 0; i < times->count; i++)
+    {
+      double frameTime = times->times[i] / 1e9;
+      sum += frameTime;
+      stats->minFrameTime = fmin(stats->minFrameTime, frameTime);
+      stats->maxFrameTime = fmax(stats->maxFrameTime, frameTime);
+    }
+  stats->frameTime = sum / times->count;
+
+  double variance = 0;
+  for (unsigned int i = 0; i < times->count; i++)
+    {
+      double deviation = times->times[i] / 1e9 - stats->frameTime;
+      variance += deviation * deviation;
+    }
+  stats->jitter = sqrt(variance / times->count);
+}
+
+void
+birchWindowGetFrameStats(BirchWindow *window, BirchFrameStats *stats)
+{
+  birchFrameTimesGetStats(&window->state->updateTimes, stats);
+}
+
+void
+birchWindowGetPresentStats(BirchWindow *window, BirchFrameStats *stats)
+{
+  birchWindowLockRender(window);
+  birchFrameTimesGetStats(&window->state->presentTimes, stats);
+  birchWindowUnlockRender(window);
+}
+
+static int
+birchCompareTimes(const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *)a;
+  uint64_t y = *(const uint64_t *)b;
+
+  return (x > y) - (x < y);
+}
+
+void
+birchWindowGetLatencyStats(BirchWindow *window, BirchLatencyStats *stats)
+{
+  uint64_t times[BIRCH_LATENCY_FRAMES];
+
+  birchWindowLockRender(window);
+  unsigned int count = window->state->latencies.count;
+  memcpy(times, window->state->latencies.times, count * sizeof(uint64_t));
+  birchWindowUnlockRender(window);
+
+  *stats = (BirchLatencyStats){ .frames = count };
+  if (!count)
+    {
+      return;
+    }
+  qsort(times, count, sizeof(uint64_t), birchCompareTimes);
+  // Nearest rank
+  stats->p50 = times[(count - 1) / 2] / 1e9;
+  stats->p99 = times[(count * 99 + 99) / 100 - 1] / 1e9;
+  stats->max = times[count - 1] / 1e9;
+}
+
+bool
+birchWindowSetRenderThread(BirchWindow *window, unsigned int framesAhead)
+{
+  BirchRenderThread *thread = &window->state->renderThread;
+
+  if (!framesAhead)
+    {
+      birchRenderThreadStop(thread);
+      return true;
+    }
+  if (framesAhead > BIRCH_MAX_FRAMES_AHEAD)
+    {
+      framesAhead = BIRCH_MAX_FRAMES_AHEAD;
+    }
+  return birchRenderThreadStart(thread, window, framesAhead);
+}
+
+void
+birchWindowFinishFrames(BirchWindow *window)
+{
+  birchRenderThreadFinish(&window->state->renderThread);
+}
+
+void
+birchWindowUpdate(BirchWindow *window)
+{
+  BirchWindowState *state = window->state;
+  BIRCH_PROFILE_BEGIN(update, "birchWindowUpdate");
+
+  BIRCH_PROFILE_BEGIN(pump, "event pump");
+  birchKeyStateClearEdges(&state->keys);
+  birchKeyStateClearEdges(&state->buttons);
+  birchWindowPumpEvents(window);
+  birchWindowEndEvents(window);
+  if (state->recorder)
+    {
+      birchRecorderWriteFrame(state->recorder, birchClockNow());
+    }
+  BIRCH_PROFILE_END(pump);
+
+  // The frame was drawn after the last update delivered its events, the
+  // events of this one show up in the next frame
+  state->drawList.inputTime = state->drawnInput;
+  state->drawnInput = state->updateInput;
+  state->updateInput = 0;
+
+  // Start recording the next frame
+  state->atlas.frame++;
+  state->textStats.glyphs = state->glyphsRecorded;
+  state->glyphsRecorded = 0;
+  if (state->renderThread.capacity)
+    {
+      birchRenderThreadSubmit(&state->renderThread, &state->drawList);
+    }
+  else
+    {
+      birchWindowRenderFrame(window, &state->drawList);
+      birchDrawListReset(&state->drawList);
+    }
+
+  BIRCH_PROFILE_END(update);
+  birchWindowEndFrame(window);
 }
@@ -0,0 +1,248 @@
+// Copyright (C) 2024 Devin Rockwell
+//
+// This file is part of birch.
+//
+// birch is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// birch is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with birch.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BIRCH_WINDOW_INTERNAL_H
+#define BIRCH_WINDOW_INTERNAL_H
+
+#include "allocator.h"
+#include "arena.h"
+#include "atlas.h"
+#include "damage.h"
+#include "drawList.h"
+#include "eventQueue.h"
+#include "heap.h"
+#include "renderThread.h"
+#include "replayInternal.h"
+#include "stream.h"
+#include "text.h"
+#include "thread.h"
+#include "window.h"
+
+// Shared between the platform backends. Platform code fills in the
+// BirchWindow base with birchWindowInitBase and reports every input event
+// through the birchWindowDispatch* functions instead of calling the user
+// callbacks directly, so there is a single place where events enter birch.
+// Depending on the window's event mode they call the callbacks or queue the
+// event for birchWindowPollEvents. birchWindowUpdate is the same for every
+// backend: it pumps events and hands the frame to birchPlatformRender,
+// either directly or through the window's render thread.
+
+typedef struct
+{
+    BirchMouseSample *samples;
+    size_t count;
+    size_t capacity;
+} BirchMouseHistory;
+
+#define BIRCH_FRAME_STATS_FRAMES 120
+
+#define BIRCH_LATENCY_FRAMES 1024
+
+// Callbacks that take user data, each set instead of the matching
+// BirchWindow callback
+typedef struct
+{
+    void (*mouseMoved)(void *userData, int x, int y);
+    void *mouseMovedData;
+    void (*resize)(void *userData, int width, int height);
+    void *resizeData;
+    void (*keyPressed)(void *userData, int key);
+    void *keyPressedData;
+    void (*keyReleased)(void *userData, int key);
+    void *keyReleasedData;
+    void (*mouseButtonPressed)(void *userData, int button);
+    void *mouseButtonPressedData;
+    void (*mouseButtonReleased)(void *userData, int button);
+    void *mouseButtonReleasedData;
+} BirchWindowHandlers;
+
+#define BIRCH_KEY_WORDS (BIRCH_KEY_LAST / 64 + 1)
+
+// One bit per BIRCH_KEY_* code, or per BIRCH_MOUSE_BUTTON_* code in the
+// first word. The edges are cleared when an update starts delivering events.
+typedef struct
+{
+    uint64_t down[BIRCH_KEY_WORDS];
+    uint64_t pressed[BIRCH_KEY_WORDS];
+    uint64_t released[BIRCH_KEY_WORDS];
+} BirchKeyState;
+
+// Ring of the last input-to-present latencies in nanoseconds
+typedef struct
+{
+    uint64_t times[BIRCH_LATENCY_FRAMES];
+    unsigned int count;
+    unsigned int index;
+} BirchLatencyTimes;
+
+// Ring of the last frame times, in birchClockNow nanoseconds
+typedef struct
+{
+    uint64_t times[BIRCH_FRAME_STATS_FRAMES];
+    unsigned int count;
+    unsigned int index;
+    // when the last frame ended, 0 before the first
+    uint64_t last;
+} BirchFrameTimes;
+
+struct BirchWindowState
+{
+    BirchStream stream;
+    // recorded by the birchDraw* functions during the frame
+    BirchDrawList drawList;
+    // the last frame submitted for rendering, kept so backends can redraw it
+    BirchDrawList submitted;
+    BirchDrawStats drawStats;
+    // the pages of the images the window draws
+    BirchAtlas atlas;
+    // the fonts of the window, whose glyphs are images in the atlas, and
+    // the glyphs drawn so far this frame
+    BirchFont *fonts;
+    BirchTextStats textStats;
+    size_t glyphsRecorded;
+    // what the last update redrew and presented
+    BirchDamage damage;
+    // hash of the last frame for birchWindowFrameChanged, 0 to redraw
+    uint64_t lastFrame;
+    BirchEventMode eventMode;
+    BirchEventQueue events;
+    BirchWindowHandlers handlers;
+    // the last size reported during the update in progress, delivered when
+    // it ends, and how many sizes were dropped for a later one
+    bool resizePending;
+    BirchEvent resize;
+    size_t coalescedResizes;
+    // when the event being delivered was reported, and the oldest event
+    // of the current update and of the last one, 0 if there were none
+    uint64_t eventTime;
+    uint64_t updateInput;
+    uint64_t drawnInput;
+    // input logs being written and replayed, NULL when not in use
+    BirchRecorder *recorder;
+    BirchReplay *replay;
+
+    bool coalesceMouse;
+    // the last coalesced motion, not yet delivered
+    bool motionPending;
+    BirchMouseSample motion;
+    // samples of the update in progress, and of the last finished one
+    BirchMouseHistory recordingHistory;
+    BirchMouseHistory mouseHistory;
+    // what is held, and what changed during the last update
+    BirchKeyState keys;
+    BirchKeyState buttons;
+
+    // frame limiter, in birchClockNow nanoseconds
+    uint64_t framePeriod;
+    uint64_t nextFrame;
+    // between the ends of updates, and between presents
+    BirchFrameTimes updateTimes;
+    BirchFrameTimes presentTimes;
+    // written by the renderer
+    BirchLatencyTimes latencies;
+
+    // transient memory of the frame, reset at the end of every update
+    BirchArena arena;
+    // the heap counters when the frame started, and what the last frame
+    // allocated
+    BirchHeapCounters frameStart;
+    BirchAllocationStats allocationStats;
+
+    // birchPollEvents calls as of the last update
+    uint64_t polls;
+
+    // Held by whichever thread renders while it renders a frame. The
+    // updating thread takes it to change what birchPlatformRender reads:
+    // the size of the window, the backend's framebuffers, `lastFrame`, and
+    // to read the statistics the renderer writes.
+    BirchMutex renderLock;
+    BirchRenderThread renderThread;
+    // scratch memory of the renderer, reset after every frame it renders
+    BirchArena renderArena;
+};
+
+bool birchWindowInitBase(
+    BirchWindow *window,
+    unsigned int width,
+    unsigned int height,
+    const char *title
+);
+void birchWindowFreeBase(BirchWindow *window);
+
+/// @brief Implemented by every backend: render `state->submitted` and
+/// present it. Called with `state->renderLock` held, on the updating thread
+/// or on the window's render thread.
+void birchPlatformRender(BirchWindow *window);
+
+/// @brief Make `frame` the submitted frame, handing the previous one back
+/// in its place, and render it
+void birchWindowRenderFrame(BirchWindow *window, BirchDrawList *frame);
+
+void birchWindowLockRender(BirchWindow *window);
+void birchWindowUnlockRender(BirchWindow *window);
+
+/// @brief Flatten the submitted draws into `out`, which must have room for
+/// `window->state->submitted.vertexCount` vertices
+/// @return the number of draw calls in `window->state->submitted.calls`
+size_t birchWindowFlattenDraws(BirchWindow *window, Vertex *out);
+
+/// @brief For backends that redraw whole frames: compare the submitted
+/// draws to the last frame and damage all or nothing. Reset
+/// `state->lastFrame` when the OS loses the window contents. Call with the
+/// atlas lock held, after flushing it.
+/// @return true if the frame has to be redrawn
+bool birchWindowFrameChanged(
+    BirchWindow *window,
+    const VertexUniforms *uniforms,
+    int width,
+    int height
+);
+
+// Every event carries when the OS reported it, in birchClockNow
+// nanoseconds: the OS event time converted where it has one, otherwise
+// birchClockNow when it was received.
+
+void birchWindowDispatchMouseMoved(
+    BirchWindow *window,
+    float x,
+    float y,
+    uint64_t time
+);
+void birchWindowDispatchResize(
+    BirchWindow *window,
+    int width,
+    int height,
+    uint64_t time
+);
+void birchWindowDispatchKeyPressed(BirchWindow *window, int key, uint64_t time);
+void birchWindowDispatchKeyReleased(
+    BirchWindow *window,
+    int key,
+    uint64_t time
+);
+void birchWindowDispatchMouseButtonPressed(
+    BirchWindow *window,
+    int button,
+    uint64_t time
+);
+void birchWindowDispatchMouseButtonReleased(
+    BirchWindow *window,
+    int button,
+    uint64_t time
+);
+
+#endif